@@ -0,0 +1,169 @@
+from argparse import ArgumentParser
+from http.server import HTTPServer, BaseHTTPRequestHandler
+from socketserver import ThreadingMixIn
+import json
+import os
+import socket
+import threading
+import time
+import boto3
+import botocore
+from aws_kit_common import *
+
+# Final update states reported by the firmware in state.reported.wincOta.state
+OTA_FINAL_STATES = ['succeeded', 'rolled back', 'failed']
+
+
+class OtaHTTPServer(ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+
+
+class OtaRequestHandler(BaseHTTPRequestHandler):
+    """Serves the OTA image and times every download of it"""
+
+    def do_GET(self):
+        server = self.server
+        if self.path.lstrip('/') != os.path.basename(server.image_file):
+            self.send_error(404)
+            return
+
+        start = time.time()
+        print('    %7.1f s: %s started the download' % (start - server.start_time, self.client_address[0]))
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/octet-stream')
+        self.send_header('Content-Length', str(len(server.image)))
+        self.end_headers()
+        self.wfile.write(server.image)
+        elapsed = time.time() - start
+        server.downloads.append({'start': start - server.start_time, 'seconds': elapsed})
+        print('    %7.1f s: %s downloaded %d bytes in %.2f s (%.1f KB/s)' % (
+            time.time() - server.start_time, self.client_address[0], len(server.image), elapsed,
+            len(server.image) / 1024.0 / max(elapsed, 0.001)))
+
+    def log_message(self, format, *args):
+        # The downloads are already logged with their timing
+        pass
+
+
+def get_local_address():
+    # The address of the interface that routes to the internet, the board must be on the same network
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        s.connect(('8.8.8.8', 80))
+        return s.getsockname()[0]
+    finally:
+        s.close()
+
+
+def aws_winc_ota(image_file, port=8000, host=None, aws_profile='default', timeout=900):
+    # Read kit info for the device serial number, which is used as the thing name
+    kit_info = read_kit_info()
+    if 'thing_name' not in kit_info:
+        raise AWSZTKitError('thing_name not found in %s. Have you run kit_provision yet?' % KIT_INFO_FILENAME)
+
+    # Create an AWS session with the credentials from the specified profile
+    print('\nInitializing AWS IoTDataPlane client')
+    try:
+        aws_session = boto3.session.Session(profile_name=aws_profile)
+    except botocore.exceptions.ProfileNotFound as e:
+        if aws_profile == 'default':
+            raise AWSZTKitError('AWS profile not found. Please make sure you have the AWS CLI installed and run "aws configure" to setup profile.')
+        else:
+            raise AWSZTKitError('AWS profile not found. Please make sure you have the AWS CLI installed and run "aws configure --profile %s" to setup profile.' % aws_profile)
+    aws_iot_data = aws_session.client('iot-data')
+    print('    Profile:  %s' % aws_session.profile_name)
+    print('    Region:   %s' % aws_session.region_name)
+
+    # Serve the image from a local HTTP server
+    server = OtaHTTPServer(('', port), OtaRequestHandler)
+    with open(image_file, 'rb') as f:
+        server.image = f.read()
+    server.image_file = image_file
+    server.downloads = []
+    server.start_time = time.time()
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+
+    url = 'http://%s:%d/%s' % (host or get_local_address(), port, os.path.basename(image_file))
+    print('\nServing the WINC1500 OTA Image')
+    print('    Image: %s (%d bytes)' % (image_file, len(server.image)))
+    print('    URL:   %s' % url)
+
+    # The board picks the URL up from the shadow delta
+    print('\nRequesting the update through the thing shadow')
+    msg = {'state': {'desired': {'wincOta': {'url': url}}}}
+    aws_iot_data.update_thing_shadow(thingName=kit_info['thing_name'], payload=json.dumps(msg))
+
+    report = {}
+    ota_state = None
+    try:
+        while time.time() - server.start_time < timeout:
+            time.sleep(1)
+            response = aws_iot_data.get_thing_shadow(thingName=kit_info['thing_name'])
+            shadow = json.loads(response['payload'].read().decode('ascii'))
+            report = shadow['state'].get('reported', {}).get('wincOta', {})
+            if report.get('url') != url or report.get('state') == ota_state:
+                continue
+            ota_state = report['state']
+            print('    %7.1f s: %s (firmware %s, status %s)' % (
+                time.time() - server.start_time, ota_state, report.get('firmware'), report.get('status')))
+            if ota_state in OTA_FINAL_STATES:
+                break
+        else:
+            raise AWSZTKitError('The board did not finish the update within %d seconds' % timeout)
+    finally:
+        # Stop requesting the update
+        msg = {'state': {'desired': {'wincOta': None}}}
+        aws_iot_data.update_thing_shadow(thingName=kit_info['thing_name'], payload=json.dumps(msg))
+        server.shutdown()
+
+    print('\nWINC1500 OTA Timing')
+    if server.downloads:
+        download = server.downloads[-1]
+        print('    Host: download started at %.1f s, served in %.2f s (%.1f KB/s)' % (
+            download['start'], download['seconds'],
+            len(server.image) / 1024.0 / max(download['seconds'], 0.001)))
+    print('    Board: download %s ms, switch %s ms, restart to AWS IoT %s ms, total %s ms' % (
+        report.get('downloadMs'), report.get('switchMs'), report.get('restartMs'), report.get('totalMs')))
+    print('    Result: %s, WINC1500 firmware %s' % (report.get('state'), report.get('firmware')))
+
+
+if __name__ == '__main__':
+    # Create argument parser to document script use
+    parser = ArgumentParser(description='Update the WINC1500 firmware of the thing from a local HTTP server')
+    parser.add_argument(
+        '--image',
+        dest='image',
+        required=True,
+        metavar='file',
+        help='WINC1500 OTA image (use a new file name for every update)')
+    parser.add_argument(
+        '--port',
+        dest='port',
+        type=int,
+        default=8000,
+        help='Local HTTP server port (default 8000)')
+    parser.add_argument(
+        '--host',
+        dest='host',
+        default=None,
+        help='Address of this computer as seen by the board (detected if omitted)')
+    parser.add_argument(
+        '--timeout',
+        dest='timeout',
+        type=int,
+        default=900,
+        help='Seconds to wait for the update to finish (default 900)')
+    parser.add_argument(
+        '--profile',
+        dest='profile',
+        nargs='?',
+        default='default',
+        metavar='name',
+        help='AWS profile name (uses default if omitted)')
+    args = parser.parse_args()
+
+    try:
+        aws_winc_ota(args.image, port=args.port, host=args.host, aws_profile=args.profile, timeout=args.timeout)
+    except AWSZTKitError as e:
+        # Capture kit errors and just display message instead of full stack trace
+        print(e)
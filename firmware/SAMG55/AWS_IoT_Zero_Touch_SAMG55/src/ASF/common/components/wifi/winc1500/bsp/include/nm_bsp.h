@@ -242,6 +242,23 @@ void nm_bsp_reset(void);
 void nm_bsp_sleep(uint32 u32TimeMsec);
 /**@}*/
 
+ 
+/** @defgroup NmBspGetTimeFn nm_bsp_get_time_ms
+*     @ingroup BSPAPI
+*     Free running host time in units of milliseconds.\n
+*    This function is used by the HIF Layer to account for the time the WINC1500 is held awake.
+*/
+/**@{*/
+/*!
+ * @fn           uint32 nm_bsp_get_time_ms(void);
+ * @brief   	 Returns a free running millisecond counter.
+ *				 The counter only has to be monotonic between calls, it may wrap around at 2^32.
+ * @note         Implementation of this function is host dependent.
+ * @return       The current host time in milliseconds
+ */
+uint32 nm_bsp_get_time_ms(void);
+/**@}*/
+
   
 /** @defgroup NmBspRegisterFn nm_bsp_register_isr
 *     @ingroup BSPAPI
@@ -266,6 +283,25 @@ void nm_bsp_sleep(uint32 u32TimeMsec);
 void nm_bsp_register_isr(tpfNmBspIsr pfIsr);
 /**@}*/
 
+
+/** @defgroup NmBspRegisterAppFn nm_bsp_register_app_isr
+*     @ingroup BSPAPI
+*   Register an application handler that is called from the WINC interrupt, after the HIF layer ISR.
+*/
+/**@{*/
+/*!
+ * @fn           void nm_bsp_register_app_isr(tpfNmBspIsr);
+ * @param [in]   tpfNmBspIsr  pfIsr
+ *               Pointer to the application handler, NULL to remove it.
+ * @brief        Lets an RTOS application wake the task that calls m2m_wifi_handle_events, instead of
+ *				 polling it. The handler runs in interrupt context.
+ * @note         Must be called after nm_bsp_init, which clears the handlers.
+ * @see          tpfNmBspIsr
+ * @return       None
+ */
+void nm_bsp_register_app_isr(tpfNmBspIsr pfIsr);
+/**@}*/
+
   
 /** @defgroup NmBspInterruptCtrl nm_bsp_interrupt_ctrl
 *     @ingroup BSPAPI
@@ -45,6 +45,7 @@
 #include "conf_winc.h"
 
 static tpfNmBspIsr gpfIsr;
+static tpfNmBspIsr gpfAppIsr;
 
 static void chip_isr(uint32_t id, uint32_t mask)
 {
@@ -52,6 +53,9 @@ static void chip_isr(uint32_t id, uint32_t mask)
 		if (gpfIsr) {
 			gpfIsr();
 		}
+		if (gpfAppIsr) {
+			gpfAppIsr();
+		}
 	}
 }
 
@@ -76,6 +80,7 @@ static void init_chip_pins(void)
 sint8 nm_bsp_init(void)
 {
 	gpfIsr = NULL;
+	gpfAppIsr = NULL;
 
 	/* Initialize chip IOs. */
 	init_chip_pins();
@@ -124,14 +129,39 @@ void nm_bsp_reset(void)
 *	@brief	Sleep in units of mSec
 *	@param[IN]	u32TimeMsec
 *				Time in milliseconds
+*	@note	Once the FreeRTOS scheduler is running the calling task is blocked
+*			so the other tasks keep running. The delay is rounded up to whole
+*			ticks plus one, since the current tick is already partially elapsed,
+*			so the WINC never gets less time than requested. Before the
+*			scheduler starts, or while it is suspended, this busy-waits.
 */
 void nm_bsp_sleep(uint32 u32TimeMsec)
 {
+	if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+		TickType_t xTicks = (TickType_t)((u32TimeMsec + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+
+		if (xTicks > 0) {
+			vTaskDelay(xTicks + 1);
+		}
+		return;
+	}
+
 	while(u32TimeMsec--) {
 		delay_ms(1);
 	}
 }
 
+/*
+*	@fn		nm_bsp_get_time_ms
+*	@brief	Free running time in units of mSec
+*	@note	Based on the FreeRTOS tick count, reads zero until the scheduler
+*			is started.
+*/
+uint32 nm_bsp_get_time_ms(void)
+{
+	return (uint32)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
 /*
 *	@fn		nm_bsp_register_isr
 *	@brief	Register interrupt service routine
@@ -156,6 +186,17 @@ void nm_bsp_register_isr(tpfNmBspIsr pfIsr)
 			CONF_WINC_SPI_INT_PRIORITY);
 }
 
+/*
+*	@fn		nm_bsp_register_app_isr
+*	@brief	Register an application handler called after the driver ISR
+*	@param[IN]	pfIsr
+*				Pointer to the application handler
+*/
+void nm_bsp_register_app_isr(tpfNmBspIsr pfIsr)
+{
+	gpfAppIsr = pfIsr;
+}
+
 /*
 *	@fn		nm_bsp_interrupt_ctrl
 *	@brief	Enable/Disable interrupts
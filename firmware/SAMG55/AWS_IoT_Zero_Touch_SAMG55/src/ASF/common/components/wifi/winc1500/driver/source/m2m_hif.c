@@ -80,6 +80,10 @@ typedef struct {
 	tpfHifCallBack pfHifCb;
 	tpfHifCallBack pfCryptoCb;
 	tpfHifCallBack pfSslCb;
+	uint32 u32WakeCnt;
+	uint32 u32SleepCnt;
+	uint32 u32AwakeStart;
+	uint32 u32AwakeMs;
 }tstrHifContext;
 
 volatile tstrHifContext gstrHifCxt;
@@ -153,6 +157,8 @@ sint8 hif_chip_wake(void)
 		{
 			ret = chip_wake();
 			if(ret != M2M_SUCCESS)goto ERR1;
+			gstrHifCxt.u32WakeCnt++;
+			gstrHifCxt.u32AwakeStart = nm_bsp_get_time_ms();
 		}
 		else
 		{
@@ -196,6 +202,33 @@ uint8 hif_get_sleep_mode(void)
 	return gstrHifCxt.u8ChipMode;
 }
 
+/*!
+@fn	\
+	NMI_API void hif_get_sleep_stats(tstrHifSleepStats *pstrStats);
+
+@brief
+	Get the number of host initiated chip wake/sleep transitions and the time the chip was held awake.
+
+@param [out]	pstrStats
+				Pointer to the structure receiving the statistics.
+*/
+
+void hif_get_sleep_stats(tstrHifSleepStats *pstrStats)
+{
+	if(pstrStats == NULL)
+	{
+		return;
+	}
+	pstrStats->u32WakeCnt = gstrHifCxt.u32WakeCnt;
+	pstrStats->u32SleepCnt = gstrHifCxt.u32SleepCnt;
+	pstrStats->u32AwakeMs = gstrHifCxt.u32AwakeMs;
+	if(gstrHifCxt.u8ChipSleep != 0 && gstrHifCxt.u8ChipMode != M2M_NO_PS)
+	{
+		/* Account for the current awake period as well */
+		pstrStats->u32AwakeMs += nm_bsp_get_time_ms() - gstrHifCxt.u32AwakeStart;
+	}
+}
+
 /**
 *	@fn		NMI_API sint8 hif_chip_sleep_sc(void);
 *	@brief	To clear the chip sleep but keep the chip sleep
@@ -231,6 +264,8 @@ sint8 hif_chip_sleep(void)
 		{
 			ret = chip_sleep();
 			if(ret != M2M_SUCCESS)goto ERR1;
+			gstrHifCxt.u32SleepCnt++;
+			gstrHifCxt.u32AwakeMs += nm_bsp_get_time_ms() - gstrHifCxt.u32AwakeStart;
 
 		}
 		else
@@ -73,6 +73,17 @@ typedef struct
     uint16  u16Length;	/*!< Payload length */
 }tstrHifHdr;
 
+/**
+*	@struct		tstrHifSleepStats
+*	@brief		Structure to hold the HIF power save statistics
+*/
+typedef struct
+{
+    uint32  u32WakeCnt;		/*!< Number of host initiated chip wakes */
+    uint32  u32SleepCnt;	/*!< Number of host initiated chip sleeps */
+    uint32  u32AwakeMs;		/*!< Time the host held the chip awake in ms */
+}tstrHifSleepStats;
+
 #ifdef __cplusplus
      extern "C" {
 #endif
@@ -215,6 +226,19 @@ NMI_API void hif_set_sleep_mode(uint8 u8Pstype);
 */
 
 NMI_API uint8 hif_get_sleep_mode(void);
+/*!
+@fn	\
+	NMI_API void hif_get_sleep_stats(tstrHifSleepStats *pstrStats);
+
+@brief
+	Get the number of host initiated chip wake/sleep transitions and the time the chip was held awake.
+	The statistics are only collected while a power save mode is enabled and are cleared by hif_init.
+
+@param [out]	pstrStats
+				Pointer to the structure receiving the statistics.
+*/
+
+NMI_API void hif_get_sleep_stats(tstrHifSleepStats *pstrStats);
 
 #ifdef CORTUS_APP
 /**
@@ -70,6 +70,7 @@ extern "C" {
 /* Low level time limit of I2C Fast Mode. */
 #define LOW_LEVEL_TIME_LIMIT 384000
 #define I2C_FAST_MODE_SPEED  400000
+#define I2C_FAST_MODE_PLUS_SPEED 1000000
 #define TWI_CLK_DIVIDER      2
 #if SAMG55
 #define TWI_CLK_CALC_ARGU    3
@@ -147,7 +148,7 @@ uint32_t twi_master_init(Twi *p_twi, const twi_options_t *p_opt)
  * \brief Set the I2C bus speed in conjunction with the clock frequency.
  *
  * \param p_twi Pointer to a TWI instance.
- * \param ul_speed The desired I2C bus speed (in Hz).
+ * \param ul_speed The desired I2C bus speed (in Hz), up to 1 MHz (Fast Mode Plus).
  * \param ul_mck Main clock of the device (in Hz).
  *
  * \retval PASS New speed setting is accepted.
@@ -159,12 +160,13 @@ uint32_t twi_set_speed(Twi *p_twi, uint32_t ul_speed, uint32_t ul_mck)
 	uint32_t c_lh_div;
 	uint32_t cldiv, chdiv;
 
-	if (ul_speed > I2C_FAST_MODE_SPEED) {
+	if (ul_speed > I2C_FAST_MODE_PLUS_SPEED) {
 		return FAIL;
 	}
 
-	/* Low level time not less than 1.3us of I2C Fast Mode. */
-	if (ul_speed > LOW_LEVEL_TIME_LIMIT) {
+	/* Low level time not less than 1.3us of I2C Fast Mode. The 0.5us of
+	 * Fast Mode Plus is met by the 50% duty cycle below up to 1 MHz. */
+	if ((ul_speed > LOW_LEVEL_TIME_LIMIT) && (ul_speed <= I2C_FAST_MODE_SPEED)) {
 		/* Low level of time fixed for 1.3us. */
 		cldiv = ul_mck / (LOW_LEVEL_TIME_LIMIT * TWI_CLK_DIVIDER) - TWI_CLK_CALC_ARGU;
 		chdiv = ul_mck / ((ul_speed + (ul_speed - LOW_LEVEL_TIME_LIMIT)) * TWI_CLK_DIVIDER) - TWI_CLK_CALC_ARGU;
@@ -0,0 +1,162 @@
+/**
+ * \file
+ * \brief AWS IoT Zero Touch Demo Task Events
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include "asf.h"
+#include "aws_event.h"
+
+
+// Global variables
+QueueHandle_t g_provisioning_event_queue = NULL;
+QueueHandle_t g_aws_wifi_event_queue = NULL;
+
+//! Number of events lost because the task queue was full
+static volatile uint32_t g_aws_event_dropped_count = 0;
+
+
+/**
+ * \brief Creates the task event queues
+ *
+ * \note Must be called before the interrupts that post events are enabled
+ *       and before the FreeRTOS scheduler is started.
+ */
+void aws_event_init(void)
+{
+    g_provisioning_event_queue = xQueueCreate(AWS_EVENT_QUEUE_LENGTH, sizeof(struct aws_event));
+    g_aws_wifi_event_queue     = xQueueCreate(AWS_EVENT_QUEUE_LENGTH, sizeof(struct aws_event));
+}
+
+/**
+ * \brief Posts an event to a task from task context
+ *
+ * The caller never blocks, so a task can also post to its own queue from the
+ * WINC1500 callbacks. If the queue is full the event is dropped and counted.
+ *
+ * \param[in] queue                 The event queue of the receiving task
+ * \param[in] type                  The event type
+ * \param[in] data                  Event specific data
+ *
+ * \return Whether the event was queued
+ */
+bool aws_event_post(QueueHandle_t queue, enum aws_event_type type, uint32_t data)
+{
+    struct aws_event event;
+
+    if (queue == NULL)
+    {
+        return false;
+    }
+
+    event.type = (uint32_t)type;
+    event.data = data;
+
+    if (xQueueSendToBack(queue, &event, 0) != pdPASS)
+    {
+        taskENTER_CRITICAL();
+        g_aws_event_dropped_count++;
+        taskEXIT_CRITICAL();
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Posts an event to a task from an interrupt
+ *
+ * The interrupt priority must not be above
+ * configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY. If the receiving task has a
+ * higher priority than the interrupted one, the context switch happens when
+ * the interrupt returns.
+ *
+ * \param[in] queue                 The event queue of the receiving task
+ * \param[in] type                  The event type
+ * \param[in] data                  Event specific data
+ *
+ * \return Whether the event was queued
+ */
+bool aws_event_post_from_isr(QueueHandle_t queue, enum aws_event_type type, uint32_t data)
+{
+    struct aws_event event;
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    if (queue == NULL)
+    {
+        return false;
+    }
+
+    event.type = (uint32_t)type;
+    event.data = data;
+
+    if (xQueueSendToBackFromISR(queue, &event, &higher_priority_task_woken) != pdPASS)
+    {
+        g_aws_event_dropped_count++;
+
+        return false;
+    }
+
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+
+    return true;
+}
+
+/**
+ * \brief Blocks the calling task until an event arrives
+ *
+ * \param[in]  queue                The event queue of the calling task
+ * \param[out] event                The received event, AWS_EVENT_TIMEOUT on timeout
+ * \param[in]  timeout_ms           The longest time to wait, portMAX_DELAY to wait forever
+ *
+ * \return Whether an event was received
+ */
+bool aws_event_wait(QueueHandle_t queue, struct aws_event *event, uint32_t timeout_ms)
+{
+    TickType_t timeout_ticks = portMAX_DELAY;
+
+    if (timeout_ms != portMAX_DELAY)
+    {
+        timeout_ticks = (TickType_t)((timeout_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+    }
+
+    if (xQueueReceive(queue, event, timeout_ticks) != pdPASS)
+    {
+        event->type = AWS_EVENT_TIMEOUT;
+        event->data = 0;
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Gets the number of events dropped because a task queue was full
+ */
+uint32_t aws_event_get_dropped_count(void)
+{
+    return g_aws_event_dropped_count;
+}
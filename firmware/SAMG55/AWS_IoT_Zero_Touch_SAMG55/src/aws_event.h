@@ -0,0 +1,82 @@
+/**
+ * \file
+ * \brief AWS IoT Zero Touch Demo Task Events
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef AWS_EVENT_H
+#define AWS_EVENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "asf.h"
+
+// Defines
+#define AWS_EVENT_QUEUE_LENGTH  (16)  // Number of events each task queue can hold
+
+/**
+ * \brief The events posted to the AWS IoT Zero Touch Demo tasks
+ */
+enum aws_event_type
+{
+    AWS_EVENT_TIMEOUT               = 0,   //! No event arrived before the task timeout
+    
+    // Provisioning Task Events
+    AWS_EVENT_USB_MESSAGE           = 1,   //! A Kit Protocol message was received over USB
+    AWS_EVENT_SW0_PRESSED           = 2,   //! SW0 was pressed
+    
+    // AWS WIFI Task Events
+    AWS_EVENT_CRYPTO_READY          = 16,  //! The ATECCx08A was initialized
+    AWS_EVENT_PROVISIONED           = 17,  //! The ATECCx08A holds valid credentials
+    AWS_EVENT_PROVISION_RESET       = 18,  //! The ATECCx08A credentials were reset
+    AWS_EVENT_WINC_INTERRUPT        = 19,  //! The WINC1500 has events pending
+    AWS_EVENT_WIFI_DISCONNECTED     = 20,  //! The WINC1500 is disconnected from the access point
+    AWS_EVENT_AWS_CONNECT_FAILURE   = 21,  //! The AWS IoT hostname lookup or connect failed
+    AWS_EVENT_SOCKET_CONNECTED      = 22,  //! The socket in the data is connected
+    AWS_EVENT_SOCKET_RECEIVED       = 23,  //! The socket in the data received data
+    AWS_EVENT_SOCKET_ERROR          = 24,  //! The socket in the data failed
+    AWS_EVENT_PUSHBUTTON            = 25   //! OLED1 pushbutton presses were queued
+};
+
+struct aws_event
+{
+    uint32_t type;  //! The aws_event_type
+    uint32_t data;  //! Event specific data
+};
+
+// Externs
+extern QueueHandle_t g_provisioning_event_queue;  //! Events for the provisioning task
+extern QueueHandle_t g_aws_wifi_event_queue;      //! Events for the AWS WIFI task
+
+
+void aws_event_init(void);
+
+bool aws_event_post(QueueHandle_t queue, enum aws_event_type type, uint32_t data);
+bool aws_event_post_from_isr(QueueHandle_t queue, enum aws_event_type type, uint32_t data);
+bool aws_event_wait(QueueHandle_t queue, struct aws_event *event, uint32_t timeout_ms);
+
+uint32_t aws_event_get_dropped_count(void);
+
+#endif // AWS_EVENT_H
@@ -0,0 +1,192 @@
+/**
+ * \file
+ * \brief AWS IoT MQTT Adaptive Keep Alive
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include "asf.h"
+#include "aws_keepalive.h"
+#include "console.h"
+
+// Global variables
+static uint32_t g_keepalive_max_s = 0;
+static uint32_t g_keepalive_interval_s = AWS_KEEPALIVE_INITIAL_S;
+static uint32_t g_keepalive_good_s = 0;
+static uint32_t g_keepalive_bad_s = 0;
+static uint32_t g_keepalive_pingresp_count = 0;
+static uint32_t g_keepalive_timeout_count = 0;
+static uint32_t g_keepalive_miss_count = 0;
+static uint32_t g_keepalive_bad_pings = 0;
+
+static void aws_keepalive_ping_handler(MQTTClient *client, int rc);
+
+/**
+ * \brief Picks the next ping interval to try
+ *
+ * The interval doubles until an interval keeps missing its PINGRESP, then a
+ * binary search between the longest tolerated and the shortest failed
+ * interval finds how long the NAT and firewalls on the path keep an idle TCP connection.
+ */
+static uint32_t aws_keepalive_get_next_interval(void)
+{
+    uint32_t interval_s = 0;
+
+    if (g_keepalive_bad_s == 0)
+    {
+        interval_s = (g_keepalive_good_s == 0) ? AWS_KEEPALIVE_INITIAL_S : (2 * g_keepalive_good_s);
+    }
+    else if ((g_keepalive_bad_s - g_keepalive_good_s) > AWS_KEEPALIVE_RESOLUTION_S)
+    {
+        interval_s = g_keepalive_good_s + ((g_keepalive_bad_s - g_keepalive_good_s) / 2);
+    }
+    else
+    {
+        interval_s = g_keepalive_good_s;
+    }
+
+    interval_s = max(interval_s, AWS_KEEPALIVE_MIN_S);
+    if (g_keepalive_max_s > 0)
+    {
+        interval_s = min(interval_s, g_keepalive_max_s);
+    }
+
+    return interval_s;
+}
+
+/**
+ * \brief Applies the ping interval to the MQTT client
+ */
+static void aws_keepalive_set_interval(MQTTClient *client, uint32_t interval_s)
+{
+    char message[80];
+
+    if (interval_s != g_keepalive_interval_s)
+    {
+        sprintf(message, "MQTT keep alive: Ping interval %lu s", (unsigned long)interval_s);
+        console_print_message(message);
+    }
+    g_keepalive_interval_s = interval_s;
+
+    MQTTSetPingInterval(client, interval_s, AWS_KEEPALIVE_PINGRESP_TIMEOUT_MS,
+                        &aws_keepalive_ping_handler);
+}
+
+/**
+ * \brief Updates the tolerated interval range with the result of a PINGREQ
+ *
+ * Called by the MQTT client. A missed PINGRESP also closes the MQTT session
+ * and the next connection retries the same interval, a single lost PINGRESP
+ * is not enough to mark the interval as failed. A failed interval is
+ * forgotten after a while so the search adapts when the path gets looser.
+ *
+ * \param[in] client                The MQTT client that sent the PINGREQ
+ * \param[in] rc                    SUCCESS when the PINGRESP arrived in time
+ */
+static void aws_keepalive_ping_handler(MQTTClient *client, int rc)
+{
+    if (rc == SUCCESS)
+    {
+        g_keepalive_pingresp_count++;
+        g_keepalive_miss_count = 0;
+        g_keepalive_good_s = max(g_keepalive_good_s, g_keepalive_interval_s);
+
+        if ((g_keepalive_bad_s != 0) && (++g_keepalive_bad_pings >= AWS_KEEPALIVE_BAD_EXPIRE_PINGS))
+        {
+            g_keepalive_bad_s = 0;
+            g_keepalive_bad_pings = 0;
+        }
+
+        aws_keepalive_set_interval(client, aws_keepalive_get_next_interval());
+    }
+    else
+    {
+        g_keepalive_timeout_count++;
+        console_print_error_message("MQTT keep alive: No PINGRESP, the connection is lost.");
+
+        if (++g_keepalive_miss_count < AWS_KEEPALIVE_BAD_MISSES)
+        {
+            return;
+        }
+        g_keepalive_miss_count = 0;
+        g_keepalive_bad_s = g_keepalive_interval_s;
+        g_keepalive_bad_pings = 0;
+
+        // The path got stricter than what was learned, search again below it
+        if (g_keepalive_good_s >= g_keepalive_bad_s)
+        {
+            g_keepalive_good_s = 0;
+        }
+    }
+}
+
+/**
+ * \brief Forgets the learned ping intervals
+ *
+ * Called when the device may have moved to another network path, for
+ * example after new WIFI credentials were provisioned.
+ */
+void aws_keepalive_reset(void)
+{
+    g_keepalive_good_s = 0;
+    g_keepalive_bad_s = 0;
+    g_keepalive_miss_count = 0;
+    g_keepalive_bad_pings = 0;
+    g_keepalive_interval_s = AWS_KEEPALIVE_INITIAL_S;
+}
+
+/**
+ * \brief Starts the adaptive keep alive on a new MQTT connection
+ *
+ * \param[in] client                The connected MQTT client
+ * \param[in] keep_alive_s          The keep alive interval sent in the MQTT CONNECT
+ */
+void aws_keepalive_start(MQTTClient *client, uint32_t keep_alive_s)
+{
+    g_keepalive_max_s = keep_alive_s;
+
+    aws_keepalive_set_interval(client, aws_keepalive_get_next_interval());
+}
+
+/**
+ * \brief Gets the adaptive keep alive statistics
+ *
+ * \param[out] stats                The keep alive statistics
+ */
+void aws_keepalive_get_stats(struct aws_keepalive_stats *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    stats->interval_s = g_keepalive_interval_s;
+    stats->max_s = g_keepalive_max_s;
+    stats->good_s = g_keepalive_good_s;
+    stats->bad_s = g_keepalive_bad_s;
+    stats->pingresp_count = g_keepalive_pingresp_count;
+    stats->timeout_count = g_keepalive_timeout_count;
+    stats->miss_count = g_keepalive_miss_count;
+}
@@ -0,0 +1,59 @@
+/**
+ * \file
+ * \brief AWS IoT MQTT Adaptive Keep Alive
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef AWS_KEEPALIVE_H
+#define AWS_KEEPALIVE_H
+
+#include <stdint.h>
+
+#include "MQTTClient.h"
+
+// Defines
+#define AWS_KEEPALIVE_INITIAL_S             (60)     // First ping interval tried on a new network path
+#define AWS_KEEPALIVE_MIN_S                 (30)     // Shortest ping interval, below common NAT idle timeouts
+#define AWS_KEEPALIVE_RESOLUTION_S          (15)     // Probing stops once the tolerated and failed intervals are this close
+#define AWS_KEEPALIVE_PINGRESP_TIMEOUT_MS   (5000)   // Time allowed for the PINGRESP before the connection is dropped
+#define AWS_KEEPALIVE_BAD_MISSES            (3)      // Consecutive missed PINGRESPs at an interval before it is marked as failed
+#define AWS_KEEPALIVE_BAD_EXPIRE_PINGS      (100)    // PINGRESPs after which a failed interval is forgotten and probed again
+
+struct aws_keepalive_stats
+{
+    uint32_t interval_s;         //! Current ping interval
+    uint32_t max_s;              //! Negotiated MQTT keep alive interval, the ping interval upper bound
+    uint32_t good_s;             //! Longest ping interval the network path tolerated, 0 if none yet
+    uint32_t bad_s;              //! Shortest ping interval that lost the connection, 0 if none
+    uint32_t pingresp_count;     //! PINGRESPs received in time
+    uint32_t timeout_count;      //! PINGRESPs missed, each one dropped the connection
+    uint32_t miss_count;         //! Consecutive PINGRESPs missed at the current interval
+};
+
+void aws_keepalive_reset(void);
+void aws_keepalive_start(MQTTClient *client, uint32_t keep_alive_s);
+
+void aws_keepalive_get_stats(struct aws_keepalive_stats *stats);
+
+#endif // AWS_KEEPALIVE_H
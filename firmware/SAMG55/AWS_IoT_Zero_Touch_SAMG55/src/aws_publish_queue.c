@@ -0,0 +1,518 @@
+/**
+ * \file
+ * \brief AWS IoT Offline Publish Queue
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "asf.h"
+#include "aws_publish_queue.h"
+
+// Defines
+#define AWS_PUBLISH_RECORD_MAGIC        (0x51504157)  // "WAPQ"
+#define AWS_PUBLISH_RECORD_COUNT        (AWS_PUBLISH_QUEUE_FLASH_SIZE / AWS_PUBLISH_QUEUE_RECORD_SIZE)
+#define AWS_PUBLISH_RECORDS_PER_SECTOR  (AWS_PUBLISH_QUEUE_SECTOR_SIZE / AWS_PUBLISH_QUEUE_RECORD_SIZE)
+#define AWS_PUBLISH_PAGES_PER_SECTOR    (AWS_PUBLISH_QUEUE_SECTOR_SIZE / IFLASH_PAGE_SIZE)
+#define AWS_PUBLISH_EPA_16_PAGES        (2)           // EFC_FCMD_EPA argument to erase 16 pages
+#define AWS_PUBLISH_MARK_RETRIES        (3)           // Attempts to program the published mark of a record
+
+#if (IFLASH_PAGE_SIZE % AWS_PUBLISH_QUEUE_RECORD_SIZE) != 0
+#error "The publish queue records must not cross a flash page"
+#endif
+
+#if AWS_PUBLISH_PAGES_PER_SECTOR != 16
+#error "The publish queue sectors must be erased 16 pages at a time"
+#endif
+
+/**
+ * \brief Header of a publish queue record in flash
+ *
+ * Records are only appended to the flash region, a record is marked as
+ * published by clearing its published word, which only turns bits from 1
+ * to 0 and so needs no erase.
+ */
+struct aws_publish_record_header
+{
+    uint32_t magic;      //! AWS_PUBLISH_RECORD_MAGIC
+    uint32_t sequence;   //! Increments with every record written
+    uint16_t length;     //! Payload length
+    uint16_t crc;        //! CRC-16 of the sequence, length and payload
+    uint32_t published;  //! 0xFFFFFFFF until the message is published, then 0
+};
+
+struct aws_publish_record
+{
+    struct aws_publish_record_header header;
+    uint8_t payload[AWS_PUBLISH_QUEUE_PAYLOAD_MAX];
+};
+
+struct aws_publish_ram_entry
+{
+    uint16_t length;
+    char     payload[AWS_PUBLISH_QUEUE_PAYLOAD_MAX];
+};
+
+
+// Global variables
+
+//! The newest messages, the indexes run freely and are wrapped on access
+static struct aws_publish_ram_entry g_ram_queue[AWS_PUBLISH_QUEUE_RAM_LENGTH];
+static uint32_t g_ram_queue_head = 0;
+static uint32_t g_ram_queue_tail = 0;
+
+//! Record index of the oldest message queued in flash
+static uint32_t g_flash_read = 0;
+//! Record index of the next record to write
+static uint32_t g_flash_write = 0;
+//! Number of messages queued in flash
+static uint32_t g_flash_depth = 0;
+//! Sequence number of the next record to write
+static uint32_t g_flash_sequence = 1;
+
+//! Record being written, kept off the task stack
+static struct aws_publish_record g_flash_record;
+
+static struct aws_publish_queue_stats g_publish_queue_stats;
+
+
+/**
+ * \brief Gets a record of the flash region
+ */
+static const struct aws_publish_record* aws_publish_queue_get_record(uint32_t index)
+{
+    return (const struct aws_publish_record*)(AWS_PUBLISH_QUEUE_FLASH_ADDR +
+                                              (index * AWS_PUBLISH_QUEUE_RECORD_SIZE));
+}
+
+/**
+ * \brief Calculates the CRC-16 (CCITT) protecting a record
+ */
+static uint16_t aws_publish_queue_crc(uint16_t crc, const uint8_t *data, size_t length)
+{
+    while (length-- > 0)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint32_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static uint16_t aws_publish_queue_record_crc(const struct aws_publish_record *record)
+{
+    uint16_t crc = 0xFFFF;
+
+    crc = aws_publish_queue_crc(crc, (const uint8_t*)&record->header.sequence,
+                                sizeof(record->header.sequence));
+    crc = aws_publish_queue_crc(crc, (const uint8_t*)&record->header.length,
+                                sizeof(record->header.length));
+    crc = aws_publish_queue_crc(crc, record->payload, record->header.length);
+
+    return crc;
+}
+
+/**
+ * \brief Checks whether a record was completely written
+ */
+static bool aws_publish_queue_record_is_valid(const struct aws_publish_record *record)
+{
+    return ((record->header.magic == AWS_PUBLISH_RECORD_MAGIC) &&
+            (record->header.length <= AWS_PUBLISH_QUEUE_PAYLOAD_MAX) &&
+            (record->header.crc == aws_publish_queue_record_crc(record)));
+}
+
+/**
+ * \brief Checks whether a record holds a message waiting to be published
+ */
+static bool aws_publish_queue_record_is_queued(const struct aws_publish_record *record)
+{
+    return (aws_publish_queue_record_is_valid(record) &&
+            (record->header.published == 0xFFFFFFFF));
+}
+
+/**
+ * \brief Checks whether a record is still erased
+ */
+static bool aws_publish_queue_record_is_blank(const struct aws_publish_record *record)
+{
+    const uint32_t *words = (const uint32_t*)record;
+
+    for (uint32_t index = 0; index < (AWS_PUBLISH_QUEUE_RECORD_SIZE / sizeof(uint32_t)); index++)
+    {
+        if (words[index] != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief Programs words inside a single flash page
+ *
+ * The whole page latch buffer is filled, with 0xFFFFFFFF outside of the new
+ * data, so the bits already programmed in the page are left untouched.
+ *
+ * \param[in] address               Flash address, word aligned
+ * \param[in] data                  The words to program
+ * \param[in] length                Number of bytes to program, a multiple of 4
+ *
+ * \return Whether the data was programmed and reads back correctly
+ */
+static bool aws_publish_queue_flash_program(uint32_t address, const void *data, uint32_t length)
+{
+    uint32_t page = (address - IFLASH_ADDR) / IFLASH_PAGE_SIZE;
+    volatile uint32_t *latch = (volatile uint32_t*)(IFLASH_ADDR + (page * IFLASH_PAGE_SIZE));
+    uint32_t first_word = (address % IFLASH_PAGE_SIZE) / sizeof(uint32_t);
+    uint32_t word_count = length / sizeof(uint32_t);
+    const uint32_t *words = (const uint32_t*)data;
+    uint32_t status = EFC_RC_OK;
+
+    // The firmware update writes the flash from another task, keep the page latch to ourselves
+    vTaskSuspendAll();
+    for (uint32_t index = 0; index < (IFLASH_PAGE_SIZE / sizeof(uint32_t)); index++)
+    {
+        if ((index >= first_word) && (index < (first_word + word_count)))
+        {
+            latch[index] = words[index - first_word];
+        }
+        else
+        {
+            latch[index] = 0xFFFFFFFF;
+        }
+    }
+    __DSB();
+    status = efc_perform_command(EFC, EFC_FCMD_WP, page);
+    xTaskResumeAll();
+
+    if (status != EFC_RC_OK)
+    {
+        return false;
+    }
+
+    return (memcmp((const void*)address, data, length) == 0);
+}
+
+/**
+ * \brief Erases a sector of the flash region
+ *
+ * Messages still queued in the sector are lost and counted as dropped.
+ */
+static void aws_publish_queue_flash_erase(uint32_t sector)
+{
+    uint32_t first_page = ((AWS_PUBLISH_QUEUE_FLASH_ADDR - IFLASH_ADDR) / IFLASH_PAGE_SIZE) +
+                          (sector * AWS_PUBLISH_PAGES_PER_SECTOR);
+
+    // Drop the oldest messages stored in the sector
+    while ((g_flash_depth > 0) && ((g_flash_read / AWS_PUBLISH_RECORDS_PER_SECTOR) == sector))
+    {
+        g_flash_read = (g_flash_read + 1) % AWS_PUBLISH_RECORD_COUNT;
+        g_flash_depth--;
+        g_publish_queue_stats.drop_count++;
+
+        while ((g_flash_depth > 0) &&
+               !aws_publish_queue_record_is_queued(aws_publish_queue_get_record(g_flash_read)))
+        {
+            g_flash_read = (g_flash_read + 1) % AWS_PUBLISH_RECORD_COUNT;
+        }
+    }
+
+    vTaskSuspendAll();
+    efc_perform_command(EFC, EFC_FCMD_EPA, first_page | AWS_PUBLISH_EPA_16_PAGES);
+    xTaskResumeAll();
+    g_publish_queue_stats.erase_count++;
+}
+
+/**
+ * \brief Appends a message to the flash region
+ *
+ * The records are written round robin through the whole region, so every
+ * sector is erased once per pass and wears evenly.
+ */
+static bool aws_publish_queue_flash_append(const char *payload, size_t length)
+{
+    uint32_t index = g_flash_write;
+
+    // Move to an erased record, erasing the next sector when needed
+    if (!aws_publish_queue_record_is_blank(aws_publish_queue_get_record(index)))
+    {
+        if ((index % AWS_PUBLISH_RECORDS_PER_SECTOR) != 0)
+        {
+            index = ((index / AWS_PUBLISH_RECORDS_PER_SECTOR) + 1) * AWS_PUBLISH_RECORDS_PER_SECTOR;
+            index %= AWS_PUBLISH_RECORD_COUNT;
+        }
+        aws_publish_queue_flash_erase(index / AWS_PUBLISH_RECORDS_PER_SECTOR);
+    }
+
+    memset(&g_flash_record, 0xFF, sizeof(g_flash_record));
+    memcpy(g_flash_record.payload, payload, length);
+    g_flash_record.header.magic = AWS_PUBLISH_RECORD_MAGIC;
+    g_flash_record.header.sequence = g_flash_sequence++;
+    g_flash_record.header.length = (uint16_t)length;
+    g_flash_record.header.crc = aws_publish_queue_record_crc(&g_flash_record);
+
+    g_flash_write = (index + 1) % AWS_PUBLISH_RECORD_COUNT;
+
+    if (!aws_publish_queue_flash_program((uint32_t)aws_publish_queue_get_record(index),
+                                         &g_flash_record, sizeof(g_flash_record)))
+    {
+        return false;
+    }
+
+    if (g_flash_depth == 0)
+    {
+        g_flash_read = index;
+    }
+    g_flash_depth++;
+
+    return true;
+}
+
+/**
+ * \brief Recovers the messages left in the flash region by a previous boot
+ */
+void aws_publish_queue_init(void)
+{
+    const struct aws_publish_record *record = NULL;
+    uint32_t newest_sequence = 0;
+    uint32_t oldest_sequence = UINT32_MAX;
+
+    memset(&g_publish_queue_stats, 0, sizeof(g_publish_queue_stats));
+    g_ram_queue_head = 0;
+    g_ram_queue_tail = 0;
+    g_flash_read = 0;
+    g_flash_write = 0;
+    g_flash_depth = 0;
+
+    for (uint32_t index = 0; index < AWS_PUBLISH_RECORD_COUNT; index++)
+    {
+        record = aws_publish_queue_get_record(index);
+        if (!aws_publish_queue_record_is_valid(record))
+        {
+            continue;
+        }
+
+        // Continue writing after the newest record
+        if (record->header.sequence >= newest_sequence)
+        {
+            newest_sequence = record->header.sequence;
+            g_flash_write = (index + 1) % AWS_PUBLISH_RECORD_COUNT;
+        }
+
+        // Continue publishing from the oldest queued record
+        if (record->header.published == 0xFFFFFFFF)
+        {
+            if (record->header.sequence < oldest_sequence)
+            {
+                oldest_sequence = record->header.sequence;
+                g_flash_read = index;
+            }
+            g_flash_depth++;
+        }
+    }
+
+    g_flash_sequence = newest_sequence + 1;
+    g_publish_queue_stats.max_depth = g_flash_depth;
+}
+
+/**
+ * \brief Queues a message until it can be published
+ *
+ * When the RAM queue is full its oldest message is moved to flash, so the
+ * messages always leave the queue in the order they were queued.
+ *
+ * \param[in] payload               The message payload
+ * \param[in] length                The payload length
+ *
+ * \return Whether the message was queued
+ */
+bool aws_publish_queue_push(const char *payload, size_t length)
+{
+    struct aws_publish_ram_entry *entry = NULL;
+
+    if ((payload == NULL) || (length > AWS_PUBLISH_QUEUE_PAYLOAD_MAX))
+    {
+        return false;
+    }
+
+    if ((g_ram_queue_head - g_ram_queue_tail) >= AWS_PUBLISH_QUEUE_RAM_LENGTH)
+    {
+        // Spill the oldest RAM message to flash
+        entry = &g_ram_queue[g_ram_queue_tail % AWS_PUBLISH_QUEUE_RAM_LENGTH];
+        if (aws_publish_queue_flash_append(entry->payload, entry->length))
+        {
+            g_publish_queue_stats.spill_count++;
+        }
+        else
+        {
+            g_publish_queue_stats.drop_count++;
+        }
+        g_ram_queue_tail++;
+    }
+
+    entry = &g_ram_queue[g_ram_queue_head % AWS_PUBLISH_QUEUE_RAM_LENGTH];
+    memcpy(entry->payload, payload, length);
+    entry->length = (uint16_t)length;
+    g_ram_queue_head++;
+
+    g_publish_queue_stats.queued_count++;
+    g_publish_queue_stats.max_depth = max(g_publish_queue_stats.max_depth,
+                                          aws_publish_queue_get_depth());
+
+    return true;
+}
+
+/**
+ * \brief Gets the oldest queued message without removing it
+ *
+ * \param[out]    payload           Receives the message payload
+ * \param[in,out] length            The payload buffer size, then the payload length
+ *
+ * \return Whether a message was returned
+ */
+bool aws_publish_queue_peek(char *payload, size_t *length)
+{
+    const struct aws_publish_record *record = NULL;
+    const struct aws_publish_ram_entry *entry = NULL;
+
+    if ((payload == NULL) || (length == NULL))
+    {
+        return false;
+    }
+
+    if (g_flash_depth > 0)
+    {
+        record = aws_publish_queue_get_record(g_flash_read);
+        if (record->header.length > *length)
+        {
+            return false;
+        }
+        memcpy(payload, record->payload, record->header.length);
+        *length = record->header.length;
+
+        return true;
+    }
+
+    if (g_ram_queue_head != g_ram_queue_tail)
+    {
+        entry = &g_ram_queue[g_ram_queue_tail % AWS_PUBLISH_QUEUE_RAM_LENGTH];
+        if (entry->length > *length)
+        {
+            return false;
+        }
+        memcpy(payload, entry->payload, entry->length);
+        *length = entry->length;
+
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * \brief Removes the oldest queued message once it was published
+ *
+ * \return Whether the message is removed for good, false if its flash
+ *         record could not be marked as published and it will be published
+ *         again after a reset
+ */
+bool aws_publish_queue_pop(void)
+{
+    static const uint32_t published = 0;
+    uint32_t mark_address = 0;
+    bool is_marked = true;
+
+    if (g_flash_depth > 0)
+    {
+        // Mark the record as published so it is not sent again after a reset
+        mark_address = (uint32_t)&aws_publish_queue_get_record(g_flash_read)->header.published;
+        is_marked = false;
+        for (uint32_t attempt = 0; (attempt < AWS_PUBLISH_MARK_RETRIES) && !is_marked; attempt++)
+        {
+            is_marked = aws_publish_queue_flash_program(mark_address, &published, sizeof(published));
+        }
+        if (!is_marked)
+        {
+            g_publish_queue_stats.mark_fail_count++;
+        }
+        g_flash_depth--;
+
+        while (g_flash_depth > 0)
+        {
+            g_flash_read = (g_flash_read + 1) % AWS_PUBLISH_RECORD_COUNT;
+            if (aws_publish_queue_record_is_queued(aws_publish_queue_get_record(g_flash_read)))
+            {
+                break;
+            }
+        }
+    }
+    else if (g_ram_queue_head != g_ram_queue_tail)
+    {
+        g_ram_queue_tail++;
+    }
+
+    return is_marked;
+}
+
+/**
+ * \brief Gets the number of queued messages
+ */
+uint32_t aws_publish_queue_get_depth(void)
+{
+    return (g_ram_queue_head - g_ram_queue_tail) + g_flash_depth;
+}
+
+/**
+ * \brief Records the result of the last drain of the queue
+ *
+ * \param[in] drain_count           Number of messages published
+ * \param[in] drain_ms              Time taken to publish them
+ */
+void aws_publish_queue_set_drain_time(uint32_t drain_count, uint32_t drain_ms)
+{
+    g_publish_queue_stats.drain_count = drain_count;
+    g_publish_queue_stats.drain_ms = drain_ms;
+}
+
+/**
+ * \brief Gets the publish queue statistics
+ *
+ * \param[out] stats                The publish queue statistics
+ */
+void aws_publish_queue_get_stats(struct aws_publish_queue_stats *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    *stats = g_publish_queue_stats;
+    stats->ram_depth = g_ram_queue_head - g_ram_queue_tail;
+    stats->flash_depth = g_flash_depth;
+}
@@ -0,0 +1,69 @@
+/**
+ * \file
+ * \brief AWS IoT Offline Publish Queue
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef AWS_PUBLISH_QUEUE_H
+#define AWS_PUBLISH_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asf.h"
+
+// Defines
+#define AWS_PUBLISH_QUEUE_RAM_LENGTH        (4)      // Messages held in RAM before the oldest is spilled to flash
+#define AWS_PUBLISH_QUEUE_RECORD_SIZE       (256)    // Flash record size, header included, must divide the flash page size
+#define AWS_PUBLISH_QUEUE_PAYLOAD_MAX       (AWS_PUBLISH_QUEUE_RECORD_SIZE - 16)
+#define AWS_PUBLISH_QUEUE_SECTOR_SIZE       (IFLASH_LOCK_REGION_SIZE)        // Flash erase unit of 16 pages
+#define AWS_PUBLISH_QUEUE_FLASH_SIZE        (2 * AWS_PUBLISH_QUEUE_SECTOR_SIZE)
+#define AWS_PUBLISH_QUEUE_FLASH_ADDR        (IFLASH_ADDR + IFLASH_SIZE - AWS_PUBLISH_QUEUE_FLASH_SIZE) // Excluded from the rom region in flash.ld
+
+struct aws_publish_queue_stats
+{
+    uint32_t ram_depth;          //! Messages currently queued in RAM
+    uint32_t flash_depth;        //! Messages currently queued in flash
+    uint32_t max_depth;          //! Largest number of messages queued at once
+    uint32_t queued_count;       //! Messages queued since boot
+    uint32_t spill_count;        //! Messages spilled from RAM to flash
+    uint32_t drop_count;         //! Messages lost because the flash region was full
+    uint32_t erase_count;        //! Flash sectors erased
+    uint32_t mark_fail_count;    //! Published flash records that could not be marked, sent again after a reset
+    uint32_t drain_count;        //! Messages published by the last drain
+    uint32_t drain_ms;           //! Duration of the last drain
+};
+
+void aws_publish_queue_init(void);
+
+bool aws_publish_queue_push(const char *payload, size_t length);
+bool aws_publish_queue_peek(char *payload, size_t *length);
+bool aws_publish_queue_pop(void);
+uint32_t aws_publish_queue_get_depth(void);
+
+void aws_publish_queue_set_drain_time(uint32_t drain_count, uint32_t drain_ms);
+void aws_publish_queue_get_stats(struct aws_publish_queue_stats *stats);
+
+#endif // AWS_PUBLISH_QUEUE_H
@@ -0,0 +1,465 @@
+/**
+ * \file
+ * \brief AWS IoT WINC1500 Socket Connections
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "asf.h"
+#include "aws_event.h"
+#include "aws_socket.h"
+#include "aws_wifi_task.h"
+#include "MQTTReturnCodes.h"
+#include "timer_interface.h"
+
+// Global variables
+//! The open connections, looked up by their WINC1500 socket handle
+static struct socket_connection *g_socket_connections[AWS_SOCKET_CONNECTIONS_MAX];
+//! Receives the data when the ring buffer has no contiguous room for a whole recv()
+static uint8_t g_socket_recv_buffer[AWS_SOCKET_RECV_SIZE];
+
+typedef struct {
+    int code;
+    const char* name;
+} ErrorInfo;
+
+#define NEW_SOCKET_ERROR(err) {err, #err}
+static const ErrorInfo g_socket_error_info[] =
+{
+    NEW_SOCKET_ERROR(SOCK_ERR_NO_ERROR),
+    NEW_SOCKET_ERROR(SOCK_ERR_INVALID_ADDRESS),
+    NEW_SOCKET_ERROR(SOCK_ERR_ADDR_ALREADY_IN_USE),
+    NEW_SOCKET_ERROR(SOCK_ERR_MAX_TCP_SOCK),
+    NEW_SOCKET_ERROR(SOCK_ERR_MAX_UDP_SOCK),
+    NEW_SOCKET_ERROR(SOCK_ERR_INVALID_ARG),
+    NEW_SOCKET_ERROR(SOCK_ERR_MAX_LISTEN_SOCK),
+    NEW_SOCKET_ERROR(SOCK_ERR_INVALID),
+    NEW_SOCKET_ERROR(SOCK_ERR_ADDR_IS_REQUIRED),
+    NEW_SOCKET_ERROR(SOCK_ERR_CONN_ABORTED),
+    NEW_SOCKET_ERROR(SOCK_ERR_TIMEOUT),
+    NEW_SOCKET_ERROR(SOCK_ERR_BUFFER_FULL),
+};
+
+static const char* get_socket_error_name(int error_code)
+{
+    for (size_t i = 0; i < sizeof(g_socket_error_info) / sizeof(g_socket_error_info[0]); i++)
+        if (error_code == g_socket_error_info[i].code)
+            return g_socket_error_info[i].name;
+    return "UNKNOWN";
+}
+
+/**
+ * \brief Gets the free space in the receive ring buffer
+ */
+static uint32_t aws_socket_get_rx_free(const struct socket_connection *connection)
+{
+    return connection->rx_buffer_size - aws_socket_get_rx_length(connection);
+}
+
+/**
+ * \brief Appends received data to the receive ring buffer
+ *
+ * The data that does not fit is dropped and counted, the reader only ever
+ * starts a recv() when there is room for a whole one.
+ */
+static void aws_socket_write_rx_buffer(struct socket_connection *connection,
+                                       const uint8_t *data, uint32_t length)
+{
+    uint32_t offset = connection->rx_tail & (connection->rx_buffer_size - 1);
+    uint32_t first_length = 0;
+
+    if (length > aws_socket_get_rx_free(connection))
+    {
+        connection->rx_overflow_count += length - aws_socket_get_rx_free(connection);
+        length = aws_socket_get_rx_free(connection);
+    }
+
+    first_length = min(length, connection->rx_buffer_size - offset);
+    memcpy(&connection->rx_buffer[offset], &data[0], first_length);
+    memcpy(&connection->rx_buffer[0], &data[first_length], length - first_length);
+
+    connection->rx_tail += length;
+}
+
+/**
+ * \brief Starts receiving the next incoming data of a connection
+ *
+ * The WINC1500 writes straight into the ring buffer when a whole recv() fits
+ * before the end of the buffer. Otherwise the data lands in a buffer shared
+ * by all connections, the socket callbacks run one at a time and copy it into
+ * the ring buffer of their connection right away.
+ *
+ * \return true if a recv() is now outstanding
+ */
+static bool aws_socket_receive(struct socket_connection *connection)
+{
+    uint8_t *buffer = &g_socket_recv_buffer[0];
+    uint32_t offset = connection->rx_tail & (connection->rx_buffer_size - 1);
+    sint16 socket_status = SOCK_ERR_NO_ERROR;
+
+    if (aws_socket_get_rx_free(connection) < AWS_SOCKET_RECV_SIZE)
+    {
+        // Wait for the reader to make room
+        return false;
+    }
+
+    if ((connection->rx_buffer_size - offset) >= AWS_SOCKET_RECV_SIZE)
+    {
+        buffer = &connection->rx_buffer[offset];
+    }
+
+    connection->rx_status = WIFI_STATUS_UNKNOWN;
+    socket_status = recv(connection->socket, buffer, AWS_SOCKET_RECV_SIZE, 0);
+    if (socket_status != SOCK_ERR_NO_ERROR)
+    {
+        return false;
+    }
+    connection->rx_pending = true;
+
+    return true;
+}
+
+/**
+ * \brief Stops dispatching the socket events to a connection
+ */
+static void aws_socket_remove(const struct socket_connection *connection)
+{
+    for (int i = 0; i < AWS_SOCKET_CONNECTIONS_MAX; i++)
+    {
+        if (g_socket_connections[i] == connection)
+        {
+            g_socket_connections[i] = NULL;
+        }
+    }
+}
+
+/**
+ * \brief Opens a connection object for a WINC1500 socket
+ *
+ * The socket callbacks for the socket are dispatched to the connection until
+ * it is closed.
+ *
+ * \param[out] connection           The connection object, owned by the caller
+ * \param[in] socket                The WINC1500 socket
+ * \param[in] rx_buffer             The receive ring buffer
+ * \param[in] rx_buffer_size        Power of two, at least the longest read plus
+ *                                  AWS_SOCKET_RECV_SIZE
+ * \param[in] event_queue           Receives the socket events of the connection
+ *
+ * \return true if the connection was opened
+ */
+bool aws_socket_open(struct socket_connection *connection, SOCKET socket,
+                     uint8_t *rx_buffer, uint32_t rx_buffer_size, QueueHandle_t event_queue)
+{
+    if ((connection == NULL) || (rx_buffer == NULL) || (rx_buffer_size <= AWS_SOCKET_RECV_SIZE) ||
+        ((rx_buffer_size & (rx_buffer_size - 1)) != 0))
+    {
+        return false;
+    }
+
+    // A connection reopened without closing it first only takes one entry
+    aws_socket_remove(connection);
+
+    memset(connection, 0, sizeof(*connection));
+    connection->socket = socket;
+    connection->event_queue = event_queue;
+    connection->rx_buffer = rx_buffer;
+    connection->rx_buffer_size = rx_buffer_size;
+    connection->rx_status = WIFI_STATUS_UNKNOWN;
+    connection->tx_status = WIFI_STATUS_UNKNOWN;
+
+    for (int i = 0; i < AWS_SOCKET_CONNECTIONS_MAX; i++)
+    {
+        if (g_socket_connections[i] == NULL)
+        {
+            g_socket_connections[i] = connection;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \brief Closes the socket of a connection and stops dispatching to it
+ *
+ * \param[in] connection            The connection object
+ */
+void aws_socket_close(struct socket_connection *connection)
+{
+    aws_socket_remove(connection);
+
+    if (connection->socket >= 0)
+    {
+        close(connection->socket);
+    }
+    connection->socket = SOCK_ERR_INVALID;
+    connection->rx_pending = false;
+    connection->rx_head = connection->rx_tail;
+}
+
+/**
+ * \brief Finds the open connection of a WINC1500 socket
+ *
+ * \return The connection, or NULL if the socket has none
+ */
+struct socket_connection* aws_socket_find(SOCKET socket)
+{
+    for (int i = 0; i < AWS_SOCKET_CONNECTIONS_MAX; i++)
+    {
+        if ((g_socket_connections[i] != NULL) && (g_socket_connections[i]->socket == socket))
+        {
+            return g_socket_connections[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Handles a WINC1500 socket callback for a connection
+ *
+ * \param[in] connection            The connection of the socket
+ * \param[in] message_type          The WINC1500 socket message type
+ * \param[in] message               The WINC1500 socket message
+ */
+void aws_socket_handle_message(struct socket_connection *connection, uint8 message_type, void *message)
+{
+    tstrSocketConnectMsg *socket_connect_message = NULL;
+    tstrSocketRecvMsg *socket_receive_message = NULL;
+    sint16 *bytes_sent = NULL;
+
+    // Check for the WINC1500 WIFI socket events
+    switch (message_type)
+    {
+    case SOCKET_MSG_CONNECT:
+        socket_connect_message = (tstrSocketConnectMsg*)message;
+        if (socket_connect_message != NULL)
+        {
+            if (socket_connect_message->s8Error == SOCK_ERR_NO_ERROR)
+            {
+                // Notify the owner the connection is up
+                aws_event_post(connection->event_queue, AWS_EVENT_SOCKET_CONNECTED, (uint32_t)connection->socket);
+            }
+            else
+            {
+                // An error has occurred
+                printf("SOCKET_MSG_CONNECT error %s(%d)\r\n", get_socket_error_name(socket_connect_message->s8Error), socket_connect_message->s8Error);
+
+                // Notify the owner the connection failed
+                aws_event_post(connection->event_queue, AWS_EVENT_AWS_CONNECT_FAILURE, (uint32_t)connection->socket);
+            }
+        }
+        break;
+
+    case SOCKET_MSG_RECV:
+    case SOCKET_MSG_RECVFROM:
+        socket_receive_message = (tstrSocketRecvMsg*)message;
+        if (socket_receive_message != NULL)
+        {
+            if (socket_receive_message->s16BufferSize > 0)
+            {
+                if (socket_receive_message->pu8Buffer == &g_socket_recv_buffer[0])
+                {
+                    aws_socket_write_rx_buffer(connection, socket_receive_message->pu8Buffer,
+                                               (uint32_t)socket_receive_message->s16BufferSize);
+                }
+                else
+                {
+                    // Received in place in the ring buffer
+                    connection->rx_tail += (uint32_t)socket_receive_message->s16BufferSize;
+                }
+
+                // The message was received
+                if (socket_receive_message->u16RemainingSize == 0)
+                {
+                    connection->rx_pending = false;
+                    connection->rx_status = WIFI_STATUS_MESSAGE_RECEIVED;
+
+                    // Notify the owner there is data to handle
+                    aws_event_post(connection->event_queue, AWS_EVENT_SOCKET_RECEIVED, (uint32_t)connection->socket);
+                }
+            }
+            else if (socket_receive_message->s16BufferSize == SOCK_ERR_TIMEOUT)
+            {
+                // A timeout has occurred
+                connection->rx_pending = false;
+                connection->rx_status = WIFI_STATUS_TIMEOUT;
+            }
+            else
+            {
+                // An error has occurred, zero bytes means the server closed the connection
+                connection->rx_pending = false;
+                connection->rx_status = WIFI_STATUS_ERROR;
+
+                // Notify the owner to close the connection
+                aws_event_post(connection->event_queue, AWS_EVENT_SOCKET_ERROR, (uint32_t)connection->socket);
+            }
+        }
+        break;
+
+    case SOCKET_MSG_SEND:
+        bytes_sent = (sint16*)message;
+
+        if (*bytes_sent <= 0 || *bytes_sent > (int32_t)connection->tx_size)
+        {
+            // Seen an odd instance where bytes_sent is way more than the requested bytes sent.
+            // This happens when we're expecting an error, so were assuming this is an error
+            // condition.
+
+            connection->tx_status = WIFI_STATUS_ERROR;
+
+            // Notify the owner to close the connection
+            aws_event_post(connection->event_queue, AWS_EVENT_SOCKET_ERROR, (uint32_t)connection->socket);
+        }
+        else if (*bytes_sent > 0)
+        {
+            // The message was sent
+            connection->tx_status = WIFI_STATUS_MESSAGE_SENT;
+        }
+        break;
+
+    default:
+        printf("%s: unhandled message %d\r\n", __FUNCTION__, (int)message_type);
+        // Do nothing
+        break;
+    }
+}
+
+/**
+ * \brief Gets the number of received bytes not read yet
+ */
+uint32_t aws_socket_get_rx_length(const struct socket_connection *connection)
+{
+    return connection->rx_tail - connection->rx_head;
+}
+
+/**
+ * \brief Reads data received on a connection
+ *
+ * Waits until read_length bytes were received, the other connections keep
+ * receiving into their own ring buffers meanwhile.
+ *
+ * \param[in] connection            The connection
+ * \param[out] read_buffer          The buffer
+ * \param[in] read_length           The number of bytes to read
+ * \param[in] timeout_ms            The timeout
+ *
+ * \return The number of bytes read, FAILURE on error or timeout
+ */
+int aws_socket_read(struct socket_connection *connection, uint8_t *read_buffer,
+                    uint32_t read_length, uint32_t timeout_ms)
+{
+    Timer read_timer;
+    uint32_t offset = 0;
+    uint32_t first_length = 0;
+
+    if ((connection->socket < 0) || ((read_length + AWS_SOCKET_RECV_SIZE) > connection->rx_buffer_size))
+    {
+        return FAILURE;
+    }
+
+    TimerInit(&read_timer);
+    TimerCountdownMS(&read_timer, timeout_ms);
+
+    while (aws_socket_get_rx_length(connection) < read_length)
+    {
+        if (connection->rx_status == WIFI_STATUS_ERROR)
+        {
+            return FAILURE;
+        }
+
+        if ((connection->rx_pending == false) && !aws_socket_receive(connection))
+        {
+            return FAILURE;
+        }
+
+        if (TimerIsExpired(&read_timer))
+        {
+            return FAILURE;
+        }
+
+        // Wait until the incoming message or error was received
+        aws_wifi_wait_for_winc(TimerLeftMS(&read_timer));
+    }
+
+    // Get the data from the ring buffer
+    offset = connection->rx_head & (connection->rx_buffer_size - 1);
+    first_length = min(read_length, connection->rx_buffer_size - offset);
+    memcpy(&read_buffer[0], &connection->rx_buffer[offset], first_length);
+    memcpy(&read_buffer[first_length], &connection->rx_buffer[0], read_length - first_length);
+
+    connection->rx_head += read_length;
+
+    return (int)read_length;
+}
+
+/**
+ * \brief Sends data on a connection and waits until the WINC1500 took it
+ *
+ * \param[in] connection            The connection
+ * \param[in] send_buffer           The buffer
+ * \param[in] send_length           The number of bytes, at most SOCKET_BUFFER_MAX_LENGTH
+ * \param[in] timeout_ms            The timeout
+ *
+ * \return The number of bytes sent, FAILURE on error or timeout
+ */
+int aws_socket_send(struct socket_connection *connection, const uint8_t *send_buffer,
+                    uint32_t send_length, uint32_t timeout_ms)
+{
+    sint16 socket_status = SOCK_ERR_NO_ERROR;
+    Timer send_timer;
+
+    if (connection->socket < 0)
+    {
+        return FAILURE;
+    }
+
+    TimerInit(&send_timer);
+    TimerCountdownMS(&send_timer, timeout_ms);
+
+    connection->tx_status = WIFI_STATUS_UNKNOWN;
+    connection->tx_size = send_length;
+
+    socket_status = send(connection->socket, (void*)send_buffer, (uint16)send_length, 0);
+    if (socket_status != SOCK_ERR_NO_ERROR)
+    {
+        return FAILURE;
+    }
+
+    // Wait until the outgoing message was sent
+    while (connection->tx_status != WIFI_STATUS_MESSAGE_SENT)
+    {
+        if (connection->tx_status == WIFI_STATUS_ERROR || TimerIsExpired(&send_timer))
+        {
+            return FAILURE;
+        }
+
+        aws_wifi_wait_for_winc(TimerLeftMS(&send_timer));
+    }
+
+    return (int)send_length;
+}
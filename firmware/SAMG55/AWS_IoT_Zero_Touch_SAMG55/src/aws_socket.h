@@ -0,0 +1,82 @@
+/**
+ * \file
+ * \brief AWS IoT WINC1500 Socket Connections
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef AWS_SOCKET_H
+#define AWS_SOCKET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "socket/include/socket.h"
+
+// Defines
+#define AWS_SOCKET_CONNECTIONS_MAX  (2)    // The MQTT session plus one transfer, such as an HTTPS download
+#define AWS_SOCKET_RECV_SIZE        (SOCKET_BUFFER_MAX_LENGTH) // Most data the WINC1500 delivers for one recv()
+
+enum wifi_status
+{
+    WIFI_STATUS_UNKNOWN          = 0,
+    WIFI_STATUS_MESSAGE_RECEIVED = 1,    
+    WIFI_STATUS_MESSAGE_SENT     = 2,
+    WIFI_STATUS_TIMEOUT          = 3,
+    WIFI_STATUS_ERROR            = 4    
+};
+
+struct socket_connection
+{
+    SOCKET socket;
+    uint32 address;
+    uint16 port;
+
+    QueueHandle_t event_queue;   //! Receives the socket connected, received and error events
+    uint8_t *rx_buffer;          //! Receive ring buffer
+    uint32_t rx_buffer_size;     //! Power of two, at least the longest read plus AWS_SOCKET_RECV_SIZE
+    uint32_t rx_head;            //! Free running index of the next byte to read
+    uint32_t rx_tail;            //! Free running index of the next byte to receive
+    bool rx_pending;             //! Whether a recv() is outstanding
+    uint32_t rx_overflow_count;  //! Received bytes dropped because the ring buffer was full
+    enum wifi_status rx_status;
+    enum wifi_status tx_status;
+    uint32_t tx_size;            //! Length of the outstanding send()
+};
+
+bool aws_socket_open(struct socket_connection *connection, SOCKET socket,
+                     uint8_t *rx_buffer, uint32_t rx_buffer_size, QueueHandle_t event_queue);
+void aws_socket_close(struct socket_connection *connection);
+
+struct socket_connection* aws_socket_find(SOCKET socket);
+void aws_socket_handle_message(struct socket_connection *connection, uint8 message_type, void *message);
+
+uint32_t aws_socket_get_rx_length(const struct socket_connection *connection);
+int aws_socket_read(struct socket_connection *connection, uint8_t *read_buffer,
+                    uint32_t read_length, uint32_t timeout_ms);
+int aws_socket_send(struct socket_connection *connection, const uint8_t *send_buffer,
+                    uint32_t send_length, uint32_t timeout_ms);
+
+#endif // AWS_SOCKET_H
@@ -0,0 +1,477 @@
+/**
+ * \file
+ * \brief AWS IoT WINC1500 Firmware Over The Air Update
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "asf.h"
+#include "aws_wifi_ota.h"
+#include "console.h"
+#include "driver/include/m2m_ota.h"
+#include "driver/include/m2m_wifi.h"
+
+// Global variables
+static enum aws_wifi_ota_state g_ota_state = AWS_WIFI_OTA_STATE_IDLE;
+static char     g_ota_url[AWS_WIFI_OTA_URL_SIZE_MAX];
+static uint32_t g_ota_status = OTA_STATUS_SUCSESS;
+static uint32_t g_ota_request_ms = 0;
+static uint32_t g_ota_phase_ms = 0;
+static uint32_t g_ota_restart_ms = 0;
+static uint32_t g_ota_download_ms = 0;
+static uint32_t g_ota_switch_ms = 0;
+static uint32_t g_ota_connected_ms = 0;
+static uint32_t g_ota_total_ms = 0;
+static uint32_t g_ota_update_count = 0;
+static uint32_t g_ota_rollback_count = 0;
+static uint32_t g_ota_trial_failures = 0;
+static bool     g_ota_restart_pending = false;
+static bool     g_ota_report_pending = false;
+
+static const char *g_ota_state_names[] =
+{
+    "idle", "requested", "downloading", "switching", "restarting",
+    "trial", "rolling back", "succeeded", "rolled back", "failed"
+};
+
+/**
+ * \brief Gets the current time in milliseconds from the FreeRTOS tick count
+ */
+static uint32_t aws_wifi_ota_get_time_ms(void)
+{
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+/**
+ * \brief Moves the update to the next state and schedules a shadow report
+ *
+ * \param[in] state                 The new update state
+ */
+static void aws_wifi_ota_set_state(enum aws_wifi_ota_state state)
+{
+    char message[96];
+
+    g_ota_state = state;
+    g_ota_phase_ms = aws_wifi_ota_get_time_ms();
+    g_ota_report_pending = true;
+
+    if ((state == AWS_WIFI_OTA_STATE_SUCCEEDED) || (state == AWS_WIFI_OTA_STATE_ROLLED_BACK) ||
+        (state == AWS_WIFI_OTA_STATE_FAILED))
+    {
+        g_ota_total_ms = g_ota_phase_ms - g_ota_request_ms;
+    }
+
+    memset(&message[0], 0, sizeof(message));
+    sprintf(&message[0], "WINC1500 OTA: %s after %lu ms, status %lu",
+            g_ota_state_names[state], (unsigned long)(g_ota_phase_ms - g_ota_request_ms),
+            (unsigned long)g_ota_status);
+    console_print_message(message);
+}
+
+/**
+ * \brief Called by the WINC1500 driver with the download, switch, rollback
+ *        and abort results
+ *
+ * \param[in] status_type           The tenuOtaUpdateStatusType of the result
+ * \param[in] status                The tenuOtaUpdateStatus result
+ */
+static void aws_wifi_ota_update_callback(uint8 status_type, uint8 status)
+{
+    uint32_t time_ms = aws_wifi_ota_get_time_ms();
+
+    g_ota_status = status;
+
+    switch (status_type)
+    {
+    case DL_STATUS:
+        if (g_ota_state != AWS_WIFI_OTA_STATE_DOWNLOADING)
+        {
+            break;
+        }
+        g_ota_download_ms = time_ms - g_ota_request_ms;
+
+        if (status != OTA_STATUS_SUCSESS)
+        {
+            aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_FAILED);
+            break;
+        }
+
+        // The image was verified by the WINC1500, make it the one to boot
+        aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_SWITCHING);
+        if (m2m_ota_switch_firmware() != M2M_SUCCESS)
+        {
+            aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_FAILED);
+        }
+        break;
+
+    case SW_STATUS:
+        if (g_ota_state != AWS_WIFI_OTA_STATE_SWITCHING)
+        {
+            break;
+        }
+        g_ota_switch_ms = time_ms - g_ota_phase_ms;
+
+        if (status != OTA_STATUS_SUCSESS)
+        {
+            aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_FAILED);
+            break;
+        }
+
+        // The new image only runs after the WINC1500 is reset
+        g_ota_restart_pending = true;
+        aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_RESTARTING);
+        break;
+
+    case RB_STATUS:
+        if (g_ota_state != AWS_WIFI_OTA_STATE_ROLLING_BACK)
+        {
+            break;
+        }
+
+        if (status != OTA_STATUS_SUCSESS)
+        {
+            aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_FAILED);
+            break;
+        }
+
+        // The previous image only runs after the WINC1500 is reset
+        g_ota_restart_pending = true;
+        g_ota_report_pending = true;
+        break;
+
+    case AB_STATUS:
+    default:
+        // The aborted download was already reported as failed
+        break;
+    }
+}
+
+/**
+ * \brief Called by the WINC1500 driver with update notifications, which are
+ *        not used since the download URL comes from the thing shadow
+ */
+static void aws_wifi_ota_notify_callback(tstrOtaUpdateInfo *update_info)
+{
+    (void)update_info;
+}
+
+/**
+ * \brief Registers the WINC1500 OTA callbacks
+ *
+ * \note Must be called after m2m_wifi_init(), every time the WINC1500 is
+ *       initialized.
+ *
+ * \return M2M_SUCCESS on success, otherwise a WINC1500 error code
+ */
+sint8 aws_wifi_ota_init(void)
+{
+    return m2m_ota_init(&aws_wifi_ota_update_callback, &aws_wifi_ota_notify_callback);
+}
+
+/**
+ * \brief Requests a WINC1500 firmware update from the given URL
+ *
+ * The download starts from aws_wifi_ota_process(). A URL already handled is
+ * ignored, the shadow delta keeps repeating it until the report is received.
+ *
+ * \param[in] url                   The HTTP(S) URL of the WINC1500 OTA image
+ *
+ * \return true if the update was requested
+ */
+bool aws_wifi_ota_request(const char *url)
+{
+    size_t url_length = (url != NULL) ? strlen(url) : 0;
+
+    if ((url_length == 0) || (url_length >= sizeof(g_ota_url)))
+    {
+        console_print_error_message("WINC1500 OTA: The download URL is missing or too long.");
+        return false;
+    }
+
+    switch (g_ota_state)
+    {
+    case AWS_WIFI_OTA_STATE_IDLE:
+    case AWS_WIFI_OTA_STATE_SUCCEEDED:
+    case AWS_WIFI_OTA_STATE_ROLLED_BACK:
+    case AWS_WIFI_OTA_STATE_FAILED:
+        if ((g_ota_state != AWS_WIFI_OTA_STATE_IDLE) && (strcmp(url, g_ota_url) == 0))
+        {
+            // Report the outcome again so the delta is cleared
+            g_ota_report_pending = true;
+            return false;
+        }
+        break;
+
+    default:
+        // Only one update at a time
+        return false;
+    }
+
+    memset(&g_ota_url[0], 0, sizeof(g_ota_url));
+    memcpy(&g_ota_url[0], url, url_length);
+
+    g_ota_status = OTA_STATUS_SUCSESS;
+    g_ota_request_ms = aws_wifi_ota_get_time_ms();
+    g_ota_download_ms = 0;
+    g_ota_switch_ms = 0;
+    g_ota_restart_ms = 0;
+    g_ota_connected_ms = 0;
+    g_ota_total_ms = 0;
+    g_ota_trial_failures = 0;
+
+    console_print_message("WINC1500 OTA: Update requested from:");
+    console_print_message(g_ota_url);
+    aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_REQUESTED);
+
+    return true;
+}
+
+/**
+ * \brief Starts the requested download and enforces the download and trial
+ *        timeouts
+ *
+ * Called by the AWS WIFI task after every event, while the WINC1500 is
+ * initialized.
+ *
+ * \param[in] wifi_connected        Whether the WINC1500 is connected to the access point
+ */
+void aws_wifi_ota_process(bool wifi_connected)
+{
+    uint32_t elapsed_ms = aws_wifi_ota_get_time_ms() - g_ota_phase_ms;
+
+    switch (g_ota_state)
+    {
+    case AWS_WIFI_OTA_STATE_REQUESTED:
+        if (!wifi_connected)
+        {
+            // Wait for the access point connection
+            break;
+        }
+
+        // The WINC1500 downloads the image on its own, the MQTT connection
+        // keeps running meanwhile
+        g_ota_update_count++;
+        aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_DOWNLOADING);
+        if (m2m_ota_start_update((uint8*)g_ota_url) != M2M_SUCCESS)
+        {
+            aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_FAILED);
+        }
+        break;
+
+    case AWS_WIFI_OTA_STATE_DOWNLOADING:
+        if (elapsed_ms >= AWS_WIFI_OTA_DOWNLOAD_TIMEOUT_MS)
+        {
+            m2m_ota_abort();
+            g_ota_status = OTA_STATUS_ABORTED;
+            g_ota_download_ms = elapsed_ms;
+            aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_FAILED);
+        }
+        break;
+
+    case AWS_WIFI_OTA_STATE_TRIAL:
+        if ((elapsed_ms < AWS_WIFI_OTA_TRIAL_TIMEOUT_MS) &&
+            (g_ota_trial_failures < AWS_WIFI_OTA_TRIAL_FAILURES_MAX))
+        {
+            break;
+        }
+
+        // The new image cannot reach AWS IoT, go back to the previous one
+        console_print_error_message("WINC1500 OTA: The new firmware did not connect to AWS IoT.");
+        aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_ROLLING_BACK);
+        if (m2m_ota_rollback() != M2M_SUCCESS)
+        {
+            aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_FAILED);
+        }
+        break;
+
+    default:
+        // Waiting for the WINC1500 or the AWS WIFI task
+        break;
+    }
+}
+
+/**
+ * \brief Returns how long the AWS WIFI task may wait before the next
+ *        aws_wifi_ota_process() call
+ */
+uint32_t aws_wifi_ota_get_timeout_ms(void)
+{
+    uint32_t elapsed_ms = aws_wifi_ota_get_time_ms() - g_ota_phase_ms;
+    uint32_t timeout_ms = 0;
+
+    switch (g_ota_state)
+    {
+    case AWS_WIFI_OTA_STATE_DOWNLOADING:
+        timeout_ms = AWS_WIFI_OTA_DOWNLOAD_TIMEOUT_MS;
+        break;
+
+    case AWS_WIFI_OTA_STATE_TRIAL:
+        timeout_ms = AWS_WIFI_OTA_TRIAL_TIMEOUT_MS;
+        break;
+
+    default:
+        return UINT32_MAX;
+    }
+
+    return (elapsed_ms < timeout_ms) ? (timeout_ms - elapsed_ms) : 0;
+}
+
+/**
+ * \brief Checks whether the WINC1500 is downloading an image
+ *
+ * The access point connection must be kept and the WINC1500 kept awake
+ * until the download completes.
+ */
+bool aws_wifi_ota_is_downloading(void)
+{
+    return (g_ota_state == AWS_WIFI_OTA_STATE_DOWNLOADING);
+}
+
+/**
+ * \brief Checks whether the WINC1500 must be reset to run the image it
+ *        switched to
+ */
+bool aws_wifi_ota_is_restart_pending(void)
+{
+    return g_ota_restart_pending;
+}
+
+/**
+ * \brief Called by the AWS WIFI task every time the WINC1500 was initialized
+ */
+void aws_wifi_ota_restarted(void)
+{
+    if (!g_ota_restart_pending)
+    {
+        return;
+    }
+    g_ota_restart_pending = false;
+    g_ota_restart_ms = aws_wifi_ota_get_time_ms();
+
+    if (g_ota_state == AWS_WIFI_OTA_STATE_ROLLING_BACK)
+    {
+        g_ota_rollback_count++;
+        aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_ROLLED_BACK);
+    }
+    else
+    {
+        aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_TRIAL);
+    }
+}
+
+/**
+ * \brief Called by the AWS WIFI task on every MQTT connection to AWS IoT
+ *
+ * Commits an image on trial, and reports the last update again on the new
+ * connection.
+ */
+void aws_wifi_ota_connected(void)
+{
+    if (g_ota_state == AWS_WIFI_OTA_STATE_TRIAL)
+    {
+        g_ota_connected_ms = aws_wifi_ota_get_time_ms() - g_ota_restart_ms;
+        aws_wifi_ota_set_state(AWS_WIFI_OTA_STATE_SUCCEEDED);
+    }
+
+    if (g_ota_state != AWS_WIFI_OTA_STATE_IDLE)
+    {
+        g_ota_report_pending = true;
+    }
+}
+
+/**
+ * \brief Called by the AWS WIFI task when connecting to AWS IoT failed
+ */
+void aws_wifi_ota_connect_failed(void)
+{
+    if (g_ota_state == AWS_WIFI_OTA_STATE_TRIAL)
+    {
+        g_ota_trial_failures++;
+    }
+}
+
+/**
+ * \brief Checks whether the update progress changed since the last report
+ */
+bool aws_wifi_ota_is_report_pending(void)
+{
+    return g_ota_report_pending;
+}
+
+/**
+ * \brief Adds the update progress to a shadow update message
+ *
+ * The URL is reported along with the progress so the shadow stops sending it
+ * as a delta.
+ *
+ * \param[in] update_message_object The shadow update message
+ */
+void aws_wifi_ota_set_reported(JSON_Object *update_message_object)
+{
+    tstrM2mRev wifi_version;
+    char firmware[16];
+
+    g_ota_report_pending = false;
+
+    json_object_dotset_string(update_message_object, "state.reported.wincOta.url", g_ota_url);
+    json_object_dotset_string(update_message_object, "state.reported.wincOta.state",
+                              g_ota_state_names[g_ota_state]);
+    json_object_dotset_number(update_message_object, "state.reported.wincOta.status", g_ota_status);
+    json_object_dotset_number(update_message_object, "state.reported.wincOta.downloadMs", g_ota_download_ms);
+    json_object_dotset_number(update_message_object, "state.reported.wincOta.switchMs", g_ota_switch_ms);
+    json_object_dotset_number(update_message_object, "state.reported.wincOta.restartMs", g_ota_connected_ms);
+    json_object_dotset_number(update_message_object, "state.reported.wincOta.totalMs",
+        (g_ota_total_ms > 0) ? g_ota_total_ms : (aws_wifi_ota_get_time_ms() - g_ota_request_ms));
+
+    if (m2m_wifi_get_firmware_version(&wifi_version) == M2M_SUCCESS)
+    {
+        sprintf(firmware, "%u.%u.%u", wifi_version.u8FirmwareMajor,
+                wifi_version.u8FirmwareMinor, wifi_version.u8FirmwarePatch);
+        json_object_dotset_string(update_message_object, "state.reported.wincOta.firmware", firmware);
+    }
+}
+
+/**
+ * \brief Gets the WINC1500 firmware update statistics
+ *
+ * \param[out] stats                The update statistics
+ */
+void aws_wifi_ota_get_stats(struct aws_wifi_ota_stats *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    stats->state = g_ota_state;
+    stats->ota_status = g_ota_status;
+    stats->download_ms = g_ota_download_ms;
+    stats->switch_ms = g_ota_switch_ms;
+    stats->restart_ms = g_ota_connected_ms;
+    stats->total_ms = g_ota_total_ms;
+    stats->update_count = g_ota_update_count;
+    stats->rollback_count = g_ota_rollback_count;
+}
@@ -0,0 +1,89 @@
+/**
+ * \file
+ * \brief AWS IoT WINC1500 Firmware Over The Air Update
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef AWS_WIFI_OTA_H
+#define AWS_WIFI_OTA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bsp/include/nm_bsp.h"
+#include "parson.h"
+
+// Defines
+#define AWS_WIFI_OTA_URL_SIZE_MAX           (256)    // Longest download URL, including the terminating null
+#define AWS_WIFI_OTA_DOWNLOAD_TIMEOUT_MS    (600000) // The download is aborted if the WINC1500 has not finished by then
+#define AWS_WIFI_OTA_TRIAL_TIMEOUT_MS       (120000) // Time the new firmware has to reconnect to AWS IoT before it is rolled back
+#define AWS_WIFI_OTA_TRIAL_FAILURES_MAX     (3)      // AWS IoT connect failures of the new firmware before it is rolled back
+
+/**
+ * \brief The WINC1500 firmware update states, reported in the thing shadow
+ */
+enum aws_wifi_ota_state
+{
+    AWS_WIFI_OTA_STATE_IDLE         = 0,  //! No update was requested
+    AWS_WIFI_OTA_STATE_REQUESTED    = 1,  //! The download URL was received
+    AWS_WIFI_OTA_STATE_DOWNLOADING  = 2,  //! The WINC1500 downloads the image into its inactive partition
+    AWS_WIFI_OTA_STATE_SWITCHING    = 3,  //! The WINC1500 marks the new image as the one to boot
+    AWS_WIFI_OTA_STATE_RESTARTING   = 4,  //! The WINC1500 is reset to boot the new image
+    AWS_WIFI_OTA_STATE_TRIAL        = 5,  //! The new image must reconnect to AWS IoT to be kept
+    AWS_WIFI_OTA_STATE_ROLLING_BACK = 6,  //! The previous image is restored
+    AWS_WIFI_OTA_STATE_SUCCEEDED    = 7,  //! The new image connected to AWS IoT
+    AWS_WIFI_OTA_STATE_ROLLED_BACK  = 8,  //! The previous image runs again
+    AWS_WIFI_OTA_STATE_FAILED       = 9   //! The download or switch failed, the running image is kept
+};
+
+struct aws_wifi_ota_stats
+{
+    uint32_t state;              //! The aws_wifi_ota_state
+    uint32_t ota_status;         //! The last WINC1500 tenuOtaUpdateStatus
+    uint32_t download_ms;        //! Time from the request to the end of the download
+    uint32_t switch_ms;          //! Time the WINC1500 took to switch the image
+    uint32_t restart_ms;         //! Time from the WINC1500 reset to the AWS IoT connection
+    uint32_t total_ms;           //! Time from the request to the final state
+    uint32_t update_count;       //! Number of updates started
+    uint32_t rollback_count;     //! Number of updates rolled back
+};
+
+sint8 aws_wifi_ota_init(void);
+
+bool aws_wifi_ota_request(const char *url);
+void aws_wifi_ota_process(bool wifi_connected);
+uint32_t aws_wifi_ota_get_timeout_ms(void);
+
+bool aws_wifi_ota_is_downloading(void);
+bool aws_wifi_ota_is_restart_pending(void);
+void aws_wifi_ota_restarted(void);
+void aws_wifi_ota_connected(void);
+void aws_wifi_ota_connect_failed(void);
+
+bool aws_wifi_ota_is_report_pending(void);
+void aws_wifi_ota_set_reported(JSON_Object *update_message_object);
+
+void aws_wifi_ota_get_stats(struct aws_wifi_ota_stats *stats);
+
+#endif // AWS_WIFI_OTA_H
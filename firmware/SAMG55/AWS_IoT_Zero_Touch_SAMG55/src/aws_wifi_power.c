@@ -0,0 +1,275 @@
+/**
+ * \file
+ * \brief AWS WIFI WINC1500 Power Save Functions
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "asf.h"
+#include "aws_wifi_power.h"
+#include "bsp/include/nm_bsp.h"
+#include "console.h"
+#include "driver/include/m2m_wifi.h"
+#include "driver/source/m2m_hif.h"
+
+// Global variables
+static uint32_t g_power_start_ms = 0;
+static uint32_t g_power_report_ms = 0;
+static bool     g_manual_sleep_active = false;
+static uint32_t g_manual_sleep_end_ms = 0;
+static uint32_t g_manual_sleep_count = 0;
+static uint32_t g_manual_sleep_ms = 0;
+
+/**
+ * \brief Enables the configured WINC1500 power save mode
+ *
+ * \note Must be called after m2m_wifi_init() and before connecting to the
+ *       access point, the listen interval is negotiated on association.
+ *
+ * \return M2M_SUCCESS on success, otherwise a WINC1500 error code
+ */
+sint8 aws_wifi_power_init(void)
+{
+    sint8 wifi_status = M2M_SUCCESS;
+    tstrM2mLsnInt listen_interval;
+
+    do 
+    {
+        // Reset the power save statistics
+        g_power_start_ms = nm_bsp_get_time_ms();
+        g_power_report_ms = g_power_start_ms;
+        g_manual_sleep_active = false;
+        g_manual_sleep_count = 0;
+        g_manual_sleep_ms = 0;
+
+        if (AWS_WIFI_POWER_SAVE_MODE == M2M_NO_PS)
+        {
+            // Break the do/while loop
+            break;
+        }
+
+        // Keep the DTIM broadcast wake ups so ARP requests are still answered
+        wifi_status = m2m_wifi_set_sleep_mode(AWS_WIFI_POWER_SAVE_MODE, 1);
+        if (wifi_status != M2M_SUCCESS)
+        {
+            // Break the do/while loop
+            break;
+        }
+
+        m2m_memset((uint8*)&listen_interval, 0, sizeof(listen_interval));
+        listen_interval.u16LsnInt = AWS_WIFI_LISTEN_INTERVAL;
+
+        wifi_status = m2m_wifi_set_lsn_int(&listen_interval);
+    } while (false);
+
+    return wifi_status;
+}
+
+/**
+ * \brief Gets the time between two WINC1500 listen wake ups
+ *
+ * The keep alive interval and the manual sleep are aligned on the listen
+ * period so the host SPI traffic lines up with the WINC1500 wake ups instead
+ * of adding new ones.
+ */
+uint32_t aws_wifi_power_get_listen_period_ms(void)
+{
+    return (uint32_t)((AWS_WIFI_LISTEN_INTERVAL * AWS_WIFI_BEACON_PERIOD_US) / 1000);
+}
+
+/**
+ * \brief Gets the MQTT keep alive interval in seconds
+ *
+ * The interval is in whole seconds, and a listen period is usually not, so
+ * the PINGREQ sent by keepalive() waits for the first listen wake up after
+ * the deadline. Of the intervals at most one listen period shorter than the
+ * maximum, the one whose deadline falls closest before a listen wake up is
+ * used, the longest one on a tie.
+ */
+unsigned short aws_wifi_power_get_keep_alive_interval(void)
+{
+    uint32_t listen_period_ms = aws_wifi_power_get_listen_period_ms();
+    uint32_t shortest_s = 0;
+    uint32_t keep_alive_s = AWS_WIFI_KEEP_ALIVE_MAX_S;
+    uint32_t wait_ms = 0;
+    uint32_t best_wait_ms = UINT32_MAX;
+
+    if (AWS_WIFI_POWER_SAVE_MODE == M2M_NO_PS || listen_period_ms == 0)
+    {
+        return AWS_WIFI_KEEP_ALIVE_MAX_S;
+    }
+
+    shortest_s = (listen_period_ms + 999) / 1000;
+    shortest_s = (AWS_WIFI_KEEP_ALIVE_MAX_S > shortest_s) ? (AWS_WIFI_KEEP_ALIVE_MAX_S - shortest_s) : 1;
+
+    for (uint32_t interval_s = AWS_WIFI_KEEP_ALIVE_MAX_S; interval_s >= shortest_s; interval_s--)
+    {
+        // Time from the deadline to the next listen wake up
+        wait_ms = (listen_period_ms - ((interval_s * 1000) % listen_period_ms)) % listen_period_ms;
+        if (wait_ms < best_wait_ms)
+        {
+            best_wait_ms = wait_ms;
+            keep_alive_s = interval_s;
+        }
+    }
+
+    return (unsigned short)keep_alive_s;
+}
+
+/**
+ * \brief Checks whether a manual sleep request is still outstanding
+ *
+ * While the WINC1500 is sleeping the AWS WIFI task skips running the MQTT
+ * client, since any SPI access would wake the WINC1500 up early.
+ */
+bool aws_wifi_power_is_sleeping(void)
+{
+    if (g_manual_sleep_active &&
+        (int32_t)(nm_bsp_get_time_ms() - g_manual_sleep_end_ms) >= 0)
+    {
+        g_manual_sleep_active = false;
+    }
+
+    return g_manual_sleep_active;
+}
+
+/**
+ * \brief Puts the WINC1500 to sleep until the next MQTT keep alive is due
+ *
+ * Only used in the M2M_PS_MANUAL mode, the automatic modes sleep on their
+ * own. The WINC1500 wakes one listen period before the ping timer expires so
+ * the next MQTTCycle() sends the PINGREQ on time. Incoming messages are
+ * buffered by the access point and delivered once the WINC1500 wakes up.
+ *
+ * \param[in] client                The connected MQTT client
+ */
+void aws_wifi_power_idle(MQTTClient *client)
+{
+    int sleep_ms = 0;
+
+    if (AWS_WIFI_POWER_SAVE_MODE != M2M_PS_MANUAL || client == NULL || client->isconnected != 1)
+    {
+        return;
+    }
+
+    // Stay awake for the PINGRESP, it is only allowed a few seconds
+    if (client->ping_outstanding)
+    {
+        return;
+    }
+
+    sleep_ms = TimerLeftMS(&client->ping_timer) - (int)aws_wifi_power_get_listen_period_ms();
+    if (sleep_ms < AWS_WIFI_MANUAL_SLEEP_MIN_MS)
+    {
+        return;
+    }
+
+    if (m2m_wifi_request_sleep((uint32)sleep_ms) != M2M_SUCCESS)
+    {
+        return;
+    }
+
+    g_manual_sleep_active = true;
+    g_manual_sleep_end_ms = nm_bsp_get_time_ms() + (uint32_t)sleep_ms;
+    g_manual_sleep_count++;
+    g_manual_sleep_ms += (uint32_t)sleep_ms;
+}
+
+/**
+ * \brief Gets the WINC1500 power save statistics
+ *
+ * \param[out] stats                The power save statistics
+ */
+void aws_wifi_power_get_stats(struct aws_wifi_power_stats *stats)
+{
+    tstrHifSleepStats hif_stats;
+
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    hif_get_sleep_stats(&hif_stats);
+
+    stats->wake_count = hif_stats.u32WakeCnt;
+    stats->sleep_count = hif_stats.u32SleepCnt;
+    stats->awake_ms = hif_stats.u32AwakeMs;
+    stats->elapsed_ms = nm_bsp_get_time_ms() - g_power_start_ms;
+    stats->manual_sleep_count = g_manual_sleep_count;
+    stats->manual_sleep_ms = g_manual_sleep_ms;
+}
+
+/**
+ * \brief Prints the WINC1500 power save statistics to the console
+ *
+ * The duty cycle is the share of time the host held the WINC1500 awake. The
+ * beacon wake ups the WINC1500 does on its own are not visible to the host.
+ *
+ * \param[in] force                 Print even if the report interval has not elapsed
+ */
+void aws_wifi_power_report(bool force)
+{
+    struct aws_wifi_power_stats stats;
+    uint32_t duty_cycle = 0;
+    uint32_t time_ms = nm_bsp_get_time_ms();
+    char message[160];
+
+    if (!force && (time_ms - g_power_report_ms) < AWS_WIFI_POWER_REPORT_INTERVAL_MS)
+    {
+        return;
+    }
+    g_power_report_ms = time_ms;
+
+    if (AWS_WIFI_POWER_SAVE_MODE == M2M_NO_PS)
+    {
+        console_print_message("WINC1500 Power Save: Disabled");
+        return;
+    }
+
+    aws_wifi_power_get_stats(&stats);
+
+    // Duty cycle in tenths of a percent
+    if (stats.elapsed_ms > 0)
+    {
+        duty_cycle = (uint32_t)(((uint64_t)stats.awake_ms * 1000) / stats.elapsed_ms);
+    }
+
+    memset(&message[0], 0, sizeof(message));
+    sprintf(&message[0], "WINC1500 Power Save: %lu wakes, %lu sleeps, awake %lu of %lu ms (%lu.%lu%% duty cycle)",
+            (unsigned long)stats.wake_count, (unsigned long)stats.sleep_count,
+            (unsigned long)stats.awake_ms, (unsigned long)stats.elapsed_ms,
+            (unsigned long)(duty_cycle / 10), (unsigned long)(duty_cycle % 10));
+    console_print_message(message);
+
+    if (AWS_WIFI_POWER_SAVE_MODE == M2M_PS_MANUAL)
+    {
+        memset(&message[0], 0, sizeof(message));
+        sprintf(&message[0], "WINC1500 Power Save: %lu manual sleep requests, %lu ms requested",
+                (unsigned long)stats.manual_sleep_count, (unsigned long)stats.manual_sleep_ms);
+        console_print_message(message);
+    }
+}
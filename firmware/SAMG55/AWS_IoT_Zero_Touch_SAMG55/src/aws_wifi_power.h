@@ -0,0 +1,67 @@
+/**
+ * \file
+ * \brief AWS WIFI WINC1500 Power Save Functions
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef AWS_WIFI_POWER_H
+#define AWS_WIFI_POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bsp/include/nm_bsp.h"
+#include "driver/include/m2m_types.h"
+#include "MQTTClient.h"
+
+// Defines
+#define AWS_WIFI_POWER_SAVE_MODE            (M2M_PS_DEEP_AUTOMATIC) // M2M_NO_PS, M2M_PS_DEEP_AUTOMATIC or M2M_PS_MANUAL
+#define AWS_WIFI_LISTEN_INTERVAL            (5)      // Number of AP beacon periods the WINC1500 sleeps between listens
+#define AWS_WIFI_BEACON_PERIOD_US           (102400) // Nominal AP beacon period of 100 TU
+#define AWS_WIFI_KEEP_ALIVE_MAX_S           (900)    // AWS will disconnect after 30min unless kept alive with a PING message
+#define AWS_WIFI_MANUAL_SLEEP_MIN_MS        (200)    // Shortest sleep worth requesting in the manual power save mode
+#define AWS_WIFI_POWER_REPORT_INTERVAL_MS   (60000)  // Interval between the power save reports on the console
+
+struct aws_wifi_power_stats
+{
+    uint32_t wake_count;         //! Number of host initiated WINC1500 wakes
+    uint32_t sleep_count;        //! Number of host initiated WINC1500 sleeps
+    uint32_t awake_ms;           //! Time the host held the WINC1500 awake
+    uint32_t elapsed_ms;         //! Time since the power save mode was enabled
+    uint32_t manual_sleep_count; //! Number of manual sleep requests
+    uint32_t manual_sleep_ms;    //! Total time requested by the manual sleep requests
+};
+
+sint8 aws_wifi_power_init(void);
+
+uint32_t aws_wifi_power_get_listen_period_ms(void);
+unsigned short aws_wifi_power_get_keep_alive_interval(void);
+
+bool aws_wifi_power_is_sleeping(void);
+void aws_wifi_power_idle(MQTTClient *client);
+
+void aws_wifi_power_get_stats(struct aws_wifi_power_stats *stats);
+void aws_wifi_power_report(bool force);
+
+#endif // AWS_WIFI_POWER_H
@@ -35,23 +35,38 @@
 #include "atcacert/atcacert_host_hw.h"
 #include "cert_def_1_signer.h"
 #include "cert_def_2_device.h"
+#include "aws_event.h"
+#include "aws_keepalive.h"
+#include "aws_publish_queue.h"
 #include "aws_status.h"
+#include "aws_wifi_ota.h"
+#include "aws_wifi_power.h"
 #include "aws_wifi_task.h"
 #include "common/include/nm_common.h"
+#include "conf_winc.h"
 #include "console.h"
 #include "cryptoauthlib.h"
+#include "ecc_devices.h"
+#include "ecc_session.h"
+#include "ecc_verify.h"
+#include "hex_codec.h"
 #include "driver/include/m2m_periph.h"
 #include "driver/include/m2m_ssl.h"
 #include "driver/include/m2m_types.h"
 #include "driver/include/m2m_wifi.h"
 #include "kit_protocol_utilities.h"
+#include "low_power.h"
 #include "MQTTClient.h"
 #include "parson.h"
 #include "provisioning_task.h"
 
 // Define
-#define AWS_WIFI_TASK_DELAY         (100 / portTICK_PERIOD_MS)
-#define AWS_WIFI_CONNECT_DELAY      (50000 / portTICK_PERIOD_MS)
+#define AWS_WIFI_CONNECT_DELAY_MS   (50000)  // Wait between the WIFI connect attempts, while events are still handled
+#define AWS_WIFI_EVENT_TIMEOUT_MAX_MS  (60000)  // Longest the task blocks, so the periodic power reports still run
+#define AWS_WIFI_BUTTON_COALESCE_MS    (250)    // Pushbutton presses within this window are published in one shadow update
+#define AWS_WIFI_MQTT_PERSISTENT_SESSION (1)    // 1 keeps the MQTT session and its QOS1 subscription on the broker across reconnects
+#define AWS_WIFI_METRICS_INTERVAL_MS   (300000) // Interval between the MQTT client metrics messages
+#define AWS_WIFI_VERIFY_BATCH_MAX      (4)      // Server certificate signatures verified at once, spread over the ECCx08A devices
 
 #define AWS_PORT                    (8883)
 
@@ -64,9 +79,13 @@
 #define INIT_CERT_BUFFER_LEN        (MAX_TLS_CERT_LENGTH*sizeof(uint32) - TLS_FILE_NAME_MAX*2 - SIGNER_CERT_MAX_LEN - DEVICE_CERT_MAX_LEN)
 
 #define MQTT_BUFFER_SIZE            (1024)
+#define MQTT_DELTA_BUFFER_SIZE      (4096)  // Longest shadow delta document, streamed in past the MQTT read buffer
+#define AWS_WIFI_RX_BUFFER_SIZE     (4096)  // Power of two, holds the longest MQTT read plus a whole WINC1500 recv()
 #define MQTT_COMMAND_TIMEOUT_MS     (2000)
-#define MQTT_YEILD_TIMEOUT_MS       (500)
-#define MQTT_KEEP_ALIVE_INTERVAL_S  (900) // AWS will disconnect after 30min unless kept alive with a PING message
+
+#if ((AWS_WIFI_LISTEN_INTERVAL * AWS_WIFI_BEACON_PERIOD_US) / 1000) >= MQTT_COMMAND_TIMEOUT_MS
+#error "The WINC1500 listen period must be shorter than the MQTT command timeout"
+#endif
 
 
 // Global variables
@@ -74,6 +93,16 @@
 //! The current state of the AWS WIFI task
 static enum aws_iot_state g_aws_wifi_state = AWS_STATE_WINC1500_INIT;
 
+//! Whether the provisioning task has initialized the ATECCx08A
+static bool g_crypto_ready = false;
+//! Whether the ATECCx08A holds valid AWS IoT and WIFI credentials
+static bool g_provisioned = false;
+
+//! Given by the WINC1500 interrupt to wake up socket operations in progress
+static SemaphoreHandle_t g_winc_semaphore = NULL;
+//! Whether an AWS_EVENT_WINC_INTERRUPT event is already queued
+static volatile bool g_winc_event_pending = false;
+
 //! Array of private key slots to rotate through the ECDH calculations
 static uint16 g_ecdh_key_slot[] = {2};
 //! Index into the ECDH private key slots array
@@ -84,17 +113,20 @@ static struct socket_connection g_socket_connection;
 static uint8_t g_host_ip_address[4];
 
 static bool g_is_connected = false;
+static bool g_wifi_connected = false;
+static bool g_wifi_disconnect_requested = false;
 
 
 static MQTTClient g_mqtt_client;
 static Network    g_mqtt_network;
 
-static uint8_t  g_rx_buffer[MQTT_BUFFER_SIZE];
-static uint32_t g_rx_buffer_length = 0;
-static uint32_t g_rx_buffer_location = 0;
+//! Receive ring buffer of the AWS TLS connection
+static uint8_t  g_rx_buffer[AWS_WIFI_RX_BUFFER_SIZE];
 
 static uint8_t  g_mqtt_rx_buffer[MQTT_BUFFER_SIZE];
 static uint8_t  g_mqtt_tx_buffer[MQTT_BUFFER_SIZE];
+//! The shadow delta document put back together from its MQTT payload chunks
+static char     g_mqtt_delta_buffer[MQTT_DELTA_BUFFER_SIZE];
 
 // AWS has a limit of 128 bytes for the MQTT client ID and thing name
 // See http://docs.aws.amazon.com/general/latest/gr/aws_service_limits.html#limits_iot
@@ -102,43 +134,21 @@ static char g_mqtt_client_id[129];
 static char g_thing_name[129];
 static char g_mqtt_update_topic_name[257];
 static char g_mqtt_update_delta_topic_name[257];
-
-static enum wifi_status g_wifi_status = WIFI_STATUS_UNKNOWN;
-
-static uint32_t g_tx_size = 0;
+static char g_mqtt_metrics_topic_name[257];
 
 static struct demo_button_state g_demo_button_state;
 
-typedef struct {
-    int code;
-    const char* name;
-} ErrorInfo;
-
-#define NEW_SOCKET_ERROR(err) {err, #err}
-static const ErrorInfo g_socket_error_info[] =
-{
-    NEW_SOCKET_ERROR(SOCK_ERR_NO_ERROR),
-    NEW_SOCKET_ERROR(SOCK_ERR_INVALID_ADDRESS),
-    NEW_SOCKET_ERROR(SOCK_ERR_ADDR_ALREADY_IN_USE),
-    NEW_SOCKET_ERROR(SOCK_ERR_MAX_TCP_SOCK),
-    NEW_SOCKET_ERROR(SOCK_ERR_MAX_UDP_SOCK),
-    NEW_SOCKET_ERROR(SOCK_ERR_INVALID_ARG),
-    NEW_SOCKET_ERROR(SOCK_ERR_MAX_LISTEN_SOCK),
-    NEW_SOCKET_ERROR(SOCK_ERR_INVALID),
-    NEW_SOCKET_ERROR(SOCK_ERR_ADDR_IS_REQUIRED),
-    NEW_SOCKET_ERROR(SOCK_ERR_CONN_ABORTED),
-    NEW_SOCKET_ERROR(SOCK_ERR_TIMEOUT),
-    NEW_SOCKET_ERROR(SOCK_ERR_BUFFER_FULL),
-};
+//! Whether pushbutton presses are waiting for the coalescing window to publish them
+static bool  g_button_update_pending = false;
+//! Ends the pushbutton coalescing window
+static Timer g_button_coalesce_timer;
+//! Time of the next MQTT client metrics message
+static Timer g_metrics_timer;
+//! Whether a failed WIFI connect waits for g_wifi_connect_timer to try again
+static bool  g_wifi_connect_retry_pending = false;
+//! Time of the next WIFI connect attempt
+static Timer g_wifi_connect_timer;
 
-static const char* get_socket_error_name(int error_code)
-{
-    for (size_t i = 0; i < sizeof(g_socket_error_info) / sizeof(g_socket_error_info[0]); i++)
-        if (error_code == g_socket_error_info[i].code)
-            return g_socket_error_info[i].name;
-    return "UNKNOWN";
-}
- 
 static sint8 ecdh_derive_client_shared_secret(tstrECPoint *server_public_key,
                                               uint8 *ecdh_shared_secret,
                                               tstrECPoint *client_public_key)
@@ -205,18 +215,69 @@ static sint8 ecdh_derive_key_pair(tstrECPoint *server_public_key)
     return status;
 }
 
+/**
+ * \brief A server certificate signature retrieved from the WINC1500.
+ */
+struct aws_wifi_verify_request
+{
+    uint8             hash[80];
+    uint8             signature[80];
+    tstrECPoint       key;
+    struct ecc_verify verify;
+};
+
+//! The server certificate signatures verified at once, kept off the task stack
+static struct aws_wifi_verify_request g_verify_requests[AWS_WIFI_VERIFY_BATCH_MAX];
+static struct ecc_job                 g_verify_jobs[AWS_WIFI_VERIFY_BATCH_MAX];
+
+/**
+ * \brief Verifies a batch of server certificate signatures
+ *
+ * The signatures of the chain are independent, so they are verified
+ * on all ECCx08A devices of the pool at once, or on the MCU when the
+ * verify mode says so.
+ */
+static sint8 ecdsa_verify_batch(size_t batch_count)
+{
+    ATCA_STATUS atca_status = ATCA_GEN_FAIL;
+
+    if (batch_count == 0)
+    {
+        return M2M_SUCCESS;
+    }
+
+    atca_status = ecc_verify_run(&g_verify_jobs[0], batch_count);
+    if (atca_status != ATCA_SUCCESS)
+    {
+        return M2M_ERR_FAIL;
+    }
+
+    for (size_t index = 0; index < batch_count; index++)
+    {
+        if (!g_verify_requests[index].verify.is_verified)
+        {
+            M2M_INFO("ECDSA SigVerif FAILED\n");
+            return M2M_ERR_FAIL;
+        }
+    }
+
+    return M2M_SUCCESS;
+}
+
 static sint8 ecdsa_process_sign_verify_request(uint32 number_of_signatures)
 {
     sint8 status = M2M_ERR_FAIL;
-    tstrECPoint	Key;
+    struct aws_wifi_verify_request *request = NULL;
     uint32 index = 0;
-    uint8 signature[80];
-    uint8 hash[80] = {0};
+    size_t batch_count = 0;
     uint16 curve_type = 0;
     
     for(index = 0; index < number_of_signatures; index++)
     {
-        status = m2m_ssl_retrieve_cert(&curve_type, hash, signature, &Key);
+        request = &g_verify_requests[batch_count];
+        memset(request->hash, 0, sizeof(request->hash));
+
+        status = m2m_ssl_retrieve_cert(&curve_type, request->hash, request->signature, &request->key);
 
         if (status != M2M_SUCCESS)
         {
@@ -226,22 +287,19 @@ static sint8 ecdsa_process_sign_verify_request(uint32 number_of_signatures)
 
         if(curve_type == EC_SECP256R1)
         {
-            bool is_verified = false;
-            
-            status = atcab_verify_extern(hash, signature, Key.X, &is_verified);
-            if(status == ATCA_SUCCESS)
-            {
-                status = (is_verified == true) ? M2M_SUCCESS : M2M_ERR_FAIL;
-                if(is_verified == false)
-                {
-                    M2M_INFO("ECDSA SigVerif FAILED\n");
-                }
-            }
-            else
-            {
-                status = M2M_ERR_FAIL;
-            }
-            
+            request->verify.message_digest = request->hash;
+            request->verify.signature      = request->signature;
+            request->verify.public_key     = request->key.X;
+            ecc_devices_init_verify_job(&g_verify_jobs[batch_count], &request->verify);
+            batch_count++;
+        }
+
+        // Verify once the batch is full or the last signature was retrieved
+        if ((batch_count == AWS_WIFI_VERIFY_BATCH_MAX) || (index == (number_of_signatures - 1)))
+        {
+            status = ecdsa_verify_batch(batch_count);
+            batch_count = 0;
+
             if(status != M2M_SUCCESS)
             {
                 m2m_ssl_stop_processing_certs();
@@ -371,19 +429,11 @@ static size_t winc_certs_get_total_files_size(const tstrTlsSrvSecHdr* header)
 static const char* bin2hex(const void* data, size_t data_size)
 {
     static char buf[256];
-    static char hex[] = "0123456789abcdef";
-    const uint8_t* data8 = data;
     
     if (data_size*2 > sizeof(buf)-1)
     return "[buf too small]";
     
-    for (size_t i = 0; i < data_size; i++)
-    {
-        buf[i*2 + 0] = hex[(*data8) >> 4];
-        buf[i*2 + 1] = hex[(*data8) & 0xF];
-        data8++;
-    }
-    buf[data_size*2] = 0;
+    buf[hex_codec_encode(data, data_size, buf, false)] = 0;
     
     return buf;
 }
@@ -456,6 +506,9 @@ static sint8 ecc_transfer_certificates(uint8_t subject_key_id[20])
 	char *signer_cert_filename = NULL;
 	uint32 sector_buffer[MAX_TLS_CERT_LENGTH];
 	
+    // Read the certificates from the ATECCx08A in one wake session
+    ecc_session_begin();
+
     do 
     {
 	    // Clear cert chain buffer
@@ -597,6 +650,8 @@ static sint8 ecc_transfer_certificates(uint8_t subject_key_id[20])
         }
     } while (false);
 
+    ecc_session_end();
+
 	if (atca_status)
 	{
     	M2M_ERR("eccSendCertsToWINC() failed with ret=%d", atca_status);
@@ -606,15 +661,37 @@ static sint8 ecc_transfer_certificates(uint8_t subject_key_id[20])
 	return status;
 }
 
+/**
+ * \brief Starts the DNS lookup of the AWS IoT hostname
+ *
+ * The DNS resolve handler connects to AWS IoT once the address is known.
+ */
+static void aws_wifi_resolve_host(void)
+{
+    ATCA_STATUS atca_status = ATCA_STATUS_UNKNOWN;
+    char  hostname[SLOT8_HOSTNAME_SIZE];
+    uint32_t hostname_length = sizeof(hostname);
+
+    atca_status = provisioning_get_hostname(&hostname_length, hostname);
+    if (atca_status == ATCA_SUCCESS)
+    {
+        gethostbyname((uint8*)hostname);
+    }
+    else
+    {
+        console_print_error_message("Unable to retrieve the provisioning AWS hostname.");
+        
+        // Notify the state machine to disconnect from the AWS IoT
+        aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_AWS_CONNECT_FAILURE, 0);
+    }
+}
+
 static void aws_wifi_callback(uint8 u8MsgType, void *pvMsg)
 {
     tstrM2mWifiStateChanged *wifi_state_changed = NULL;
     tstrM2MIPConfig *ip_config = NULL;
     tstrSystemTime *system_time = NULL;
-    ATCA_STATUS atca_status = ATCA_STATUS_UNKNOWN;
     uint8 *ip_address = NULL;
-	char  hostname[SLOT8_HOSTNAME_SIZE];
-	uint32_t hostname_length = sizeof(hostname);
     char message[256];
     
     switch (u8MsgType)
@@ -625,22 +702,16 @@ static void aws_wifi_callback(uint8 u8MsgType, void *pvMsg)
         switch (wifi_state_changed->u8CurrState)
         {
         case M2M_WIFI_CONNECTED:
+            g_wifi_connected = true;
             console_print_message("WINC1500 WIFI: Connected to the WIFI access point.");
             break;
         
         case M2M_WIFI_DISCONNECTED:
-            if (wifi_state_changed->u8CurrState == M2M_WIFI_CONNECTED)
-            {
-                // Set the state to disconnect from the AWS IoT
-                g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
-            }
-            else
-            {
-                console_print_message("WINC1500 WIFI: Disconnected from the WIFI access point.");
+            g_wifi_connected = false;
+            console_print_message("WINC1500 WIFI: Disconnected from the WIFI access point.");
 
-                // Set the state to disconnect from the AWS IoT
-                g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;
-            }
+            // Notify the state machine to reconnect
+            aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_WIFI_DISCONNECTED, 0);
             break;
         
         default:
@@ -662,18 +733,7 @@ static void aws_wifi_callback(uint8 u8MsgType, void *pvMsg)
                 ip_address[0], ip_address[1], ip_address[3], ip_address[4]);
         console_print_message(message);
 
-        atca_status = provisioning_get_hostname(&hostname_length, hostname);
-        if (atca_status == ATCA_SUCCESS)
-        {
-            gethostbyname((uint8*)hostname);
-        }
-        else
-        {
-            console_print_error_message("Unable to retrieve the provisioning AWS hostname.");
-            
-            // Set the state to disconnect from the AWS IoT
-            g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
-        }
+        aws_wifi_resolve_host();
         break;
         
     case M2M_WIFI_RESP_GET_SYS_TIME:
@@ -713,94 +773,16 @@ static void aws_wifi_ssl_callback(uint8 u8MsgType, void *pvMsg)
 
 static void aws_wifi_socket_handler(SOCKET sock, uint8 u8Msg, void *pvMsg)
 {
-    tstrSocketConnectMsg *socket_connect_message = NULL;
-    tstrSocketRecvMsg *socket_receive_message = NULL;
-    sint16 *bytes_sent = NULL;
-    
-    // Check for the WINC1500 WIFI socket events
-    switch (u8Msg)
-    {
-    case SOCKET_MSG_CONNECT:
-        socket_connect_message = (tstrSocketConnectMsg*)pvMsg;
-        if (socket_connect_message != NULL)
-        {
-            if (socket_connect_message->s8Error == SOCK_ERR_NO_ERROR)
-            {
-                // Set the state to connected to the AWS IoT
-                g_aws_wifi_state = AWS_STATE_AWS_CONNECTED;
-            }
-            else
-            {
-                // An error has occurred
-                printf("SOCKET_MSG_CONNECT error %s(%d)\r\n", get_socket_error_name(socket_connect_message->s8Error), socket_connect_message->s8Error);
-                
-                // Set the state to disconnect from the AWS IoT
-                g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
-            }
-        }
-        break;
-    
-    case SOCKET_MSG_RECV:
-    case SOCKET_MSG_RECVFROM:
-        socket_receive_message = (tstrSocketRecvMsg*)pvMsg;
-        if (socket_receive_message != NULL)
-        {
-            if (socket_receive_message->s16BufferSize >= 0)
-            {
-                g_rx_buffer_length += socket_receive_message->s16BufferSize;
-
-                // The message was received
-                if (socket_receive_message->u16RemainingSize == 0)
-                {
-                    g_wifi_status = WIFI_STATUS_MESSAGE_RECEIVED;
-                }
-                //printf("%s: SOCKET_MSG_RECV %d\r\n", __FUNCTION__, (int)socket_receive_message->s16BufferSize);
-            }
-            else
-            {
-                if (socket_receive_message->s16BufferSize == SOCK_ERR_TIMEOUT)
-                {
-                    // A timeout has occurred
-                    g_wifi_status = WIFI_STATUS_TIMEOUT;
-                }
-                else
-                {
-                    // An error has occurred
-                    g_wifi_status = WIFI_STATUS_ERROR;
-
-                    // Set the state to disconnect from the AWS IoT
-                    g_aws_wifi_state = AWS_STATE_WIFI_DISCONNECT;
-                }
-            }
-        }
-        break;
-        
-    case SOCKET_MSG_SEND:
-        bytes_sent = (sint16*)pvMsg;
-        
-        if (*bytes_sent <= 0 || *bytes_sent > (int32_t)g_tx_size)
-        {
-            // Seen an odd instance where bytes_sent is way more than the requested bytes sent.
-            // This happens when we're expecting an error, so were assuming this is an error
-            // condition.
-
-            g_wifi_status = WIFI_STATUS_ERROR;
+    struct socket_connection *connection = aws_socket_find(sock);
 
-            // Set the state to disconnect from the AWS IoT
-            g_aws_wifi_state = AWS_STATE_WIFI_DISCONNECT;
-        }
-        else if (*bytes_sent > 0)
-        {
-            // The message was sent
-            g_wifi_status = WIFI_STATUS_MESSAGE_SENT;
-        }
-        //printf("%s: SOCKET_MSG_SEND %d\r\n", __FUNCTION__, (int)*bytes_sent);
-    break;
-
-    default:
-        printf("%s: unhandled message %d\r\n", __FUNCTION__, (int)u8Msg);
-        // Do nothing
-        break;
+    // Dispatch the WINC1500 WIFI socket events to the connection of the socket
+    if (connection != NULL)
+    {
+        aws_socket_handle_message(connection, u8Msg, pvMsg);
+    }
+    else
+    {
+        printf("%s: unhandled socket %d message %d\r\n", __FUNCTION__, (int)sock, (int)u8Msg);
     }
 }
 
@@ -833,8 +815,8 @@ static void aws_wifi_dns_resolve_handler(uint8 *pu8DomainName, uint32 u32ServerI
             {
                 console_print_error_message("Failed to create the socket.");
                 
-                // Set the state to disconnect from the AWS IoT
-                g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+                // Notify the state machine to disconnect from the AWS IoT
+                aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_AWS_CONNECT_FAILURE, 0);
                 
                 // Break the do/while loop
                 break;
@@ -864,15 +846,30 @@ static void aws_wifi_dns_resolve_handler(uint8 *pu8DomainName, uint32 u32ServerI
                 // Close the socket
                 close(new_socket);
                 
-                // Set the state to disconnect from the AWS IoT
-                g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+                // Notify the state machine to disconnect from the AWS IoT
+                aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_AWS_CONNECT_FAILURE, 0);
                 
                 // Break the do/while loop
                 break;
             }
 
-            // Save the new socket connection information
-            g_socket_connection.socket    = new_socket;
+            // Save the new socket connection information, its socket events are
+            // dispatched to it from now on
+            if (!aws_socket_open(&g_socket_connection, new_socket, g_rx_buffer,
+                                 sizeof(g_rx_buffer), g_aws_wifi_event_queue))
+            {
+                console_print_error_message("Failed to open the socket connection.");
+                
+                // Close the socket, no events are dispatched for it
+                close(new_socket);
+                g_socket_connection.socket = SOCK_ERR_INVALID;
+                
+                // Notify the state machine to disconnect from the AWS IoT
+                aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_AWS_CONNECT_FAILURE, 0);
+                
+                // Break the do/while loop
+                break;
+            }
             g_socket_connection.address   = socket_address.sin_addr.s_addr;
             g_socket_connection.port      = AWS_PORT;
         } while (false);
@@ -883,17 +880,18 @@ static void aws_wifi_dns_resolve_handler(uint8 *pu8DomainName, uint32 u32ServerI
                 
         console_print_error_message("WINC1500 DNS lookup failed.");
                 
-        // Set the state to disconnect from the AWS IoT
-        g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+        // Notify the state machine to disconnect from the AWS IoT
+        aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_AWS_CONNECT_FAILURE, 0);
     }
 }
 
-static void aws_mqtt_shadow_update_delta_callback(MessageData *data)
+static void aws_mqtt_process_shadow_update_delta(char *payload, size_t length)
 {
     JSON_Value *delta_message_value = NULL;
     JSON_Object *delta_message_object = NULL;
     JSON_Object *led_state_object = NULL;
     const char *led_status = NULL;
+    const char *ota_url = NULL;
     char led_str[] = "led1";
     int i;
     ioport_pin_t led_pin;
@@ -901,7 +899,7 @@ static void aws_mqtt_shadow_update_delta_callback(MessageData *data)
     do 
     {
         // Parse the LED update message
-        delta_message_value   = json_parse_string((char*)data->message->payload);
+        delta_message_value   = json_parse_string(payload);
         delta_message_object  = json_value_get_object(delta_message_value);
         
         led_state_object = json_object_get_object(delta_message_object, "state");
@@ -914,7 +912,7 @@ static void aws_mqtt_shadow_update_delta_callback(MessageData *data)
         // Print the received MQTT LED update message
         console_print_message("\r\n");
         console_print_message("Received MQTT Shadow Update Delta Message:");
-        console_print_hex_dump(data->message->payload, data->message->payloadlen);
+        console_print_hex_dump(payload, length);
         console_print_message("\r\n");
 
         // Set the LED states
@@ -934,6 +932,13 @@ static void aws_mqtt_shadow_update_delta_callback(MessageData *data)
                 oled1_led_set_state(led_pin, (strcmp(led_status, "on") == 0) ? OLED1_LED_ON : OLED1_LED_OFF);
             }
         }
+
+        // Start a WINC1500 firmware update, its progress is reported separately
+        ota_url = json_object_dotget_string(led_state_object, "wincOta.url");
+        if (ota_url != NULL)
+        {
+            aws_wifi_ota_request(ota_url);
+        }
     } while (false);
 
     // Free allocated memory
@@ -943,6 +948,42 @@ static void aws_mqtt_shadow_update_delta_callback(MessageData *data)
     aws_wifi_publish_shadow_update_message(g_demo_button_state);
 }
 
+/**
+ * \brief Collects the chunks of a shadow delta and processes the whole document
+ *
+ * A delta longer than the MQTT read buffer arrives in several calls, a
+ * shorter one in a single call.
+ */
+static void aws_mqtt_shadow_update_delta_chunk_callback(MessageChunkData *data)
+{
+    char message[128];
+
+    if (data->totallen >= sizeof(g_mqtt_delta_buffer))
+    {
+        if (data->offset == 0)
+        {
+            sprintf(message, "Dropped a %lu byte MQTT shadow update delta message, the limit is %u bytes.",
+                    (unsigned long)data->totallen, (unsigned int)(sizeof(g_mqtt_delta_buffer) - 1));
+            console_print_error_message(message);
+        }
+        return;
+    }
+
+    memcpy(&g_mqtt_delta_buffer[data->offset], data->message->payload, data->message->payloadlen);
+    if ((data->offset + data->message->payloadlen) == data->totallen)
+    {
+        g_mqtt_delta_buffer[data->totallen] = 0;
+        aws_mqtt_process_shadow_update_delta(g_mqtt_delta_buffer, data->totallen);
+    }
+}
+
+static void aws_mqtt_shadow_update_delta_callback(MessageData *data)
+{
+    MessageChunkData chunk_data = {data->message, data->topicName, 0, data->message->payloadlen};
+
+    aws_mqtt_shadow_update_delta_chunk_callback(&chunk_data);
+}
+
 static void aws_wifi_disable_pullups(void)
 {
     uint32 pin_mask = 
@@ -969,10 +1010,47 @@ static unsigned short aws_wifi_get_message_id(void)
     return message_id;
 }
 
+/**
+ * \brief Called from the WINC1500 interrupt, after the driver has counted it
+ */
+static void aws_wifi_winc_isr(void)
+{
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    // Wake up a socket operation waiting on the WINC1500
+    xSemaphoreGiveFromISR(g_winc_semaphore, &higher_priority_task_woken);
+
+    // Wake up the task waiting for events, one queued interrupt event is enough
+    if (!g_winc_event_pending)
+    {
+        g_winc_event_pending = aws_event_post_from_isr(g_aws_wifi_event_queue,
+                                                       AWS_EVENT_WINC_INTERRUPT, 0);
+    }
+
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+/**
+ * \brief Waits for the WINC1500 interrupt, then handles the WINC1500 events
+ *
+ * Used while a socket operation is in progress. The socket callbacks update
+ * the status the caller is waiting on, other events are queued for the state
+ * machine.
+ *
+ * \param[in] timeout_ms            The longest time to wait for the interrupt
+ */
+void aws_wifi_wait_for_winc(uint32_t timeout_ms)
+{
+    xSemaphoreTake(g_winc_semaphore, (TickType_t)((timeout_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS));
+
+    m2m_wifi_handle_events(NULL);
+}
+
 static sint8 aws_wifi_init(void)
 {
     sint8 wifi_status = M2M_SUCCESS;
     tstrWifiInitParam wifi_paramaters;
+    bool spi_enabled = false;
     
     do 
     {
@@ -986,9 +1064,23 @@ static sint8 aws_wifi_init(void)
         m2m_memset((uint8*)&wifi_paramaters, 0, sizeof(wifi_paramaters));
         wifi_paramaters.pfAppWifiCb = aws_wifi_callback;
     
+        // Wake up the AWS WIFI task from the WINC1500 interrupt
+        if (g_winc_semaphore == NULL)
+        {
+            g_winc_semaphore = xSemaphoreCreateBinary();
+        }
+
         // Initialize the WINC1500 WIFI module
         nm_bsp_init();
+        nm_bsp_register_app_isr(&aws_wifi_winc_isr);
+        spi_enabled = spi_is_enabled(CONF_WINC_SPI);
         wifi_status = m2m_wifi_init(&wifi_paramaters);
+        if (!spi_enabled && spi_is_enabled(CONF_WINC_SPI))
+        {
+            // The WINC1500 interrupt pin is not a fast startup input and
+            // cannot wake the device from the wait modes
+            low_power_replace_flexcom_lock(SLEEPMGR_SLEEP_WFI);
+        }
         if (wifi_status != M2M_SUCCESS)
         {
             // Break the do/while loop
@@ -1009,6 +1101,14 @@ static sint8 aws_wifi_init(void)
             break;
         }
 
+        // Receive the WINC1500 firmware update results
+        wifi_status = aws_wifi_ota_init();
+        if (wifi_status != M2M_SUCCESS)
+        {
+            // Break the do/while loop
+            break;
+        }
+
         // Set the active WINC1500 TLS cipher suites
          wifi_status = m2m_ssl_set_active_ciphersuites(SSL_ECC_ONLY_CIPHERS);
         if (wifi_status != M2M_SUCCESS)
@@ -1017,8 +1117,17 @@ static sint8 aws_wifi_init(void)
             break;
         }
 
+        // Enable the WINC1500 power save mode
+        wifi_status = aws_wifi_power_init();
+        if (wifi_status != M2M_SUCCESS)
+        {
+            // Break the do/while loop
+            break;
+        }
+
         // Reset the socket connection information
         memset(&g_socket_connection, 0, sizeof(g_socket_connection));
+        g_socket_connection.socket = SOCK_ERR_INVALID;
 
         // Initialize the WINC1500 WIFI socket
         socketInit();      
@@ -1026,8 +1135,9 @@ static sint8 aws_wifi_init(void)
         
         
         // Initialize the MQTT library
-        g_mqtt_network.mqttread  = &mqtt_packet_read;
-        g_mqtt_network.mqttwrite = &mqtt_packet_write;
+        g_mqtt_network.mqttread   = &mqtt_packet_read;
+        g_mqtt_network.mqttwrite  = &mqtt_packet_write;
+        g_mqtt_network.mqttwritev = &mqtt_packet_writev;
         
         MQTTClientInit(&g_mqtt_client, &g_mqtt_network, MQTT_COMMAND_TIMEOUT_MS, 
                        g_mqtt_tx_buffer, sizeof(g_mqtt_tx_buffer),
@@ -1038,132 +1148,288 @@ static sint8 aws_wifi_init(void)
 }
 
 /**
- * \brief Sets the current AWS WIFI state of the AWS WIFI task
- */
-void aws_wifi_set_state(enum aws_iot_state state)
-{
-    g_aws_wifi_state = state;
-}
-
-/**
- * \brief Gets the current AWS WIFI task state.
+ * \brief Reads data from the AWS IoT connection
+ *
+ * A receive is left pending on the socket when this returns, even on a
+ * timeout, so the arrival of the next data posts AWS_EVENT_SOCKET_RECEIVED
+ * and the AWS WIFI task does not have to poll the socket.
+ *
+ * \param[out] read_buffer          The buffer receiving the data
+ * \param[in]  read_length          The number of bytes to read
+ * \param[in]  timeout_ms           The longest time to wait for the data
+ *
+ * \return The number of bytes read, or FAILURE
  */
-enum aws_iot_state aws_wifi_get_state(void)
-{
-    return g_aws_wifi_state;
-}
-
 int aws_wifi_read_data(uint8_t *read_buffer, uint32_t read_length, 
                        uint32_t timeout_ms)
 {
-    int status = SUCCESS;
-    
     if (g_is_connected == false || g_aws_wifi_state <= AWS_STATE_WIFI_DISCONNECT)
     {
         return FAILURE;
     }
-    
-    if (g_rx_buffer_length >= read_length)
-    {
-        status = SUCCESS;
-        
-        // Get the data from the existing received buffer
-        memcpy(&read_buffer[0], &g_rx_buffer[g_rx_buffer_location], read_length);
-
-        g_rx_buffer_location += read_length;
-        g_rx_buffer_length -= read_length;
-    }
-    else
-    {
-        // Reset the message buffer information
-        g_wifi_status = WIFI_STATUS_UNKNOWN;
-        g_rx_buffer_location = 0;
-        g_rx_buffer_length = 0;
-
-        memset(&g_rx_buffer[0], 0, sizeof(g_rx_buffer));
-
-        // Receive the incoming message
-        g_wifi_status = recv(g_socket_connection.socket, g_rx_buffer, sizeof(g_rx_buffer), timeout_ms);
-
-        do
-        {
-            // Wait until the incoming message or error was received
-            m2m_wifi_handle_events(NULL);
-
-            if (g_wifi_status == WIFI_STATUS_TIMEOUT)
-            {
-                status = FAILURE;
-                
-                // Break the do/while loop
-                break;
-            }
-            else if (g_wifi_status == WIFI_STATUS_ERROR)
-            {
-                status = FAILURE;
-                
-                // Break the do/while loop
-                break;
-            }
-
-            if (g_wifi_status == WIFI_STATUS_MESSAGE_RECEIVED)
-            {
-                status = SUCCESS;
-
-                memcpy(&read_buffer[0], &g_rx_buffer[0], read_length);
 
-                g_rx_buffer_location += read_length;
-                g_rx_buffer_length -= read_length;
-            }            
-        } while (g_wifi_status != WIFI_STATUS_MESSAGE_RECEIVED);
-    }
-            
-    return ((status == SUCCESS) ? (int)read_length : status);
+    return aws_socket_read(&g_socket_connection, read_buffer, read_length, timeout_ms);
 }
 
+/**
+ * \brief Sends data over the AWS IoT connection
+ *
+ * \param[in] send_buffer           The data to send
+ * \param[in] send_length           The number of bytes to send
+ * \param[in] timeout_ms            The longest time to wait for the send to complete
+ *
+ * \return The number of bytes sent, or FAILURE
+ */
 int aws_wifi_send_data(uint8_t *send_buffer, uint32_t send_length, 
                        uint32_t timeout_ms)
 {
-    int status = SUCCESS;
-    
     if (g_is_connected == false)
     {
         return FAILURE;
     }
-    
-    g_wifi_status = send(g_socket_connection.socket, send_buffer, send_length, 0);
-    g_tx_size = send_length;
-
-    do
-    {
-        // Wait until the outgoing message was sent
-        m2m_wifi_handle_events(NULL);    
 
-        if (g_wifi_status == WIFI_STATUS_ERROR)
-        {
-            status = FAILURE;
-                
-            // Break the do/while loop
-            break;
-        }
-    } while (g_wifi_status != WIFI_STATUS_MESSAGE_SENT);
-    
-    return ((status == SUCCESS) ? (int)send_length : status);
+    return aws_socket_send(&g_socket_connection, send_buffer, send_length, timeout_ms);
 }
 
-void aws_wifi_publish_shadow_update_message(struct demo_button_state state)
+/**
+ * \brief Publishes the messages queued while AWS IoT was not reachable
+ *
+ * The QOS0 messages are sent back to back, oldest first, without waiting
+ * for the broker in between. Stops at the first failure, the remaining
+ * messages stay queued for the next connection.
+ */
+static void aws_wifi_drain_publish_queue(void)
 {
     int mqtt_status = FAILURE;
     MQTTMessage message;
-    char json_message[256];
-    JSON_Value *update_message_value = NULL;
-    JSON_Object *update_message_object = NULL;
+    char payload[AWS_PUBLISH_QUEUE_PAYLOAD_MAX];
+    size_t payload_length = 0;
+    uint32_t drain_count = 0;
+    uint32_t drain_ms = 0;
+    TickType_t drain_start = xTaskGetTickCount();
+    char status_message[128];
+
+    if ((g_mqtt_client.isconnected != 1) || (aws_publish_queue_get_depth() == 0))
+    {
+        return;
+    }
 
     do
     {
-        // Only publish message when in the reporting state
-        if (g_mqtt_client.isconnected != 1)
-            break; 
+        payload_length = sizeof(payload);
+        if (!aws_publish_queue_peek(payload, &payload_length))
+        {
+            // Break the do/while loop
+            break;
+        }
+
+        message.qos        = QOS0;
+        message.retained   = 0;
+        message.dup        = 0;
+        message.id         = aws_wifi_get_message_id();
+        message.payload    = payload;
+        message.payloadlen = payload_length;
+
+        mqtt_status = MQTTPublish(&g_mqtt_client, g_mqtt_update_topic_name, &message);
+        if (mqtt_status != SUCCESS)
+        {
+            // Break the do/while loop
+            break;
+        }
+
+        if (!aws_publish_queue_pop())
+        {
+            console_print_error_message("A published message could not be marked in flash, it will be sent again after a reset.");
+        }
+        drain_count++;
+    } while (g_mqtt_client.isconnected == 1);
+
+    drain_ms = (uint32_t)((xTaskGetTickCount() - drain_start) * portTICK_PERIOD_MS);
+    aws_publish_queue_set_drain_time(drain_count, drain_ms);
+
+    memset(&status_message[0], 0, sizeof(status_message));
+    sprintf(&status_message[0], "Published %lu queued MQTT Shadow Update Messages in %lu ms, %lu left.",
+            (unsigned long)drain_count, (unsigned long)drain_ms,
+            (unsigned long)aws_publish_queue_get_depth());
+    console_print_message(status_message);
+}
+
+/**
+ * \brief Adds an MQTT client latency histogram to the metrics message
+ *
+ * \param[in] metrics_object        The metrics message
+ * \param[in] name                  The dotted name of the histogram
+ * \param[in] histogram             The latency histogram
+ */
+static void aws_wifi_set_metrics_histogram(JSON_Object *metrics_object, const char *name,
+                                           const MQTTHistogram *histogram)
+{
+    JSON_Value *buckets_value = json_value_init_array();
+    JSON_Array *buckets_array = json_value_get_array(buckets_value);
+    char key[48];
+
+    for (int i = 0; i < MQTT_HISTOGRAM_BUCKETS; i++)
+    {
+        json_array_append_number(buckets_array, histogram->buckets[i]);
+    }
+
+    sprintf(key, "%s.count", name);
+    json_object_dotset_number(metrics_object, key, histogram->count);
+    sprintf(key, "%s.avg_ms", name);
+    json_object_dotset_number(metrics_object, key,
+        (histogram->count > 0) ? (histogram->total_ms / histogram->count) : 0);
+    sprintf(key, "%s.max_ms", name);
+    json_object_dotset_number(metrics_object, key, histogram->max_ms);
+    sprintf(key, "%s.buckets", name);
+    json_object_dotset_value(metrics_object, key, buckets_value);
+}
+
+/**
+ * \brief Publishes the MQTT client counters and latency histograms
+ *
+ * The message goes to the <thing>/metrics topic with QOS0, it is not queued
+ * while disconnected. Only the packet types seen so far are listed. Bucket i
+ * of a histogram counts the samples up to 4^i ms, the last bucket the rest.
+ */
+static void aws_wifi_publish_metrics_message(void)
+{
+    int mqtt_status = FAILURE;
+    MQTTMessage message;
+    MQTTClientStats stats;
+    char *json_message = NULL;
+    char key[48];
+    JSON_Value *metrics_message_value = NULL;
+    JSON_Object *metrics_message_object = NULL;
+
+    do
+    {
+        MQTTGetStats(&g_mqtt_client, &stats);
+
+        // Create the metrics message
+        metrics_message_value  = json_value_init_object();
+        metrics_message_object = json_value_get_object(metrics_message_value);
+
+        json_object_set_number(metrics_message_object, "uptime_ms",
+            (double)(xTaskGetTickCount() * portTICK_PERIOD_MS));
+
+        for (int type = CONNECT; type <= DISCONNECT; type++)
+        {
+            if (stats.packets_in[type] > 0)
+            {
+                sprintf(key, "in.%s.packets", MQTTPacket_getName(type));
+                json_object_dotset_number(metrics_message_object, key, stats.packets_in[type]);
+                sprintf(key, "in.%s.bytes", MQTTPacket_getName(type));
+                json_object_dotset_number(metrics_message_object, key, stats.bytes_in[type]);
+            }
+            if (stats.packets_out[type] > 0)
+            {
+                sprintf(key, "out.%s.packets", MQTTPacket_getName(type));
+                json_object_dotset_number(metrics_message_object, key, stats.packets_out[type]);
+                sprintf(key, "out.%s.bytes", MQTTPacket_getName(type));
+                json_object_dotset_number(metrics_message_object, key, stats.bytes_out[type]);
+            }
+        }
+
+        json_object_set_number(metrics_message_object, "waitfor_timeouts", stats.waitfor_timeouts);
+        aws_wifi_set_metrics_histogram(metrics_message_object, "rtt.connack", &stats.connack_rtt);
+        aws_wifi_set_metrics_histogram(metrics_message_object, "rtt.suback", &stats.suback_rtt);
+        aws_wifi_set_metrics_histogram(metrics_message_object, "rtt.puback", &stats.puback_rtt);
+        aws_wifi_set_metrics_histogram(metrics_message_object, "cycle", &stats.cycle_time);
+        aws_wifi_set_metrics_histogram(metrics_message_object, "handler", &stats.handler_time);
+
+        json_message = json_serialize_to_string(metrics_message_value);
+        if (json_message == NULL)
+        {
+            console_print_error_message("The AWS IoT Demo failed to create the MQTT metrics message.");
+
+            // Break the do/while loop
+            break;
+        }
+
+        message.qos      = QOS0;
+        message.retained = 0;
+        message.dup      = 0;
+        message.id       = aws_wifi_get_message_id();
+        message.payload  = json_message;
+        message.payloadlen = strlen(json_message);
 
+        console_print_message("Publishing MQTT Metrics Message.");
+
+        mqtt_status = MQTTPublish(&g_mqtt_client, g_mqtt_metrics_topic_name, &message);
+        if (mqtt_status != SUCCESS)
+        {
+            console_print_error_message("The AWS IoT Demo failed to publish the MQTT metrics message.");
+        }
+    } while (false);
+
+    // Free allocated memory
+    json_free_serialized_string(json_message);
+    json_value_free(metrics_message_value);
+}
+
+/**
+ * \brief Publishes the WINC1500 firmware update progress to the thing shadow
+ *
+ * The report is not queued while disconnected, the latest progress is
+ * reported again on the next connection.
+ */
+static void aws_wifi_publish_ota_report_message(void)
+{
+    int mqtt_status = FAILURE;
+    MQTTMessage message;
+    char *json_message = NULL;
+    JSON_Value *update_message_value = NULL;
+    JSON_Object *update_message_object = NULL;
+
+    do
+    {
+        // Create the WINC1500 firmware update report message
+        update_message_value  = json_value_init_object();
+        update_message_object = json_value_get_object(update_message_value);
+
+        aws_wifi_ota_set_reported(update_message_object);
+
+        json_message = json_serialize_to_string(update_message_value);
+        if (json_message == NULL)
+        {
+            console_print_error_message("The AWS IoT Demo failed to create the MQTT WINC1500 OTA report message.");
+
+            // Break the do/while loop
+            break;
+        }
+
+        message.qos      = QOS0;
+        message.retained = 0;
+        message.dup      = 0;
+        message.id       = aws_wifi_get_message_id();
+        message.payload  = json_message;
+        message.payloadlen = strlen(json_message);
+
+        console_print_message("Publishing MQTT WINC1500 OTA Report Message:");
+        console_print_hex_dump(message.payload, message.payloadlen);
+
+        mqtt_status = MQTTPublish(&g_mqtt_client, g_mqtt_update_topic_name, &message);
+        if (mqtt_status != SUCCESS)
+        {
+            console_print_error_message("The AWS IoT Demo failed to publish the MQTT WINC1500 OTA report message.");
+        }
+    } while (false);
+
+    // Free allocated memory
+    json_free_serialized_string(json_message);
+    json_value_free(update_message_value);
+}
+
+void aws_wifi_publish_shadow_update_message(struct demo_button_state state)
+{
+    int mqtt_status = FAILURE;
+    MQTTMessage message;
+    char json_message[256];
+    JSON_Value *update_message_value = NULL;
+    JSON_Object *update_message_object = NULL;
+
+    do
+    {
         // Create the Button update message
         update_message_value   = json_value_init_object();
         update_message_object  = json_value_get_object(update_message_value);
@@ -1191,12 +1457,35 @@ void aws_wifi_publish_shadow_update_message(struct demo_button_state state)
         message.payload = json_message;
         message.payloadlen = (json_serialization_size(update_message_value) - 1);
 
+        if ((g_mqtt_client.isconnected != 1) || (aws_publish_queue_get_depth() > 0))
+        {
+            // Keep the message, behind the older ones, until AWS IoT is reachable
+            console_print_message("Queuing MQTT Shadow Update Message:");
+            console_print_hex_dump(message.payload, message.payloadlen);
+
+            if (!aws_publish_queue_push(json_message, message.payloadlen))
+            {
+                console_print_error_message("The AWS IoT Demo failed to queue the MQTT shadow update message.");
+            }
+
+            aws_wifi_drain_publish_queue();
+
+            // Break the do/while loop
+            break;
+        }
+
         console_print_message("Publishing MQTT Shadow Update Message:");
         console_print_hex_dump(message.payload, message.payloadlen);
 
         mqtt_status = MQTTPublish(&g_mqtt_client, g_mqtt_update_topic_name, &message);
         if (mqtt_status != SUCCESS)
         {
+            // Keep the message to publish it on the next connection
+            if (!aws_publish_queue_push(json_message, message.payloadlen))
+            {
+                console_print_error_message("The AWS IoT Demo failed to queue the MQTT shadow update message.");
+            }
+
             // The AWS IoT Demo failed to publish the MQTT LED update message
             aws_iot_set_status(AWS_STATE_AWS_REPORTING,
                                 AWS_STATUS_AWS_REPORT_FAILURE,
@@ -1211,352 +1500,447 @@ void aws_wifi_publish_shadow_update_message(struct demo_button_state state)
     json_value_free(update_message_value);
 }
 
-void aws_wifi_task(void *params)
+/**
+ * \brief Runs the AWS WIFI state machine for the current state
+ *
+ * States that wait for something return without changing the state, the
+ * AWS WIFI task runs them again after the next event.
+ */
+static void aws_wifi_process_state(void)
 {
     ATCA_STATUS atca_status = ATCA_STATUS_UNKNOWN;
     sint8 wifi_status = M2M_SUCCESS;
     int mqtt_status = FAILURE;
-    enum aws_iot_state provisioning_state = AWS_STATE_UNKNOWN;
+    uint32_t rx_length = 0;
     char ssid[SLOT8_SSID_SIZE];
     uint32_t ssid_length = 0;
     char password[SLOT8_WIFI_PASSWORD_SIZE];
     uint32_t password_length = 0;
     MQTTPacket_connectData mqtt_options = MQTTPacket_connectData_initializer;
+    MQTTConnackData connack_data;
     char message[256];
 
-    do 
+    // The state machine for the AWS WIFI task
+    switch (g_aws_wifi_state)
     {
-        // get the current provisioning state
-        provisioning_state = provisioning_get_state();
-
-        if (g_aws_wifi_state >= AWS_STATE_WIFI_CONFIGURE)
+    case AWS_STATE_WINC1500_INIT:
+        /**
+         * Initialize the AWS IoT Zero Touch Demo AWS WIFI task
+         *
+         * This portion of the state machine should never be
+         * called more than once
+         */
+
+        // Wait until the provisioning task has initialized the ATECCx08A
+        if (g_crypto_ready)
         {
-            // Obtain the provisioning mutex
-            xSemaphoreTake(g_provisioning_mutex, portMAX_DELAY);
+            // Initialize the AWS WINC1500 WIFI
+            wifi_status = aws_wifi_init();
+            if (wifi_status == M2M_SUCCESS)
+            {
+                // The WINC1500 may have been reset to run an updated firmware
+                aws_wifi_ota_restarted();
+
+                // Set the current state
+                aws_iot_set_status(AWS_STATE_WIFI_CONFIGURE,
+                                   AWS_STATUS_SUCCESS,
+                                   "The AWS IoT Zero Touch Demo WINC1500 WIFI configure was successful.");
+            
+                // Set the next AWS WIFI state
+                g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;                    
+            }
+            else
+            {
+                // Set the current state
+                aws_iot_set_status(AWS_STATE_ATECCx08A_INIT,
+                                   AWS_STATUS_ATECCx08A_INIT_FAILURE,
+                                   "The AWS IoT Zero Touch Demo WINC1500 WIFI init was not successful.");
+
+                console_print_error_message("An WINC1500 WIFI initialization error has occurred.");
+                console_print_error_message("Stopping the AWS IoT demo.");
+
+                // An error has occurred during initialization.  Stop the demo.
+                g_aws_wifi_state = AWS_STATE_UNKNOWN;
+            }             
         }
+        break;
         
-        // The state machine for the AWS WIFI task
-        switch (g_aws_wifi_state)
-        {
-        case AWS_STATE_WINC1500_INIT:
-            /**
-             * Initialize the AWS IoT Zero Touch Demo AWS WIFI task
-             *
-             * This portion of the state machine should never be
-             * called more than once
-             */
-
-            // Wait until the provisioning task is at least in the configure state
-            if (provisioning_state >= AWS_STATE_ATECCx08A_INIT)
+    case AWS_STATE_WIFI_CONFIGURE:
+        // Wait until the ATECCx08A has been provisioned
+        if (g_provisioned)
+        {
+            // Transfer the ATECCx08A certificates to the WINC1500
+            uint8_t subject_key_id[20];
+            wifi_status= ecc_transfer_certificates(subject_key_id);
+            if (wifi_status == M2M_SUCCESS)
             {
-                // Initialize the AWS WINC1500 WIFI
-                wifi_status = aws_wifi_init();
-                if (wifi_status == M2M_SUCCESS)
-                {
-                    // Set the current state
-                    aws_iot_set_status(AWS_STATE_WIFI_CONFIGURE,
-                                       AWS_STATUS_SUCCESS,
-                                       "The AWS IoT Zero Touch Demo WINC1500 WIFI configure was successful.");
+                // Convert the binary subject key ID to a hex string to use as the MQTT client ID
+                hex_codec_encode(subject_key_id, sizeof(subject_key_id), g_mqtt_client_id, false);
+                g_mqtt_client_id[sizeof(subject_key_id)*2] = 0; // Add terminating null
+
+                // Make the thing name the same as the MQTT client ID
+                memcpy(g_thing_name, g_mqtt_client_id, min(sizeof(g_thing_name), sizeof(g_mqtt_client_id)));
+                g_thing_name[sizeof(g_thing_name)-1] = 0; // Ensure a terminating null
+
+                // Initialize the AWS MQTT update topic name
+                memset(&g_mqtt_update_topic_name[0], 0, sizeof(g_mqtt_update_topic_name));
+                sprintf(&g_mqtt_update_topic_name[0], "$aws/things/%s/shadow/update", g_thing_name);
+
+                // Initialize the AWS MQTT update delta topic name
+                memset(&g_mqtt_update_delta_topic_name[0], 0, sizeof(g_mqtt_update_delta_topic_name));
+                sprintf(&g_mqtt_update_delta_topic_name[0], "$aws/things/%s/shadow/update/delta", g_thing_name);
+
+                // Initialize the MQTT client metrics topic name
+                memset(&g_mqtt_metrics_topic_name[0], 0, sizeof(g_mqtt_metrics_topic_name));
+                sprintf(&g_mqtt_metrics_topic_name[0], "%s/metrics", g_thing_name);
+
+                // Set the current state
+                aws_iot_set_status(AWS_STATE_AWS_CONNECT,
+                                   AWS_STATUS_SUCCESS,
+                                   "The AWS IoT Zero Touch Demo WINC1500 WIFI connect was successful.");
                 
-                    // Set the next AWS WIFI state
-                    g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;                    
-                }
-                else
-                {
-                    // Set the current state
-                    aws_iot_set_status(AWS_STATE_ATECCx08A_INIT,
-                                       AWS_STATUS_ATECCx08A_INIT_FAILURE,
-                                       "The AWS IoT Zero Touch Demo WINC1500 WIFI init was not successful.");
-
-                    console_print_error_message("An WINC1500 WIFI initialization error has occurred.");
-                    console_print_error_message("Stopping the AWS IoT demo.");
-
-                    // An error has occurred during initialization.  Stop the demo.
-                    g_aws_wifi_state = AWS_STATE_UNKNOWN;
-                }             
+                // Set the next AWS WIFI state
+                g_aws_wifi_state = AWS_STATE_AWS_CONNECT;
             }
-            break;
-            
-        case AWS_STATE_WIFI_CONFIGURE:
-            // Wait until the provisioning task has passed the configure state
-            if (provisioning_state > AWS_STATE_ATECCx08A_CONFIGURE)
+            else
             {
-                // Transfer the ATECCx08A certificates to the WINC1500
-                uint8_t subject_key_id[20];
-                wifi_status= ecc_transfer_certificates(subject_key_id);
-                if (wifi_status == M2M_SUCCESS)
-                {
-                    // Convert the binary subject key ID to a hex string to use as the MQTT client ID
-                    for (int i=0; i<20; i++)
-                    {
-                        g_mqtt_client_id[i*2+0] = "0123456789abcdef"[subject_key_id[i] >> 4];
-                        g_mqtt_client_id[i*2+1] = "0123456789abcdef"[subject_key_id[i] & 0x0F];
-                    }
-                    g_mqtt_client_id[20*2] = 0; // Add terminating null
-
-                    // Make the thing name the same as the MQTT client ID
-                    memcpy(g_thing_name, g_mqtt_client_id, min(sizeof(g_thing_name), sizeof(g_mqtt_client_id)));
-                    g_thing_name[sizeof(g_thing_name)-1] = 0; // Ensure a terminating null
-
-                    // Initialize the AWS MQTT update topic name
-                    memset(&g_mqtt_update_topic_name[0], 0, sizeof(g_mqtt_update_topic_name));
-                    sprintf(&g_mqtt_update_topic_name[0], "$aws/things/%s/shadow/update", g_thing_name);
-
-                    // Initialize the AWS MQTT update delta topic name
-                    memset(&g_mqtt_update_delta_topic_name[0], 0, sizeof(g_mqtt_update_delta_topic_name));
-                    sprintf(&g_mqtt_update_delta_topic_name[0], "$aws/things/%s/shadow/update/delta", g_thing_name);
-
-                    // Set the current state
-                    aws_iot_set_status(AWS_STATE_AWS_CONNECT,
-                                       AWS_STATUS_SUCCESS,
-                                       "The AWS IoT Zero Touch Demo WINC1500 WIFI connect was successful.");
-                    
-                    // Set the next AWS WIFI state
-                    g_aws_wifi_state = AWS_STATE_AWS_CONNECT;
-                }
-                else
-                {
-                    // Set the current state
-                    aws_iot_set_status(AWS_STATE_WIFI_CONFIGURE,
-                                       AWS_STATUS_ATECCx08A_INIT_FAILURE,
-                                       "The AWS IoT Zero Touch Demo WINC1500 WIFI configure was not successful.");
+                // Set the current state
+                aws_iot_set_status(AWS_STATE_WIFI_CONFIGURE,
+                                   AWS_STATUS_ATECCx08A_INIT_FAILURE,
+                                   "The AWS IoT Zero Touch Demo WINC1500 WIFI configure was not successful.");
 
-                    console_print_error_message("An WINC1500 WIFI configure error has occurred.");
-                    console_print_error_message("Stopping the AWS IoT demo.");
+                console_print_error_message("An WINC1500 WIFI configure error has occurred.");
+                console_print_error_message("Stopping the AWS IoT demo.");
 
-                    // An error has occurred during initialization.  Stop the demo.
-                    g_aws_wifi_state = AWS_STATE_UNKNOWN;
-                }
+                // An error has occurred during initialization.  Stop the demo.
+                g_aws_wifi_state = AWS_STATE_UNKNOWN;
             }
-            break;
-            
-        case AWS_STATE_AWS_CONNECT:
-            do 
+        }
+        break;
+        
+    case AWS_STATE_AWS_CONNECT:
+        do 
+        {
+            // Wait for the next attempt after a failed connect
+            if (g_wifi_connect_retry_pending && !TimerIsExpired(&g_wifi_connect_timer))
             {
-                // Get the AWS WIFI SSID
-                ssid_length = sizeof(ssid);
-                atca_status = provisioning_get_ssid(&ssid_length, ssid);
-                if (atca_status != ATCA_SUCCESS)
-                {
-                    // Set the current state
-                    aws_iot_set_status(AWS_STATE_AWS_CONNECT,
-                                       AWS_STATUS_ATECCx08A_UNPROVISIONED,
-                                       "Unable to retrieve the AWS WIFI SSID from the ATECCx08A.");
+                // Break the do/while loop
+                break;
+            }
+            g_wifi_connect_retry_pending = false;
 
-                    console_print_error_message("Unable to retrieve the AWS WIFI SSID from the ATECCx08A.");
+            // Get the AWS WIFI SSID
+            ssid_length = sizeof(ssid);
+            atca_status = provisioning_get_ssid(&ssid_length, ssid);
+            if (atca_status != ATCA_SUCCESS)
+            {
+                // Set the current state
+                aws_iot_set_status(AWS_STATE_AWS_CONNECT,
+                                   AWS_STATUS_ATECCx08A_UNPROVISIONED,
+                                   "Unable to retrieve the AWS WIFI SSID from the ATECCx08A.");
 
-                    // Set the state to start the ATECCx08A device AWS WIFI process
-                    g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;
-                    
-                    // Break the do/while loop
-                    break;
-                }
+                console_print_error_message("Unable to retrieve the AWS WIFI SSID from the ATECCx08A.");
 
-                // Get the AWS WIFI Password
-                password_length = sizeof(password);
-                atca_status = provisioning_get_wifi_password(&password_length, password);
-                if (atca_status != ATCA_SUCCESS)
-                {
-                    // Set the current state
-                    aws_iot_set_status(AWS_STATE_AWS_CONNECT,
-                                       AWS_STATUS_ATECCx08A_UNPROVISIONED,
-                                       "Unable to retrieve the AWS WIFI Password from the ATECCx08A.");
+                // Wait for the ATECCx08A device to be provisioned again
+                g_provisioned = false;
 
-                    console_print_error_message("Unable to retrieve the AWS WIFI Password from the ATECCx08A.");
+                // Set the state to start the ATECCx08A device AWS WIFI process
+                g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;
+                
+                // Break the do/while loop
+                break;
+            }
 
-                    // Set the state to start the AWS WIFI process
-                    g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;
+            // Get the AWS WIFI Password
+            password_length = sizeof(password);
+            atca_status = provisioning_get_wifi_password(&password_length, password);
+            if (atca_status != ATCA_SUCCESS)
+            {
+                // Set the current state
+                aws_iot_set_status(AWS_STATE_AWS_CONNECT,
+                                   AWS_STATUS_ATECCx08A_UNPROVISIONED,
+                                   "Unable to retrieve the AWS WIFI Password from the ATECCx08A.");
 
-                    // Break the do/while loop
-                    break;
-                }
-            
-                // Start the WINC1500 WIFI connect process
-                do
-                {
-                    memset(&message[0], 0, sizeof(message));
-                    sprintf(message, 
-                            "\r\nAttempting to connect to AWS IoT ...\r\n  SSID:     %s\r\n  Password: %s",
-                            ssid, password);
-                    console_print_message(message);
-                    
-                    if (strlen(password) > 0)
-                    {
-                        wifi_status = m2m_wifi_connect(ssid, (uint8)ssid_length,
-                                                       M2M_WIFI_SEC_WPA_PSK, password,
-                                                       M2M_WIFI_CH_ALL);
-                    }
-                    else
-                    {
-                        // Zero-length password used to indicate an open wifi ap
-                        wifi_status = m2m_wifi_connect(ssid, (uint8)ssid_length,
-                                                       M2M_WIFI_SEC_OPEN, password,
-                                                       M2M_WIFI_CH_ALL);
-                    }
-                    if (wifi_status == M2M_SUCCESS)
-                    {
-                        // Set the next AWS WIFI state
-                        g_aws_wifi_state = AWS_STATE_AWS_CONNECTING;
-                    }
-                    else
-                    {
-                        // Delay the AWS WIFI task connection attempts
-                        vTaskDelay(AWS_WIFI_CONNECT_DELAY);
-                    }
-                } while (wifi_status != M2M_SUCCESS);
-            } while (false);            
-            break;
+                console_print_error_message("Unable to retrieve the AWS WIFI Password from the ATECCx08A.");
 
-        case AWS_STATE_AWS_CONNECTING:
-            // Waiting for the AWS IoT connection to complete
-            break;
+                // Wait for the ATECCx08A device to be provisioned again
+                g_provisioned = false;
 
-        case AWS_STATE_AWS_CONNECTED:
-            // The AWS Zero Touch Demo is connect to AWS IoT
-            
-            console_print_success_message("AWS Zero Touch Demo: Connected to AWS IoT.");
+                // Set the state to start the AWS WIFI process
+                g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;
+
+                // Break the do/while loop
+                break;
+            }
+        
+            // Start the WINC1500 WIFI connect process
+            memset(&message[0], 0, sizeof(message));
+            sprintf(message, 
+                    "\r\nAttempting to connect to AWS IoT ...\r\n  SSID:     %s\r\n  Password: %s",
+                    ssid, password);
+            console_print_message(message);
             
-            g_is_connected = true;
+            if (strlen(password) > 0)
+            {
+                wifi_status = m2m_wifi_connect(ssid, (uint8)ssid_length,
+                                               M2M_WIFI_SEC_WPA_PSK, password,
+                                               M2M_WIFI_CH_ALL);
+            }
+            else
+            {
+                // Zero-length password used to indicate an open wifi ap
+                wifi_status = m2m_wifi_connect(ssid, (uint8)ssid_length,
+                                               M2M_WIFI_SEC_OPEN, password,
+                                               M2M_WIFI_CH_ALL);
+            }
+            if (wifi_status == M2M_SUCCESS)
+            {
+                // Set the next AWS WIFI state
+                g_aws_wifi_state = AWS_STATE_AWS_CONNECTING;
+            }
+            else
+            {
+                // Stay in this state, the event wait times out for the next attempt
+                TimerInit(&g_wifi_connect_timer);
+                TimerCountdownMS(&g_wifi_connect_timer, AWS_WIFI_CONNECT_DELAY_MS);
+                g_wifi_connect_retry_pending = true;
+            }
+        } while (false);            
+        break;
 
-            do 
+    case AWS_STATE_AWS_CONNECTING:
+        // Waiting for the AWS IoT connection to complete
+        break;
+
+    case AWS_STATE_AWS_CONNECTED:
+        // The AWS Zero Touch Demo is connect to AWS IoT
+        
+        console_print_success_message("AWS Zero Touch Demo: Connected to AWS IoT.");
+        
+        g_is_connected = true;
+
+        do 
+        {
+            // Send the MQTT Connect message
+            mqtt_options.keepAliveInterval = aws_wifi_power_get_keep_alive_interval();
+            mqtt_options.cleansession = (AWS_WIFI_MQTT_PERSISTENT_SESSION ? 0 : 1);
+            mqtt_options.clientID.cstring = g_mqtt_client_id;
+
+            // Register the delta handler first, a persistent session delivers
+            // the deltas queued while offline right after the CONNACK
+            MQTTSetMessageChunkHandler(&g_mqtt_client, g_mqtt_update_delta_topic_name,
+                                       &aws_mqtt_shadow_update_delta_chunk_callback);
+
+            memset(&connack_data, 0, sizeof(connack_data));
+            mqtt_status = MQTTConnectWithResults(&g_mqtt_client, &mqtt_options, &connack_data);
+            if (mqtt_status != SUCCESS)
             {
-                // Send the MQTT Connect message
-                mqtt_options.keepAliveInterval = MQTT_KEEP_ALIVE_INTERVAL_S;
-                mqtt_options.cleansession = 1;
-                mqtt_options.clientID.cstring = g_mqtt_client_id;
+                // The AWS IoT Demo failed to retrieve the device serial number
+                aws_iot_set_status(AWS_STATE_AWS_SUBSCRIPTION,
+                                   AWS_STATUS_AWS_SUBSCRIPTION_FAILURE,
+                                   "The AWS IoT Demo failed to connect with the MQTT connect message.");
             
-                mqtt_status = MQTTConnect(&g_mqtt_client, &mqtt_options);
-                if (mqtt_status != SUCCESS)
-                {
-                    // The AWS IoT Demo failed to retrieve the device serial number
-                    aws_iot_set_status(AWS_STATE_AWS_SUBSCRIPTION,
-                                       AWS_STATUS_AWS_SUBSCRIPTION_FAILURE,
-                                       "The AWS IoT Demo failed to connect with the MQTT connect message.");
-                
-                    console_print_message("\r\n");
-                    console_print_error_message("The AWS IoT Demo failed to connect with the MQTT connect message.");
-                
-                    // Set the state to start the AWS WIFI Disconnect process
-                    if (g_aws_wifi_state > AWS_STATE_WIFI_DISCONNECT)
-                        g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+                console_print_message("\r\n");
+                console_print_error_message("The AWS IoT Demo failed to connect with the MQTT connect message.");
 
-                    // Break the do/while loop
-                    break;
-                }
+                // A WINC1500 firmware on trial is rolled back after a few failures
+                aws_wifi_ota_connect_failed();
             
-                // Subscribe to the AWS IoT update delta topic message
+                // Set the state to start the AWS WIFI Disconnect process
+                if (g_aws_wifi_state > AWS_STATE_WIFI_DISCONNECT)
+                    g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+
+                // Break the do/while loop
+                break;
+            }
+
+            // Ping only as often as the network path needs to keep the connection
+            aws_keepalive_start(&g_mqtt_client, mqtt_options.keepAliveInterval);
+        
+            if (AWS_WIFI_MQTT_PERSISTENT_SESSION && (connack_data.sessionPresent == 1))
+            {
+                // The broker still holds the session and its delta subscription
+                console_print_message("\r\n");
+                console_print_success_message("Resumed the MQTT session, the update topic subscription is kept:");
+                console_print_success_message(g_mqtt_update_delta_topic_name);
+                console_print_message("\r\n");
+            }
+            else
+            {
+                // Subscribe to the AWS IoT update delta topic message, with QOS1 the
+                // broker queues the deltas of a persistent session while offline
                 mqtt_status = MQTTSubscribe(&g_mqtt_client, g_mqtt_update_delta_topic_name, 
-                                            QOS0, &aws_mqtt_shadow_update_delta_callback);
-                if (mqtt_status != SUCCESS)
-                {
-                    // The AWS IoT Demo failed to retrieve the device serial number
-                    aws_iot_set_status(AWS_STATE_AWS_SUBSCRIPTION,
-                                       AWS_STATUS_AWS_SUBSCRIPTION_FAILURE,
-                                       "The AWS IoT Demo failed to subscribe to the MQTT update topic subscription.");
-                
-                    console_print_message("\r\n");
-                    console_print_error_message(
-                        "The AWS IoT Demo failed to subscribe to the MQTT update topic subscription.");
-                
-                    // Set the state to start the AWS WIFI Disconnect process
-                    if (g_aws_wifi_state > AWS_STATE_WIFI_DISCONNECT)
-                        g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+                                            (AWS_WIFI_MQTT_PERSISTENT_SESSION ? QOS1 : QOS0),
+                                            &aws_mqtt_shadow_update_delta_callback);
 
-                    // Break the do/while loop
-                    break;
-                }
+                // Stream the deltas again, MQTTSubscribe() registered the regular handler
+                MQTTSetMessageChunkHandler(&g_mqtt_client, g_mqtt_update_delta_topic_name,
+                                           &aws_mqtt_shadow_update_delta_chunk_callback);
+            }
+            if (mqtt_status != SUCCESS)
+            {
+                // The AWS IoT Demo failed to retrieve the device serial number
+                aws_iot_set_status(AWS_STATE_AWS_SUBSCRIPTION,
+                                   AWS_STATUS_AWS_SUBSCRIPTION_FAILURE,
+                                   "The AWS IoT Demo failed to subscribe to the MQTT update topic subscription.");
             
+                console_print_message("\r\n");
+                console_print_error_message(
+                    "The AWS IoT Demo failed to subscribe to the MQTT update topic subscription.");
+            
+                // Set the state to start the AWS WIFI Disconnect process
+                if (g_aws_wifi_state > AWS_STATE_WIFI_DISCONNECT)
+                    g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+
+                // Break the do/while loop
+                break;
+            }
+        
+            if (connack_data.sessionPresent != 1)
+            {
                 console_print_message("\r\n");
                 console_print_success_message("Subscribed to the MQTT update topic subscription:");
                 console_print_success_message(g_mqtt_update_delta_topic_name);
                 console_print_message("\r\n");
-                
-                // Flash the processing LED to show the AWS IoT Demo has connected to AWS IoT
-                led_flash_processing_led(5);
-                
-                // Publish initial button state
-                aws_wifi_publish_shadow_update_message(g_demo_button_state);
+            }
+            
+            // Flash the processing LED to show the AWS IoT Demo has connected to AWS IoT
+            led_flash_processing_led(5);
+            
+            // Publish the messages queued while disconnected, oldest first
+            aws_wifi_drain_publish_queue();
+
+            // Publish initial button state, including the presses still being coalesced
+            g_button_update_pending = false;
+            aws_wifi_publish_shadow_update_message(g_demo_button_state);
+
+            // Keep a WINC1500 firmware on trial, and report the last update again
+            aws_wifi_ota_connected();
+
+            // Publish the MQTT client metrics periodically while connected
+            TimerInit(&g_metrics_timer);
+            TimerCountdownMS(&g_metrics_timer, AWS_WIFI_METRICS_INTERVAL_MS);
+
+            // Set the state to AWS WIFI Reporting process
+            g_aws_wifi_state = AWS_STATE_AWS_REPORTING;
+        } while (false);
+        break;
+        
+    case AWS_STATE_AWS_REPORTING:
+        // Sending/receiving topic update messages to/from AWS IoT
 
-                // Set the state to AWS WIFI Reporting process
-                g_aws_wifi_state = AWS_STATE_AWS_REPORTING;
-            } while (false);
+        if (aws_wifi_power_is_sleeping())
+        {
+            // Wait for the WINC1500 to wake up for the next MQTT keep alive
             break;
-            
-        case AWS_STATE_AWS_REPORTING:
-            // Sending/receiving topic update messages to/from AWS IoT
+        }
 
-            if (g_selected_pushbutton != OLED1_PUSHBUTTON_ID_UNKNOWN)
-            {            
-                switch (g_selected_pushbutton)
-                {
-                case OLED1_PUSHBUTTON_ID_1:
-                    g_demo_button_state.button_1 = !g_demo_button_state.button_1;
-                    break;
-                        
-                case OLED1_PUSHBUTTON_ID_2:
-                    g_demo_button_state.button_2 = !g_demo_button_state.button_2;
-                    break;
-                        
-                case OLED1_PUSHBUTTON_ID_3:
-                    g_demo_button_state.button_3 = !g_demo_button_state.button_3;
-                    break;
-                        
-                default:
-                    // Do nothing
-                    break;
-                }
+        if ((aws_socket_get_rx_length(&g_socket_connection) > 0) || (!g_socket_connection.rx_pending) ||
+            TimerIsExpired(&g_mqtt_client.ping_timer) ||
+            (g_mqtt_client.ping_outstanding && TimerIsExpired(&g_mqtt_client.pingresp_timer)))
+        {
+            // Process every complete MQTT packet already received
+            do 
+            {
+                rx_length = aws_socket_get_rx_length(&g_socket_connection);
+                mqtt_status = MQTTCycle(&g_mqtt_client, (rx_length > 0) ? MQTT_COMMAND_TIMEOUT_MS : 0);
+            } while ((mqtt_status == SUCCESS) && (aws_socket_get_rx_length(&g_socket_connection) > 0) &&
+                     (aws_socket_get_rx_length(&g_socket_connection) < rx_length));
 
-                // Publish the button update message
-                aws_wifi_publish_shadow_update_message(g_demo_button_state);
+            if (mqtt_status != SUCCESS)
+            {
+                // The AWS IoT Demo failed to retrieve the device serial number
+                aws_iot_set_status(AWS_STATE_AWS_REPORTING,
+                                    AWS_STATUS_AWS_REPORT_FAILURE,
+                                    "The AWS IoT Demo failed to publish the MQTT LED update message.");
                 
-                // Reset the selected pushbutton
-                g_selected_pushbutton = OLED1_PUSHBUTTON_ID_UNKNOWN;
+                console_print_message("\r\n");
+                console_print_error_message("The AWS IoT Demo failed to publish the MQTT LED update message.");
             }
-            else
+            
+            // If an error occurred in the WIFI connection, make sure to disconnect properly
+            if ((g_socket_connection.rx_status == WIFI_STATUS_ERROR) ||
+                (g_socket_connection.tx_status == WIFI_STATUS_ERROR))
             {
-                // Wait for incoming update messages
-                mqtt_status = MQTTYield(&g_mqtt_client, MQTT_YEILD_TIMEOUT_MS);
-                if (mqtt_status != SUCCESS)
-                {
-                    // The AWS IoT Demo failed to retrieve the device serial number
-                    aws_iot_set_status(AWS_STATE_AWS_REPORTING,
-                                        AWS_STATUS_AWS_REPORT_FAILURE,
-                                        "The AWS IoT Demo failed to publish the MQTT LED update message.");
-                    
-                    console_print_message("\r\n");
-                    console_print_error_message("The AWS IoT Demo failed to publish the MQTT LED update message.");
-                }
-                
-                // If an error occurred in the WIFI connection, make sure to disconnect properly
-                if (g_wifi_status == WIFI_STATUS_ERROR)
-                {
-                    g_is_connected = false;
-                }
+                g_is_connected = false;
             }
-            break;
+            else if (g_mqtt_client.isconnected != 1)
+            {
+                // The PINGRESP was missed or a packet was cut short, the connection
+                // is lost so skip the MQTT disconnect
+                g_is_connected = false;
 
-        case AWS_STATE_WIFI_DISCONNECT:
-            // The AWS Zero Touch Demo is disconnected from access point
-            
+                // Set the state to start the AWS WIFI Disconnect process
+                g_aws_wifi_state = AWS_STATE_WIFI_DISCONNECT;
+            }
+            else if (!aws_wifi_ota_is_downloading())
+            {
+                // Let the WINC1500 sleep until the next MQTT keep alive is due
+                aws_wifi_power_idle(&g_mqtt_client);
+            }
+        }
+
+        // Periodically report the WINC1500 power save statistics
+        aws_wifi_power_report(false);
+        break;
+
+    case AWS_STATE_WIFI_DISCONNECT:
+        // The AWS Zero Touch Demo is disconnected from access point
+        
+        if ((g_is_connected == true) || (g_socket_connection.socket >= 0))
+        {
             g_is_connected = false;
 
-            // Disconnect from the WINC1500 WIFI
-            m2m_wifi_disconnect();
-            
             // Close the socket
-            close(g_socket_connection.socket);
-                        
-            console_print_success_message("AWS Zero Touch Demo: Disconnected from WIFI access point.");
-            
-            // Set the state to start the AWS WIFI Configure process
-            g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;
+            aws_socket_close(&g_socket_connection);
+        }
+
+        if ((g_wifi_connected == true) && (g_wifi_disconnect_requested == false) &&
+            aws_wifi_ota_is_downloading())
+        {
+            // Leaving the access point would abort the WINC1500 firmware download,
+            // reconnect to AWS IoT over the same association instead
+            console_print_message("AWS Zero Touch Demo: Reconnecting to AWS IoT during the WINC1500 firmware download.");
+            g_aws_wifi_state = AWS_STATE_AWS_CONNECTING;
+            aws_wifi_resolve_host();
             break;
-                        
-        case AWS_STATE_AWS_DISCONNECT:       
-            // The AWS Zero Touch Demo is disconnected from AWS IoT
+        }
 
-            // Disconnect from AWS IoT
-            if (g_is_connected == true)
+        if ((g_wifi_connected == true) && (g_wifi_disconnect_requested == false))
+        {
+            // Disconnect from the WINC1500 WIFI and wait for the disconnected event
+            m2m_wifi_disconnect();
+            g_wifi_disconnect_requested = true;
+            break;
+        }
+        g_wifi_disconnect_requested = false;
+                    
+        console_print_success_message("AWS Zero Touch Demo: Disconnected from WIFI access point.");
+
+        if (aws_wifi_ota_is_restart_pending())
+        {
+            // Reset and initialize the WINC1500 again to boot the image it switched to
+            console_print_message("AWS Zero Touch Demo: Restarting the WINC1500.");
+            socketDeinit();
+            m2m_wifi_deinit(NULL);
+
+            g_aws_wifi_state = AWS_STATE_WINC1500_INIT;
+            break;
+        }
+        
+        // Set the state to start the AWS WIFI Configure process
+        g_aws_wifi_state = AWS_STATE_WIFI_CONFIGURE;
+        break;
+                    
+    case AWS_STATE_AWS_DISCONNECT:       
+        // The AWS Zero Touch Demo is disconnected from AWS IoT
+
+        // Disconnect from AWS IoT
+        if (g_is_connected == true)
+        {
+            // A persistent session keeps its subscription on the broker so the
+            // update deltas sent while offline are queued for the next connection
+            if (!AWS_WIFI_MQTT_PERSISTENT_SESSION)
             {
                 // Unsubscribe to the AWS IoT update delta topic message
                 mqtt_status = MQTTUnsubscribe(&g_mqtt_client, g_mqtt_update_delta_topic_name);
@@ -1571,38 +1955,307 @@ void aws_wifi_task(void *params)
                     console_print_error_message(
                         "The AWS IoT Demo failed to unsubscribe to the MQTT update topic subscription.");
                 }
-                
-                // Disconnect from AWS IoT
-                mqtt_status = MQTTDisconnect(&g_mqtt_client);
-                if (mqtt_status != SUCCESS)
-                {
-                    // The AWS IoT Demo failed to disconnect from AWS IoT
-                    aws_iot_set_status(AWS_STATE_AWS_DISCONNECT,
-                                       AWS_STATUS_AWS_SUBSCRIPTION_FAILURE,
-                                       "The AWS IoT Demo failed to disconnect with the MQTT disconnect message.");
-                    
-                    console_print_message("\r\n");
-                    console_print_error_message(
-                        "The AWS IoT Demo failed to disconnect with the MQTT disconnect message.");
-                }
             }
             
-            // Set the state to start the AWS WIFI Discoonect process
-            g_aws_wifi_state = AWS_STATE_WIFI_DISCONNECT;
+            // Disconnect from AWS IoT
+            mqtt_status = MQTTDisconnect(&g_mqtt_client);
+            if (mqtt_status != SUCCESS)
+            {
+                // The AWS IoT Demo failed to disconnect from AWS IoT
+                aws_iot_set_status(AWS_STATE_AWS_DISCONNECT,
+                                   AWS_STATUS_AWS_SUBSCRIPTION_FAILURE,
+                                   "The AWS IoT Demo failed to disconnect with the MQTT disconnect message.");
+                
+                console_print_message("\r\n");
+                console_print_error_message(
+                    "The AWS IoT Demo failed to disconnect with the MQTT disconnect message.");
+            }
+        }
+        
+        // Report the WINC1500 power save statistics for the session
+        aws_wifi_power_report(true);
+
+        // Set the state to start the AWS WIFI Discoonect process
+        g_aws_wifi_state = AWS_STATE_WIFI_DISCONNECT;
+        break;
+                       
+    default:
+        // Do nothing
+        break;
+    }
+}
+
+/**
+ * \brief Applies the pushbutton presses queued by the OLED1 interrupt
+ *
+ * Every press toggles the reported button state right away, the shadow update
+ * is published when the coalescing window started by the first press ends.
+ */
+static void aws_wifi_read_pushbuttons(void)
+{
+    struct oled1_pushbutton_event pushbutton;
+    char message[64];
+
+    while (oled1_pushbutton_get_event(&pushbutton))
+    {
+        switch (pushbutton.id)
+        {
+        case OLED1_PUSHBUTTON_ID_1:
+            g_demo_button_state.button_1 = !g_demo_button_state.button_1;
+            break;
+                
+        case OLED1_PUSHBUTTON_ID_2:
+            g_demo_button_state.button_2 = !g_demo_button_state.button_2;
             break;
-                           
+                
+        case OLED1_PUSHBUTTON_ID_3:
+            g_demo_button_state.button_3 = !g_demo_button_state.button_3;
+            break;
+                
         default:
             // Do nothing
-            break;
-        }        
+            continue;
+        }
 
-        // Handle WINC1500 pending events
+        memset(&message[0], 0, sizeof(message));
+        sprintf(&message[0], "OLED1 Pushbutton %u pressed at %lu ms",
+                (unsigned int)pushbutton.id, (unsigned long)pushbutton.timestamp_ms);
+        console_print_message(message);
+
+        if (!g_button_update_pending)
+        {
+            // Start the coalescing window with the first press of a burst
+            g_button_update_pending = true;
+            TimerInit(&g_button_coalesce_timer);
+            TimerCountdownMS(&g_button_coalesce_timer, AWS_WIFI_BUTTON_COALESCE_MS);
+        }
+    }
+}
+
+/**
+ * \brief Handles an event posted to the AWS WIFI task
+ *
+ * \param[in] event                 The event to handle
+ */
+static void aws_wifi_handle_event(const struct aws_event *event)
+{
+    switch (event->type)
+    {
+    case AWS_EVENT_CRYPTO_READY:
+        g_crypto_ready = true;
+        break;
+
+    case AWS_EVENT_PROVISIONED:
+        g_provisioned = true;
+
+        // New WIFI credentials may lead to another network path
+        aws_keepalive_reset();
+
+        // Reconnect with the new credentials
+        if ((g_aws_wifi_state > AWS_STATE_WIFI_DISCONNECT) &&
+            (g_aws_wifi_state != AWS_STATE_AWS_DISCONNECT))
+        {
+            g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+        }
+        break;
+
+    case AWS_EVENT_PROVISION_RESET:
+        g_provisioned = false;
+
+        // Disconnect until the ATECCx08A is provisioned again
+        if (g_aws_wifi_state > AWS_STATE_WIFI_CONFIGURE)
+        {
+            g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+        }
+        break;
+
+    case AWS_EVENT_WINC_INTERRUPT:
+        // Handle WINC1500 pending events, the callbacks may post more events
+        g_winc_event_pending = false;
         m2m_wifi_handle_events(NULL);
+        break;
+
+    case AWS_EVENT_WIFI_DISCONNECTED:
+        if (g_aws_wifi_state >= AWS_STATE_AWS_CONNECTING)
+        {
+            // Set the state to start the AWS WIFI Disconnect process
+            g_aws_wifi_state = AWS_STATE_WIFI_DISCONNECT;
+        }
+        break;
+
+    case AWS_EVENT_AWS_CONNECT_FAILURE:
+        if (g_aws_wifi_state == AWS_STATE_AWS_CONNECTING)
+        {
+            // A WINC1500 firmware on trial is rolled back after a few failures
+            aws_wifi_ota_connect_failed();
+
+            // Set the state to start the AWS WIFI Disconnect process
+            g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+        }
+        break;
+
+    case AWS_EVENT_SOCKET_CONNECTED:
+        if ((g_aws_wifi_state == AWS_STATE_AWS_CONNECTING) &&
+            ((SOCKET)event->data == g_socket_connection.socket))
+        {
+            // Set the state to start the AWS IoT connection
+            g_aws_wifi_state = AWS_STATE_AWS_CONNECTED;
+        }
+        break;
+
+    case AWS_EVENT_SOCKET_ERROR:
+        if ((g_aws_wifi_state > AWS_STATE_WIFI_DISCONNECT) &&
+            ((SOCKET)event->data == g_socket_connection.socket))
+        {
+            // The connection is lost, skip the MQTT disconnect
+            g_is_connected = false;
+
+            // Set the state to start the AWS WIFI Disconnect process
+            g_aws_wifi_state = AWS_STATE_WIFI_DISCONNECT;
+        }
+        break;
+
+    case AWS_EVENT_PUSHBUTTON:
+        aws_wifi_read_pushbuttons();
+        break;
+
+    default:
+        // The received data is handled by the AWS IoT reporting state
+        break;
+    }
+}
+
+/**
+ * \brief Advances the WINC1500 firmware update
+ *
+ * Reports the update progress while connected to AWS IoT, and disconnects
+ * once the WINC1500 must be reset to boot the image it switched to.
+ */
+static void aws_wifi_handle_ota(void)
+{
+    // The WINC1500 must be initialized to download or roll back an image
+    if (g_aws_wifi_state < AWS_STATE_WIFI_CONFIGURE)
+    {
+        return;
+    }
+
+    aws_wifi_ota_process(g_wifi_connected);
+
+    if (aws_wifi_ota_is_report_pending() &&
+        (g_aws_wifi_state == AWS_STATE_AWS_REPORTING) && (g_mqtt_client.isconnected == 1))
+    {
+        aws_wifi_publish_ota_report_message();
+    }
+
+    if (aws_wifi_ota_is_restart_pending())
+    {
+        if ((g_aws_wifi_state > AWS_STATE_WIFI_DISCONNECT) &&
+            (g_aws_wifi_state != AWS_STATE_AWS_DISCONNECT))
+        {
+            // Set the state to start the AWS WIFI Disconnect process
+            g_aws_wifi_state = AWS_STATE_AWS_DISCONNECT;
+        }
+        else if (g_aws_wifi_state == AWS_STATE_WIFI_CONFIGURE)
+        {
+            g_aws_wifi_state = AWS_STATE_WIFI_DISCONNECT;
+        }
+    }
+}
+
+/**
+ * \brief Returns how long the AWS WIFI task may wait for the next event
+ *
+ * The task must wake up in time to publish the coalesced pushbutton presses,
+ * to retry a failed WIFI connect and, while connected to AWS IoT, to send the
+ * MQTT keep alive. Otherwise it only wakes up for events.
+ */
+static uint32_t aws_wifi_get_event_timeout(void)
+{
+    uint32_t timeout_ms = AWS_WIFI_EVENT_TIMEOUT_MAX_MS;
+    int left_ms = 0;
+
+    // Wake up to publish the pushbutton presses when the coalescing window ends,
+    // or to queue them while disconnected
+    if (g_button_update_pending)
+    {
+        left_ms = TimerLeftMS(&g_button_coalesce_timer);
+        timeout_ms = min(timeout_ms, (uint32_t)max(left_ms, 0));
+    }
+
+    if ((g_aws_wifi_state == AWS_STATE_AWS_REPORTING) && (g_mqtt_client.isconnected == 1))
+    {
+        left_ms = TimerLeftMS(&g_mqtt_client.ping_timer);
+        timeout_ms = min(timeout_ms, (uint32_t)max(left_ms, 0));
+
+        left_ms = TimerLeftMS(&g_metrics_timer);
+        timeout_ms = min(timeout_ms, (uint32_t)max(left_ms, 0));
+
+        // Drop the connection as soon as a PINGRESP is overdue
+        if (g_mqtt_client.ping_outstanding)
+        {
+            left_ms = TimerLeftMS(&g_mqtt_client.pingresp_timer);
+            timeout_ms = min(timeout_ms, (uint32_t)max(left_ms, 0));
+        }
+    }
+
+    // Wake up to retry a failed WIFI connect
+    if ((g_aws_wifi_state == AWS_STATE_AWS_CONNECT) && g_wifi_connect_retry_pending)
+    {
+        left_ms = TimerLeftMS(&g_wifi_connect_timer);
+        timeout_ms = min(timeout_ms, (uint32_t)max(left_ms, 0));
+    }
+
+    // Wake up to end a stalled WINC1500 firmware download or a failed trial
+    timeout_ms = min(timeout_ms, aws_wifi_ota_get_timeout_ms());
+
+    return timeout_ms;
+}
+
+void aws_wifi_task(void *params)
+{
+    struct aws_event event;
+    enum aws_iot_state previous_state = AWS_STATE_UNKNOWN;
+
+    // Recover the messages queued in flash before the last reset
+    aws_publish_queue_init();
+
+    do 
+    {
+        // Block until an event arrives or the MQTT keep alive is due
+        aws_event_wait(g_aws_wifi_event_queue, &event, aws_wifi_get_event_timeout());
+
+        // Obtain the provisioning mutex
+        xSemaphoreTake(g_provisioning_mutex, portMAX_DELAY);
+
+        aws_wifi_handle_event(&event);
+
+        // Run the state machine until it waits for the next event
+        do 
+        {
+            previous_state = g_aws_wifi_state;
+            aws_wifi_process_state();
+            aws_wifi_handle_ota();
+        } while (g_aws_wifi_state != previous_state);
+
+        // Publish, or queue while disconnected, the final state of a burst of pushbutton presses
+        if (g_button_update_pending && TimerIsExpired(&g_button_coalesce_timer))
+        {
+            g_button_update_pending = false;
+            aws_wifi_publish_shadow_update_message(g_demo_button_state);
+        }
+
+        // Publish the MQTT client metrics
+        if ((g_aws_wifi_state == AWS_STATE_AWS_REPORTING) && (g_mqtt_client.isconnected == 1) &&
+            TimerIsExpired(&g_metrics_timer))
+        {
+            TimerCountdownMS(&g_metrics_timer, AWS_WIFI_METRICS_INTERVAL_MS);
+            aws_wifi_publish_metrics_message();
+        }
 
         // Release the provisioning mutex
         xSemaphoreGive(g_provisioning_mutex);
 
-        // Delay the AWS WIFI task
-        vTaskDelay(AWS_WIFI_TASK_DELAY);
+        // Periodically report the time spent in the low power idle
+        low_power_report(false);
     } while (true);
-}
\ No newline at end of file
+}
@@ -30,35 +30,19 @@
 
 #include <stdbool.h>
 
+#include "aws_socket.h"
 #include "aws_status.h"
 #include "bsp/include/nm_bsp.h"
 #include "oled1.h"
 #include "socket/include/socket.h"
 
-enum wifi_status
-{
-    WIFI_STATUS_UNKNOWN          = 0,
-    WIFI_STATUS_MESSAGE_RECEIVED = 1,    
-    WIFI_STATUS_MESSAGE_SENT     = 2,
-    WIFI_STATUS_TIMEOUT          = 3,
-    WIFI_STATUS_ERROR            = 4    
-};
-
-struct socket_connection
-{
-    SOCKET socket;
-    uint32 address;
-    uint16 port;
-};
-
-void aws_wifi_set_state(enum aws_iot_state state);
-enum aws_iot_state aws_wifi_get_state(void);
-
 int aws_wifi_read_data(uint8_t *read_buffer, uint32_t read_length, 
                        uint32_t timeout_ms);
 int aws_wifi_send_data(uint8_t *send_buffer, uint32_t send_length, 
                        uint32_t timeout_ms);
                        
+void aws_wifi_wait_for_winc(uint32_t timeout_ms);
+
 void aws_wifi_publish_shadow_update_message(struct demo_button_state state);
 
 void aws_wifi_task(void *params);
@@ -10,6 +10,7 @@
  */
 #include <stdint.h>
 void assert_triggered( const char * file, uint32_t line );
+uint32_t system_stats_get_run_time_counter( void );
 #endif
 
 #include "sysclk.h"
@@ -17,6 +18,8 @@ void assert_triggered( const char * file, uint32_t line );
 #define configUSE_PREEMPTION                    1
 #define configUSE_IDLE_HOOK                     0
 #define configUSE_TICK_HOOK                     0
+#define configUSE_TICKLESS_IDLE                 2 /* vPortSuppressTicksAndSleep() is in low_power.c */
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   3
 #define configPRIO_BITS                         2
 #define configCPU_CLOCK_HZ                      /*(8000000)*/( sysclk_get_cpu_hz() )
 #define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
@@ -25,19 +28,23 @@ void assert_triggered( const char * file, uint32_t line );
 /* configTOTAL_HEAP_SIZE is not used when heap_3.c is used. */
 #define configTOTAL_HEAP_SIZE                   ( ( size_t ) ( 60000 ) )
 #define configMAX_TASK_NAME_LEN                 ( 15 )
-#define configUSE_TRACE_FACILITY                0
+#define configUSE_TRACE_FACILITY                1
 #define configUSE_16_BIT_TICKS                  0
 #define configIDLE_SHOULD_YIELD                 1
 #define configUSE_MUTEXES                       1
 #define configQUEUE_REGISTRY_SIZE               0
-#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configCHECK_FOR_STACK_OVERFLOW          2
 #define configUSE_RECURSIVE_MUTEXES             1
 #define configUSE_MALLOC_FAILED_HOOK            0
 #define configUSE_COUNTING_SEMAPHORES           1
 #define configUSE_QUEUE_SETS                    1
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 #define configENABLE_BACKWARD_COMPATIBILITY     0
 
+/* Run time statistics, counted with the RTT set up by configure_rtt(). */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        system_stats_get_run_time_counter()
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         ( 2 )
@@ -59,7 +66,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_xTaskGetSchedulerState          1
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
-#define INCLUDE_uxTaskGetStackHighWaterMark     0
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
 #define INCLUDE_xTaskGetIdleTaskHandle          0
 #define INCLUDE_xTimerGetTimerDaemonTaskHandle  0
 #define INCLUDE_pcTaskGetTaskName               0
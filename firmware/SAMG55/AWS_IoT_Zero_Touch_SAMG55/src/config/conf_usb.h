@@ -62,6 +62,10 @@
 #define  USB_DEVICE_PRODUCT_NAME          "AWS IoT Zero Touch Demo"
 // #define  USB_DEVICE_SERIAL_NAME           "12...EF"
 
+//! USB interrupt priority, not above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+//! since the report out callback posts a FreeRTOS event
+#define  UDD_USB_INT_LEVEL                10
+
 /**
  * Device speeds support
  * @{
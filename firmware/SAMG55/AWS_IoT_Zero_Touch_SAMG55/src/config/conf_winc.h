@@ -83,7 +83,7 @@ extern "C" {
 #define CONF_WINC_SPI_INT_PIO			PIOA
 #define CONF_WINC_SPI_INT_PIO_ID		ID_PIOA
 #define CONF_WINC_SPI_INT_MASK			PIO_PA24
-#define CONF_WINC_SPI_INT_PRIORITY		(0)
+#define CONF_WINC_SPI_INT_PRIORITY		(10) /* Not above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, the ISR posts FreeRTOS events */
 
 /** Clock polarity & phase. */
 #define CONF_WINC_SPI_POL				(0)
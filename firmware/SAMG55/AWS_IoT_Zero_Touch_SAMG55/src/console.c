@@ -32,6 +32,7 @@
 #include "asf.h"
 #include "console.h"
 #include "hex_dump.h"
+#include "low_power.h"
 #include "driver/include/m2m_wifi.h"
 #include "version.h"
 
@@ -54,6 +55,9 @@ void console_init(void)
 	// Configure console UART
 	sysclk_enable_peripheral_clock(CONSOLE_UART_ID);
 	stdio_serial_init(CONF_UART, &uart_serial_options);
+
+	// Only ever sent to, the low power idle waits for the last character
+	low_power_replace_flexcom_lock(SLEEPMGR_WAIT);
 }
 
 /**
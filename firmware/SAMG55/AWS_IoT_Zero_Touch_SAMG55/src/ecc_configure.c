@@ -28,10 +28,12 @@
 
 
 #include "ecc_configure.h"
+#include "ecc_devices.h"
 #include "provisioning_task.h"
 #include "atca_cfgs.h"
 #include "console.h"
 #include "atca_command.h"
+#include "task.h"
 
 // Default AWS config for the ECCx08A.  The first 16 bytes are device specific and are not copied
 // 
@@ -47,29 +49,86 @@ uint8_t aws_config[] = {
     0x3C, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x30, 0x00,   0x3C, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x30, 0x00
 };
 
+// Results of the last detect_crypto_device()
+static struct ecc_probe g_ecc_probe;
+
 //local function prototypes
 ATCA_STATUS configure_device(uint8_t new_device_address);
 
+/**
+ * \brief Reads a word of the config zone
+ *
+ * \note  Talks to the device directly, CryptoAuthLib is not initialized for it.
+ */
+static ATCA_STATUS probe_config_word(ATCADevice device, uint16_t word, uint8_t data[4])
+{
+    ATCA_STATUS status;
+    ATCAPacket packet;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.param1 = ATCA_ZONE_CONFIG;
+    packet.param2 = word;
+    status = ecc_devices_execute(device, &packet, &atRead);
+    if(status == ATCA_SUCCESS)
+        memcpy(data, &packet.data[ATCA_RSP_DATA_IDX], 4);
+
+    return status;
+}
+
+/**
+ * \brief Reads the revision and the lock bytes of the AWS ECCx08A into g_ecc_probe
+ */
+static ATCA_STATUS probe_aws_device(ATCADevice device)
+{
+    ATCA_STATUS status;
+    ATCAPacket packet;
+    uint8_t lock_word[4];
+
+    memset(&packet, 0, sizeof(packet));
+    packet.param1 = INFO_MODE_REVISION;
+    status = ecc_devices_execute(device, &packet, &atInfo);
+    if(status != ATCA_SUCCESS)
+        return status;
+
+    memcpy(g_ecc_probe.revision, &packet.data[ATCA_RSP_DATA_IDX], INFO_SIZE);
+
+    // a single read returns the lock bytes of both zones
+    status = probe_config_word(device, ECC_DEVICES_LOCK_WORD, lock_word);
+    if(status != ATCA_SUCCESS)
+        return status;
+
+    g_ecc_probe.data_locked   = (lock_word[ECC_DEVICES_LOCK_DATA_INDEX] == ECC_DEVICES_LOCKED);
+    g_ecc_probe.config_locked = (lock_word[ECC_DEVICES_LOCK_CONFIG_INDEX] == ECC_DEVICES_LOCKED);
+    g_ecc_probe.valid = true;
+
+    return ATCA_SUCCESS;
+}
+
 ATCA_STATUS detect_crypto_device()
 {
     ATCA_STATUS  status;
     static bool attachedDevices[3];    //array to keep track of the devices detected
-    uint8_t cur_config[ATCA_ECC_CONFIG_SIZE];
+    TickType_t start = xTaskGetTickCount();
+    ATCADevice device = NULL;
+    uint8_t serial_number[4];
 
     // do device detection
     memset(attachedDevices, 0, sizeof(attachedDevices));
+    memset(&g_ecc_probe, 0, sizeof(g_ecc_probe));
         
     g_crypto_device = cfg_ateccx08a_i2c_default;
     g_crypto_device.atcai2c.slave_address = ECCx08A_DEFAULT_ADDRESS;
     g_crypto_device.atcai2c.bus = 0;
-    g_crypto_device.atcai2c.baud = 400000;
+    g_crypto_device.atcai2c.baud = ECC_DEVICES_BAUD_DEFAULT;
 
     // detect any devices connected with factory default address, ECCx08A_DEFAULT_ADDRESS
-    status = atcab_init(&g_crypto_device);
-    if(status != ATCA_SUCCESS)
-        return status;
-        
-    status = atcab_read_config_zone(cur_config);
+    device = newATCADevice(&g_crypto_device);
+    if(device == NULL)
+        return ATCA_ALLOC_FAILURE;
+
+    // the serial number differs between devices, so two devices answering at once fail the CRC
+    status = probe_config_word(device, SERIAL_NUMBER_WORD, serial_number);
+    deleteATCADevice(&device);
     if(status == ATCA_RX_CRC_ERROR)
     {
         // corrupted data received.  A likely cause is that there are multiple devices with the same address attached.
@@ -89,8 +148,16 @@ ATCA_STATUS detect_crypto_device()
 
     // try to communicate with AWS_ECCx08A_I2C_ADDRESS
     g_crypto_device.atcai2c.slave_address = AWS_ECCx08A_I2C_ADDRESS;
-    atcab_init(&g_crypto_device);
-    status = atcab_read_config_zone(cur_config);
+    device = newATCADevice(&g_crypto_device);
+    if(device == NULL)
+        return ATCA_ALLOC_FAILURE;
+
+    status = probe_aws_device(device);
+
+    // leave the device asleep, as after power on
+    atsleep(atGetIFace(device));
+    deleteATCADevice(&device);
+    g_ecc_probe.probe_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
         
     if(status == ATCA_TOO_MANY_COMM_RETRIES)
         // no devices found
@@ -120,6 +187,14 @@ ATCA_STATUS detect_crypto_device()
 
 }
 
+/**
+ * \brief Gets the results of the last detect_crypto_device()
+ */
+const struct ecc_probe *get_crypto_device_probe(void)
+{
+    return &g_ecc_probe;
+}
+
 ATCA_STATUS preconfigure_crypto_device()
 {
     ATCA_STATUS  status;
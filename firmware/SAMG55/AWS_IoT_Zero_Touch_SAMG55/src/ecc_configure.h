@@ -42,12 +42,26 @@
 #define SLOTCONFIG_OFFSET   20
 #define KEYCONFIG_OFFSET    96
 
+// Config zone word holding SN[4:7], unique to each device
+#define SERIAL_NUMBER_WORD  2
+
+// Results of the boot probe of the AWS ECCx08A, used to initialize CryptoAuthLib
+struct ecc_probe
+{
+    bool     valid;                   //! Whether the device answered both probe commands
+    uint8_t  revision[INFO_SIZE];     //! The Info command revision
+    bool     config_locked;           //! Whether the Config zone is locked
+    bool     data_locked;             //! Whether the Data zone is locked
+    uint32_t probe_ms;                //! Time the detection took
+};
+
 // ! Mutable device description object
 extern ATCAIfaceCfg      g_crypto_device;
 
 // Function Prototypes
 ATCA_STATUS preconfigure_crypto_device(void);
 ATCA_STATUS detect_crypto_device(void);
+const struct ecc_probe *get_crypto_device_probe(void);
 bool check_config_compatibility(void);
 
 
@@ -0,0 +1,793 @@
+/**
+ * \file
+ * \brief ATECCx08A Secure Element Pool
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "asf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "console.h"
+#include "ecc_devices.h"
+#include "hal/hal_samg55_i2c_asf.h"
+#include "provisioning_task.h"
+
+// Defines
+#define ECC_DEVICES_SECONDARY_ADDRESSES  { AWS_WINC_ECC508A_I2C_ADDRESS, ECCx08A_DEFAULT_ADDRESS }
+#define ECC_DEVICES_UNASSIGNED           (0xFF)   //! Device index of a job that has not started
+#define ECC_DEVICES_TWI                  (EXT1_TWI_MODULE)  //! The TWI of the ATECCx08A bus
+#define ECC_DEVICES_TWI_CLK_OFFSET       (3)      //! Peripheral clocks the TWI adds to each SCL half period
+
+
+/**
+ * \brief A device of the pool.
+ */
+struct ecc_device
+{
+    ATCAIfaceCfg            cfg;        //! The interface configuration of a secondary device
+    ATCADevice              device;     //! The secondary device, NULL for the primary device
+    struct kit_device       kit;        //! The Kit Protocol description of the device
+    struct ecc_device_stats stats;      //! The device statistics
+};
+
+/**
+ * \brief The job running on a device of the pool.
+ */
+struct ecc_device_slot
+{
+    struct ecc_job *job;                //! The job, NULL if the device is idle
+    ATCAPacket      packet;             //! The command of the current step and its response
+    TickType_t      sent;               //! When the command of the current step was sent
+};
+
+
+// Global variables
+
+//! The devices of the pool, the primary device first
+static struct ecc_device      g_ecc_devices[ECC_DEVICES_MAX];
+static size_t                 g_ecc_device_count = 0;
+
+//! Times a faster I2C speed failed its check and the bus went back to the previous speed
+static uint32_t               g_ecc_baud_fallbacks = 0;
+
+//! The scheduler state of each device, kept off the task stack
+static struct ecc_device_slot g_ecc_device_slots[ECC_DEVICES_MAX];
+
+//! The jobs started by ecc_devices_start(), NULL when no jobs are running
+static struct ecc_job        *g_ecc_jobs = NULL;
+static size_t                 g_ecc_job_count = 0;
+
+
+/**
+ * \brief Executes a single command on a device, waiting for its response
+ *
+ * \note  Works on any device, CryptoAuthLib does not need to be initialized.
+ *
+ * \param[in]     device            The device
+ * \param[in,out] packet            The command packet, returns the response
+ * \param[in]     build             Builds the command packet
+ *
+ * \return  The command status
+ */
+ATCA_STATUS ecc_devices_execute(ATCADevice device, ATCAPacket *packet,
+                                ATCA_STATUS (*build)(ATCACommand, ATCAPacket*))
+{
+    ATCA_STATUS status = build(atGetCommands(device), packet);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+
+    return atca_execute_command(packet, device);
+}
+
+/**
+ * \brief Identifies a secondary device and checks that it can run jobs
+ *
+ * \param[in,out] ecc_device        The device, returns its type
+ *
+ * \return  ATCA_SUCCESS if the device is an ATECCx08A with a locked Config zone
+ */
+static ATCA_STATUS ecc_devices_identify(struct ecc_device *ecc_device)
+{
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+    ATCAPacket packet;
+    uint8_t revision = 0;
+
+    // Read the device revision
+    memset(&packet, 0, sizeof(packet));
+    packet.param1 = INFO_MODE_REVISION;
+    status = ecc_devices_execute(ecc_device->device, &packet, &atInfo);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+
+    revision = packet.data[ATCA_RSP_DATA_IDX + 2];
+    if (revision >= 0x60)
+    {
+        ecc_device->cfg.devtype = ATECC608A;
+        ecc_device->kit.device_id = KIT_DEVICE_ID_ATECC608A;
+    }
+    else if (revision >= 0x50)
+    {
+        ecc_device->cfg.devtype = ATECC508A;
+        ecc_device->kit.device_id = KIT_DEVICE_ID_ATECC508A;
+    }
+    else
+    {
+        return ATCA_BAD_PARAM;
+    }
+
+    // Only a configured device runs the Verify command
+    memset(&packet, 0, sizeof(packet));
+    packet.param1 = ATCA_ZONE_CONFIG;
+    packet.param2 = ECC_DEVICES_LOCK_WORD;
+    status = ecc_devices_execute(ecc_device->device, &packet, &atRead);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+
+    if (packet.data[ATCA_RSP_DATA_IDX + ECC_DEVICES_LOCK_CONFIG_INDEX] != ECC_DEVICES_LOCKED)
+    {
+        return ATCA_NOT_LOCKED;
+    }
+
+    return ATCA_SUCCESS;
+}
+
+/**
+ * \brief Releases the secondary devices of the pool
+ */
+static void ecc_devices_release(void)
+{
+    for (size_t index = 0; index < g_ecc_device_count; index++)
+    {
+        if (g_ecc_devices[index].device != NULL)
+        {
+            deleteATCADevice(&g_ecc_devices[index].device);
+        }
+    }
+
+    memset(&g_ecc_devices[0], 0, sizeof(g_ecc_devices));
+    g_ecc_device_count = 0;
+}
+
+/**
+ * \brief Initializes the pool with the primary device and probes the secondary devices
+ *
+ * \param[in] primary_cfg           The configuration CryptoAuthLib was initialized with
+ *
+ * \return  ATCA_SUCCESS, a secondary device that is not found is left out of the pool
+ */
+ATCA_STATUS ecc_devices_init(ATCAIfaceCfg *primary_cfg)
+{
+    const uint8_t secondary_addresses[] = ECC_DEVICES_SECONDARY_ADDRESSES;
+    struct ecc_device *ecc_device = NULL;
+    char message[64];
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+
+    ecc_devices_release();
+
+    // The primary device is the CryptoAuthLib device, used through atcab_get_device()
+    ecc_device = &g_ecc_devices[ECC_DEVICES_PRIMARY];
+    ecc_device->cfg = *primary_cfg;
+    ecc_device->kit.device_id = (primary_cfg->devtype == ATECC608A) ?
+                                KIT_DEVICE_ID_ATECC608A : KIT_DEVICE_ID_ATECC508A;
+    ecc_device->kit.protocol  = KIT_DEVICE_TWI;
+    ecc_device->kit.address   = primary_cfg->atcai2c.slave_address;
+    g_ecc_device_count = 1;
+
+    for (size_t index = 0; index < sizeof(secondary_addresses); index++)
+    {
+        if ((g_ecc_device_count >= ECC_DEVICES_MAX) ||
+            (secondary_addresses[index] == primary_cfg->atcai2c.slave_address))
+        {
+            continue;
+        }
+
+        ecc_device = &g_ecc_devices[g_ecc_device_count];
+        ecc_device->cfg = *primary_cfg;
+        ecc_device->cfg.atcai2c.slave_address = secondary_addresses[index];
+        ecc_device->kit.protocol = KIT_DEVICE_TWI;
+        ecc_device->kit.address  = secondary_addresses[index];
+
+        ecc_device->device = newATCADevice(&ecc_device->cfg);
+        if (ecc_device->device == NULL)
+        {
+            memset(ecc_device, 0, sizeof(*ecc_device));
+            break;
+        }
+
+        status = ecc_devices_identify(ecc_device);
+        deleteATCADevice(&ecc_device->device);
+        if (status != ATCA_SUCCESS)
+        {
+            memset(ecc_device, 0, sizeof(*ecc_device));
+            continue;
+        }
+
+        // Create the device again, its command timing follows the device type
+        ecc_device->device = newATCADevice(&ecc_device->cfg);
+        if (ecc_device->device == NULL)
+        {
+            memset(ecc_device, 0, sizeof(*ecc_device));
+            break;
+        }
+
+        sprintf(&message[0], "Found a secondary ECCx08A TWI(%02X).", ecc_device->kit.address);
+        console_print_message(message);
+        g_ecc_device_count++;
+    }
+
+    return ATCA_SUCCESS;
+}
+
+size_t ecc_devices_get_count(void)
+{
+    return g_ecc_device_count;
+}
+
+/**
+ * \brief Gets a device of the pool
+ *
+ * \param[in] index                 The device index, the Kit Protocol device handle
+ *
+ * \return  The device, NULL if there is no device at the index
+ */
+ATCADevice ecc_devices_get_device(size_t index)
+{
+    if (index >= g_ecc_device_count)
+    {
+        return NULL;
+    }
+
+    // CryptoAuthLib creates the primary device again on every atcab_init()
+    return (index == ECC_DEVICES_PRIMARY) ? atcab_get_device() : g_ecc_devices[index].device;
+}
+
+bool ecc_devices_get_kit_device(size_t index, struct kit_device *kit_device)
+{
+    if ((index >= g_ecc_device_count) || (kit_device == NULL))
+    {
+        return false;
+    }
+
+    *kit_device = g_ecc_devices[index].kit;
+
+    return true;
+}
+
+/**
+ * \brief Gets the fastest I2C speed all devices of the pool support
+ *
+ * \note  The ATECC508A is kept at the speed it was always run at.
+ */
+uint32_t ecc_devices_get_max_baud(void)
+{
+    uint32_t baud = ECC_DEVICES_BAUD_ATECC608A;
+
+    for (size_t index = 0; index < g_ecc_device_count; index++)
+    {
+        if (g_ecc_devices[index].cfg.devtype != ATECC608A)
+        {
+            baud = ECC_DEVICES_BAUD_DEFAULT;
+        }
+    }
+
+    return baud;
+}
+
+/**
+ * \brief Sets the I2C speed of the shared bus
+ *
+ * \note  The bus stays open, only its clock changes. It must not be called
+ *        while a job is running on the bus.
+ *
+ * \param[in,out] primary_cfg       The configuration CryptoAuthLib was initialized with
+ * \param[in]     baud              The I2C speed, in Hz
+ *
+ * \return  ATCA_BAD_PARAM if the TWI can not run at the speed, the speed is
+ *          left unchanged then
+ */
+ATCA_STATUS ecc_devices_set_baud(ATCAIfaceCfg *primary_cfg, uint32_t baud)
+{
+    ATCADevice device = atcab_get_device();
+
+    if (device == NULL)
+    {
+        return ATCA_NOT_INITIALIZED;
+    }
+
+    if (twi_set_speed(ECC_DEVICES_TWI, baud, sysclk_get_peripheral_hz()) != PASS)
+    {
+        return ATCA_BAD_PARAM;
+    }
+
+    // All devices share the bus, so they all run at the same speed. The HAL
+    // drops to a slower speed for the wake pulse and restores this one after.
+    primary_cfg->atcai2c.baud = baud;
+    for (size_t index = 0; index < g_ecc_device_count; index++)
+    {
+        g_ecc_devices[index].cfg.atcai2c.baud = baud;
+    }
+
+    change_i2c_speed(atGetIFace(device), baud);
+
+    return ATCA_SUCCESS;
+}
+
+/**
+ * \brief Gets the I2C clock the TWI actually generates
+ *
+ * \return  The SCL frequency, in Hz, from the TWI clock waveform generator
+ */
+uint32_t ecc_devices_get_scl_hz(void)
+{
+    uint32_t cwgr = ECC_DEVICES_TWI->TWI_CWGR;
+    uint32_t ckdiv = (cwgr & TWI_CWGR_CKDIV_Msk) >> TWI_CWGR_CKDIV_Pos;
+    uint32_t low = (((cwgr & TWI_CWGR_CLDIV_Msk) >> TWI_CWGR_CLDIV_Pos) << ckdiv) + ECC_DEVICES_TWI_CLK_OFFSET;
+    uint32_t high = (((cwgr & TWI_CWGR_CHDIV_Msk) >> TWI_CWGR_CHDIV_Pos) << ckdiv) + ECC_DEVICES_TWI_CLK_OFFSET;
+
+    return sysclk_get_peripheral_hz() / (low + high);
+}
+
+/**
+ * \brief Moves the bus to the fastest I2C speed the devices support
+ *
+ * The config zone is read at the current speed first, then read again
+ * several times at the faster speed. A CRC error or a read that does not
+ * match returns the bus to the current speed.
+ *
+ * \param[in,out] primary_cfg       The configuration CryptoAuthLib was initialized with
+ *
+ * \return  ATCA_SUCCESS at either speed, the CryptoAuthLib status otherwise
+ */
+ATCA_STATUS ecc_devices_negotiate_baud(ATCAIfaceCfg *primary_cfg)
+{
+    uint32_t current_baud = primary_cfg->atcai2c.baud;
+    uint32_t baud = ecc_devices_get_max_baud();
+    uint8_t baseline[ATCA_ECC_CONFIG_SIZE];
+    uint8_t config[ATCA_ECC_CONFIG_SIZE];
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+    char message[64];
+
+    if (baud <= current_baud)
+    {
+        return ATCA_SUCCESS;
+    }
+
+    status = atcab_read_config_zone(baseline);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+
+    status = ecc_devices_set_baud(primary_cfg, baud);
+    for (size_t read = 0; (read < ECC_DEVICES_BAUD_CHECK_READS) && (status == ATCA_SUCCESS); read++)
+    {
+        status = atcab_read_config_zone(config);
+        if ((status == ATCA_SUCCESS) && (memcmp(config, baseline, sizeof(config)) != 0))
+        {
+            status = ATCA_RX_CRC_ERROR;
+        }
+    }
+
+    if (status != ATCA_SUCCESS)
+    {
+        g_ecc_baud_fallbacks++;
+        sprintf(&message[0], "The ECCx08A failed at %lu kHz, staying at %lu kHz.",
+                (unsigned long)(baud / 1000), (unsigned long)(current_baud / 1000));
+        console_print_warning_message(message);
+
+        return ecc_devices_set_baud(primary_cfg, current_baud);
+    }
+
+    sprintf(&message[0], "The ECCx08A I2C bus runs at %lu kHz.", (unsigned long)(baud / 1000));
+    console_print_message(message);
+
+    return ATCA_SUCCESS;
+}
+
+/**
+ * \brief Builds and sends the next step of the job running on a device
+ *
+ * \return  ATCA_SUCCESS if the step was sent, ATCA_NOT_INITIALIZED if the job is complete
+ */
+static ATCA_STATUS ecc_devices_send_step(size_t index)
+{
+    struct ecc_device_slot *slot = &g_ecc_device_slots[index];
+    ATCADevice device = ecc_devices_get_device(index);
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+
+    memset(&slot->packet, 0, sizeof(slot->packet));
+    if (!slot->job->build(slot->job, device, &slot->packet))
+    {
+        return ATCA_NOT_INITIALIZED;
+    }
+
+    status = atsend(atGetIFace(device), (uint8_t*)&slot->packet, slot->packet.txsize);
+    if (status == ATCA_SUCCESS)
+    {
+        slot->sent = xTaskGetTickCount();
+        g_ecc_devices[index].stats.commands++;
+    }
+
+    return status;
+}
+
+/**
+ * \brief Ends the job running on a device and puts the device to idle
+ */
+static void ecc_devices_end_job(size_t index, ATCA_STATUS status)
+{
+    struct ecc_device_slot *slot = &g_ecc_device_slots[index];
+
+    slot->job->status = status;
+    if (status != ATCA_SUCCESS)
+    {
+        g_ecc_devices[index].stats.failures++;
+    }
+
+    atidle(atGetIFace(ecc_devices_get_device(index)));
+    slot->job = NULL;
+}
+
+/**
+ * \brief Starts the next pending job the device can run
+ *
+ * \return  Whether a job was started
+ */
+static bool ecc_devices_start_job(size_t index, struct ecc_job *jobs, size_t job_count)
+{
+    struct ecc_device_slot *slot = &g_ecc_device_slots[index];
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+
+    for (size_t job = 0; job < job_count; job++)
+    {
+        if ((jobs[job].device_index != ECC_DEVICES_UNASSIGNED) ||
+            (!jobs[job].any_device && (index != ECC_DEVICES_PRIMARY)))
+        {
+            continue;
+        }
+
+        slot->job = &jobs[job];
+        slot->job->device_index = (uint8_t)index;
+        g_ecc_devices[index].stats.jobs++;
+
+        status = atwake(atGetIFace(ecc_devices_get_device(index)));
+        if (status == ATCA_SUCCESS)
+        {
+            status = ecc_devices_send_step(index);
+        }
+
+        if (status != ATCA_SUCCESS)
+        {
+            ecc_devices_end_job(index, (status == ATCA_NOT_INITIALIZED) ? ATCA_SUCCESS : status);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * \brief Receives the response of the step running on a device, once the device is done
+ *
+ * \return  Whether the device answered or timed out
+ */
+static bool ecc_devices_poll_job(size_t index)
+{
+    struct ecc_device_slot *slot = &g_ecc_device_slots[index];
+    uint32_t busy_ms = ((xTaskGetTickCount() - slot->sent) * portTICK_PERIOD_MS);
+    uint16_t response_length = sizeof(slot->packet.data);
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+
+    // A device NACKs its address while it executes the command
+    status = atreceive(atGetIFace(ecc_devices_get_device(index)), slot->packet.data, &response_length);
+    if ((status != ATCA_SUCCESS) && (busy_ms < ECC_DEVICES_STEP_TIMEOUT_MS))
+    {
+        return false;
+    }
+
+    g_ecc_devices[index].stats.busy_ms += busy_ms;
+
+    if (status == ATCA_SUCCESS)
+    {
+        status = atCheckCrc(slot->packet.data);
+    }
+
+    if (status == ATCA_SUCCESS)
+    {
+        status = slot->job->complete(slot->job, &slot->packet);
+    }
+
+    if (status == ATCA_SUCCESS)
+    {
+        slot->job->step++;
+        status = ecc_devices_send_step(index);
+    }
+
+    if (status != ATCA_SUCCESS)
+    {
+        ecc_devices_end_job(index, (status == ATCA_NOT_INITIALIZED) ? ATCA_SUCCESS : status);
+    }
+
+    return true;
+}
+
+/**
+ * \brief Starts the pending jobs on the idle devices and polls the busy ones
+ *
+ * \return  Whether a job was started or a device answered
+ */
+static bool ecc_devices_advance(void)
+{
+    bool progress = false;
+
+    for (size_t index = 0; index < g_ecc_device_count; index++)
+    {
+        if (g_ecc_device_slots[index].job == NULL)
+        {
+            progress |= ecc_devices_start_job(index, g_ecc_jobs, g_ecc_job_count);
+        }
+        else
+        {
+            progress |= ecc_devices_poll_job(index);
+        }
+    }
+
+    return progress;
+}
+
+/**
+ * \brief Counts the started jobs that have not ended
+ */
+static size_t ecc_devices_get_pending(void)
+{
+    size_t pending = 0;
+
+    for (size_t job = 0; job < g_ecc_job_count; job++)
+    {
+        pending += (g_ecc_jobs[job].status == ATCA_STATUS_UNKNOWN) ? 1 : 0;
+    }
+
+    return pending;
+}
+
+/**
+ * \brief Starts independent jobs on the devices of the pool, without waiting for them
+ *
+ * A job starts on the first idle device allowed to run it. While a device
+ * executes a command, the TWI bus is free to send the commands of the other
+ * devices, so jobs on different devices overlap. The caller can do other
+ * work while the first commands execute, then calls ecc_devices_wait().
+ *
+ * \note  Until ecc_devices_wait() returns, the devices must not be used
+ *        through any other API.
+ *
+ * \param[in,out] jobs              The jobs, each returns its status
+ * \param[in]     job_count         The number of jobs
+ *
+ * \return  ATCA_SUCCESS if the jobs were started
+ */
+ATCA_STATUS ecc_devices_start(struct ecc_job *jobs, size_t job_count)
+{
+    if ((jobs == NULL) || (g_ecc_device_count == 0) || (g_ecc_jobs != NULL))
+    {
+        return ATCA_BAD_PARAM;
+    }
+
+    for (size_t job = 0; job < job_count; job++)
+    {
+        jobs[job].step = 0;
+        jobs[job].device_index = ECC_DEVICES_UNASSIGNED;
+        jobs[job].status = ATCA_STATUS_UNKNOWN;
+    }
+
+    memset(&g_ecc_device_slots[0], 0, sizeof(g_ecc_device_slots));
+    g_ecc_jobs = jobs;
+    g_ecc_job_count = job_count;
+
+    ecc_devices_advance();
+
+    return ATCA_SUCCESS;
+}
+
+/**
+ * \brief Waits for the started jobs to end
+ *
+ * \return  ATCA_SUCCESS if all jobs succeeded, the status of the first failed job otherwise
+ */
+ATCA_STATUS ecc_devices_wait(void)
+{
+    ATCA_STATUS status = ATCA_SUCCESS;
+
+    if (g_ecc_jobs == NULL)
+    {
+        return ATCA_NOT_INITIALIZED;
+    }
+
+    while (ecc_devices_get_pending() > 0)
+    {
+        if (!ecc_devices_advance())
+        {
+            // All devices are executing, let the other tasks run
+            vTaskDelay(1);
+        }
+    }
+
+    for (size_t job = 0; job < g_ecc_job_count; job++)
+    {
+        if (g_ecc_jobs[job].status != ATCA_SUCCESS)
+        {
+            status = g_ecc_jobs[job].status;
+            break;
+        }
+    }
+
+    g_ecc_jobs = NULL;
+    g_ecc_job_count = 0;
+
+    return status;
+}
+
+/**
+ * \brief Runs independent jobs on the devices of the pool
+ *
+ * \param[in,out] jobs              The jobs, each returns its status
+ * \param[in]     job_count         The number of jobs
+ *
+ * \return  ATCA_SUCCESS if all jobs succeeded, the status of the first failed job otherwise
+ */
+ATCA_STATUS ecc_devices_run(struct ecc_job *jobs, size_t job_count)
+{
+    ATCA_STATUS status = ecc_devices_start(jobs, job_count);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+
+    return ecc_devices_wait();
+}
+
+/**
+ * \brief Builds the Nonce and the Verify command of a verify job
+ */
+static bool ecc_devices_build_verify(struct ecc_job *job, ATCADevice device, ATCAPacket *packet)
+{
+    struct ecc_verify *verify = (struct ecc_verify*)job->context;
+
+    switch (job->step)
+    {
+    case 0:
+        // Load the message digest into TempKey
+        packet->param1 = NONCE_MODE_PASSTHROUGH;
+        packet->param2 = 0;
+        memcpy(&packet->data[0], verify->message_digest, ATCA_SHA256_DIGEST_SIZE);
+        return (atNonce(atGetCommands(device), packet) == ATCA_SUCCESS);
+
+    case 1:
+        packet->param1 = VERIFY_MODE_EXTERNAL;
+        packet->param2 = VERIFY_KEY_P256;
+        memcpy(&packet->data[0], verify->signature, ATCA_SIG_SIZE);
+        memcpy(&packet->data[ATCA_SIG_SIZE], verify->public_key, ATCA_PUB_KEY_SIZE);
+        return (atVerify(atGetCommands(device), packet) == ATCA_SUCCESS);
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * \brief Takes the Nonce and the Verify response of a verify job
+ */
+static ATCA_STATUS ecc_devices_complete_verify(struct ecc_job *job, const ATCAPacket *packet)
+{
+    struct ecc_verify *verify = (struct ecc_verify*)job->context;
+    ATCA_STATUS status = isATCAError((uint8_t*)packet->data);
+
+    if (job->step == 1)
+    {
+        // A signature that does not match is a result, not a failure
+        verify->is_verified = (status == ATCA_SUCCESS);
+        if (status == ATCA_CHECKMAC_VERIFY_FAILED)
+        {
+            status = ATCA_SUCCESS;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * \brief Sets up a job verifying an external P-256 signature on any device
+ *
+ * \param[out] job                  The job
+ * \param[in]  verify               The signature to verify, returns the result
+ */
+void ecc_devices_init_verify_job(struct ecc_job *job, struct ecc_verify *verify)
+{
+    memset(job, 0, sizeof(*job));
+
+    verify->is_verified = false;
+
+    job->build      = &ecc_devices_build_verify;
+    job->complete   = &ecc_devices_complete_verify;
+    job->any_device = true;
+    job->context    = verify;
+}
+
+void ecc_devices_get_stats(size_t index, struct ecc_device_stats *stats)
+{
+    if (index < g_ecc_device_count)
+    {
+        *stats = g_ecc_devices[index].stats;
+    }
+    else
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+/**
+ * \brief Adds the pool statistics to a JSON object
+ *
+ * \param[in,out] stats_object      The JSON object, gets an "ecc_devices" array
+ */
+void ecc_devices_get_json(JSON_Object *stats_object)
+{
+    JSON_Value *devices_value = json_value_init_array();
+    JSON_Array *devices_array = json_value_get_array(devices_value);
+    JSON_Value *device_value = NULL;
+    JSON_Object *device_object = NULL;
+
+    json_object_set_number(stats_object, "ecc_baud",
+                           (g_ecc_device_count > 0) ? g_ecc_devices[ECC_DEVICES_PRIMARY].cfg.atcai2c.baud : 0);
+    json_object_set_number(stats_object, "ecc_scl_hz", ecc_devices_get_scl_hz());
+    json_object_set_number(stats_object, "ecc_baud_fallbacks", g_ecc_baud_fallbacks);
+
+    for (size_t index = 0; index < g_ecc_device_count; index++)
+    {
+        device_value  = json_value_init_object();
+        device_object = json_value_get_object(device_value);
+
+        json_object_set_number(device_object, "address",   g_ecc_devices[index].kit.address);
+        json_object_set_number(device_object, "device_id", g_ecc_devices[index].kit.device_id);
+        json_object_set_number(device_object, "jobs",      g_ecc_devices[index].stats.jobs);
+        json_object_set_number(device_object, "commands",  g_ecc_devices[index].stats.commands);
+        json_object_set_number(device_object, "busy_ms",   g_ecc_devices[index].stats.busy_ms);
+        json_object_set_number(device_object, "failures",  g_ecc_devices[index].stats.failures);
+
+        json_array_append_value(devices_array, device_value);
+    }
+
+    json_object_set_value(stats_object, "ecc_devices", devices_value);
+}
@@ -0,0 +1,138 @@
+/**
+ * \file
+ * \brief ATECCx08A Secure Element Pool
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef ECC_DEVICES_H
+#define ECC_DEVICES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cryptoauthlib.h"
+#include "kit_protocol_api.h"
+#include "parson.h"
+
+// Defines
+#define ECC_DEVICES_MAX               (3)      //! The primary ATECCx08A and the secondary devices probed
+#define ECC_DEVICES_PRIMARY           (0)      //! Index of the provisioned ATECCx08A holding the AWS IoT keys
+#define ECC_DEVICES_STEP_TIMEOUT_MS   (250)    //! Longest a device may take to answer one command
+
+// Config zone word holding the lock bytes, one 4-byte read returns both
+#define ECC_DEVICES_LOCK_WORD         (21)
+#define ECC_DEVICES_LOCK_DATA_INDEX   (2)        //! Index of the LockValue byte in the word
+#define ECC_DEVICES_LOCK_CONFIG_INDEX (3)        //! Index of the LockConfig byte in the word
+#define ECC_DEVICES_LOCKED            (0x00)     //! Lock byte value of a locked zone
+
+#define ECC_DEVICES_BAUD_DEFAULT      (400000)   //! I2C speed the devices are detected at
+#define ECC_DEVICES_BAUD_ATECC608A    (1000000)  //! Fastest I2C speed of the ATECC608A
+#define ECC_DEVICES_BAUD_CHECK_READS  (8)        //! Config zone reads that must match before a faster speed is kept
+
+struct ecc_job;
+
+/**
+ * \brief Builds the command packet of the current step of a job.
+ *
+ * \param[in,out] job      The job, job->step is the step to build
+ * \param[in]     device   The device the step runs on
+ * \param[out]    packet   The command packet, with its CRC
+ *
+ * \return  Whether there is a step to run, false when the job is complete
+ */
+typedef bool (*ecc_job_build)(struct ecc_job *job, ATCADevice device, ATCAPacket *packet);
+
+/**
+ * \brief Takes the response of the current step of a job.
+ *
+ * \param[in,out] job      The job
+ * \param[in]     packet   The command packet, its data holds the response
+ *
+ * \return  ATCA_SUCCESS to continue with the next step, the job status otherwise
+ */
+typedef ATCA_STATUS (*ecc_job_complete)(struct ecc_job *job, const ATCAPacket *packet);
+
+/**
+ * \brief An operation of one or more ATECCx08A commands, run on one device.
+ *
+ * \note  The device stays awake between the steps of a job, so TempKey
+ *        carries over, for example from a Nonce to a Verify.
+ */
+struct ecc_job
+{
+    ecc_job_build    build;         //! Builds the packet of each step
+    ecc_job_complete complete;      //! Takes the response of each step
+    bool             any_device;    //! False if the job needs the keys of the primary device
+    void            *context;       //! The operation's data
+    uint8_t          step;          //! The current step, counted by the scheduler
+    uint8_t          device_index;  //! The device the job ran on
+    ATCA_STATUS      status;        //! The job status
+};
+
+/**
+ * \brief The statistics of a device of the pool.
+ */
+struct ecc_device_stats
+{
+    uint32_t jobs;                  //! Jobs run on the device
+    uint32_t commands;              //! Commands run on the device
+    uint32_t busy_ms;               //! Time spent from sending the commands to receiving the responses
+    uint32_t failures;              //! Jobs that ended on a communication failure
+};
+
+ATCA_STATUS ecc_devices_init(ATCAIfaceCfg *primary_cfg);
+ATCA_STATUS ecc_devices_execute(ATCADevice device, ATCAPacket *packet,
+                                ATCA_STATUS (*build)(ATCACommand, ATCAPacket*));
+
+size_t ecc_devices_get_count(void);
+ATCADevice ecc_devices_get_device(size_t index);
+bool ecc_devices_get_kit_device(size_t index, struct kit_device *kit_device);
+
+ATCA_STATUS ecc_devices_start(struct ecc_job *jobs, size_t job_count);
+ATCA_STATUS ecc_devices_wait(void);
+ATCA_STATUS ecc_devices_run(struct ecc_job *jobs, size_t job_count);
+
+uint32_t ecc_devices_get_max_baud(void);
+ATCA_STATUS ecc_devices_set_baud(ATCAIfaceCfg *primary_cfg, uint32_t baud);
+uint32_t ecc_devices_get_scl_hz(void);
+ATCA_STATUS ecc_devices_negotiate_baud(ATCAIfaceCfg *primary_cfg);
+
+/**
+ * \brief The data of a job verifying an external P-256 signature.
+ */
+struct ecc_verify
+{
+    const uint8_t *message_digest;  //! The 32-byte SHA-256 digest that was signed
+    const uint8_t *signature;       //! The 64-byte signature, R and S
+    const uint8_t *public_key;      //! The 64-byte public key, X and Y
+    bool           is_verified;     //! The verify result, set by the job
+};
+
+void ecc_devices_init_verify_job(struct ecc_job *job, struct ecc_verify *verify);
+
+void ecc_devices_get_stats(size_t index, struct ecc_device_stats *stats);
+void ecc_devices_get_json(JSON_Object *stats_object);
+
+#endif // ECC_DEVICES_H
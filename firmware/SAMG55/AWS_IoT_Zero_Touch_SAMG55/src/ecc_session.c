@@ -0,0 +1,188 @@
+/**
+ * \file
+ * \brief ATECCx08A Wake Sessions
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "ecc_session.h"
+
+/**
+ * \brief The state of the wake session.
+ *
+ * Every CryptoAuthLib command wakes the device, executes and idles it. A
+ * session replaces the wake and idle functions of the device interface, so
+ * the device stays awake from one command to the next and is idled once
+ * when the session ends.
+ */
+struct ecc_session
+{
+    ATCAIface   iface;                          //! The interface of the device, NULL outside of a session
+    uint32_t    depth;                          //! Nested sessions
+    bool        awake;                          //! Whether the device was woken and not idled since
+    TickType_t  woken;                          //! When the device was woken
+    ATCA_STATUS (*wake)(ATCAIface iface);       //! The wake function of the interface
+    ATCA_STATUS (*idle)(ATCAIface iface);       //! The idle function of the interface
+    ATCA_STATUS (*sleep)(ATCAIface iface);      //! The sleep function of the interface
+};
+
+// Global variables
+static struct ecc_session       g_ecc_session;
+static struct ecc_session_stats g_ecc_session_stats;
+
+
+static ATCA_STATUS ecc_session_wake(ATCAIface iface)
+{
+    TickType_t now = xTaskGetTickCount();
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+
+    if (g_ecc_session.awake)
+    {
+        if (((now - g_ecc_session.woken) * portTICK_PERIOD_MS) < ECC_SESSION_AWAKE_MAX_MS)
+        {
+            g_ecc_session_stats.wakes_avoided++;
+            return ATCA_SUCCESS;
+        }
+
+        // Entering idle restarts the watchdog window of the next wake
+        g_ecc_session.idle(iface);
+        g_ecc_session.awake = false;
+        g_ecc_session_stats.watchdog_rewakes++;
+    }
+
+    status = g_ecc_session.wake(iface);
+    g_ecc_session_stats.wakes++;
+    if (status == ATCA_SUCCESS)
+    {
+        g_ecc_session.awake = true;
+        g_ecc_session.woken = now;
+    }
+
+    return status;
+}
+
+static ATCA_STATUS ecc_session_idle(ATCAIface iface)
+{
+    if (g_ecc_session.awake)
+    {
+        g_ecc_session_stats.idles_avoided++;
+        return ATCA_SUCCESS;
+    }
+
+    return g_ecc_session.idle(iface);
+}
+
+static ATCA_STATUS ecc_session_sleep(ATCAIface iface)
+{
+    g_ecc_session.awake = false;
+
+    return g_ecc_session.sleep(iface);
+}
+
+/**
+ * \brief Keeps the CryptoAuthLib device awake across the following commands
+ *
+ * \note  Sessions nest, each ecc_session_begin() needs an ecc_session_end().
+ *        The device must not be initialized again during a session.
+ *
+ * \return  ATCA_SUCCESS, ATCA_NOT_INITIALIZED if there is no device
+ */
+ATCA_STATUS ecc_session_begin(void)
+{
+    ATCADevice device = atcab_get_device();
+    ATCAIface iface = NULL;
+
+    if (g_ecc_session.depth > 0)
+    {
+        g_ecc_session.depth++;
+        return ATCA_SUCCESS;
+    }
+
+    if ((device == NULL) || ((iface = atGetIFace(device)) == NULL))
+    {
+        return ATCA_NOT_INITIALIZED;
+    }
+
+    memset(&g_ecc_session, 0, sizeof(g_ecc_session));
+    g_ecc_session.iface = iface;
+    g_ecc_session.depth = 1;
+    g_ecc_session.wake  = iface->atwake;
+    g_ecc_session.idle  = iface->atidle;
+    g_ecc_session.sleep = iface->atsleep;
+
+    iface->atwake  = &ecc_session_wake;
+    iface->atidle  = &ecc_session_idle;
+    iface->atsleep = &ecc_session_sleep;
+
+    g_ecc_session_stats.sessions++;
+
+    return ATCA_SUCCESS;
+}
+
+/**
+ * \brief Idles the device kept awake by the session
+ */
+void ecc_session_end(void)
+{
+    ATCAIface iface = g_ecc_session.iface;
+
+    if ((g_ecc_session.depth == 0) || (--g_ecc_session.depth > 0))
+    {
+        return;
+    }
+
+    iface->atwake  = g_ecc_session.wake;
+    iface->atidle  = g_ecc_session.idle;
+    iface->atsleep = g_ecc_session.sleep;
+
+    if (g_ecc_session.awake)
+    {
+        g_ecc_session.idle(iface);
+    }
+
+    memset(&g_ecc_session, 0, sizeof(g_ecc_session));
+}
+
+void ecc_session_get_stats(struct ecc_session_stats *stats)
+{
+    *stats = g_ecc_session_stats;
+}
+
+void ecc_session_get_json(JSON_Object *stats_object)
+{
+    JSON_Value *session_value = json_value_init_object();
+    JSON_Object *session_object = json_value_get_object(session_value);
+
+    json_object_set_number(session_object, "sessions",         g_ecc_session_stats.sessions);
+    json_object_set_number(session_object, "wakes",            g_ecc_session_stats.wakes);
+    json_object_set_number(session_object, "wakes_avoided",    g_ecc_session_stats.wakes_avoided);
+    json_object_set_number(session_object, "idles_avoided",    g_ecc_session_stats.idles_avoided);
+    json_object_set_number(session_object, "watchdog_rewakes", g_ecc_session_stats.watchdog_rewakes);
+
+    json_object_set_value(stats_object, "ecc_session", session_value);
+}
@@ -0,0 +1,54 @@
+/**
+ * \file
+ * \brief ATECCx08A Wake Sessions
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef ECC_SESSION_H
+#define ECC_SESSION_H
+
+#include <stdint.h>
+
+#include "cryptoauthlib.h"
+#include "parson.h"
+
+// Defines
+#define ECC_SESSION_AWAKE_MAX_MS  (500)  //! Longest the device is kept awake, the watchdog sleeps it after 0.7s at the earliest
+
+struct ecc_session_stats
+{
+    uint32_t sessions;          //! Sessions begun
+    uint32_t wakes;             //! Wake pulses sent during sessions
+    uint32_t wakes_avoided;     //! Wakes skipped since the device was already awake
+    uint32_t idles_avoided;     //! Idles deferred to the end of the session
+    uint32_t watchdog_rewakes;  //! Idle and wake cycles to restart the watchdog window
+};
+
+ATCA_STATUS ecc_session_begin(void);
+void ecc_session_end(void);
+
+void ecc_session_get_stats(struct ecc_session_stats *stats);
+void ecc_session_get_json(JSON_Object *stats_object);
+
+#endif // ECC_SESSION_H
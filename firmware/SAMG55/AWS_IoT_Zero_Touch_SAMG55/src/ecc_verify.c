@@ -0,0 +1,238 @@
+/**
+ * \file
+ * \brief ECDSA Signature Verification on the ATECCx08A or the MCU
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "ecc_verify.h"
+#include "p256.h"
+
+/**
+ * \brief The verify statistics.
+ */
+struct ecc_verify_stats
+{
+    uint32_t benchmark_software_ms;   //! Time of the benchmarked software verify
+    uint32_t benchmark_atecc_ms;      //! Time of the benchmarked ATECCx08A verify
+    uint32_t software_verifies;       //! Signatures verified on the MCU
+    uint32_t software_ms;             //! Time spent verifying on the MCU
+    uint32_t atecc_verifies;          //! Signatures verified on the ATECCx08A devices
+    uint32_t atecc_ms;                //! Time spent verifying on the ATECCx08A devices
+};
+
+// Global variables
+
+//! The requested verify mode
+static enum ecc_verify_mode    g_ecc_verify_mode = ECC_VERIFY_MODE_DEFAULT;
+//! Whether the software verify runs, resolved by the benchmark in ECC_VERIFY_MODE_AUTO
+static bool                    g_ecc_verify_software = false;
+//! Whether ECC_VERIFY_MODE_AUTO has been resolved
+static bool                    g_ecc_verify_benchmarked = false;
+
+static struct ecc_verify_stats g_ecc_verify_stats;
+
+//! The mode names of the kit protocol, indexed by mode
+static const char *g_ecc_verify_mode_names[] = { "auto", "atecc", "software" };
+
+#define ECC_VERIFY_MODES  (sizeof(g_ecc_verify_mode_names) / sizeof(g_ecc_verify_mode_names[0]))
+
+
+/**
+ * \brief Sets where the signatures are verified
+ *
+ * \note  Setting ECC_VERIFY_MODE_AUTO benchmarks again on the next verify.
+ */
+void ecc_verify_set_mode(enum ecc_verify_mode mode)
+{
+    g_ecc_verify_mode = mode;
+    g_ecc_verify_software = (mode == ECC_VERIFY_MODE_SOFTWARE);
+    g_ecc_verify_benchmarked = (mode != ECC_VERIFY_MODE_AUTO);
+}
+
+enum ecc_verify_mode ecc_verify_get_mode(void)
+{
+    return g_ecc_verify_mode;
+}
+
+const char* ecc_verify_get_mode_name(enum ecc_verify_mode mode)
+{
+    if ((size_t)mode >= ECC_VERIFY_MODES)
+    {
+        return NULL;
+    }
+
+    return g_ecc_verify_mode_names[mode];
+}
+
+/**
+ * \return  Whether the name is one of the mode names
+ */
+bool ecc_verify_get_mode_by_name(const char *name, enum ecc_verify_mode *mode)
+{
+    for (size_t index = 0; index < ECC_VERIFY_MODES; index++)
+    {
+        if ((name != NULL) && (strcmp(name, g_ecc_verify_mode_names[index]) == 0))
+        {
+            *mode = (enum ecc_verify_mode)index;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \brief Verifies signatures on the MCU
+ */
+static void ecc_verify_run_software(struct ecc_job *jobs, size_t job_count)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    for (size_t job = 0; job < job_count; job++)
+    {
+        struct ecc_verify *verify = (struct ecc_verify*)jobs[job].context;
+
+        verify->is_verified = p256_verify(verify->message_digest, verify->signature,
+                                          verify->public_key);
+        jobs[job].status = ATCA_SUCCESS;
+    }
+
+    g_ecc_verify_stats.software_verifies += job_count;
+    g_ecc_verify_stats.software_ms += ((xTaskGetTickCount() - start) * portTICK_PERIOD_MS);
+}
+
+/**
+ * \brief Verifies signatures on the ATECCx08A devices of the pool
+ */
+static ATCA_STATUS ecc_verify_run_atecc(struct ecc_job *jobs, size_t job_count)
+{
+    TickType_t start = xTaskGetTickCount();
+    ATCA_STATUS atca_status = ecc_devices_run(jobs, job_count);
+
+    g_ecc_verify_stats.atecc_verifies += job_count;
+    g_ecc_verify_stats.atecc_ms += ((xTaskGetTickCount() - start) * portTICK_PERIOD_MS);
+
+    return atca_status;
+}
+
+/**
+ * \brief Verifies the first signature both ways and keeps the faster one
+ *
+ * The ATECCx08A time is divided by the devices of the pool, since a batch
+ * is spread over all of them. The software verify is only kept if it
+ * agrees with the ATECCx08A.
+ */
+static ATCA_STATUS ecc_verify_benchmark(struct ecc_job *job)
+{
+    struct ecc_verify *verify = (struct ecc_verify*)job->context;
+    TickType_t start = xTaskGetTickCount();
+    bool is_verified = false;
+    ATCA_STATUS atca_status = ATCA_GEN_FAIL;
+
+    is_verified = p256_verify(verify->message_digest, verify->signature, verify->public_key);
+    g_ecc_verify_stats.benchmark_software_ms = ((xTaskGetTickCount() - start) * portTICK_PERIOD_MS);
+
+    start = xTaskGetTickCount();
+    atca_status = ecc_verify_run_atecc(job, 1);
+    g_ecc_verify_stats.benchmark_atecc_ms = ((xTaskGetTickCount() - start) * portTICK_PERIOD_MS);
+    if (atca_status != ATCA_SUCCESS)
+    {
+        // Benchmark again on the next verify
+        return atca_status;
+    }
+
+    g_ecc_verify_software = (is_verified == verify->is_verified) &&
+                            ((g_ecc_verify_stats.benchmark_software_ms * ecc_devices_get_count()) <=
+                             g_ecc_verify_stats.benchmark_atecc_ms);
+    g_ecc_verify_benchmarked = true;
+
+    return ATCA_SUCCESS;
+}
+
+/**
+ * \brief Verifies external P-256 signatures where the verify mode says
+ *
+ * \param[in,out] jobs              Jobs set up by ecc_devices_init_verify_job(),
+ *                                  each returns its status and result
+ * \param[in]     job_count         The number of jobs
+ *
+ * \return  ATCA_SUCCESS if all jobs ran, the status of the first failed job otherwise
+ */
+ATCA_STATUS ecc_verify_run(struct ecc_job *jobs, size_t job_count)
+{
+    ATCA_STATUS atca_status = ATCA_SUCCESS;
+
+    if ((jobs == NULL) || (job_count == 0))
+    {
+        return ATCA_BAD_PARAM;
+    }
+
+    if (!g_ecc_verify_benchmarked)
+    {
+        atca_status = ecc_verify_benchmark(&jobs[0]);
+        if (atca_status != ATCA_SUCCESS)
+        {
+            return atca_status;
+        }
+
+        // The first job is done
+        jobs++;
+        job_count--;
+        if (job_count == 0)
+        {
+            return ATCA_SUCCESS;
+        }
+    }
+
+    if (g_ecc_verify_software)
+    {
+        ecc_verify_run_software(jobs, job_count);
+        return ATCA_SUCCESS;
+    }
+
+    return ecc_verify_run_atecc(jobs, job_count);
+}
+
+void ecc_verify_get_json(JSON_Object *stats_object)
+{
+    JSON_Value *verify_value = json_value_init_object();
+    JSON_Object *verify_object = json_value_get_object(verify_value);
+
+    json_object_set_string(verify_object,  "mode",                  ecc_verify_get_mode_name(g_ecc_verify_mode));
+    json_object_set_boolean(verify_object, "software",              g_ecc_verify_software);
+    json_object_set_boolean(verify_object, "benchmarked",           g_ecc_verify_benchmarked);
+    json_object_set_number(verify_object,  "benchmark_software_ms", g_ecc_verify_stats.benchmark_software_ms);
+    json_object_set_number(verify_object,  "benchmark_atecc_ms",    g_ecc_verify_stats.benchmark_atecc_ms);
+    json_object_set_number(verify_object,  "software_verifies",     g_ecc_verify_stats.software_verifies);
+    json_object_set_number(verify_object,  "software_ms",           g_ecc_verify_stats.software_ms);
+    json_object_set_number(verify_object,  "atecc_verifies",        g_ecc_verify_stats.atecc_verifies);
+    json_object_set_number(verify_object,  "atecc_ms",              g_ecc_verify_stats.atecc_ms);
+
+    json_object_set_value(stats_object, "ecc_verify", verify_value);
+}
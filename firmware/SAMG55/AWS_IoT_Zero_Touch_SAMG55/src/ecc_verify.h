@@ -0,0 +1,61 @@
+/**
+ * \file
+ * \brief ECDSA Signature Verification on the ATECCx08A or the MCU
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef ECC_VERIFY_H
+#define ECC_VERIFY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cryptoauthlib.h"
+#include "ecc_devices.h"
+#include "parson.h"
+
+/**
+ * \brief Where external P-256 signatures are verified.
+ */
+enum ecc_verify_mode
+{
+    ECC_VERIFY_MODE_AUTO,       //! Benchmarked on the first verify, the faster one is kept
+    ECC_VERIFY_MODE_ATECC,      //! On the ATECCx08A devices of the pool
+    ECC_VERIFY_MODE_SOFTWARE    //! On the MCU, leaving the ATECCx08A and the TWI bus free
+};
+
+// Defines
+#define ECC_VERIFY_MODE_DEFAULT  (ECC_VERIFY_MODE_AUTO)
+
+void ecc_verify_set_mode(enum ecc_verify_mode mode);
+enum ecc_verify_mode ecc_verify_get_mode(void);
+const char* ecc_verify_get_mode_name(enum ecc_verify_mode mode);
+bool ecc_verify_get_mode_by_name(const char *name, enum ecc_verify_mode *mode);
+
+ATCA_STATUS ecc_verify_run(struct ecc_job *jobs, size_t job_count);
+
+void ecc_verify_get_json(JSON_Object *stats_object);
+
+#endif // ECC_VERIFY_H
@@ -0,0 +1,211 @@
+/**
+ * \file
+ * \brief Resident Boot Sector for Firmware Updates
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include "asf.h"
+#include "firmware_update.h"
+
+// Defines
+#define FIRMWARE_BOOT_PAGES_PER_SECTOR  (IFLASH_LOCK_REGION_SIZE / IFLASH_PAGE_SIZE)
+#define FIRMWARE_BOOT_EPA_16_PAGES      (2)  // EFC_FCMD_EPA argument to erase 16 pages
+#define FIRMWARE_BOOT_APP_PAGE          ((FIRMWARE_UPDATE_APP_ADDR - IFLASH_ADDR) / IFLASH_PAGE_SIZE)
+#define FIRMWARE_BOOT_MARKER_PAGE       ((FIRMWARE_UPDATE_MARKER_ADDR - IFLASH_ADDR) / IFLASH_PAGE_SIZE)
+#define FIRMWARE_BOOT_COMMAND_CODE_SIZE (6)  // Halfwords of g_firmware_boot_command_code
+
+// The boot sector runs before the C runtime is set up, everything it uses
+// must be in the .boot sections and it may only use the stack
+#define FIRMWARE_BOOT_FUNC              __attribute__ ((section(".boot"), noinline))
+#define FIRMWARE_BOOT_CONST             __attribute__ ((section(".boot.rodata")))
+
+extern uint32_t _estack;
+
+void firmware_boot_reset(void);
+void firmware_boot_fault(void);
+
+/**
+ * \brief The vector table at the start of the flash
+ *
+ * The application vector table follows the boot sector, the application
+ * points VTOR at it from its Reset_Handler.
+ */
+__attribute__ ((section(".boot_vectors"), used))
+static const void *const g_firmware_boot_vectors[4] =
+{
+    (void*)&_estack,
+    (void*)firmware_boot_reset,
+    (void*)firmware_boot_fault,  // NMI
+    (void*)firmware_boot_fault   // HardFault
+};
+
+
+/**
+ * \brief Thumb code that writes EEFC_FCR and waits for EEFC_FSR.FRDY
+ *
+ * The flash cannot be read while it is erased or programmed, so this must
+ * not run from the flash. ASF keeps efc_perform_fcr() in .ramfunc for the
+ * same reason, but .ramfunc is only copied to RAM by the C runtime.
+ * Called as uint32_t (*)(Efc *efc, uint32_t fcr), returns EEFC_FSR.
+ */
+FIRMWARE_BOOT_CONST
+static const uint16_t g_firmware_boot_command_code[FIRMWARE_BOOT_COMMAND_CODE_SIZE] =
+{
+    0x6041,  //    str  r1, [r0, #4]   EEFC_FCR = fcr
+    0x6882,  // 1: ldr  r2, [r0, #8]   status = EEFC_FSR
+    0x07D3,  //    lsls r3, r2, #31
+    0xD0FC,  //    beq  1b             until FRDY
+    0x4610,  //    mov  r0, r2
+    0x4770   //    bx   lr
+};
+
+
+/**
+ * \brief Runs a flash controller command and waits for it
+ *
+ * The command and the wait run from a copy of g_firmware_boot_command_code
+ * on the stack.
+ *
+ * \return The error flags of the command, they are cleared by reading them
+ */
+FIRMWARE_BOOT_FUNC
+static uint32_t firmware_boot_flash_command(uint32_t command, uint32_t argument)
+{
+    // Volatile, so the copy is not turned into a memcpy() call in the application
+    volatile uint16_t code[FIRMWARE_BOOT_COMMAND_CODE_SIZE] __attribute__ ((aligned(4)));
+    uint32_t (*perform_fcr)(Efc *efc, uint32_t fcr) = NULL;
+    uint32_t status = 0;
+
+    for (uint32_t index = 0; index < FIRMWARE_BOOT_COMMAND_CODE_SIZE; index++)
+    {
+        code[index] = g_firmware_boot_command_code[index];
+    }
+    __DSB();
+    __ISB();
+
+    perform_fcr = (uint32_t (*)(Efc*, uint32_t))((uint32_t)code | 1);
+    status = perform_fcr(EFC, EEFC_FCR_FKEY_PASSWD | EEFC_FCR_FCMD(command) | EEFC_FCR_FARG(argument));
+
+    return (status & (EEFC_FSR_FCMDE | EEFC_FSR_FLOCKE | EEFC_FSR_FLERR));
+}
+
+/**
+ * \brief Copies the staged image over the application
+ *
+ * The staging region is only read, so the copy can be restarted from the
+ * beginning as often as needed.
+ *
+ * \return Whether the application region reads back as the staged image
+ */
+FIRMWARE_BOOT_FUNC
+static bool firmware_boot_copy(uint32_t image_size)
+{
+    uint32_t page_count = (image_size + IFLASH_PAGE_SIZE - 1) / IFLASH_PAGE_SIZE;
+    const volatile uint32_t *source = NULL;
+    volatile uint32_t *latch = NULL;
+    uint32_t error = 0;
+
+    for (uint32_t page = 0; page < page_count; page++)
+    {
+        source = (const volatile uint32_t*)(FIRMWARE_UPDATE_STAGING_ADDR + (page * IFLASH_PAGE_SIZE));
+        latch = (volatile uint32_t*)(FIRMWARE_UPDATE_APP_ADDR + (page * IFLASH_PAGE_SIZE));
+
+        // The copy may take longer than the watchdog period
+        WDT->WDT_CR = WDT_CR_KEY_PASSWD | WDT_CR_WDRSTT;
+
+        if ((page % FIRMWARE_BOOT_PAGES_PER_SECTOR) == 0)
+        {
+            error |= firmware_boot_flash_command(EFC_FCMD_EPA,
+                                                 (FIRMWARE_BOOT_APP_PAGE + page) | FIRMWARE_BOOT_EPA_16_PAGES);
+        }
+
+        for (uint32_t index = 0; index < (IFLASH_PAGE_SIZE / sizeof(uint32_t)); index++)
+        {
+            latch[index] = source[index];
+        }
+        __DSB();
+
+        error |= firmware_boot_flash_command(EFC_FCMD_WP, FIRMWARE_BOOT_APP_PAGE + page);
+    }
+
+    source = (const volatile uint32_t*)FIRMWARE_UPDATE_STAGING_ADDR;
+    latch = (volatile uint32_t*)FIRMWARE_UPDATE_APP_ADDR;
+    for (uint32_t index = 0; index < ((page_count * IFLASH_PAGE_SIZE) / sizeof(uint32_t)); index++)
+    {
+        if (latch[index] != source[index])
+        {
+            return false;
+        }
+    }
+
+    return (error == 0);
+}
+
+/**
+ * \brief Resets the processor, the copy starts over from the boot sector
+ */
+FIRMWARE_BOOT_FUNC
+void firmware_boot_fault(void)
+{
+    RSTC->RSTC_CR = RSTC_CR_KEY_PASSWD | RSTC_CR_PROCRST | RSTC_CR_PERRST;
+    while (true)
+    {
+    }
+}
+
+/**
+ * \brief Finishes a pending firmware update and starts the application
+ *
+ * The marker is erased only once the application region reads back as the
+ * staged image, a reset or power loss before that copies the image again.
+ */
+FIRMWARE_BOOT_FUNC
+void firmware_boot_reset(void)
+{
+    const volatile struct firmware_update_marker *marker =
+        (const volatile struct firmware_update_marker*)FIRMWARE_UPDATE_MARKER_ADDR;
+    const volatile uint32_t *vectors = (const volatile uint32_t*)FIRMWARE_UPDATE_APP_ADDR;
+    uint32_t stack = 0;
+    void (*reset_handler)(void) = NULL;
+
+    if ((marker->magic == FIRMWARE_UPDATE_MARKER_MAGIC) &&
+        (marker->image_size == ~marker->image_size_check) &&
+        (marker->image_size > 0) && (marker->image_size <= FIRMWARE_UPDATE_APP_SIZE))
+    {
+        if (!firmware_boot_copy(marker->image_size) ||
+            (firmware_boot_flash_command(EFC_FCMD_EPA, FIRMWARE_BOOT_MARKER_PAGE | FIRMWARE_BOOT_EPA_16_PAGES) != 0))
+        {
+            firmware_boot_fault();
+        }
+    }
+
+    // Start the application as if it was reset into
+    stack = vectors[0];
+    reset_handler = (void (*)(void))vectors[1];
+    SCB->VTOR = FIRMWARE_UPDATE_APP_ADDR & SCB_VTOR_TBLOFF_Msk;
+    __set_MSP(stack);
+    reset_handler();
+
+    firmware_boot_fault();
+}
@@ -0,0 +1,296 @@
+/**
+ * \file
+ * \brief Host Firmware Update over the Kit Protocol
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "asf.h"
+#include "crypto/atca_crypto_sw_sha2.h"
+#include "firmware_update.h"
+
+// Defines
+#define FIRMWARE_UPDATE_PAGES_PER_SECTOR  (IFLASH_LOCK_REGION_SIZE / IFLASH_PAGE_SIZE)
+#define FIRMWARE_UPDATE_EPA_16_PAGES      (2)                         // EFC_FCMD_EPA argument to erase 16 pages
+#define FIRMWARE_UPDATE_SWITCH_DELAY      (100 / portTICK_PERIOD_MS)  // Lets the USB response go out before the switch
+
+#if (FIRMWARE_UPDATE_REGION_SIZE % IFLASH_LOCK_REGION_SIZE) != 0
+#error "The firmware update regions must be whole flash sectors"
+#endif
+
+#if (FIRMWARE_UPDATE_BLOCK_SIZE_MAX % IFLASH_PAGE_SIZE) != 0
+#error "The firmware update blocks must be whole flash pages"
+#endif
+
+#if FIRMWARE_UPDATE_PAGES_PER_SECTOR != 16
+#error "The firmware update sectors must be erased 16 pages at a time"
+#endif
+
+
+// Global variables
+static enum firmware_update_state g_firmware_update_state = FIRMWARE_UPDATE_STATE_IDLE;
+
+//! SHA-256 of the image received so far
+static atcac_sha2_256_ctx g_firmware_update_sha;
+//! SHA-256 the host announced for the image
+static uint8_t g_firmware_update_digest[FIRMWARE_UPDATE_DIGEST_SIZE];
+
+//! Page being programmed, the end of the last page is padded with the erased value
+static uint32_t g_firmware_update_page[IFLASH_PAGE_SIZE / sizeof(uint32_t)];
+
+static TickType_t g_firmware_update_start = 0;
+static bool g_firmware_update_switch_pending = false;
+
+static struct firmware_update_stats g_firmware_update_stats;
+
+
+/**
+ * \brief Programs a page of the staging region
+ *
+ * A sector is erased when its first page is programmed, so the staging
+ * region is erased as the image streams in rather than all up front. The
+ * scheduler is suspended while the page latch is filled so the flash writes
+ * of other tasks can not interleave.
+ *
+ * \return Whether the page was programmed and reads back correctly
+ */
+static bool firmware_update_program_page(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    uint32_t page = (address - IFLASH_ADDR) / IFLASH_PAGE_SIZE;
+    volatile uint32_t *latch = (volatile uint32_t*)address;
+    uint32_t status = EFC_RC_OK;
+
+    memset(g_firmware_update_page, 0xFF, sizeof(g_firmware_update_page));
+    memcpy(g_firmware_update_page, data, length);
+
+    if ((page % FIRMWARE_UPDATE_PAGES_PER_SECTOR) == 0)
+    {
+        vTaskSuspendAll();
+        status = efc_perform_command(EFC, EFC_FCMD_EPA, page | FIRMWARE_UPDATE_EPA_16_PAGES);
+        xTaskResumeAll();
+        if (status != EFC_RC_OK)
+        {
+            return false;
+        }
+        g_firmware_update_stats.erase_count++;
+    }
+
+    vTaskSuspendAll();
+    for (uint32_t index = 0; index < (IFLASH_PAGE_SIZE / sizeof(uint32_t)); index++)
+    {
+        latch[index] = g_firmware_update_page[index];
+    }
+    __DSB();
+    status = efc_perform_command(EFC, EFC_FCMD_WP, page);
+    xTaskResumeAll();
+
+    if (status != EFC_RC_OK)
+    {
+        return false;
+    }
+
+    return (memcmp((const void*)address, g_firmware_update_page, IFLASH_PAGE_SIZE) == 0);
+}
+
+/**
+ * \brief Starts receiving a new image into the staging region
+ *
+ * \param[in] image_size            The image size
+ * \param[in] digest                The SHA-256 of the image
+ *
+ * \return false if the image does not fit the application region
+ */
+bool firmware_update_begin(uint32_t image_size, const uint8_t *digest)
+{
+    if ((image_size == 0) || (image_size > FIRMWARE_UPDATE_APP_SIZE) || (digest == NULL))
+    {
+        return false;
+    }
+
+    memset(&g_firmware_update_stats, 0, sizeof(g_firmware_update_stats));
+    g_firmware_update_stats.image_size = image_size;
+    memcpy(g_firmware_update_digest, digest, sizeof(g_firmware_update_digest));
+    atcac_sw_sha2_256_init(&g_firmware_update_sha);
+
+    g_firmware_update_start = xTaskGetTickCount();
+    g_firmware_update_switch_pending = false;
+    g_firmware_update_state = FIRMWARE_UPDATE_STATE_RECEIVING;
+    g_firmware_update_stats.state = g_firmware_update_state;
+
+    return true;
+}
+
+/**
+ * \brief Writes the next block of the image to the staging region
+ *
+ * The blocks must arrive in order. Every block is a whole number of flash
+ * pages except the last one.
+ *
+ * \param[in] offset                Offset of the block in the image
+ * \param[in] data                  The block
+ * \param[in] length                The block length
+ *
+ * \return false if the block is out of order or the flash write failed
+ */
+bool firmware_update_write(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    uint32_t page_length = 0;
+    TickType_t start = 0;
+
+    if ((g_firmware_update_state != FIRMWARE_UPDATE_STATE_RECEIVING) ||
+        (offset != g_firmware_update_stats.bytes_written) ||
+        (length == 0) || (length > FIRMWARE_UPDATE_BLOCK_SIZE_MAX) ||
+        (length > (g_firmware_update_stats.image_size - offset)) ||
+        (((length % IFLASH_PAGE_SIZE) != 0) && ((offset + length) != g_firmware_update_stats.image_size)))
+    {
+        return false;
+    }
+
+    start = xTaskGetTickCount();
+    for (uint32_t index = 0; index < length; index += page_length)
+    {
+        page_length = min(IFLASH_PAGE_SIZE, length - index);
+        if (!firmware_update_program_page(FIRMWARE_UPDATE_STAGING_ADDR + offset + index,
+                                          &data[index], page_length))
+        {
+            g_firmware_update_state = FIRMWARE_UPDATE_STATE_FAILED;
+            g_firmware_update_stats.state = g_firmware_update_state;
+            return false;
+        }
+    }
+    g_firmware_update_stats.flash_ms += (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+    // Hash the data as it was written, the pages were read back and compared
+    start = xTaskGetTickCount();
+    atcac_sw_sha2_256_update(&g_firmware_update_sha, data, length);
+    g_firmware_update_stats.hash_ms += (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+    g_firmware_update_stats.bytes_written += length;
+    g_firmware_update_stats.elapsed_ms = (xTaskGetTickCount() - g_firmware_update_start) * portTICK_PERIOD_MS;
+
+    return true;
+}
+
+/**
+ * \brief Verifies the received image
+ *
+ * The image must be complete, match the announced SHA-256 and start with a
+ * vector table pointing into the RAM and the application region.
+ *
+ * \return Whether the image can be switched to
+ */
+bool firmware_update_verify(void)
+{
+    uint8_t digest[FIRMWARE_UPDATE_DIGEST_SIZE];
+    const uint32_t *vectors = (const uint32_t*)FIRMWARE_UPDATE_STAGING_ADDR;
+    bool verified = false;
+
+    if ((g_firmware_update_state != FIRMWARE_UPDATE_STATE_RECEIVING) ||
+        (g_firmware_update_stats.bytes_written != g_firmware_update_stats.image_size))
+    {
+        return false;
+    }
+
+    atcac_sw_sha2_256_finish(&g_firmware_update_sha, digest);
+
+    verified = (memcmp(digest, g_firmware_update_digest, sizeof(digest)) == 0) &&
+               (g_firmware_update_stats.image_size >= (2 * sizeof(uint32_t))) &&
+               (vectors[0] > IRAM_ADDR) && (vectors[0] <= (IRAM_ADDR + IRAM_SIZE)) &&
+               (vectors[1] >= FIRMWARE_UPDATE_APP_ADDR) &&
+               (vectors[1] < (FIRMWARE_UPDATE_APP_ADDR + g_firmware_update_stats.image_size));
+
+    g_firmware_update_state = (verified ? FIRMWARE_UPDATE_STATE_VERIFIED : FIRMWARE_UPDATE_STATE_FAILED);
+    g_firmware_update_stats.state = g_firmware_update_state;
+
+    return verified;
+}
+
+/**
+ * \brief Requests the switch to the verified image
+ *
+ * The switch itself is done by firmware_update_switch() once the response
+ * to the host was sent.
+ */
+bool firmware_update_request_switch(void)
+{
+    if (g_firmware_update_state != FIRMWARE_UPDATE_STATE_VERIFIED)
+    {
+        return false;
+    }
+
+    g_firmware_update_switch_pending = true;
+
+    return true;
+}
+
+bool firmware_update_is_switch_pending(void)
+{
+    return g_firmware_update_switch_pending;
+}
+
+/**
+ * \brief Switches to the verified image, does not return unless the marker
+ * could not be programmed
+ *
+ * Only the copy pending marker is programmed here, the boot sector copies
+ * the staged image over the application after the reset. The running
+ * application is never erased by itself, a power loss during the copy
+ * restarts it from the beginning on the next boot.
+ */
+void firmware_update_switch(void)
+{
+    struct firmware_update_marker marker;
+
+    if (!g_firmware_update_switch_pending || (g_firmware_update_state != FIRMWARE_UPDATE_STATE_VERIFIED))
+    {
+        return;
+    }
+    g_firmware_update_switch_pending = false;
+
+    vTaskDelay(FIRMWARE_UPDATE_SWITCH_DELAY);
+
+    marker.magic = FIRMWARE_UPDATE_MARKER_MAGIC;
+    marker.image_size = g_firmware_update_stats.image_size;
+    marker.image_size_check = ~g_firmware_update_stats.image_size;
+    if (!firmware_update_program_page(FIRMWARE_UPDATE_MARKER_ADDR, (const uint8_t*)&marker, sizeof(marker)))
+    {
+        g_firmware_update_state = FIRMWARE_UPDATE_STATE_FAILED;
+        g_firmware_update_stats.state = g_firmware_update_state;
+        return;
+    }
+
+    vTaskSuspendAll();
+    cpu_irq_disable();
+
+    RSTC->RSTC_CR = RSTC_CR_KEY_PASSWD | RSTC_CR_PROCRST | RSTC_CR_PERRST;
+    while (true)
+    {
+    }
+}
+
+void firmware_update_get_stats(struct firmware_update_stats *stats)
+{
+    memcpy(stats, &g_firmware_update_stats, sizeof(*stats));
+}
@@ -0,0 +1,103 @@
+/**
+ * \file
+ * \brief Host Firmware Update over the Kit Protocol
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef FIRMWARE_UPDATE_H
+#define FIRMWARE_UPDATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "asf.h"
+#include "aws_publish_queue.h"
+
+// Defines
+#define FIRMWARE_UPDATE_DIGEST_SIZE     (32)     // SHA-256 of the image
+#define FIRMWARE_UPDATE_BLOCK_SIZE_MAX  (2048)   // Largest image block in one kit message, a multiple of the flash page size
+#define FIRMWARE_UPDATE_REGION_SIZE     ((IFLASH_SIZE - AWS_PUBLISH_QUEUE_FLASH_SIZE) / 2)
+#define FIRMWARE_UPDATE_BOOT_SIZE       (IFLASH_LOCK_REGION_SIZE)  // The boot region in flash.ld, never erased by an update
+#define FIRMWARE_UPDATE_APP_ADDR        (IFLASH_ADDR + FIRMWARE_UPDATE_BOOT_SIZE)  // The rom region in flash.ld
+#define FIRMWARE_UPDATE_APP_SIZE        (FIRMWARE_UPDATE_REGION_SIZE - FIRMWARE_UPDATE_BOOT_SIZE)
+#define FIRMWARE_UPDATE_STAGING_ADDR    (IFLASH_ADDR + FIRMWARE_UPDATE_REGION_SIZE)  // Excluded from the rom region in flash.ld
+#define FIRMWARE_UPDATE_MARKER_ADDR     (FIRMWARE_UPDATE_STAGING_ADDR + FIRMWARE_UPDATE_APP_SIZE)  // Last sector of the staging region
+#define FIRMWARE_UPDATE_MARKER_MAGIC    (0x46575550)  // "FWUP"
+
+/**
+ * \brief The board:fwupdate(...) commands, the first byte of the command data
+ */
+enum firmware_update_command
+{
+    FIRMWARE_UPDATE_COMMAND_BEGIN   = 0x00,  // Image size (4 bytes, little endian) and SHA-256
+    FIRMWARE_UPDATE_COMMAND_WRITE   = 0x01,  // Block offset (4 bytes, little endian) and block
+    FIRMWARE_UPDATE_COMMAND_VERIFY  = 0x02,
+    FIRMWARE_UPDATE_COMMAND_SWITCH  = 0x03,
+    FIRMWARE_UPDATE_COMMAND_STATUS  = 0x04
+};
+
+enum firmware_update_state
+{
+    FIRMWARE_UPDATE_STATE_IDLE      = 0,
+    FIRMWARE_UPDATE_STATE_RECEIVING = 1,
+    FIRMWARE_UPDATE_STATE_VERIFIED  = 2,
+    FIRMWARE_UPDATE_STATE_FAILED    = 3
+};
+
+/**
+ * \brief The copy pending marker
+ *
+ * Programmed when switching to a verified image. While it is in flash the
+ * boot sector copies the staged image over the application on every reset,
+ * it is erased once the copy reads back correctly.
+ */
+struct firmware_update_marker
+{
+    uint32_t magic;              //! FIRMWARE_UPDATE_MARKER_MAGIC
+    uint32_t image_size;         //! Size of the staged image
+    uint32_t image_size_check;   //! Complement of image_size, guards against a partly programmed marker
+};
+
+struct firmware_update_stats
+{
+    uint32_t state;              //! enum firmware_update_state
+    uint32_t image_size;         //! Size of the image being received
+    uint32_t bytes_written;      //! Image bytes written to the staging region
+    uint32_t erase_count;        //! Staging region sectors erased
+    uint32_t elapsed_ms;         //! From the begin command to the last block written
+    uint32_t flash_ms;           //! Time spent erasing and programming the flash
+    uint32_t hash_ms;            //! Time spent hashing the image
+};
+
+bool firmware_update_begin(uint32_t image_size, const uint8_t *digest);
+bool firmware_update_write(uint32_t offset, const uint8_t *data, uint32_t length);
+bool firmware_update_verify(void);
+
+bool firmware_update_request_switch(void);
+bool firmware_update_is_switch_pending(void);
+void firmware_update_switch(void);
+
+void firmware_update_get_stats(struct firmware_update_stats *stats);
+
+#endif // FIRMWARE_UPDATE_H
@@ -25,478 +25,475 @@
  * THIS SOFTWARE.
  */
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "hex_codec.h"
 #include "kit_protocol_interpreter.h"
 #include "kit_protocol_utilities.h"
 
 
-static struct kit_interpreter_interface *g_kit_interpreter_interface = NULL;
+//! The registration key of a command prefix, its layer and the one or two lowercase characters that select it
+#define KIT_COMMAND_KEY(layer, first, second) \
+    (((uint32_t)(uint8_t)(layer) << 16) | ((uint32_t)(uint8_t)(first) << 8) | (uint8_t)(second))
 
-static enum kit_protocol_command g_message_command = KIT_COMMAND_UNKNOWN;
-static char g_message_data[KIT_MESSAGE_SIZE_MAX];
-static uint16_t g_message_length = 0;
-static uint32_t  g_selected_device_handle = 0;
+#define KIT_RESPONSE_HEX_OVERHEAD    (5)             //! The status, the data delimiters and the message delimiter
+#define KIT_COMMAND_PREFIX_SIZE_MAX  (2)             //! Longer command names must match exactly
+#define KIT_COMMAND_NAME_KEY_FLAG    (0x80000000UL)  //! Keeps the keys of full names apart from prefix keys
+#define KIT_COMMAND_NAME_SIZE_MAX    (32)            //! Longest registered command name
+
+//! The command is handled by the interpreter itself, not by an interface function
+#define KIT_FUNCTION_NONE    ((size_t)-1)
 
+//! The interface function of a command, converted back to its own type before the call
+typedef void (*kit_interpreter_function)(void);
 
 /**
- * \brief Parses the target (<target>) section of the Kit Protocol message.
- *
- * \param[in] section               The target section name to be parsed
- * \param[in] section_length        The length, in bytes, of the target section name
- *
- * \return  The target section parsing status
- *            KIT_STATUS_SUCCESS           - The target section parsed correctly
- *            KIT_STATUS_COMMAND_NOT_VALID - The target section not parsed correctly
+ * \brief How the response message of a command is created.
  */
-static enum kit_protocol_status kit_interpreter_parse_target_section(char *section,
-                                                                     uint16_t section_length)
+enum kit_interpreter_response
 {
-    enum kit_protocol_status status = KIT_STATUS_SUCCESS;
-    char *begin_delimiter = NULL;
-    char *end_delimiter = NULL;
-    uint16_t device_handle_size = 0;
-    uint32_t device_handle = 0;
+    KIT_RESPONSE_HEX  = 0x00,   //! <status>(<hex data>)\n
+    KIT_RESPONSE_RAW  = 0x01,   //! The message data is the complete response message
+    KIT_RESPONSE_BYTE = 0x02    //! <first data byte>\n
+};
 
-    // Convert the Kit Protocol command message to lowercase
-    kit_protocol_convert_to_lowercase(section_length, section);
+/**
+ * \brief A Kit Protocol command registration.
+ */
+struct kit_interpreter_command
+{
+    const char *name;                           //! The lowercase name prefix, or the full name if longer
+    enum kit_protocol_command layer;            //! The target or command the command belongs to
+    enum kit_protocol_command command;          //! The command
+    enum kit_protocol_status (*call)(kit_interpreter_function function);  //! Calls the function, NULL for a layer
+    size_t function;                            //! Offset of the function in struct kit_interpreter_interface
+    enum kit_interpreter_response response;     //! How the response message is created
+};
 
-    // Check the first character in target section
-    switch (section[0])
-    {
-    case 'b':        // The target: board
-	    g_message_command = KIT_COMMAND_BOARD;
-	    break;
+/**
+ * \brief A Kit Protocol target registration, only the first character of a target counts.
+ */
+struct kit_interpreter_target
+{
+    char name;                                  //! The lowercase first character of the target
+    enum kit_protocol_command layer;            //! The commands of the target
+};
 
+
+static enum kit_protocol_status kit_interpreter_call_message(kit_interpreter_function function);
+static enum kit_protocol_status kit_interpreter_call_device_message(kit_interpreter_function function);
+static enum kit_protocol_status kit_interpreter_call_enable(kit_interpreter_function function);
+static enum kit_protocol_status kit_interpreter_call_device(kit_interpreter_function function);
 #ifndef KIT_PROTOCOL_NO_LEGACY_SUPPORT
-    case 'a':        // The target: AES132
-    case 'e':        // The target: ECCx08(A)
-    case 's':        // The target: SHA204(A)
+static enum kit_protocol_status kit_interpreter_call_physical_select(kit_interpreter_function function);
 #endif // KIT_PROTOCOL_NO_LEGACY_SUPPORT
-	case 'd':        // The target: device
-	    g_message_command = KIT_COMMAND_DEVICE;
-	    break;
-
-    default:
-	    // Unknown Kit Protocol command message
-	    g_message_command = KIT_COMMAND_UNKNOWN;
-    }
 
-    // Find the device index
-    if (g_message_command != KIT_COMMAND_UNKNOWN)
-    {
-        begin_delimiter = strchr(section, KIT_DATA_BEGIN_DELIMITER);
-        if (begin_delimiter != NULL)
-        {
-            end_delimiter = strchr(section, KIT_DATA_END_DELIMITER);
-            if (end_delimiter == NULL)
-            {
-                end_delimiter = (begin_delimiter + KIT_DEVICE_HANDLE_SIZE);
-            }
-            
-            // Get the device handle size
-            device_handle_size = (end_delimiter - (begin_delimiter + 1));
-            if (device_handle_size == KIT_DEVICE_HANDLE_SIZE)
-            {
-                // Retrieve the device handle from the section string data
-                device_handle = (uint32_t)strtol((begin_delimiter + 1), NULL, 16);                                                   
-                                                   
-                // Set the currently selected device handle
-                kit_interpreter_set_selected_device_handle(device_handle);
-            }
-            else
-            {
-                // Invalid Kit Protocol command message format
-                status = KIT_STATUS_COMMAND_NOT_VALID;
-            }            
-        }
-    }
-    else
-    {
-        // Invalid Kit Protocol command message format
-        status = KIT_STATUS_COMMAND_NOT_VALID;
-    }
+#define KIT_FUNCTION(name)   offsetof(struct kit_interpreter_interface, name)
 
-    return status;
-}
+//! The Kit Protocol targets
+static const struct kit_interpreter_target g_kit_interpreter_targets[] =
+{
+    { 'b', KIT_COMMAND_BOARD },         // The target: board
+#ifndef KIT_PROTOCOL_NO_LEGACY_SUPPORT
+    { 'a', KIT_COMMAND_DEVICE },        // The target: AES132
+    { 'e', KIT_COMMAND_DEVICE },        // The target: ECCx08(A)
+    { 's', KIT_COMMAND_DEVICE },        // The target: SHA204(A)
+#endif // KIT_PROTOCOL_NO_LEGACY_SUPPORT
+    { 'd', KIT_COMMAND_DEVICE }         // The target: device
+};
 
 /**
- * \brief Parses the command (<command>) section of the Kit Protocol message.
+ * \brief The Kit Protocol commands.
  *
- * \param[in] section               The command section name to be parsed
- * \param[in] section_length        The length, in bytes, of the command section name
- *
- * \return  The command section parsing status
- *            KIT_STATUS_SUCCESS           - The command section parsed correctly
- *            KIT_STATUS_COMMAND_NOT_VALID - The command section not parsed correctly
+ * \note  A command is selected by its first character, or by its first two
+ *        characters where a two character prefix is registered, so both
+ *        board:fwupdate() and board:fw() select the firmware update command
+ *        while board:firmware() selects the firmware command. A name longer
+ *        than KIT_COMMAND_PREFIX_SIZE_MAX is only selected by the full name
+ *        and takes precedence over the prefixes, so device:talk_batch() does
+ *        not select device:talk().
  */
-static enum kit_protocol_status kit_interpreter_parse_command_section(char *section,
-                                                                      uint16_t section_length)
+static const struct kit_interpreter_command g_kit_interpreter_commands[] =
 {
-    enum kit_protocol_status status = KIT_STATUS_SUCCESS;
-    char *begin_delimiter = NULL;
-    char *end_delimiter = NULL;
+    // board:version()
+    { "v",  KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_VERSION, &kit_interpreter_call_message,
+      KIT_FUNCTION(board_get_version), KIT_RESPONSE_RAW },
+    // board:firmware()
+    { "f",  KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_FIRMWARE, &kit_interpreter_call_message,
+      KIT_FUNCTION(board_get_firmware), KIT_RESPONSE_RAW },
+    // board:fwupdate(...)
+    { "fw", KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_FWUPDATE, &kit_interpreter_call_message,
+      KIT_FUNCTION(board_fwupdate), KIT_RESPONSE_HEX },
+    // board:device(00)
+    { "d",  KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_GET_DEVICE, &kit_interpreter_call_device_message,
+      KIT_FUNCTION(board_get_device), KIT_RESPONSE_RAW },
+    // board:discover()
+    { "di", KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_DISCOVER, &kit_interpreter_call_enable,
+      KIT_FUNCTION(board_discover), KIT_RESPONSE_BYTE },
+    // board:get_devices()
+    { "g",  KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_GET_DEVICES, &kit_interpreter_call_message,
+      KIT_FUNCTION(board_get_devices), KIT_RESPONSE_HEX },
+    // board:last_error()
+    { "l",  KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_GET_LAST_ERROR, &kit_interpreter_call_message,
+      KIT_FUNCTION(board_get_last_error), KIT_RESPONSE_RAW },
+    // board:application(...)
+    { "a",  KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_APPLICATION, &kit_interpreter_call_device_message,
+      KIT_FUNCTION(board_application), KIT_RESPONSE_HEX },
+    // board:polling(01)
+    { "p",  KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_POLLING, &kit_interpreter_call_enable,
+      KIT_FUNCTION(board_polling), KIT_RESPONSE_HEX },
+    // board:stats()
+    { "s",  KIT_COMMAND_BOARD, KIT_COMMAND_BOARD_STATS, &kit_interpreter_call_message,
+      KIT_FUNCTION(board_get_stats), KIT_RESPONSE_HEX },
+
+    // device[(00000000)]:idle()
+    { "i",  KIT_COMMAND_DEVICE, KIT_COMMAND_DEVICE_IDLE, &kit_interpreter_call_device,
+      KIT_FUNCTION(device_idle), KIT_RESPONSE_HEX },
+    // device[(00000000)]:sleep()
+    { "s",  KIT_COMMAND_DEVICE, KIT_COMMAND_DEVICE_SLEEP, &kit_interpreter_call_device,
+      KIT_FUNCTION(device_sleep), KIT_RESPONSE_HEX },
+    // device[(00000000)]:send(...)
+    { "se", KIT_COMMAND_DEVICE, KIT_COMMAND_DEVICE_SEND, &kit_interpreter_call_device_message,
+      KIT_FUNCTION(device_send), KIT_RESPONSE_HEX },
+    // device[(00000000)]:wake()
+    { "w",  KIT_COMMAND_DEVICE, KIT_COMMAND_DEVICE_WAKE, &kit_interpreter_call_device,
+      KIT_FUNCTION(device_wake), KIT_RESPONSE_HEX },
+    // device[(00000000)]:receive()
+    { "r",  KIT_COMMAND_DEVICE, KIT_COMMAND_DEVICE_RECEIVE, &kit_interpreter_call_device_message,
+      KIT_FUNCTION(device_receive), KIT_RESPONSE_HEX },
+    // device[(00000000)]:talk(...)
+    { "t",  KIT_COMMAND_DEVICE, KIT_COMMAND_DEVICE_TALK, &kit_interpreter_call_device_message,
+      KIT_FUNCTION(device_talk), KIT_RESPONSE_HEX },
+    // device[(00000000)]:talk_batch(...)
+    { "talk_batch", KIT_COMMAND_DEVICE, KIT_COMMAND_DEVICE_TALK_BATCH, &kit_interpreter_call_device_message,
+      KIT_FUNCTION(device_talk_batch), KIT_RESPONSE_HEX },
 
-    // Find the data delimiter
-    begin_delimiter = strchr(section, KIT_DATA_BEGIN_DELIMITER);
-    if (begin_delimiter == NULL)
-    {
-        begin_delimiter = strchr(section, KIT_LAYER_DELIMITER);
-    }
-    
-    if (begin_delimiter != NULL)
-    {
-        // Convert the Kit Protocol command message to lowercase
-        kit_protocol_convert_to_lowercase((begin_delimiter - section), section);
+#ifndef KIT_PROTOCOL_NO_LEGACY_SUPPORT
+    // device:physical:...
+    { "p",  KIT_COMMAND_DEVICE, KIT_COMMAND_PHYSICAL, NULL,
+      KIT_FUNCTION_NONE, KIT_RESPONSE_HEX },
+    // device:physical:select(00)
+    { "s",  KIT_COMMAND_PHYSICAL, KIT_COMMAND_PHYSICAL_SELECT, &kit_interpreter_call_physical_select,
+      KIT_FUNCTION_NONE, KIT_RESPONSE_HEX },
+#endif // KIT_PROTOCOL_NO_LEGACY_SUPPORT
+};
 
-        if (g_message_command == KIT_COMMAND_BOARD)
-        {
-            // Board messages
+#define KIT_INTERPRETER_COMMANDS  (sizeof(g_kit_interpreter_commands) / sizeof(g_kit_interpreter_commands[0]))
+#define KIT_INTERPRETER_TARGETS   (sizeof(g_kit_interpreter_targets) / sizeof(g_kit_interpreter_targets[0]))
 
-            // Check the first character in board command section
-            switch (section[0])
-            {
-            case 'v':        // The board version command: board:version()
-                g_message_command = KIT_COMMAND_BOARD_VERSION;
-                break;
 
-            case 'f':        // The board firmware command: board:firmware()
-                g_message_command = KIT_COMMAND_BOARD_FIRMWARE;
-                break;
+static struct kit_interpreter_interface *g_kit_interpreter_interface = NULL;
+static struct kit_protocol_hash_table g_kit_interpreter_command_hash;
 
-            case 'd':
-                // Check the second character in board command section
-                switch (section[1])
-                {
-                case 'i':    // The board discovery command: board:discover()
-                    g_message_command = KIT_COMMAND_BOARD_DISCOVER;
-                    break;
+static const struct kit_interpreter_command *g_message_entry = NULL;
+static char g_message_data[KIT_MESSAGE_SIZE_MAX];
+static uint16_t g_message_length = 0;
+static uint32_t  g_selected_device_handle = 0;
 
-                default:     // The board get device command: board:device(00)
-                    g_message_command = KIT_COMMAND_BOARD_GET_DEVICE;
-                    break; 
-                }
-                break;
 
-            case 'g':        // The board get devices command: board:get_devices()
-                g_message_command = KIT_COMMAND_BOARD_GET_DEVICES;
-                break;
+static enum kit_protocol_status kit_interpreter_call_message(kit_interpreter_function function)
+{
+    enum kit_protocol_status (*handler)(uint8_t*, uint16_t*) =
+        (enum kit_protocol_status (*)(uint8_t*, uint16_t*))function;
 
-            case 'l':        // The board get last error command: board:last_error()
-                g_message_command = KIT_COMMAND_BOARD_GET_LAST_ERROR;
-                break;
+    return handler((uint8_t*)g_message_data, &g_message_length);
+}
 
-            case 'a':        // The board application-specific command: board:application(...)
-                g_message_command = KIT_COMMAND_BOARD_APPLICATION;
-                break;
+static enum kit_protocol_status kit_interpreter_call_device_message(kit_interpreter_function function)
+{
+    enum kit_protocol_status (*handler)(uint32_t, uint8_t*, uint16_t*) =
+        (enum kit_protocol_status (*)(uint32_t, uint8_t*, uint16_t*))function;
 
-            default:
-                // Unknown Kit Protocol command message
-                g_message_command = KIT_COMMAND_UNKNOWN;
-            }
-        }
-        else if (g_message_command == KIT_COMMAND_DEVICE)
-        {    
-            // Board messages
+    return handler(g_selected_device_handle, (uint8_t*)g_message_data, &g_message_length);
+}
 
-            // Check the first character in board command section
-            switch (section[0])
-            {
-            case 'p':        // The device physical command: device[(00)]:physical:...
-                g_message_command = KIT_COMMAND_PHYSICAL;
-                break;
+static enum kit_protocol_status kit_interpreter_call_enable(kit_interpreter_function function)
+{
+    enum kit_protocol_status (*handler)(bool) = (enum kit_protocol_status (*)(bool))function;
 
-            case 'i':        // The device idle command: device[(00)]:idle()
-                g_message_command = KIT_COMMAND_DEVICE_IDLE;
-                break;
+    return handler((bool)g_message_data[0]);
+}
 
-            case 's':
-                // Check the second character in command section
-                switch (section[1])
-                {
-                case 'e':    // The device send command: device[(00)]:send(...)
-                    g_message_command = KIT_COMMAND_DEVICE_SEND;
-                    break;
+static enum kit_protocol_status kit_interpreter_call_device(kit_interpreter_function function)
+{
+    enum kit_protocol_status (*handler)(uint32_t) = (enum kit_protocol_status (*)(uint32_t))function;
 
-                default:     // The device sleep command: device[(00)]:sleep()
-                    g_message_command = KIT_COMMAND_DEVICE_SLEEP;
-                    break; 
-                }
-                break;
+    return handler(g_selected_device_handle);
+}
 
-            case 'w':        // The device wakeup command: device[(00)]:wake()
-                g_message_command = KIT_COMMAND_DEVICE_WAKE;
-                break;
+#ifndef KIT_PROTOCOL_NO_LEGACY_SUPPORT
+static enum kit_protocol_status kit_interpreter_call_physical_select(kit_interpreter_function function)
+{
+    (void)function;
 
-            case 'r':        // The device receive command: device[(00)]:receive()
-                g_message_command = KIT_COMMAND_DEVICE_RECEIVE;
-                break;
+    // The device index is a single byte: device:physical:select(00)
+    if (g_message_length != (KIT_DEVICE_INDEX_SIZE / 2))
+    {
+        return KIT_STATUS_COMMAND_NOT_VALID;
+    }
 
-            case 't':        // The device talk command: device[(00)]:talk(...)
-                g_message_command = KIT_COMMAND_DEVICE_TALK;
-                break;
+    // Set the currently selected device handle
+    kit_interpreter_set_selected_device_handle((uint8_t)g_message_data[0]);
+    g_message_length = 0;
 
-            default:
-                // Unknown Kit Protocol command message
-                g_message_command = KIT_COMMAND_UNKNOWN;
-            }
-        }
+    return KIT_STATUS_SUCCESS;
+}
+#endif // KIT_PROTOCOL_NO_LEGACY_SUPPORT
 
-        // Get the message data        
-        if ((g_message_command != KIT_COMMAND_PHYSICAL) &&
-            (g_message_command != KIT_COMMAND_UNKNOWN))
-        {
-            end_delimiter = strchr((begin_delimiter + 1), KIT_DATA_END_DELIMITER);
-            if (end_delimiter != NULL)
-            {
-                // Save the message data
-                memset(&g_message_data[0], 0, sizeof(g_message_data));
-                g_message_length = (end_delimiter - (begin_delimiter + 1));
-                strncpy(&g_message_data[0], (begin_delimiter + 1), g_message_length);
-            }
-            else
-            {
-                // Invalid Kit Protocol command message format
-                status = KIT_STATUS_COMMAND_NOT_VALID;
-            }
-        }
-        else if (g_message_command == KIT_COMMAND_UNKNOWN)
-        {
-            // Invalid Kit Protocol command message format
-            status = KIT_STATUS_COMMAND_NOT_VALID;
-        }
+/**
+ * \brief Gets the registration key of a command name.
+ *
+ * \param[in] layer                 The target or command the name belongs to
+ * \param[in] name                  The command name, not null-terminated
+ * \param[in] name_length           The length, in bytes, of the command name
+ *
+ * \return  The prefix key of a short name, the FNV-1a hash of a longer one
+ *          with the layer mixed in. Both are taken over the lowercase name.
+ *          Names longer than any registered name all share one key, the
+ *          caller confirms the name against the registered one.
+ */
+static uint32_t kit_interpreter_get_key(enum kit_protocol_command layer,
+                                        const char *name,
+                                        size_t name_length)
+{
+    char lowercase_name[KIT_COMMAND_NAME_SIZE_MAX + 1];
+
+    if (name_length <= KIT_COMMAND_PREFIX_SIZE_MAX)
+    {
+        return KIT_COMMAND_KEY(layer, tolower((uint8_t)name[0]),
+                               ((name_length > 1) ? tolower((uint8_t)name[1]) : 0));
     }
-    else
+
+    if (name_length > KIT_COMMAND_NAME_SIZE_MAX)
     {
-        // Invalid Kit Protocol command message format
-        status = KIT_STATUS_COMMAND_NOT_VALID;
+        return KIT_COMMAND_NAME_KEY_FLAG;
     }
 
-    return status;
+    for (size_t index = 0; index < name_length; index++)
+    {
+        lowercase_name[index] = (char)tolower((uint8_t)name[index]);
+    }
+    lowercase_name[name_length] = '\0';
+
+    return (((kit_protocol_hash_string(lowercase_name) ^ (uint8_t)layer) * KIT_HASH_FNV_PRIME) |
+            KIT_COMMAND_NAME_KEY_FLAG);
 }
 
 /**
- * \brief Parses the subcommand (<subcommand>) section of the Kit Protocol message.
+ * \brief Finds the registered command selected by a command name.
  *
- * \param[in] section               The subcommand section name to be parsed
- * \param[in] section_length        The length, in bytes, of the subcommand section name
+ * \param[in] layer                 The target or command the name belongs to
+ * \param[in] name                  The command name, not null-terminated
+ * \param[in] name_length           The length, in bytes, of the command name
  *
- * \return  The command section parsing status
- *            KIT_STATUS_SUCCESS           - The command section parsed correctly
- *            KIT_STATUS_COMMAND_NOT_VALID - The command section not parsed correctly
+ * \return  The command registration, or NULL if the name selects no command
  */
-static enum kit_protocol_status kit_interpreter_parse_subcommand_section(char *section,
-                                                                         uint16_t section_length)
+static const struct kit_interpreter_command *kit_interpreter_find_command(enum kit_protocol_command layer,
+                                                                          const char *name,
+                                                                          size_t name_length)
 {
-    enum kit_protocol_status status = KIT_STATUS_SUCCESS;
-    char *begin_delimiter = NULL;
-    char *end_delimiter = NULL;
-    uint8_t device_index_size = 0;
-    uint8_t device_index = 0;
-
-    // Find the data delimiter
-    begin_delimiter = strchr(section, KIT_DATA_BEGIN_DELIMITER);
-    if (begin_delimiter != NULL)
-    {
-        // Convert the Kit Protocol subcommand message to lowercase
-        kit_protocol_convert_to_lowercase((begin_delimiter - section), section);
+    const char *registered_name = NULL;
+    uint32_t key = 0;
+    int index = -1;
 
-        // Check the first character in subcommand section
-        switch (section[0])
-        {
-        case 's':        // The device idle command: device:physical:select(00)
-            g_message_command = KIT_COMMAND_PHYSICAL_SELECT;
-            break;
-
-        default:
-            // Unknown Kit Protocol command message
-            g_message_command = KIT_COMMAND_UNKNOWN;
-        }
-
-        // Parse the message data
-        if (g_message_command == KIT_COMMAND_PHYSICAL_SELECT)
+    // A full name takes precedence over the prefixes, confirmed against the registered name
+    if (name_length > KIT_COMMAND_PREFIX_SIZE_MAX)
+    {
+        index = kit_protocol_hash_find(&g_kit_interpreter_command_hash,
+                                       kit_interpreter_get_key(layer, name, name_length));
+        if (index >= 0)
         {
-            end_delimiter = strchr((begin_delimiter + 1), KIT_DATA_END_DELIMITER);
-            if (end_delimiter != NULL)
+            registered_name = g_kit_interpreter_commands[index].name;
+            for (size_t offset = 0; offset < name_length; offset++)
             {
-                // Determine the device index size
-                device_index_size = (end_delimiter - (begin_delimiter + 1));
-                if (device_index_size == KIT_DEVICE_INDEX_SIZE)
-                {
-                    // Retrieve the device handle from the section string data
-                    device_index = (uint8_t)strtol((begin_delimiter + 1), NULL, 16);
-                                        
-                    // Set the currently selected device handle
-                    kit_interpreter_set_selected_device_handle(device_index);
-                }
-                else
+                if (registered_name[offset] != tolower((uint8_t)name[offset]))
                 {
-                    // Invalid Kit Protocol command message format
-                    status = KIT_STATUS_COMMAND_NOT_VALID;
+                    index = -1;
+                    break;
                 }
             }
-            else
+            if ((index >= 0) && (registered_name[name_length] == '\0'))
             {
-                // Invalid Kit Protocol command message format
-                status = KIT_STATUS_COMMAND_NOT_VALID;
+                return &g_kit_interpreter_commands[index];
             }
         }
     }
-    else
+
+    // A two character prefix takes precedence over the first character alone
+    key = kit_interpreter_get_key(layer, name, min(name_length, KIT_COMMAND_PREFIX_SIZE_MAX));
+    index = kit_protocol_hash_find(&g_kit_interpreter_command_hash, key);
+    if ((index < 0) && ((key & 0xFF) != 0))
     {
-        // Invalid Kit Protocol command message format
-        status = KIT_STATUS_COMMAND_NOT_VALID;
+        index = kit_protocol_hash_find(&g_kit_interpreter_command_hash, (key & ~0xFFUL));
     }
 
-    return status;
+    return ((index < 0) ? NULL : &g_kit_interpreter_commands[index]);
 }
 
 /**
  * \brief Parses the incoming Kit Protocol command message.
  *
- * \param[in] message_length        The length, in bytes, of the command message
+ * \note  The message is tokenized in a single pass, without modifying it:
+ *          <target>[(<device handle>)]:<command>[:<subcommand>](<hex data>)\n
+ *        The hex data is decoded straight into the message data buffer.
+ *
  * \param[in] message               The command message to be parsed
+ * \param[in] message_length        The length, in bytes, of the command message
  *
- * \return
+ * \return  The message parsing status
+ *            KIT_STATUS_SUCCESS           - The message parsed correctly
+ *            KIT_STATUS_COMMAND_NOT_VALID - The message not parsed correctly
  */
 static enum kit_protocol_status kit_interpreter_parse(const char *message,
                                                       uint16_t message_length)
-
 {
-    enum kit_protocol_status status = KIT_STATUS_SUCCESS;
-    char section[KIT_SECTION_NAME_SIZE_MAX];
-    char *current_delimiter_location = NULL;
-    char *previous_delimiter_location = NULL;
-    size_t target_length = 0;
-    size_t command_length = 0;
-
-    // Parse the Kit Protocol target information
-    previous_delimiter_location = (char*)message;
-    memset(&section[0], 0, sizeof(section));
-
-    // Find the target delimiter <target>:<command>:<subcommand>
-    current_delimiter_location = strchr(previous_delimiter_location, KIT_LAYER_DELIMITER);
-    if (current_delimiter_location != NULL)
+    const char *position = message;
+    const char *end = (message + message_length);
+    const char *token = NULL;
+    const struct kit_interpreter_command *entry = NULL;
+    enum kit_protocol_command layer = KIT_COMMAND_UNKNOWN;
+    uint8_t device_handle[KIT_DEVICE_HANDLE_SIZE / 2];
+    size_t data_length = 0;
+
+    g_message_entry = NULL;
+    g_message_length = 0;
+
+    // The target, only its first character counts
+    for (size_t index = 0; index < KIT_INTERPRETER_TARGETS; index++)
     {
-        target_length = min(KIT_SECTION_NAME_SIZE_MAX, 
-                            ((current_delimiter_location - previous_delimiter_location) + 1));
-        if (target_length > 0)
+        if (g_kit_interpreter_targets[index].name == tolower((uint8_t)*position))
         {
-            // Parse the target information
-            strncpy(&section[0], previous_delimiter_location, target_length);
-            status = kit_interpreter_parse_target_section(section, target_length);
-            if (status != KIT_STATUS_SUCCESS)
-            {
-                // Invalid Kit Protocol command message format
-                status = KIT_STATUS_COMMAND_NOT_VALID;
-            }
-        }
-        else
-        {
-            // Invalid Kit Protocol command message format
-            status = KIT_STATUS_COMMAND_NOT_VALID;
+            layer = g_kit_interpreter_targets[index].layer;
+            break;
         }
     }
-    else
+    if (layer == KIT_COMMAND_UNKNOWN)
     {
-        // Invalid Kit Protocol command message format
-        status = KIT_STATUS_COMMAND_NOT_VALID;
+        return KIT_STATUS_COMMAND_NOT_VALID;
     }
 
-
-    // Parse the Kit Protocol command information
-    if (status == KIT_STATUS_SUCCESS)
+    while ((position < end) && (*position != KIT_LAYER_DELIMITER) &&
+           (*position != KIT_DATA_BEGIN_DELIMITER) && (*position != KIT_MESSAGE_DELIMITER))
     {
-        previous_delimiter_location = (current_delimiter_location + 1);
-        memset(section, 0, sizeof(section));
+        position++;
+    }
 
-        // Find the target delimiter or end of message delimiter
-        current_delimiter_location = strchr(previous_delimiter_location, KIT_LAYER_DELIMITER);
-        if (current_delimiter_location == NULL)
+    // The optional device handle of the target
+    if ((position < end) && (*position == KIT_DATA_BEGIN_DELIMITER))
+    {
+        token = ++position;
+        while ((position < end) && (*position != KIT_DATA_END_DELIMITER) &&
+               (*position != KIT_MESSAGE_DELIMITER))
         {
-            current_delimiter_location = strchr(previous_delimiter_location, KIT_MESSAGE_DELIMITER);
+            position++;
         }
 
-        if (current_delimiter_location != NULL)
-        {
-            command_length = ((current_delimiter_location - previous_delimiter_location) + 1);
-            if (command_length > 0)
-            {
-                // Parse the command information
-                strncpy(section, previous_delimiter_location, command_length);
-                status = kit_interpreter_parse_command_section(section, command_length);
-                if (status != KIT_STATUS_SUCCESS)
-                {
-                    // Invalid Kit Protocol command message format
-                    status = KIT_STATUS_COMMAND_NOT_VALID;
-                }
-            }
-            else
-            {
-                // Invalid Kit Protocol command message format
-                status = KIT_STATUS_COMMAND_NOT_VALID;
-            }
-        }
-        else
+        if ((position >= end) || ((position - token) != KIT_DEVICE_HANDLE_SIZE))
         {
-            // Invalid Kit Protocol command message format
-            status = KIT_STATUS_COMMAND_NOT_VALID;
+            return KIT_STATUS_COMMAND_NOT_VALID;
         }
+        position++;
+
+        // Set the currently selected device handle
+        hex_codec_decode(token, KIT_DEVICE_HANDLE_SIZE, device_handle);
+        kit_interpreter_set_selected_device_handle(((uint32_t)device_handle[0] << 24) |
+                                                   ((uint32_t)device_handle[1] << 16) |
+                                                   ((uint32_t)device_handle[2] << 8) |
+                                                   ((uint32_t)device_handle[3]));
     }
 
-
-    // Parse the Kit Protocol subcommand information (Only needed for device physical messages)
-    if ((status == KIT_STATUS_SUCCESS) && 
-        (g_message_command == KIT_COMMAND_PHYSICAL))
+    // The command, and the subcommands of a command layer
+    do
     {
-        previous_delimiter_location = (current_delimiter_location + 1);
-        memset(section, 0, sizeof(section));
+        if ((position >= end) || (*position != KIT_LAYER_DELIMITER))
+        {
+            return KIT_STATUS_COMMAND_NOT_VALID;
+        }
 
-        // Find the end of message delimiter
-        current_delimiter_location = strchr(previous_delimiter_location, KIT_MESSAGE_DELIMITER);
-        if (current_delimiter_location != NULL)
+        token = ++position;
+        while ((position < end) && (*position != KIT_LAYER_DELIMITER) &&
+               (*position != KIT_DATA_BEGIN_DELIMITER) && (*position != KIT_MESSAGE_DELIMITER))
         {
-            command_length = (current_delimiter_location - previous_delimiter_location);
-            if (command_length > 0)
-            {
-                // Parse the subcommand information
-                strncpy(section, previous_delimiter_location, command_length);
-                status = kit_interpreter_parse_subcommand_section(section, command_length);
-                if (status != KIT_STATUS_SUCCESS)
-                {
-                    // Invalid Kit Protocol command message format
-                    status = KIT_STATUS_COMMAND_NOT_VALID;
-                }
-            }
-            else
-            {
-                // Invalid Kit Protocol command message format
-                status = KIT_STATUS_COMMAND_NOT_VALID;
-            }
+            position++;
         }
-        else
+
+        if (position == token)
         {
-            // Invalid Kit Protocol command message format
-            status = KIT_STATUS_COMMAND_NOT_VALID;
+            return KIT_STATUS_COMMAND_NOT_VALID;
         }
+
+        entry = kit_interpreter_find_command(layer, token, (size_t)(position - token));
+        if (entry == NULL)
+        {
+            return KIT_STATUS_COMMAND_NOT_VALID;
+        }
+        layer = entry->command;
+    } while (entry->call == NULL);
+
+    // The message data
+    if ((position >= end) || (*position != KIT_DATA_BEGIN_DELIMITER))
+    {
+        return KIT_STATUS_COMMAND_NOT_VALID;
     }
 
+    token = ++position;
+    while ((position < end) && (*position != KIT_DATA_END_DELIMITER) &&
+           (*position != KIT_MESSAGE_DELIMITER))
+    {
+        position++;
+    }
 
-    // Convert the ASCII hex message data to binary
-    if (status == KIT_STATUS_SUCCESS)
+    data_length = (size_t)(position - token);
+    if ((position >= end) || (*position != KIT_DATA_END_DELIMITER) ||
+        (((data_length + 1) / 2) >= sizeof(g_message_data)))
     {
-        g_message_length = kit_protocol_convert_hex_to_binary(g_message_length, 
-                                                              (uint8_t*)g_message_data);
+        return KIT_STATUS_COMMAND_NOT_VALID;
     }
 
-    return status;
+    // Convert the ASCII hex message data to binary, null-terminated for text handlers
+    g_message_length = (uint16_t)hex_codec_decode(token, data_length, g_message_data);
+    g_message_data[g_message_length] = '\0';
+
+    g_message_entry = entry;
+
+    return KIT_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Calls the interface function of a registered command.
+ *
+ * \param[in] entry                 The command registration
+ *
+ * \return  The status of the command
+ *            KIT_STATUS_COMMAND_NOT_SUPPORTED - The application has no function for the command
+ */
+static enum kit_protocol_status kit_interpreter_dispatch(const struct kit_interpreter_command *entry)
+{
+    kit_interpreter_function function = NULL;
+
+    if (entry->function == KIT_FUNCTION_NONE)
+    {
+        return entry->call(NULL);
+    }
+
+    function = *(const kit_interpreter_function*)((const uint8_t*)g_kit_interpreter_interface +
+                                                   entry->function);
+    if (function == NULL)
+    {
+        // The Kit Protocol command is not supported in this application
+        return KIT_STATUS_COMMAND_NOT_SUPPORTED;
+    }
+
+    return entry->call(function);
 }
 
 /**
  * \brief Serializes the outgoing Kit Protocol response message.
  *
+ * \param[in]     status            The status of the command
  * \param[out]    response          The response buffer to store the response message
  * \param[in,out] response_length   The length, in bytes, of the response buffer
  *
@@ -506,47 +503,55 @@ static enum kit_protocol_status kit_interpreter_serialize(enum kit_protocol_stat
                                                           char *response,
                                                           uint16_t *response_length)
 {
-    if (status != KIT_STATUS_COMMAND_NOT_SUPPORTED)
-    {
-        // Convert the binary response message to ASCII hex data
-        switch (g_message_command)
-        {
-        case KIT_COMMAND_BOARD_VERSION:
-        case KIT_COMMAND_BOARD_FIRMWARE:
-        case KIT_COMMAND_BOARD_GET_DEVICE:
-        case KIT_COMMAND_BOARD_GET_LAST_ERROR:
-            /** 
-             * Create the Kit Protocol response message with the information from 
-             * the application's command handling function
-             */
-            *response_length = g_message_length;
-            memcpy(&response[0], &g_message_data[0], g_message_length);
-            break;
-        
-        case KIT_COMMAND_BOARD_DISCOVER:
-            // Create the Kit Protocol response message
-            sprintf(&response[0], "%02X%c", g_message_data[0], KIT_MESSAGE_DELIMITER);
-            *response_length = strlen(response);
-            break;
-        
-        default:
-            // Convert the response message binary data to ASCII hex
-            g_message_length = kit_protocol_convert_binary_to_hex(g_message_length, 
-                                                                  (uint8_t*)g_message_data);
-    
-            // Create the Kit Protocol response message
-            sprintf(&response[0], "%02X(%s)%c", (uint8_t)status, &g_message_data[0], 
-                    KIT_MESSAGE_DELIMITER);
-            *response_length = strlen(response);
-            break;
-        }
-    }
-    else
+    uint8_t status_byte = 0;
+    size_t length = 0;
+
+    if (status == KIT_STATUS_COMMAND_NOT_SUPPORTED)
     {
         // Create the Kit Protocol KIT_STATUS_COMMAND_NOT_SUPPORTED response message
         sprintf(&response[0], "%02X()%c", (uint8_t)status, KIT_MESSAGE_DELIMITER);
+        *response_length = strlen(response);
+
+        return KIT_STATUS_SUCCESS;
     }
-                
+
+    switch (g_message_entry->response)
+    {
+    case KIT_RESPONSE_RAW:
+        /**
+         * Create the Kit Protocol response message with the information from
+         * the application's command handling function
+         */
+        *response_length = g_message_length;
+        memcpy(&response[0], &g_message_data[0], g_message_length);
+        break;
+
+    case KIT_RESPONSE_BYTE:
+        // Create the Kit Protocol response message
+        sprintf(&response[0], "%02X%c", (uint8_t)g_message_data[0], KIT_MESSAGE_DELIMITER);
+        *response_length = strlen(response);
+        break;
+
+    default:
+        // The status, the response data as ASCII hex and the delimiters must fit
+        if (g_message_length > kit_interpreter_get_max_response_length())
+        {
+            status = KIT_STATUS_INVALID_SIZE;
+            g_message_length = 0;
+        }
+
+        // Create the Kit Protocol response message, encoding the data straight into it
+        status_byte = (uint8_t)status;
+        length = hex_codec_encode(&status_byte, 1, &response[0], true);
+        response[length++] = KIT_DATA_BEGIN_DELIMITER;
+        length += hex_codec_encode(g_message_data, g_message_length, &response[length], true);
+        response[length++] = KIT_DATA_END_DELIMITER;
+        response[length++] = KIT_MESSAGE_DELIMITER;
+        response[length] = '\0';
+        *response_length = (uint16_t)length;
+        break;
+    }
+
     return KIT_STATUS_SUCCESS;
 }
 
@@ -555,18 +560,34 @@ static enum kit_protocol_status kit_interpreter_serialize(enum kit_protocol_stat
  *
  * \param[in] interface             The Kit Protocol interface
  *
- * \return    
+ * \return
  */
 enum kit_protocol_status kit_interpreter_init(struct kit_interpreter_interface *interface)
 {
+    uint32_t keys[KIT_INTERPRETER_COMMANDS];
+    const struct kit_interpreter_command *entry = NULL;
+
     if (interface == NULL)
     {
         return KIT_STATUS_INVALID_PARAM;
     }
 
+    // Generate the perfect hash table of the registered commands
+    for (size_t index = 0; index < KIT_INTERPRETER_COMMANDS; index++)
+    {
+        entry = &g_kit_interpreter_commands[index];
+        keys[index] = kit_interpreter_get_key(entry->layer, entry->name, strlen(entry->name));
+    }
+
+    if (kit_protocol_hash_build(&g_kit_interpreter_command_hash, keys,
+                                KIT_INTERPRETER_COMMANDS) == false)
+    {
+        return KIT_STATUS_FAILURE;
+    }
+
     // Save the interface
     g_kit_interpreter_interface = interface;
-    
+
     return KIT_STATUS_SUCCESS;
 }
 
@@ -588,6 +609,15 @@ uint16_t kit_interpreter_get_max_message_length(void)
     return (uint16_t)(sizeof(g_message_data));
 }
 
+/**
+ * \brief Gets the Kit Protocol maximum response data length, the most binary
+ *        data a <status>(<hex data>)\n response message holds
+ */
+uint16_t kit_interpreter_get_max_response_length(void)
+{
+    return (uint16_t)((KIT_MESSAGE_SIZE_MAX - KIT_RESPONSE_HEX_OVERHEAD) / 2);
+}
+
 bool kit_interpreter_message_complete(const char *message,
                                       uint16_t message_length)
 {
@@ -625,219 +655,10 @@ enum kit_protocol_status kit_interpreter_handle_message(char *message,
         if (status == KIT_STATUS_SUCCESS)
         {
             // Process the Kit Protocol command message
-            switch (g_message_command)
-            {
-            case KIT_COMMAND_BOARD_VERSION:
-                if (g_kit_interpreter_interface->board_get_version != NULL)
-                {
-                    status = g_kit_interpreter_interface->board_get_version((uint8_t*)g_message_data,
-                                                                            &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_BOARD_FIRMWARE:
-                if (g_kit_interpreter_interface->board_get_firmware != NULL)
-                {
-                    status = g_kit_interpreter_interface->board_get_firmware((uint8_t*)g_message_data,
-                                                                             &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_BOARD_GET_DEVICE:
-                if (g_kit_interpreter_interface->board_get_device != NULL)
-                {
-                    status = g_kit_interpreter_interface->board_get_device(g_selected_device_handle, 
-                                                                           (uint8_t*)g_message_data,
-                                                                           &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_BOARD_GET_DEVICES:
-                if (g_kit_interpreter_interface->board_get_devices != NULL)
-                {
-                    status = g_kit_interpreter_interface->board_get_devices((uint8_t*)g_message_data,
-                                                                            &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_BOARD_DISCOVER:
-                if (g_kit_interpreter_interface->board_discover != NULL)
-                {
-                    status = g_kit_interpreter_interface->board_discover((bool)g_message_data[0]);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_BOARD_GET_LAST_ERROR:
-                if (g_kit_interpreter_interface->board_get_last_error != NULL)
-                {
-                    status = g_kit_interpreter_interface->board_get_last_error((uint8_t*)g_message_data,
-                                                                               &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_BOARD_APPLICATION:
-                if (g_kit_interpreter_interface->board_application != NULL)
-                {
-                    status = g_kit_interpreter_interface->board_application(g_selected_device_handle, 
-                                                                            (uint8_t*)g_message_data,
-                                                                            &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_BOARD_POLLING:
-                if (g_kit_interpreter_interface->board_polling != NULL)
-                {
-                    status = g_kit_interpreter_interface->board_polling((bool)g_message_data[0]);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_DEVICE_IDLE:
-                if (g_kit_interpreter_interface->device_idle != NULL)
-                {
-                    status = g_kit_interpreter_interface->device_idle(g_selected_device_handle);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
+            status = kit_interpreter_dispatch(g_message_entry);
 
-            case KIT_COMMAND_DEVICE_SLEEP:
-                if (g_kit_interpreter_interface->device_sleep != NULL)
-                {
-                    status = g_kit_interpreter_interface->device_sleep(g_selected_device_handle);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_DEVICE_WAKE:
-                if (g_kit_interpreter_interface->device_wake != NULL)
-                {
-                    status = g_kit_interpreter_interface->device_wake(g_selected_device_handle);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_DEVICE_RECEIVE:
-                if (g_kit_interpreter_interface->device_receive != NULL)
-                {
-                    status = g_kit_interpreter_interface->device_receive(g_selected_device_handle, 
-                                                                         (uint8_t*)g_message_data,
-                                                                         &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            case KIT_COMMAND_DEVICE_SEND:
-                if (g_kit_interpreter_interface->device_send != NULL)
-                {
-                    status = g_kit_interpreter_interface->device_send(g_selected_device_handle, 
-                                                                      (uint8_t*)g_message_data,
-                                                                      &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;                    
-                }
-                break;
-
-            case KIT_COMMAND_DEVICE_TALK:
-                if (g_kit_interpreter_interface->device_talk != NULL)
-                {
-                    status = g_kit_interpreter_interface->device_talk(g_selected_device_handle, 
-                                                                      (uint8_t*)g_message_data,
-                                                                      &g_message_length);
-                }
-                else
-                {
-                    // The Kit Protocol command is not supported in this application
-                    status = KIT_STATUS_COMMAND_NOT_SUPPORTED;
-                }
-                break;
-
-            default:
-                // Unknown Kit Protocol command message
-                break;
-            }
-            
-            
-            // Reset the message information, if necessary
-            if (status == KIT_STATUS_COMMAND_NOT_SUPPORTED)
-            {
-                g_message_length = 0;
-                memset(&g_message_data[0], 0, sizeof(g_message_data));
-            }
-            
-            
             // Create the Kit Protocol response message
-            switch (g_message_command)
-            {
-            case KIT_COMMAND_BOARD_VERSION:
-            case KIT_COMMAND_BOARD_FIRMWARE:
-            case KIT_COMMAND_BOARD_GET_DEVICE:
-                // Do nothing.  These command response messages do not need to be serialized
-                status = KIT_STATUS_SUCCESS;
-                break;
-            
-            default:
-                // Serialize the command response message
-                status = kit_interpreter_serialize(status, message, message_length);
-                break;
-            }            
+            status = kit_interpreter_serialize(status, message, message_length);
         }
         else
         {
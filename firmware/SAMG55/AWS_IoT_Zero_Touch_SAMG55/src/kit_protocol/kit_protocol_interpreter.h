@@ -58,6 +58,8 @@ enum kit_protocol_command
     KIT_COMMAND_BOARD_GET_LAST_ERROR = 0x06,
     KIT_COMMAND_BOARD_APPLICATION    = 0x07,
     KIT_COMMAND_BOARD_POLLING        = 0x08,
+    KIT_COMMAND_BOARD_STATS          = 0x09,
+    KIT_COMMAND_BOARD_FWUPDATE       = 0x0A,
 
     KIT_COMMAND_DEVICE               = 0x30,
     KIT_COMMAND_DEVICE_IDLE          = 0x31,
@@ -66,6 +68,7 @@ enum kit_protocol_command
     KIT_COMMAND_DEVICE_SEND          = 0x34,
     KIT_COMMAND_DEVICE_RECEIVE       = 0x35,
     KIT_COMMAND_DEVICE_TALK          = 0x36,
+    KIT_COMMAND_DEVICE_TALK_BATCH    = 0x37,
 
 #ifndef KIT_PROTOCOL_NO_LEGACY_SUPPORT
     KIT_COMMAND_PHYSICAL             = 0xF0,
@@ -101,6 +104,10 @@ struct kit_interpreter_interface
                                                   uint8_t *message,
                                                   uint16_t *message_length);
     enum kit_protocol_status (*board_polling)(bool enabled);
+    enum kit_protocol_status (*board_get_stats)(uint8_t *message,
+                                                uint16_t *message_length);
+    enum kit_protocol_status (*board_fwupdate)(uint8_t *message,
+                                               uint16_t *message_length);
 
     // Device Kit Protocol message functions
     enum kit_protocol_status (*device_idle)(uint32_t device_handle);
@@ -115,6 +122,9 @@ struct kit_interpreter_interface
     enum kit_protocol_status (*device_talk)(uint32_t device_handle, 
                                             uint8_t *message,
                                             uint16_t *message_length);
+    enum kit_protocol_status (*device_talk_batch)(uint32_t device_handle,
+                                                  uint8_t *message,
+                                                  uint16_t *message_length);
 };
 
 enum kit_protocol_status kit_interpreter_init(struct kit_interpreter_interface *interface);
@@ -123,6 +133,7 @@ uint8_t kit_interpreter_get_selected_device_handle(void);
 void kit_interpreter_set_selected_device_handle(const uint32_t handle);
 
 uint16_t kit_interpreter_get_max_message_length(void);
+uint16_t kit_interpreter_get_max_response_length(void);
 
 bool kit_interpreter_message_complete(const char *message,
                                       uint16_t message_length);
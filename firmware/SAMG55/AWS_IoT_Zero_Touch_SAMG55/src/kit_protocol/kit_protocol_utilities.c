@@ -29,8 +29,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "hex_codec.h"
 #include "kit_protocol_utilities.h"
 
+#define KIT_HASH_MULTIPLIER_FIRST  (0x9E3779B1UL)   //! Odd, 2^32 divided by the golden ratio
+
+//! The slot of a key, the top bits of the key times the table multiplier
+#define KIT_HASH_SLOT(multiplier, key) \
+    ((uint32_t)((uint32_t)(key) * (uint32_t)(multiplier)) >> (32 - KIT_HASH_TABLE_BITS))
+
 /**
  * \brief Converts an ASCII hex character to a nibble.
  *
@@ -95,25 +102,12 @@ uint8_t kit_protocol_convert_nibble_to_hex(uint8_t nibble)
  */
 uint16_t kit_protocol_convert_hex_to_binary(uint16_t length, uint8_t *buffer)
 {
-    uint16_t index = 0;
-    uint16_t binary_index = 0;
-    uint8_t  hex = 0;
-
     if ((buffer == NULL) || (length < 2))
     {
         return 0;
     }
 
-    for (index = 0, binary_index = 0; index < length; index += 2, binary_index++)
-    {
-        hex = buffer[index];
-        buffer[binary_index]  = (kit_protocol_convert_hex_to_nibble(hex) << 4);
-
-        hex = buffer[(index + 1)];
-        buffer[binary_index] |= kit_protocol_convert_hex_to_nibble(hex);
-    }
-
-    return binary_index;
+    return (uint16_t)hex_codec_decode((const char*)buffer, length, buffer);
 }
 
 /**
@@ -131,33 +125,13 @@ uint16_t kit_protocol_convert_hex_to_binary(uint16_t length, uint8_t *buffer)
  */
 uint16_t kit_protocol_convert_binary_to_hex(uint16_t length, uint8_t *buffer)
 {
-    const size_t hex_buffer_size = ((length * 2) + 1);
-
-    char     *hex_buffer = NULL;
-    uint16_t hex_length = 0;
-
     if ((buffer == NULL) || (length == 0))
     {
         return 0;
     }
 
-    // Allocate the memory needed for the ASCII hex buffer
-    hex_buffer = (char*)malloc(hex_buffer_size);
-    memset(hex_buffer, 0, hex_buffer_size);
-
-    for (uint16_t index = 0; index < length; index++)
-    {
-        hex_buffer[hex_length++] = (char)kit_protocol_convert_nibble_to_hex((buffer[index] >> 4));
-        hex_buffer[hex_length++] = (char)kit_protocol_convert_nibble_to_hex((buffer[index] & 0x0F));
-    }
-
-    // Save the ASCII hex buffer
-    memcpy(buffer, hex_buffer, hex_length);
-
-    // Free the allocated memory
-    free(hex_buffer);
-
-    return hex_length;
+    // Converted in place, from the end of the buffer
+    return (uint16_t)hex_codec_encode(buffer, length, (char*)buffer, true);
 }
 
 /**
@@ -193,3 +167,103 @@ void kit_protocol_convert_to_uppercase(size_t length, char *buffer)
         }
     }
 }
+
+/**
+ * \brief Hashes a null-terminated C string into a 32-bit key (FNV-1a).
+ *
+ * \param[in] string       The null-terminated C string to be hashed
+ *
+ * \return    The 32-bit key
+ */
+uint32_t kit_protocol_hash_string(const char *string)
+{
+    uint32_t hash = KIT_HASH_FNV_OFFSET;
+
+    if (string != NULL)
+    {
+        while (*string != '\0')
+        {
+            hash ^= (uint8_t)*string++;
+            hash *= KIT_HASH_FNV_PRIME;
+        }
+    }
+
+    return hash;
+}
+
+/**
+ * \brief Generates the perfect hash table for a registration table.
+ *
+ * \param[out] table       The hash table to be generated
+ * \param[in]  keys        The key of each registration table entry
+ * \param[in]  count       The number of registration table entries
+ *
+ * \return    Whether a collision free table was found. Fails on duplicate
+ *            keys or more than KIT_HASH_TABLE_SIZE entries.
+ */
+bool kit_protocol_hash_build(struct kit_protocol_hash_table *table,
+                             const uint32_t *keys, size_t count)
+{
+    uint32_t multiplier = KIT_HASH_MULTIPLIER_FIRST;
+    uint32_t slot = 0;
+    size_t index = 0;
+
+    if ((table == NULL) || (keys == NULL) || (count > KIT_HASH_TABLE_SIZE))
+    {
+        return false;
+    }
+
+    for (uint32_t tries = 0; tries < KIT_HASH_BUILD_TRIES; tries++, multiplier += 2)
+    {
+        memset(table, 0, sizeof(*table));
+
+        // Place every key, stop at the first slot already taken
+        for (index = 0; index < count; index++)
+        {
+            slot = KIT_HASH_SLOT(multiplier, keys[index]);
+            if (table->entries[slot] != 0)
+            {
+                break;
+            }
+
+            table->keys[slot] = keys[index];
+            table->entries[slot] = (uint8_t)(index + 1);
+        }
+
+        if (index == count)
+        {
+            table->multiplier = multiplier;
+            return true;
+        }
+    }
+
+    memset(table, 0, sizeof(*table));
+
+    return false;
+}
+
+/**
+ * \brief Looks up a key in a perfect hash table.
+ *
+ * \param[in] table        The hash table generated by kit_protocol_hash_build()
+ * \param[in] key          The key to be found
+ *
+ * \return    The registration table entry index, or -1 if the key is not registered
+ */
+int kit_protocol_hash_find(const struct kit_protocol_hash_table *table, uint32_t key)
+{
+    uint32_t slot = 0;
+
+    if (table == NULL)
+    {
+        return -1;
+    }
+
+    slot = KIT_HASH_SLOT(table->multiplier, key);
+    if ((table->entries[slot] == 0) || (table->keys[slot] != key))
+    {
+        return -1;
+    }
+
+    return (table->entries[slot] - 1);
+}
@@ -28,6 +28,7 @@
 #ifndef KIT_PROTOCOL_UTILITIES_H
 #define KIT_PROTOCOL_UTILITIES_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -51,6 +52,29 @@ extern "C" {
 #endif // min
 
 
+#define KIT_HASH_TABLE_BITS        (6)                          //! Slot index bits of a hash table
+#define KIT_HASH_TABLE_SIZE        (1 << KIT_HASH_TABLE_BITS)   //! Slots in a hash table, the most keys it holds
+#define KIT_HASH_BUILD_TRIES       (4096)                       //! Multipliers tried before a build gives up
+#define KIT_HASH_FNV_OFFSET        (0x811C9DC5UL)               //! FNV-1a offset basis of kit_protocol_hash_string()
+#define KIT_HASH_FNV_PRIME         (0x01000193UL)               //! FNV-1a prime of kit_protocol_hash_string()
+
+/**
+ * \brief A perfect hash table mapping 32-bit keys to the index of an entry in
+ *        a static registration table.
+ *
+ * \note  The table is generated once from the keys of the registration table
+ *        by kit_protocol_hash_build(), which searches for a multiplier that
+ *        gives every key its own slot. A lookup is then one multiply, one
+ *        shift and one compare, however many entries are registered.
+ */
+struct kit_protocol_hash_table
+{
+    uint32_t multiplier;                        //! The multiplier found for the registered keys
+    uint32_t keys[KIT_HASH_TABLE_SIZE];         //! The key stored in each slot
+    uint8_t  entries[KIT_HASH_TABLE_SIZE];      //! The entry index plus one, zero for an empty slot
+};
+
+
 /**
  * \brief Converts an ASCII hex character to a nibble.
  *
@@ -112,6 +136,38 @@ void kit_protocol_convert_to_lowercase(size_t length, char *buffer);
  */
 void kit_protocol_convert_to_uppercase(size_t length, char *buffer);
 
+/**
+ * \brief Hashes a null-terminated C string into a 32-bit key (FNV-1a).
+ *
+ * \param[in] string       The null-terminated C string to be hashed
+ *
+ * \return    The 32-bit key
+ */
+uint32_t kit_protocol_hash_string(const char *string);
+
+/**
+ * \brief Generates the perfect hash table for a registration table.
+ *
+ * \param[out] table       The hash table to be generated
+ * \param[in]  keys        The key of each registration table entry
+ * \param[in]  count       The number of registration table entries
+ *
+ * \return    Whether a collision free table was found. Fails on duplicate
+ *            keys or more than KIT_HASH_TABLE_SIZE entries.
+ */
+bool kit_protocol_hash_build(struct kit_protocol_hash_table *table,
+                             const uint32_t *keys, size_t count);
+
+/**
+ * \brief Looks up a key in a perfect hash table.
+ *
+ * \param[in] table        The hash table generated by kit_protocol_hash_build()
+ * \param[in] key          The key to be found
+ *
+ * \return    The registration table entry index, or -1 if the key is not registered
+ */
+int kit_protocol_hash_find(const struct kit_protocol_hash_table *table, uint32_t key);
+
 #ifdef __cplusplus 
 }
 #endif // __cplusplus
@@ -0,0 +1,269 @@
+/**
+ * \file
+ * \brief Low Power Idle Functions
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "asf.h"
+#include "console.h"
+#include "low_power.h"
+
+// Global variables
+static struct low_power_residency g_low_power_residency;
+static uint32_t g_low_power_start_rtt = 0;
+static uint32_t g_low_power_report_rtt = 0;
+
+static const char * const g_sleep_mode_names[SLEEPMGR_NR_OF_MODES] =
+{
+    "Active",
+    "WFE",
+    "WFI",
+    "Wait Fast",
+    "Wait",
+    "Backup"
+};
+
+/**
+ * \brief Converts RTT counts to milliseconds
+ *
+ * \param[in] rtt_counts            A number of RTT counts, e.g. an RTT timer value
+ *
+ * \return  The time in milliseconds
+ */
+uint32_t low_power_rtt_to_ms(uint32_t rtt_counts)
+{
+    return (uint32_t)(((uint64_t)rtt_counts * 1000) / LOW_POWER_RTT_FREQUENCY_HZ);
+}
+
+/**
+ * \brief Initializes the low power idle
+ *
+ * The RTT alarm is used as the wake up source while the SysTick is stopped.
+ * The backup mode loses the RAM contents, so the wait mode is locked as the
+ * deepest mode the idle task may ever use. Peripherals hold their own locks
+ * through the sleep manager, e.g. the WINC1500 SPI limits the idle to WFI
+ * and an active USB connection keeps the CPU active.
+ *
+ * \note Must be called after configure_rtt() and before the scheduler starts.
+ */
+void low_power_init(void)
+{
+    memset(&g_low_power_residency, 0, sizeof(g_low_power_residency));
+
+    // Never go deeper than the wait mode, RAM must be retained
+    sleepmgr_lock_mode(SLEEPMGR_WAIT);
+
+    // Allow the RTT alarm to wake the device from the wait mode
+    pmc_set_fast_startup_input(PMC_FSMR_RTTAL);
+
+    g_low_power_start_rtt = rtt_read_timer_value(RTT);
+    g_low_power_report_rtt = g_low_power_start_rtt;
+}
+
+/**
+ * \brief Replaces the lock flexcom_enable() takes with a shallower one
+ *
+ * flexcom_enable() locks SLEEPMGR_ACTIVE for as long as the FLEXCOM is
+ * enabled, which would keep the idle task from ever sleeping. The console
+ * USART and the WINC1500 SPI are masters that only transfer while a task
+ * waits on them, so each caller locks the mode its own wake up needs instead.
+ *
+ * \param[in] mode                  The deepest sleep mode the FLEXCOM allows
+ */
+void low_power_replace_flexcom_lock(enum sleepmgr_mode mode)
+{
+    sleepmgr_lock_mode(mode);
+    sleepmgr_unlock_mode(SLEEPMGR_ACTIVE);
+}
+
+/**
+ * \brief FreeRTOS tickless idle implementation (configUSE_TICKLESS_IDLE 2)
+ *
+ * Stops the SysTick, arms the RTT alarm for the expected idle time and enters
+ * the deepest sleep mode allowed by the sleep manager locks. On wake up the
+ * RTOS tick count is stepped by the time measured with the RTT.
+ *
+ * \param[in] xExpectedIdleTime     Number of ticks until a task unblocks
+ */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+    enum sleepmgr_mode sleep_mode;
+    uint32_t rtt_start = 0;
+    uint32_t rtt_counts = 0;
+    uint32_t slept_ms = 0;
+    TickType_t slept_ticks = 0;
+
+    // Find the deepest sleep mode the peripherals allow
+    sleep_mode = sleepmgr_get_sleep_mode();
+    if (sleep_mode == SLEEPMGR_ACTIVE)
+    {
+        return;
+    }
+
+    // The wait modes stop the console USART clock, let it finish sending first
+    if ((sleep_mode > SLEEPMGR_SLEEP_WFI) && !usart_is_tx_empty(CONSOLE_UART))
+    {
+        sleep_mode = SLEEPMGR_SLEEP_WFI;
+    }
+
+    // The idle task runs part way through the current tick, so sleep one tick less
+    if (xExpectedIdleTime < 2)
+    {
+        return;
+    }
+    rtt_counts = (uint32_t)(((uint64_t)(xExpectedIdleTime - 1) * portTICK_PERIOD_MS *
+                             LOW_POWER_RTT_FREQUENCY_HZ) / 1000);
+    if (rtt_counts == 0)
+    {
+        return;
+    }
+
+    cpu_irq_disable();
+
+    // Stop the tick interrupt
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+    if (eTaskConfirmSleepModeStatus() == eAbortSleep)
+    {
+        // A task became ready or a context switch is pending, restart the tick
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        g_low_power_residency.abort_count++;
+        cpu_irq_enable();
+        return;
+    }
+
+    // Wake up on the RTT alarm
+    rtt_start = rtt_read_timer_value(RTT);
+    rtt_write_alarm_time(RTT, rtt_start + rtt_counts);
+    rtt_get_status(RTT); // Clear a stale alarm from an earlier, shorter sleep
+    rtt_enable_interrupt(RTT, RTT_MR_ALMIEN);
+
+    if (sleep_mode <= SLEEPMGR_SLEEP_WFI)
+    {
+        // A pending interrupt still wakes the core while interrupts are
+        // masked, so there is no window between the check above and the WFI
+        __DSB();
+        __WFI();
+        __ISB();
+    }
+    else
+    {
+        // The wait modes switch the clocks, the sleep manager restores them
+        sleepmgr_sleep(sleep_mode);
+        cpu_irq_disable();
+    }
+
+    // Account for the time slept, whatever woke the device up
+    rtt_disable_interrupt(RTT, RTT_MR_ALMIEN);
+    rtt_counts = rtt_read_timer_value(RTT) - rtt_start;
+    slept_ms = low_power_rtt_to_ms(rtt_counts);
+
+    slept_ticks = (TickType_t)(slept_ms / portTICK_PERIOD_MS);
+    if (slept_ticks > (xExpectedIdleTime - 1))
+    {
+        slept_ticks = xExpectedIdleTime - 1;
+    }
+    vTaskStepTick(slept_ticks);
+
+    g_low_power_residency.sleep_count[sleep_mode]++;
+    g_low_power_residency.sleep_ms[sleep_mode] += slept_ms;
+
+    // Restart the tick interrupt with a full period
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    cpu_irq_enable();
+}
+
+/**
+ * \brief Gets the low power idle residency statistics
+ *
+ * \param[out] residency            The idle residency statistics
+ */
+void low_power_get_residency(struct low_power_residency *residency)
+{
+    if (residency == NULL)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    memcpy(residency, &g_low_power_residency, sizeof(*residency));
+    taskEXIT_CRITICAL();
+
+    residency->elapsed_ms = low_power_rtt_to_ms(rtt_read_timer_value(RTT) - g_low_power_start_rtt);
+}
+
+/**
+ * \brief Prints the time spent in each sleep mode to the console
+ *
+ * \param[in] force                 Print even if the report interval has not elapsed
+ */
+void low_power_report(bool force)
+{
+    struct low_power_residency residency;
+    uint32_t rtt_now = rtt_read_timer_value(RTT);
+    uint32_t asleep_ms = 0;
+    uint32_t residency_percent = 0;
+    char message[128];
+
+    if (!force && low_power_rtt_to_ms(rtt_now - g_low_power_report_rtt) < LOW_POWER_REPORT_INTERVAL_MS)
+    {
+        return;
+    }
+    g_low_power_report_rtt = rtt_now;
+
+    low_power_get_residency(&residency);
+
+    for (int mode = SLEEPMGR_ACTIVE + 1; mode < SLEEPMGR_NR_OF_MODES; mode++)
+    {
+        if (residency.sleep_count[mode] == 0)
+        {
+            continue;
+        }
+        asleep_ms += residency.sleep_ms[mode];
+
+        memset(&message[0], 0, sizeof(message));
+        sprintf(&message[0], "Idle Residency: %-9s %lu ms in %lu sleeps",
+                g_sleep_mode_names[mode], (unsigned long)residency.sleep_ms[mode],
+                (unsigned long)residency.sleep_count[mode]);
+        console_print_message(message);
+    }
+
+    // Residency in tenths of a percent
+    if (residency.elapsed_ms > 0)
+    {
+        residency_percent = (uint32_t)(((uint64_t)asleep_ms * 1000) / residency.elapsed_ms);
+    }
+
+    memset(&message[0], 0, sizeof(message));
+    sprintf(&message[0], "Idle Residency: asleep %lu of %lu ms (%lu.%lu%%), %lu sleeps aborted",
+            (unsigned long)asleep_ms, (unsigned long)residency.elapsed_ms,
+            (unsigned long)(residency_percent / 10), (unsigned long)(residency_percent % 10),
+            (unsigned long)residency.abort_count);
+    console_print_message(message);
+}
@@ -0,0 +1,55 @@
+/**
+ * \file
+ * \brief Low Power Idle Functions
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef LOW_POWER_H
+#define LOW_POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "asf.h"
+
+// Defines
+#define LOW_POWER_RTT_FREQUENCY_HZ          (1024)   // RTT clocked from the 32768Hz slow clock with a prescaler of 32
+#define LOW_POWER_REPORT_INTERVAL_MS        (60000)  // Interval between the idle residency reports on the console
+
+struct low_power_residency
+{
+    uint32_t sleep_count[SLEEPMGR_NR_OF_MODES]; //! Number of sleeps per sleep manager mode
+    uint32_t sleep_ms[SLEEPMGR_NR_OF_MODES];    //! Time spent sleeping per sleep manager mode
+    uint32_t abort_count;                       //! Number of sleeps aborted because a task became ready
+    uint32_t elapsed_ms;                        //! Time since the low power idle was initialized
+};
+
+void low_power_init(void);
+void low_power_replace_flexcom_lock(enum sleepmgr_mode mode);
+uint32_t low_power_rtt_to_ms(uint32_t rtt_counts);
+
+void low_power_get_residency(struct low_power_residency *residency);
+void low_power_report(bool force);
+
+#endif // LOW_POWER_H
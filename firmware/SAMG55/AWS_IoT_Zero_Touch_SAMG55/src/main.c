@@ -25,12 +25,17 @@
  * THIS SOFTWARE.
  */
 
+#include <stdio.h>
+
 #include "asf.h"
+#include "aws_event.h"
 #include "aws_wifi_task.h"
 #include "console.h"
 #include "led.h"
+#include "low_power.h"
 #include "oled1.h"
 #include "provisioning_task.h"
+#include "system_stats.h"
 #include "timer_interface.h"
 
 // Defines
@@ -51,6 +56,9 @@ static void freertos_init(void)
     // Create the provisioning mutex
     g_provisioning_mutex = xSemaphoreCreateMutex();
 
+    // Create the task event queues
+    aws_event_init();
+
     // Initialize the AWS WIFI task
     xTaskCreate(aws_wifi_task, "AWS WIFI",
                 AWS_WIFI_TASK_STACK_SIZE, NULL,
@@ -62,6 +70,22 @@ static void freertos_init(void)
                 PROVISIONING_TASK_PRIORITY, NULL);
 }
 
+/**
+ * \brief FreeRTOS stack overflow hook (configCHECK_FOR_STACK_OVERFLOW 2)
+ *
+ * The stack of the task has been corrupted, so report the task name over the
+ * UART without the console mutex and halt.
+ */
+void vApplicationStackOverflowHook(TaskHandle_t task, char *task_name)
+{
+    (void)task;
+
+    taskDISABLE_INTERRUPTS();
+    printf("\r\nERROR: Stack overflow in the %s task\r\n", task_name);
+
+    for (;;);
+}
+
 /**
  * \brief Starts the FreeRTOS scheduler.
  */
@@ -79,11 +103,17 @@ int main(void)
 	// Initialize clocks.
     sysclk_init();
 
+    // Initialize the sleep manager before any peripheral takes a lock
+    sleepmgr_init();
+
 	// Initialize GPIO states.
     board_init();
 
     // Configure real time clock
     configure_rtt();
+
+    // Use the RTT to wake up from the tickless idle
+    low_power_init();
     
 	// Initialize the UART console.
 	console_init();
@@ -94,6 +124,9 @@ int main(void)
     // Initialize the OLED1 board
     oled1_init();
 
+    // Count the allocations made by the JSON parser
+    system_stats_init();
+
     // Initialize the FreeRTOS tasks
     freertos_init();
 
@@ -28,16 +28,41 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "aws_event.h"
 #include "aws_wifi_task.h"
 #include "console.h"
+#include "low_power.h"
 #include "oled1.h"
-#include "timer_interface.h"
+
+// Defines
+#define OLED1_PUSHBUTTON_PRIORITY  (10)  // Must not be above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY to post events
+#define OLED1_PUSHBUTTON_COUNT     (OLED1_PUSHBUTTON_ID_3 + 1)
+#define OLED1_PUSHBUTTON_DEBOUNCE_RTT \
+    ((OLED1_PUSHBUTTON_DEBOUNCE_MS * LOW_POWER_RTT_FREQUENCY_HZ) / 1000)  // The debounce time in RTT counts
+
+#if (OLED1_PUSHBUTTON_QUEUE_LENGTH & (OLED1_PUSHBUTTON_QUEUE_LENGTH - 1)) != 0
+#error "The OLED1 pushbutton queue length must be a power of two"
+#endif
 
 // Global Variables
-static Timer    g_debouce_timer;
-static uint32_t g_previous_pushbutton_id = 0;
 
-enum oled1_pushbutton_id g_selected_pushbutton = OLED1_PUSHBUTTON_ID_UNKNOWN;
+/**
+ * Single producer, single consumer ring of the pushbutton presses. Only the
+ * interrupt writes the head and only the AWS WIFI task writes the tail, so
+ * no lock is needed. The indexes run freely and are masked on access.
+ */
+static struct oled1_pushbutton_event g_pushbutton_queue[OLED1_PUSHBUTTON_QUEUE_LENGTH];
+static volatile uint32_t g_pushbutton_queue_head = 0;
+static volatile uint32_t g_pushbutton_queue_tail = 0;
+
+//! RTT counts at the last accepted edge of each pushbutton, written by the interrupt
+static uint32_t g_pushbutton_edge_rtt[OLED1_PUSHBUTTON_COUNT];
+//! Presses that did not fit in the ring, written by the interrupt
+static volatile uint32_t g_pushbutton_overflow[OLED1_PUSHBUTTON_COUNT];
+//! Overflowed presses already returned to the task, written by the task
+static uint32_t g_pushbutton_overflow_read[OLED1_PUSHBUTTON_COUNT];
+//! Whether an AWS_EVENT_PUSHBUTTON event is queued and the ring not yet read
+static volatile bool g_pushbutton_event_pending = false;
 
 /**
  * \brief Callback to handle when the user selects a pushbutton on the 
@@ -48,39 +73,60 @@ enum oled1_pushbutton_id g_selected_pushbutton = OLED1_PUSHBUTTON_ID_UNKNOWN;
  */
 static void oled1_pushbutton_callback(uint32_t id, uint32_t mask)
 {
+    enum oled1_pushbutton_id pushbutton_id = OLED1_PUSHBUTTON_ID_UNKNOWN;
+    uint32_t time_rtt = rtt_read_timer_value(RTT);
+    uint32_t head = g_pushbutton_queue_head;
     
     do 
     {
-        // Check for pushbutton debouce
-        if ((TimerIsExpired(&g_debouce_timer) == 0) && (id == g_previous_pushbutton_id))
+        if ((OLED1_PIN_PUSHBUTTON_1_ID == id) && (OLED1_PIN_PUSHBUTTON_1_MASK == mask))
+        {        
+            pushbutton_id = OLED1_PUSHBUTTON_ID_1;
+        }
+        if ((OLED1_PIN_PUSHBUTTON_2_ID == id) && (OLED1_PIN_PUSHBUTTON_2_MASK == mask))
+        {
+            pushbutton_id = OLED1_PUSHBUTTON_ID_2;
+        }
+        if ((OLED1_PIN_PUSHBUTTON_3_ID == id) && (OLED1_PIN_PUSHBUTTON_3_MASK == mask))
+        {
+            pushbutton_id = OLED1_PUSHBUTTON_ID_3;
+        }
+
+        if (pushbutton_id == OLED1_PUSHBUTTON_ID_UNKNOWN)
         {
             // Break the do/while loop
             break;
         }
-        else
+
+        // Check for pushbutton debounce
+        if ((time_rtt - g_pushbutton_edge_rtt[pushbutton_id]) < OLED1_PUSHBUTTON_DEBOUNCE_RTT)
         {
-            TimerInit(&g_debouce_timer);
-            TimerCountdownMS(&g_debouce_timer, 900);
-        }
-        
-        if ((OLED1_PIN_PUSHBUTTON_1_ID == id) && (OLED1_PIN_PUSHBUTTON_1_MASK == mask))
-        {        
-            // Notify AWS IoT of the new OLED LED state
-            g_selected_pushbutton = OLED1_PUSHBUTTON_ID_1;
+            // Break the do/while loop
+            break;
         }
-        if ((OLED1_PIN_PUSHBUTTON_2_ID == id) && (OLED1_PIN_PUSHBUTTON_2_MASK == mask))
+        g_pushbutton_edge_rtt[pushbutton_id] = time_rtt;
+
+        if ((head - g_pushbutton_queue_tail) < OLED1_PUSHBUTTON_QUEUE_LENGTH)
         {
-            // Notify AWS IoT of the new OLED LED state
-            g_selected_pushbutton = OLED1_PUSHBUTTON_ID_2;
+            // Queue the press, the event must be written before the head is moved
+            g_pushbutton_queue[head & (OLED1_PUSHBUTTON_QUEUE_LENGTH - 1)].timestamp_ms =
+                low_power_rtt_to_ms(time_rtt);
+            g_pushbutton_queue[head & (OLED1_PUSHBUTTON_QUEUE_LENGTH - 1)].id = (uint8_t)pushbutton_id;
+            __DMB();
+            g_pushbutton_queue_head = head + 1;
         }
-        if ((OLED1_PIN_PUSHBUTTON_3_ID == id) && (OLED1_PIN_PUSHBUTTON_3_MASK == mask))
+        else
         {
-            // Notify AWS IoT of the new OLED LED state
-            g_selected_pushbutton = OLED1_PUSHBUTTON_ID_3;
+            // The ring is full, count the press so it still reaches the task
+            g_pushbutton_overflow[pushbutton_id]++;
         }
 
-        // Save the pressed pushbutton id;
-        g_previous_pushbutton_id = id;
+        // Notify AWS IoT of the new OLED LED state, one queued event covers all presses
+        if (!g_pushbutton_event_pending)
+        {
+            g_pushbutton_event_pending = aws_event_post_from_isr(g_aws_wifi_event_queue,
+                                                                 AWS_EVENT_PUSHBUTTON, 0);
+        }
     } while (false);
 }
 
@@ -89,6 +135,12 @@ static void oled1_pushbutton_callback(uint32_t id, uint32_t mask)
  */
 void oled1_init(void)
 {
+    // Accept the first press of every pushbutton
+    for (uint32_t index = 0; index < OLED1_PUSHBUTTON_COUNT; index++)
+    {
+        g_pushbutton_edge_rtt[index] = rtt_read_timer_value(RTT) - OLED1_PUSHBUTTON_DEBOUNCE_RTT;
+    }
+
     // Set the pin direction of the OLED1 LEDs
     ioport_set_pin_dir(OLED1_LED1, IOPORT_DIR_OUTPUT);
     ioport_set_pin_dir(OLED1_LED2, IOPORT_DIR_OUTPUT);
@@ -106,7 +158,8 @@ void oled1_init(void)
                     OLED1_PIN_PUSHBUTTON_1_MASK, OLED1_PIN_PUSHBUTTON_1_ATTR,
                     &oled1_pushbutton_callback);
     NVIC_EnableIRQ((IRQn_Type)OLED1_PIN_PUSHBUTTON_1_ID);
-    pio_handler_set_priority(OLED1_PIN_PUSHBUTTON_1_PIO, (IRQn_Type)OLED1_PIN_PUSHBUTTON_1_ID, 0);
+    pio_handler_set_priority(OLED1_PIN_PUSHBUTTON_1_PIO, (IRQn_Type)OLED1_PIN_PUSHBUTTON_1_ID,
+                             OLED1_PUSHBUTTON_PRIORITY);
     pio_enable_interrupt(OLED1_PIN_PUSHBUTTON_1_PIO, OLED1_PIN_PUSHBUTTON_1_MASK);
 
     // Configure Pushbutton 2
@@ -116,7 +169,8 @@ void oled1_init(void)
                     OLED1_PIN_PUSHBUTTON_2_MASK, OLED1_PIN_PUSHBUTTON_2_ATTR,
                     &oled1_pushbutton_callback);
     NVIC_EnableIRQ((IRQn_Type)OLED1_PIN_PUSHBUTTON_2_ID);
-    pio_handler_set_priority(OLED1_PIN_PUSHBUTTON_2_PIO, (IRQn_Type)OLED1_PIN_PUSHBUTTON_2_ID, 0);
+    pio_handler_set_priority(OLED1_PIN_PUSHBUTTON_2_PIO, (IRQn_Type)OLED1_PIN_PUSHBUTTON_2_ID,
+                             OLED1_PUSHBUTTON_PRIORITY);
     pio_enable_interrupt(OLED1_PIN_PUSHBUTTON_2_PIO, OLED1_PIN_PUSHBUTTON_2_MASK);
 
     // Configure Pushbutton 3
@@ -126,10 +180,70 @@ void oled1_init(void)
                     OLED1_PIN_PUSHBUTTON_3_MASK, OLED1_PIN_PUSHBUTTON_3_ATTR,
                     &oled1_pushbutton_callback);
     NVIC_EnableIRQ((IRQn_Type)OLED1_PIN_PUSHBUTTON_3_ID);
-    pio_handler_set_priority(OLED1_PIN_PUSHBUTTON_3_PIO, (IRQn_Type)OLED1_PIN_PUSHBUTTON_3_ID, 0);
+    pio_handler_set_priority(OLED1_PIN_PUSHBUTTON_3_PIO, (IRQn_Type)OLED1_PIN_PUSHBUTTON_3_ID,
+                             OLED1_PUSHBUTTON_PRIORITY);
     pio_enable_interrupt(OLED1_PIN_PUSHBUTTON_3_PIO, OLED1_PIN_PUSHBUTTON_3_MASK);
 }
 
+/**
+ * \brief Gets the next pushbutton press queued by the interrupt.
+ *
+ * Must only be called from the AWS WIFI task. Presses that overflowed the
+ * ring are returned once the ring is empty, stamped with the current time.
+ *
+ * \param[out] event                The pushbutton press
+ *
+ * \return Whether a press was returned
+ */
+bool oled1_pushbutton_get_event(struct oled1_pushbutton_event *event)
+{
+    uint32_t tail = g_pushbutton_queue_tail;
+
+    // Presses queued from now on post a new event
+    g_pushbutton_event_pending = false;
+
+    if (tail != g_pushbutton_queue_head)
+    {
+        // Read the event before handing the entry back to the interrupt
+        __DMB();
+        *event = g_pushbutton_queue[tail & (OLED1_PUSHBUTTON_QUEUE_LENGTH - 1)];
+        __DMB();
+        g_pushbutton_queue_tail = tail + 1;
+
+        return true;
+    }
+
+    for (uint32_t id = OLED1_PUSHBUTTON_ID_1; id < OLED1_PUSHBUTTON_COUNT; id++)
+    {
+        if (g_pushbutton_overflow_read[id] != g_pushbutton_overflow[id])
+        {
+            g_pushbutton_overflow_read[id]++;
+
+            event->timestamp_ms = low_power_rtt_to_ms(rtt_read_timer_value(RTT));
+            event->id = (uint8_t)id;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \brief Gets the number of pushbutton presses that overflowed the ring.
+ */
+uint32_t oled1_pushbutton_get_overflow_count(void)
+{
+    uint32_t count = 0;
+
+    for (uint32_t id = OLED1_PUSHBUTTON_ID_1; id < OLED1_PUSHBUTTON_COUNT; id++)
+    {
+        count += g_pushbutton_overflow[id];
+    }
+
+    return count;
+}
+
 /** 
  * \brief Sets the state of the OLED1 LEDs.
  *
@@ -41,6 +41,9 @@
 #define OLED1_LED2  OLED1_LED2_PIN
 #define OLED1_LED3  OLED1_LED3_PIN
 
+#define OLED1_PUSHBUTTON_DEBOUNCE_MS   (50)  // Edges of the same pushbutton closer than this are contact bounce
+#define OLED1_PUSHBUTTON_QUEUE_LENGTH  (16)  // Number of presses queued for the AWS WIFI task, must be a power of two
+
 enum oled1_pushbutton_id
 {
     OLED1_PUSHBUTTON_ID_UNKNOWN = 0,
@@ -56,8 +59,11 @@ enum oled1_led_state
     OLED1_LED_TOGGLE = 2
 };
 
-// Extern
-enum oled1_pushbutton_id g_selected_pushbutton;
+struct oled1_pushbutton_event
+{
+    uint32_t timestamp_ms;  //! RTT time of the press, in milliseconds
+    uint8_t  id;            //! The enum oled1_pushbutton_id of the pressed pushbutton
+};
 
 struct demo_button_state
 {
@@ -68,6 +74,9 @@ struct demo_button_state
 
 void oled1_init(void);
 
+bool oled1_pushbutton_get_event(struct oled1_pushbutton_event *event);
+uint32_t oled1_pushbutton_get_overflow_count(void);
+
 void oled1_led_set_state(ioport_pin_t pin, enum oled1_led_state state);
 bool oled1_led_is_active(ioport_pin_t pin);
 
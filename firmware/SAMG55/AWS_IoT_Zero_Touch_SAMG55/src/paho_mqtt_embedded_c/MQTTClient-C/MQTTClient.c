@@ -20,6 +20,8 @@
 #pragma GCC diagnostic ignored "-Wshadow"
 #pragma GCC diagnostic ignored "-Wcast-align"
 
+#include <string.h>
+
 #include "MQTTClient.h"
 
 static void NewMessageData(MessageData* md, MQTTString* aTopicName, MQTTMessage* aMessage) {
@@ -33,6 +35,45 @@ static int getNextPacketId(MQTTClient *c) {
 }
 
 
+#define MQTT_STOPWATCH_RANGE_MS 3600000 /* longest duration measured by a stopwatch */
+
+static void stopwatchStart(Timer* stopwatch) {
+    TimerInit(stopwatch);
+    TimerCountdownMS(stopwatch, MQTT_STOPWATCH_RANGE_MS);
+}
+
+
+static unsigned int stopwatchRead(Timer* stopwatch) {
+    return MQTT_STOPWATCH_RANGE_MS - TimerLeftMS(stopwatch);
+}
+
+
+static void histogramAdd(MQTTHistogram* h, unsigned int ms)
+{
+    int i = 0;
+
+    while (i < MQTT_HISTOGRAM_BUCKETS - 1 && ms > (1u << (2 * i)))
+        ++i;
+    h->buckets[i]++;
+    h->count++;
+    h->total_ms += ms;
+    if (ms > h->max_ms)
+        h->max_ms = ms;
+}
+
+
+static void countPacket(unsigned int* packets, unsigned int* bytes, unsigned char header, int length)
+{
+    packets[header >> 4]++;
+    bytes[header >> 4] += length;
+}
+
+
+static unsigned int getPingInterval(MQTTClient *c) {
+    return (c->ping_interval == 0 || c->ping_interval > c->keepAliveInterval) ? c->keepAliveInterval : c->ping_interval;
+}
+
+
 static int sendPacket(MQTTClient* c, int length, Timer* timer)
 {
     int rc = FAILURE, 
@@ -47,7 +88,31 @@ static int sendPacket(MQTTClient* c, int length, Timer* timer)
     }
     if (sent == length)
     {
-        TimerCountdown(&c->ping_timer, c->keepAliveInterval); // record the fact that we have successfully sent the packet
+        TimerCountdown(&c->ping_timer, getPingInterval(c)); // record the fact that we have successfully sent the packet
+        countPacket(c->stats.packets_out, c->stats.bytes_out, c->buf[0], length);
+        rc = SUCCESS;
+    }
+    else
+        rc = FAILURE;
+    return rc;
+}
+
+
+static int sendPacketSegments(MQTTClient* c, const NetworkSegment* segments, int count, Timer* timer)
+{
+    int rc = FAILURE,
+        length = 0,
+        i;
+
+    for (i = 0; i < count; ++i)
+        length += segments[i].length;
+
+    if (!TimerIsExpired(timer))
+        rc = c->ipstack->mqttwritev(c->ipstack, segments, count, TimerLeftMS(timer));
+    if (rc == length)
+    {
+        TimerCountdown(&c->ping_timer, getPingInterval(c)); // record the fact that we have successfully sent the packet
+        countPacket(c->stats.packets_out, c->stats.bytes_out, segments[0].buffer[0], length);
         rc = SUCCESS;
     }
     else
@@ -63,7 +128,11 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
     c->ipstack = network;
     
     for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+    {
         c->messageHandlers[i].topicFilter = 0;
+        c->messageHandlers[i].fp = NULL;
+        c->messageHandlers[i].chunkfp = NULL;
+    }
     c->command_timeout_ms = command_timeout_ms;
     c->buf = sendbuf;
     c->buf_size = sendbuf_size;
@@ -71,9 +140,15 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
     c->readbuf_size = readbuf_size;
     c->isconnected = 0;
     c->ping_outstanding = 0;
+    c->ping_interval = 0;
+    c->pingresp_timeout_ms = command_timeout_ms;
+    c->pingHandler = NULL;
     c->defaultMessageHandler = NULL;
 	c->next_packetid = 1;
+    c->stream_payloadlen = 0;
+    memset(&c->stats, 0, sizeof(c->stats));
     TimerInit(&c->ping_timer);
+    TimerInit(&c->pingresp_timer);
 #if defined(MQTT_TASK)
 	MutexInit(&c->mutex);
 #endif
@@ -108,12 +183,30 @@ exit:
 }
 
 
+static int discardPacket(MQTTClient* c, int rem_len)
+{
+    int len = 0;
+
+    while (rem_len > 0)
+    {
+        len = (rem_len < (int)c->readbuf_size) ? rem_len : (int)c->readbuf_size;
+        if (c->ipstack->mqttread(c->ipstack, c->readbuf, len, c->command_timeout_ms) != len)
+            return FAILURE;
+        rem_len -= len;
+    }
+    return SUCCESS;
+}
+
+
 static int readPacket(MQTTClient* c, Timer* timer)
 {
     int rc = FAILURE;
     MQTTHeader header = {0};
     int len = 0;
     int rem_len = 0;
+    int var_len = 0;
+
+    c->stream_payloadlen = 0;
 
     /* 1. read the header byte.  This has the packet type in it */
     if (c->ipstack->mqttread(c->ipstack, c->readbuf, 1, TimerLeftMS(timer)) != 1)
@@ -123,12 +216,39 @@ static int readPacket(MQTTClient* c, Timer* timer)
     /* 2. read the remaining length.  This is variable in itself */
     decodePacket(c, &rem_len, TimerLeftMS(timer));
     len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
+    header.byte = c->readbuf[0];
+
+    if (len + rem_len > (int)c->readbuf_size)
+    {
+        /* 3a. too long for readbuf. A PUBLISH is read up to its payload, which the caller then
+         * streams to the handlers. Anything else is read and dropped to keep the stream in sync.
+         * The packet has started arriving, so the rest gets the full command timeout. */
+        if (header.bits.type == PUBLISH && rem_len >= 2)
+        {
+            if (c->ipstack->mqttread(c->ipstack, c->readbuf + len, 2, c->command_timeout_ms) != 2)
+                goto exit;
+            rem_len -= 2;
+            var_len = ((c->readbuf[len] << 8) | c->readbuf[len + 1]) + ((header.bits.qos > 0) ? 2 : 0);
+            len += 2;
+            if (var_len < rem_len && len + var_len < (int)c->readbuf_size)
+            {
+                if (c->ipstack->mqttread(c->ipstack, c->readbuf + len, var_len, c->command_timeout_ms) != var_len)
+                    goto exit;
+                c->stream_payloadlen = rem_len - var_len;
+                countPacket(c->stats.packets_in, c->stats.bytes_in, c->readbuf[0], len + rem_len);
+                rc = PUBLISH;
+                goto exit;
+            }
+        }
+        discardPacket(c, rem_len);
+        goto exit;
+    }
 
     /* 3. read the rest of the buffer using a callback to supply the rest of the data */
     if (rem_len > 0 && (c->ipstack->mqttread(c->ipstack, c->readbuf + len, rem_len, TimerLeftMS(timer)) != rem_len))
         goto exit;
 
-    header.byte = c->readbuf[0];
+    countPacket(c->stats.packets_in, c->stats.bytes_in, c->readbuf[0], len + rem_len);
     rc = header.bits.type;
 exit:
     return rc;
@@ -166,6 +286,13 @@ static char isTopicMatched(char* topicFilter, MQTTString* topicName)
 }
 
 
+static char isHandlerMatched(MQTTClient* c, int i, MQTTString* topicName)
+{
+    return c->messageHandlers[i].topicFilter != 0 && (MQTTPacket_equals(topicName, (char*)c->messageHandlers[i].topicFilter) ||
+            isTopicMatched((char*)c->messageHandlers[i].topicFilter, topicName));
+}
+
+
 int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
 {
     int i;
@@ -174,14 +301,24 @@ int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
     // we have to find the right message handler - indexed by topic
     for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
     {
-        if (c->messageHandlers[i].topicFilter != 0 && (MQTTPacket_equals(topicName, (char*)c->messageHandlers[i].topicFilter) ||
-                isTopicMatched((char*)c->messageHandlers[i].topicFilter, topicName)))
+        if (isHandlerMatched(c, i, topicName))
         {
+            Timer stopwatch;
+            stopwatchStart(&stopwatch);
             if (c->messageHandlers[i].fp != NULL)
             {
                 MessageData md;
                 NewMessageData(&md, topicName, message);
                 c->messageHandlers[i].fp(&md);
+                histogramAdd(&c->stats.handler_time, stopwatchRead(&stopwatch));
+                rc = SUCCESS;
+            }
+            else if (c->messageHandlers[i].chunkfp != NULL)
+            {
+                // the whole payload is in readbuf, hand it over as a single chunk
+                MessageChunkData md = {message, topicName, 0, message->payloadlen};
+                c->messageHandlers[i].chunkfp(&md);
+                histogramAdd(&c->stats.handler_time, stopwatchRead(&stopwatch));
                 rc = SUCCESS;
             }
         }
@@ -190,8 +327,11 @@ int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
     if (rc == FAILURE && c->defaultMessageHandler != NULL) 
     {
         MessageData md;
+        Timer stopwatch;
+        stopwatchStart(&stopwatch);
         NewMessageData(&md, topicName, message);
         c->defaultMessageHandler(&md);
+        histogramAdd(&c->stats.handler_time, stopwatchRead(&stopwatch));
         rc = SUCCESS;
     }   
     
@@ -199,26 +339,75 @@ int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
 }
 
 
+// the payload is read into readbuf behind the topic, one chunk at a time, and handed to the
+// streaming handlers; handlers that need the whole payload at once cannot get this message
+static int deliverMessageChunks(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
+{
+    unsigned char* chunk = (unsigned char*)message->payload;
+    int chunk_size = (int)c->readbuf_size - (int)(chunk - c->readbuf);
+    MQTTMessage chunk_message = *message;
+    MessageChunkData md = {&chunk_message, topicName, 0, c->stream_payloadlen};
+    int len = 0,
+        i;
+
+    while (md.offset < md.totallen)
+    {
+        len = (md.totallen - md.offset < (size_t)chunk_size) ? (int)(md.totallen - md.offset) : chunk_size;
+        if (c->ipstack->mqttread(c->ipstack, chunk, len, c->command_timeout_ms) != len)
+        {
+            // the rest of the packet is still in the stream, it cannot be resynchronized
+            c->stream_payloadlen = 0;
+            c->isconnected = 0;
+            return FAILURE;
+        }
+
+        chunk_message.payloadlen = len;
+        for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+        {
+            if (c->messageHandlers[i].chunkfp != NULL && isHandlerMatched(c, i, topicName))
+            {
+                Timer stopwatch;
+                stopwatchStart(&stopwatch);
+                c->messageHandlers[i].chunkfp(&md);
+                histogramAdd(&c->stats.handler_time, stopwatchRead(&stopwatch));
+            }
+        }
+        md.offset += len;
+    }
+    c->stream_payloadlen = 0;
+    return SUCCESS;
+}
+
+
 int keepalive(MQTTClient* c)
 {
-    int rc = FAILURE;
+    int rc = SUCCESS;
 
     if (c->keepAliveInterval == 0)
-    {
-        rc = SUCCESS;
         goto exit;
-    }
 
-    if (TimerIsExpired(&c->ping_timer))
+    if (c->ping_outstanding)
+    {
+        if (TimerIsExpired(&c->pingresp_timer))
+        {
+            // no PINGRESP in time, the connection is gone even if the socket does not know yet
+            c->ping_outstanding = 0;
+            c->isconnected = 0;
+            rc = FAILURE;
+            if (c->pingHandler != NULL)
+                c->pingHandler(c, FAILURE);
+        }
+    }
+    else if (TimerIsExpired(&c->ping_timer))
     {
-        if (!c->ping_outstanding)
+        Timer timer;
+        TimerInit(&timer);
+        TimerCountdownMS(&timer, 1000);
+        int len = MQTTSerialize_pingreq(c->buf, c->buf_size);
+        if (len > 0 && (rc = sendPacket(c, len, &timer)) == SUCCESS) // send the ping packet
         {
-            Timer timer;
-            TimerInit(&timer);
-            TimerCountdownMS(&timer, 1000);
-            int len = MQTTSerialize_pingreq(c->buf, c->buf_size);
-            if (len > 0 && (rc = sendPacket(c, len, &timer)) == SUCCESS) // send the ping packet
-                c->ping_outstanding = 1;
+            c->ping_outstanding = 1;
+            TimerCountdownMS(&c->pingresp_timer, c->pingresp_timeout_ms);
         }
     }
 
@@ -229,6 +418,9 @@ exit:
 
 int cycle(MQTTClient* c, Timer* timer)
 {
+    Timer stopwatch;
+    stopwatchStart(&stopwatch);
+
     // read the socket, see what work is due
     unsigned short packet_type = readPacket(c, timer);
     
@@ -250,7 +442,13 @@ int cycle(MQTTClient* c, Timer* timer)
                (unsigned char**)&msg.payload, (int*)&msg.payloadlen, c->readbuf, c->readbuf_size) != 1)
                 goto exit;
             msg.qos = (enum QoS)intQoS;
-            deliverMessage(c, &topicName, &msg);
+            if (c->stream_payloadlen > 0)
+            {
+                if ((rc = deliverMessageChunks(c, &topicName, &msg)) != SUCCESS)
+                    goto exit; // the rest of the packet could not be read
+            }
+            else
+                deliverMessage(c, &topicName, &msg);
             if (msg.qos != QOS0)
             {
                 if (msg.qos == QOS1)
@@ -283,11 +481,16 @@ int cycle(MQTTClient* c, Timer* timer)
         case PUBCOMP:
             break;
         case PINGRESP:
+            if (c->ping_outstanding && c->pingHandler != NULL)
+                c->pingHandler(c, SUCCESS);
             c->ping_outstanding = 0;
             break;
     }
-    keepalive(c);
+    if (keepalive(c) != SUCCESS)
+        rc = FAILURE;
 exit:
+    if (packet_type != (unsigned short)FAILURE)
+        histogramAdd(&c->stats.cycle_time, stopwatchRead(&stopwatch));
     if (rc == SUCCESS)
         rc = packet_type;
     return rc;
@@ -315,6 +518,17 @@ int MQTTYield(MQTTClient* c, int timeout_ms)
 }
 
 
+int MQTTCycle(MQTTClient* c, int timeout_ms)
+{
+    Timer timer;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, timeout_ms);
+
+    return (cycle(c, &timer) == FAILURE) ? FAILURE : SUCCESS;
+}
+
+
 void MQTTRun(void* parm)
 {
 	Timer timer;
@@ -351,7 +565,10 @@ int waitfor(MQTTClient* c, int packet_type, Timer* timer)
     do
     {
         if (TimerIsExpired(timer))
+        {
+            c->stats.waitfor_timeouts++;
             break; // we timed out
+        }
     }
     while ((rc = cycle(c, timer)) != packet_type);  
     
@@ -359,7 +576,19 @@ int waitfor(MQTTClient* c, int packet_type, Timer* timer)
 }
 
 
-int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options)
+static int waitforAck(MQTTClient* c, int packet_type, Timer* timer, MQTTHistogram* rtt)
+{
+    Timer stopwatch;
+    int rc = FAILURE;
+
+    stopwatchStart(&stopwatch);
+    if ((rc = waitfor(c, packet_type, timer)) == packet_type)
+        histogramAdd(rtt, stopwatchRead(&stopwatch));
+    return rc;
+}
+
+
+int MQTTConnectWithResults(MQTTClient* c, MQTTPacket_connectData* options, MQTTConnackData* data)
 {
     Timer connect_timer;
     int rc = FAILURE;
@@ -379,19 +608,20 @@ int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options)
         options = &default_options; /* set default options if none were supplied */
     
     c->keepAliveInterval = options->keepAliveInterval;
-    TimerCountdown(&c->ping_timer, c->keepAliveInterval);
+    c->ping_outstanding = 0;
+    TimerCountdown(&c->ping_timer, getPingInterval(c));
     if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
         goto exit;
     if ((rc = sendPacket(c, len, &connect_timer)) != SUCCESS)  // send the connect packet
         goto exit; // there was a problem
     
     // this will be a blocking call, wait for the connack
-    if (waitfor(c, CONNACK, &connect_timer) == CONNACK)
+    if (waitforAck(c, CONNACK, &connect_timer, &c->stats.connack_rtt) == CONNACK)
     {
-        unsigned char connack_rc = 255;
-        unsigned char sessionPresent = 0;
-        if (MQTTDeserialize_connack(&sessionPresent, &connack_rc, c->readbuf, c->readbuf_size) == 1)
-            rc = connack_rc;
+        data->rc = 0;
+        data->sessionPresent = 0;
+        if (MQTTDeserialize_connack(&data->sessionPresent, &data->rc, c->readbuf, c->readbuf_size) == 1)
+            rc = data->rc;
         else
             rc = FAILURE;
     }
@@ -410,6 +640,82 @@ exit:
 }
 
 
+void MQTTSetPingInterval(MQTTClient* c, unsigned int interval, unsigned int pingresp_timeout_ms,
+		pingResultHandler handler)
+{
+    c->ping_interval = interval;
+    c->pingresp_timeout_ms = pingresp_timeout_ms;
+    c->pingHandler = handler;
+    if (c->isconnected && !c->ping_outstanding)
+        TimerCountdown(&c->ping_timer, getPingInterval(c));
+}
+
+
+int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options)
+{
+    MQTTConnackData data;
+    return MQTTConnectWithResults(c, options, &data);
+}
+
+
+static int setMessageHandlers(MQTTClient* c, const char* topicFilter, messageHandler messageHandler,
+        messageChunkHandler messageChunkHandler)
+{
+    int rc = FAILURE;
+    int i = -1;
+
+    /* first check for an existing matching slot */
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+    {
+        if (c->messageHandlers[i].topicFilter != NULL && strcmp(c->messageHandlers[i].topicFilter, topicFilter) == 0)
+        {
+            if (messageHandler == NULL && messageChunkHandler == NULL) /* remove existing */
+            {
+                c->messageHandlers[i].topicFilter = NULL;
+                c->messageHandlers[i].fp = NULL;
+                c->messageHandlers[i].chunkfp = NULL;
+            }
+            rc = SUCCESS;
+            break;
+        }
+    }
+    /* if no existing, look for an empty slot (unless we are removing) */
+    if (messageHandler != NULL || messageChunkHandler != NULL)
+    {
+        if (rc == FAILURE)
+        {
+            for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+            {
+                if (c->messageHandlers[i].topicFilter == NULL)
+                {
+                    rc = SUCCESS;
+                    break;
+                }
+            }
+        }
+        if (i < MAX_MESSAGE_HANDLERS)
+        {
+            c->messageHandlers[i].topicFilter = topicFilter;
+            c->messageHandlers[i].fp = messageHandler;
+            c->messageHandlers[i].chunkfp = messageChunkHandler;
+        }
+    }
+    return rc;
+}
+
+
+int MQTTSetMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler messageHandler)
+{
+    return setMessageHandlers(c, topicFilter, messageHandler, NULL);
+}
+
+
+int MQTTSetMessageChunkHandler(MQTTClient* c, const char* topicFilter, messageChunkHandler messageChunkHandler)
+{
+    return setMessageHandlers(c, topicFilter, NULL, messageChunkHandler);
+}
+
+
 int MQTTSubscribe(MQTTClient* c, const char* topicFilter, enum QoS qos, messageHandler messageHandler)
 { 
     int rc = FAILURE;  
@@ -433,26 +739,14 @@ int MQTTSubscribe(MQTTClient* c, const char* topicFilter, enum QoS qos, messageH
     if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
         goto exit;             // there was a problem
     
-    if (waitfor(c, SUBACK, &timer) == SUBACK)      // wait for suback 
+    if (waitforAck(c, SUBACK, &timer, &c->stats.suback_rtt) == SUBACK)      // wait for suback 
     {
         int count = 0, grantedQoS = -1;
         unsigned short mypacketid;
         if (MQTTDeserialize_suback(&mypacketid, 1, &count, &grantedQoS, c->readbuf, c->readbuf_size) == 1)
             rc = grantedQoS; // 0, 1, 2 or 0x80 
         if (rc != 0x80)
-        {
-            int i;
-            for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-            {
-                if (c->messageHandlers[i].topicFilter == 0)
-                {
-                    c->messageHandlers[i].topicFilter = topicFilter;
-                    c->messageHandlers[i].fp = messageHandler;
-                    rc = 0;
-                    break;
-                }
-            }
-        }
+            rc = MQTTSetMessageHandler(c, topicFilter, messageHandler);
     }
     else 
         rc = FAILURE;
@@ -491,7 +785,11 @@ int MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
     {
         unsigned short mypacketid;  // should be the same as the packetid above
         if (MQTTDeserialize_unsuback(&mypacketid, c->readbuf, c->readbuf_size) == 1)
-            rc = 0; 
+        {
+            /* remove the subscription message handler associated with this topic, if there is one */
+            MQTTSetMessageHandler(c, topicFilter, NULL);
+            rc = 0;
+        }
     }
     else
         rc = FAILURE;
@@ -504,6 +802,30 @@ exit:
 }
 
 
+void MQTTGetStats(MQTTClient* c, MQTTClientStats* stats)
+{
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+    *stats = c->stats;
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+}
+
+
+void MQTTResetStats(MQTTClient* c)
+{
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+    memset(&c->stats, 0, sizeof(c->stats));
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+}
+
+
 int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
 {
     int rc = FAILURE;
@@ -524,16 +846,37 @@ int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
     if (message->qos == QOS1 || message->qos == QOS2)
         message->id = getNextPacketId(c);
     
-    len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id, 
-              topic, (unsigned char*)message->payload, message->payloadlen);
-    if (len <= 0)
-        goto exit;
-    if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
-        goto exit; // there was a problem
+    if (c->ipstack->mqttwritev != NULL &&
+        MQTTPacket_len(MQTTSerialize_publishLength(message->qos, topic, message->payloadlen)) > (int)c->buf_size)
+    {
+        // Only the header is built in c->buf, the payload is sent from the caller's buffer.
+        // Each segment is its own network write, so this is only used when the packet does not fit
+        NetworkSegment segments[2];
+
+        len = MQTTSerialize_publishHeader(c->buf, c->buf_size, 0, message->qos, message->retained, message->id,
+                  topic, message->payloadlen);
+        if (len <= 0)
+            goto exit;
+        segments[0].buffer = c->buf;
+        segments[0].length = len;
+        segments[1].buffer = (const unsigned char*)message->payload;
+        segments[1].length = message->payloadlen;
+        if ((rc = sendPacketSegments(c, segments, 2, &timer)) != SUCCESS)
+            goto exit; // there was a problem
+    }
+    else
+    {
+        len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id, 
+                  topic, (unsigned char*)message->payload, message->payloadlen);
+        if (len <= 0)
+            goto exit;
+        if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
+            goto exit; // there was a problem
+    }
     
     if (message->qos == QOS1)
     {
-        if (waitfor(c, PUBACK, &timer) == PUBACK)
+        if (waitforAck(c, PUBACK, &timer, &c->stats.puback_rtt) == PUBACK)
         {
             unsigned short mypacketid;
             unsigned char dup, type;
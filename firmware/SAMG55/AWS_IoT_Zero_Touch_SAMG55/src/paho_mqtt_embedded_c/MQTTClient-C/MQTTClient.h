@@ -56,6 +56,12 @@
 #define MAX_MESSAGE_HANDLERS 5 /* redefinable - how many subscriptions do you want? */
 #endif
 
+#if !defined(MQTT_HISTOGRAM_BUCKETS)
+#define MQTT_HISTOGRAM_BUCKETS 8 /* redefinable - bucket i counts samples up to 4^i ms, the last one the rest */
+#endif
+
+#define MQTT_PACKET_TYPES 16 /* the packet type is the top 4 bits of the fixed header */
+
 enum QoS { QOS0, QOS1, QOS2 };
 
 /* all failure return codes must be negative */
@@ -95,7 +101,48 @@ typedef struct MessageData
     MQTTString* topicName;
 } MessageData;
 
+typedef struct MQTTConnackData
+{
+    unsigned char rc;
+    unsigned char sessionPresent;
+} MQTTConnackData;
+
+/* A piece of a PUBLISH payload handed to a streaming handler as it arrives.
+ * message->payload and message->payloadlen describe this chunk only. */
+typedef struct MessageChunkData
+{
+    MQTTMessage* message;
+    MQTTString* topicName;
+    size_t offset;      /* offset of this chunk in the whole payload */
+    size_t totallen;    /* length of the whole payload */
+} MessageChunkData;
+
+typedef struct MQTTHistogram
+{
+    unsigned int count;
+    unsigned int total_ms;
+    unsigned int max_ms;
+    unsigned int buckets[MQTT_HISTOGRAM_BUCKETS];
+} MQTTHistogram;
+
+typedef struct MQTTClientStats
+{
+    unsigned int packets_in[MQTT_PACKET_TYPES];     /* indexed by the MQTT packet type */
+    unsigned int bytes_in[MQTT_PACKET_TYPES];
+    unsigned int packets_out[MQTT_PACKET_TYPES];
+    unsigned int bytes_out[MQTT_PACKET_TYPES];
+    unsigned int waitfor_timeouts;                  /* acks that did not arrive before the command timeout */
+    MQTTHistogram connack_rtt;
+    MQTTHistogram suback_rtt;
+    MQTTHistogram puback_rtt;
+    MQTTHistogram cycle_time;                       /* cycles that read a packet, handlers included */
+    MQTTHistogram handler_time;                     /* message handler calls, one per chunk when streaming */
+} MQTTClientStats;
+
 typedef void (*messageHandler)(MessageData*);
+typedef void (*messageChunkHandler)(MessageChunkData*);
+struct MQTTClient;
+typedef void (*pingResultHandler)(struct MQTTClient*, int rc);
 
 typedef struct MQTTClient
 {
@@ -113,12 +160,19 @@ typedef struct MQTTClient
     {
         const char* topicFilter;
         void (*fp) (MessageData*);
+        void (*chunkfp) (MessageChunkData*);
     } messageHandlers[MAX_MESSAGE_HANDLERS];      /* Message handlers are indexed by subscription topic */
 
     void (*defaultMessageHandler) (MessageData*);
 
     Network* ipstack;
     Timer ping_timer;
+    unsigned int ping_interval;         /* seconds without outbound traffic before a PINGREQ, 0 for keepAliveInterval */
+    unsigned int pingresp_timeout_ms;   /* time allowed for the PINGRESP before the connection is considered lost */
+    Timer pingresp_timer;
+    pingResultHandler pingHandler;      /* told whether each PINGREQ got its PINGRESP in time */
+    size_t stream_payloadlen;           /* payload bytes of a PUBLISH too long for readbuf, still to be read */
+    MQTTClientStats stats;
 #if defined(MQTT_TASK)
 	Mutex mutex;
 	Thread thread;
@@ -145,7 +199,61 @@ DLLExport void MQTTClientInit(MQTTClient* client, Network* network, unsigned int
  */
 DLLExport int MQTTConnect(MQTTClient* client, MQTTPacket_connectData* options);
 
+/** MQTT Connect - send an MQTT connect packet down the network and wait for a Connack
+ *  The nework object must be connected to the network endpoint before calling this
+ *  @param options - connect options
+ *  @param data - returns the CONNACK return code and session present flag
+ *  @return success code
+ */
+DLLExport int MQTTConnectWithResults(MQTTClient* client, MQTTPacket_connectData* options,
+		MQTTConnackData* data);
+
+/** MQTT SetMessageHandler - set or remove a per topic message handler, without sending a subscribe
+ *  Used to restore the handlers when the broker still holds the subscriptions of a persistent session
+ *  @param client - the client object to use
+ *  @param topicFilter - the topic filter set the message handler for
+ *  @param messageHandler - pointer to the message handler function or NULL to remove
+ *  @return success code
+ */
+DLLExport int MQTTSetMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler messageHandler);
+
+/** MQTT SetMessageChunkHandler - set or remove a streaming message handler for a topic filter.
+ *  The handler gets the payload in chunks of at most readbuf_size bytes as it is read from
+ *  the network, so payloads longer than readbuf can be received. A payload that fits in
+ *  readbuf is delivered as a single chunk. Replaces a handler set with MQTTSubscribe.
+ *  @param client - the client object to use
+ *  @param topicFilter - the topic filter set the message handler for
+ *  @param messageChunkHandler - pointer to the streaming message handler function or NULL to remove
+ *  @return success code
+ */
+DLLExport int MQTTSetMessageChunkHandler(MQTTClient* c, const char* topicFilter, messageChunkHandler messageChunkHandler);
+
+/** MQTT SetPingInterval - set how long the connection may stay without outbound traffic before a PINGREQ is sent
+ *  Any packet sent restarts the interval. A PINGRESP not received within pingresp_timeout_ms closes the
+ *  session: the next MQTTYield or MQTTCycle fails and isconnected is cleared.
+ *  @param client - the client object to use
+ *  @param interval - the ping interval in seconds, 0 or anything above keepAliveInterval uses keepAliveInterval
+ *  @param pingresp_timeout_ms - the time allowed for the PINGRESP
+ *  @param handler - called with SUCCESS or FAILURE for each PINGREQ, or NULL
+ */
+DLLExport void MQTTSetPingInterval(MQTTClient* c, unsigned int interval, unsigned int pingresp_timeout_ms,
+		pingResultHandler handler);
+
+/** MQTT GetStats - copy the packet counters and latency histograms of the client
+ *  Counters are kept from MQTTClientInit or the last MQTTResetStats, across connections.
+ *  @param client - the client object to use
+ *  @param stats - the statistics copy
+ */
+DLLExport void MQTTGetStats(MQTTClient* client, MQTTClientStats* stats);
+
+/** MQTT ResetStats - clear the packet counters and latency histograms of the client
+ *  @param client - the client object to use
+ */
+DLLExport void MQTTResetStats(MQTTClient* client);
+
 /** MQTT Publish - send an MQTT publish packet and wait for all acks to complete for all QoSs
+ *  When the network provides mqttwritev, payloads too large for the send buffer are written
+ *  straight from message->payload after the header.
  *  @param client - the client object to use
  *  @param topic - the topic to publish to
  *  @param message - the message to send
@@ -181,6 +289,15 @@ DLLExport int MQTTDisconnect(MQTTClient* client);
  */
 DLLExport int MQTTYield(MQTTClient* client, int time);
 
+/** MQTT Cycle - handle at most one incoming packet, then send a ping if the keep alive is due.
+ *  Unlike MQTTYield this returns as soon as the packet is handled, for event driven callers
+ *  that only cycle once the network layer has received data.
+ *  @param client - the client object to use
+ *  @param timeout_ms - the time, in milliseconds, to wait for the packet to be complete
+ *  @return success code
+ */
+DLLExport int MQTTCycle(MQTTClient* client, int timeout_ms);
+
 #if defined(MQTT_TASK)
 /** MQTT start background thread for a client.  After this, MQTTYield should not be called.
 *  @param client - the client object to use
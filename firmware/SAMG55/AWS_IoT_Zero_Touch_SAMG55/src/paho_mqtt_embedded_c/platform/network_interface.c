@@ -46,6 +46,8 @@
 #include "aws_wifi_task.h"
 #include "MQTTReturnCodes.h"
 #include "network_interface.h"
+#include "socket/include/socket.h"
+#include "timer_interface.h"
 
 /**
  * \brief Reads data from the WINC1500 module.
@@ -76,3 +78,49 @@ int mqtt_packet_write(Network *network, unsigned char *send_buffer, int length,
 {
     return aws_wifi_send_data(send_buffer, length, timeout_ms);
 }
+
+/**
+ * \brief Writes a list of buffers to the WINC1500 module as one stream.
+ *
+ * Each segment is handed to the WINC1500 straight from the caller's buffer,
+ * split in chunks of at most SOCKET_BUFFER_MAX_LENGTH bytes, so a packet
+ * never has to be staged in a single contiguous buffer first.
+ *
+ * \param network[in]               The Eclipse Paho MQTT network information
+ * \param segments[in]              The buffers to send, in order
+ * \param count[in]                 The number of buffers
+ * \param timeout_ms[in]            The timeout for the whole list
+ *
+ * \return    The number of bytes sent or the MQTT status on failure
+ */
+int mqtt_packet_writev(Network *network, const NetworkSegment *segments, int count, int timeout_ms)
+{
+    Timer send_timer;
+    int sent = 0;
+    int i = 0;
+    int offset = 0;
+    int chunk_length = 0;
+    int status = 0;
+
+    TimerInit(&send_timer);
+    TimerCountdownMS(&send_timer, timeout_ms);
+
+    for (i = 0; i < count; i++)
+    {
+        for (offset = 0; offset < segments[i].length; offset += chunk_length)
+        {
+            chunk_length = min(segments[i].length - offset, SOCKET_BUFFER_MAX_LENGTH);
+
+            status = aws_wifi_send_data((uint8_t*)&segments[i].buffer[offset], chunk_length,
+                                        TimerLeftMS(&send_timer));
+            if (status != chunk_length)
+            {
+                return FAILURE;
+            }
+
+            sent += chunk_length;
+        }
+    }
+
+    return sent;
+}
@@ -47,12 +47,19 @@
 
 #include <stdint.h>
 
+typedef struct mqtt_network_segment {
+	const unsigned char *buffer;
+	int length;
+} NetworkSegment;
+
 typedef struct mqtt_network {
 	int (*mqttread)(struct mqtt_network *network, unsigned char *read_buffer, int length, int timeout_ms);
 	int (*mqttwrite)(struct mqtt_network *network, unsigned char *send_buffer, int length, int timeout_ms);
+	int (*mqttwritev)(struct mqtt_network *network, const NetworkSegment *segments, int count, int timeout_ms);
 } Network;
 
 int mqtt_packet_read(Network *network, unsigned char *read_buffer, int length, int timeout_ms);
 int mqtt_packet_write(Network *network, unsigned char *send_buffer, int length, int timeout_ms);
+int mqtt_packet_writev(Network *network, const NetworkSegment *segments, int count, int timeout_ms);
 
 #endif // MQTT_NETWORK_INTERFACE_H
\ No newline at end of file
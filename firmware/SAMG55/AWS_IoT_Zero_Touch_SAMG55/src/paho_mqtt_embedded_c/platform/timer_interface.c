@@ -61,9 +61,10 @@ void RTT_Handler(void)
     {
 	}
 
-	// Alarm
+	// Alarm, used to wake up from the tickless idle
 	if ((status & RTT_SR_ALMS) == RTT_SR_ALMS)
     {
+		rtt_disable_interrupt(RTT, RTT_MR_ALMIEN);
 	}
 }
 
@@ -80,12 +81,12 @@ void configure_rtt(void)
 	previous_time = rtt_read_timer_value(RTT);
 	while (previous_time == rtt_read_timer_value(RTT));
 
-	// Enable Real Time Timer interrupt
+	// Enable Real Time Timer interrupt. Only the alarm is enabled when needed,
+	// an increment interrupt would wake the device up every millisecond.
 	NVIC_DisableIRQ(RTT_IRQn);
 	NVIC_ClearPendingIRQ(RTT_IRQn);
 	NVIC_SetPriority(RTT_IRQn, 0);
 	NVIC_EnableIRQ(RTT_IRQn);
-	rtt_enable_interrupt(RTT, RTT_MR_RTTINCIEN);
 }
 
 /**
@@ -30,17 +30,23 @@
 
 #include "asf.h"
 #include "atcacert/atcacert_client.h"
-#include "atcacert/atcacert_host_hw.h"
+#include "aws_event.h"
 #include "aws_wifi_task.h"
 #include "cert_def_1_signer.h"
 #include "cert_def_2_device.h"
 #include "cert_def_3_device_csr.h"
 #include "console.h"
+#include "ecc_devices.h"
+#include "ecc_session.h"
+#include "ecc_verify.h"
+#include "firmware_update.h"
+#include "hex_codec.h"
 #include "kit_protocol_interpreter.h"
 #include "kit_protocol_utilities.h"
 #include "led.h"
 #include "parson.h"
 #include "provisioning_task.h"
+#include "system_stats.h"
 #include "usb_hid.h"
 #include "version.h"
 #include "ecc_configure.h"
@@ -48,18 +54,25 @@
 #include "atca_cfgs.h"
 
 // Defines
-#define PROVISIONING_TASK_DELAY  (100 / portTICK_PERIOD_MS)
+#define PROVISIONING_PRECONFIGURE_REMINDER_MS  (2500)  // How often the SW0 instructions are printed
+#define PROVISIONING_CONFIGURE_POLL_MS         (100)   // How often an unprovisioned ATECCx08A is checked again
+#define PROVISIONING_SW0_PRIORITY              (10)    // Must not be above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY to post events
+#define PROVISIONING_SW0_ATTR                  (PIO_PULLUP | PIO_DEBOUNCE | PIO_IT_FALL_EDGE)
+#define PROVISIONING_BENCHMARK_ITERATIONS      (10)    // Default reads timed at each I2C speed
+#define PROVISIONING_BENCHMARK_ITERATIONS_MAX  (100)
+#define PROVISIONING_SIGN_BATCH_MAX            (20)    // Digests signed per signBatch, the signatures must fit one kit response
+#define PROVISIONING_CERTIFICATES_SIZE         (1024)  // The decoded Signer and Device certificates of saveCredentials
+#define PROVISIONING_CERTIFICATE_SIZE_MAX      (512)   // A certificate rebuilt from its certificate definition
+#define PROVISIONING_DEVICE_LOCS_MAX           (16)    // Device locations a certificate definition is stored in
 
 
 // Global variables
 
 //! The current state of the provisioning task
-enum aws_iot_state g_provisioning_state = AWS_STATE_ATECCx08A_DETECT;
+static enum aws_iot_state g_provisioning_state = AWS_STATE_ATECCx08A_DETECT;
 
 //! The Kit Protocol interpreter
 static struct kit_interpreter_interface g_kit_interpreter_interface;
-//! The array of CryptoAuth devices found
-static struct kit_device                g_kit_devices[AWS_KIT_DEVICES_MAX];
 
 //! FreeRTOS provisioning mutex
 SemaphoreHandle_t g_provisioning_mutex;
@@ -67,6 +80,9 @@ SemaphoreHandle_t g_provisioning_mutex;
 //! Mutable device description
 ATCAIfaceCfg      g_crypto_device;
 
+//! Time from boot until the ATECCx08A was ready for the AWS WIFI task
+static uint32_t   g_crypto_ready_ms = 0;
+
 
 /**
  * \brief Initializes the CryptoAuthLib library
@@ -77,8 +93,7 @@ ATCAIfaceCfg      g_crypto_device;
 static ATCA_STATUS cryptoauthlib_init(void)
 {
     ATCA_STATUS status = ATCA_NO_DEVICES;
-    bool device_locked = false;
-    uint8_t revision[INFO_SIZE];
+    const struct ecc_probe *probe = get_crypto_device_probe();
     
     // Grab the default configuration
     g_crypto_device = cfg_ateccx08a_i2c_default;
@@ -87,61 +102,46 @@ static ATCA_STATUS cryptoauthlib_init(void)
     g_crypto_device.atcai2c.slave_address = AWS_ECCx08A_I2C_ADDRESS;
     g_crypto_device.devtype = ATECC508A;
     g_crypto_device.atcai2c.bus = 0;
-    g_crypto_device.atcai2c.baud = 400000;
+    g_crypto_device.atcai2c.baud = ECC_DEVICES_BAUD_DEFAULT;
     
     do 
     {
-        status = atcab_init(&g_crypto_device);
-        if (status != ATCA_SUCCESS)
+        // The boot probe already read the revision and the lock bytes
+        if (!probe->valid)
         {
-            console_print_error_message("The CryptoAuthLib library failed to initialize.");
+            console_print_error_message("The ATECCx08A device failed to return the revision information.");
             
             // Break the do/while loop
             break;
         }
 
-        // Force the ATECCx08A to sleep
-        atcab_wakeup();
-        atcab_sleep();
-        
         // Check to make sure the ATECCx08A Config zone is locked    
-	    status = atcab_is_locked(LOCK_ZONE_CONFIG, &device_locked);
-        if (status != ATCA_SUCCESS || !device_locked)
+        if (!probe->config_locked)
         {
             console_print_error_message("The ATECCx08A Config Zone is not locked.");
+            status = ATCA_NOT_LOCKED;
             
             // Break the do/while loop
             break;
         }
 
-        // Check to make sure the ATECCx08A Config zone is locked
-        status = atcab_is_locked(LOCK_ZONE_DATA, &device_locked);
-        if (status != ATCA_SUCCESS || !device_locked)
+        // Check to make sure the ATECCx08A Data zone is locked
+        if (!probe->data_locked)
         {
             console_print_error_message("The ATECCx08A Data Zone is not locked.");
+            status = ATCA_NOT_LOCKED;
             
             // Break the do/while loop
             break;
         }
 
-        // Check to make sure the demo can communicate with the ATECCx08A
-        memset(&revision[0], 0, sizeof(revision));
-        status = atcab_info(revision); 
-        if (status != ATCA_SUCCESS)
-        {
-            console_print_error_message("The ATECCx08A device failed to return the revision information.");
-
-            // Break the do/while loop
-            break;
-        }
-        
         // set the appropriate device type
-        if(revision[2] >= 0x60)
+        if(probe->revision[2] >= 0x60)
         {
             //found an ATECC608A
             g_crypto_device.devtype = ATECC608A;
         }
-        else if(revision[2] >= 0x50  && revision[2] < 0x60)
+        else if(probe->revision[2] >= 0x50  && probe->revision[2] < 0x60)
         {
             //found an ATECC508
             g_crypto_device.devtype = ATECC508A;
@@ -162,14 +162,20 @@ static ATCA_STATUS cryptoauthlib_init(void)
             break;
         }
     
-        // Add the AWSECCx08A device to the Kit device array
-        memset(&g_kit_devices, 0, sizeof(g_kit_devices));
-    
-        g_kit_devices[0].device_id = KIT_DEVICE_ID_ATECC508A;
-        g_kit_devices[0].protocol  = KIT_DEVICE_TWI;
-        g_kit_devices[0].address   = AWS_ECCx08A_I2C_ADDRESS;
-        
-        status = ATCA_SUCCESS;
+        // Add the AWS ECCx08A device and any secondary ECCx08A devices to the device pool
+        status = ecc_devices_init(&g_crypto_device);
+        if (status != ATCA_SUCCESS)
+        {
+            // Break the do/while loop
+            break;
+        }
+
+        // Run the bus at the fastest speed all devices pass the check at
+        status = ecc_devices_negotiate_baud(&g_crypto_device);
+        if (status != ATCA_SUCCESS)
+        {
+            console_print_error_message("The CryptoAuthLib library failed to initialize.");
+        }
     } while (false);    
     
     return status;
@@ -185,18 +191,21 @@ static void kit_protocol_init(void)
     g_kit_interpreter_interface.board_get_version    = &kit_board_get_version;
     g_kit_interpreter_interface.board_get_firmware   = &kit_board_get_firmware;
     g_kit_interpreter_interface.board_get_device     = &kit_board_get_device;
-    g_kit_interpreter_interface.board_get_devices    = NULL;
+    g_kit_interpreter_interface.board_get_devices    = &kit_board_get_devices;
     g_kit_interpreter_interface.board_discover       = NULL;
     g_kit_interpreter_interface.board_get_last_error = NULL;
     g_kit_interpreter_interface.board_application    = &kit_board_application;
     g_kit_interpreter_interface.board_polling        = NULL;
+    g_kit_interpreter_interface.board_get_stats      = &kit_board_get_stats;
+    g_kit_interpreter_interface.board_fwupdate       = &kit_board_fwupdate;
     
     g_kit_interpreter_interface.device_idle          = &kit_device_idle;
     g_kit_interpreter_interface.device_sleep         = &kit_device_sleep;
     g_kit_interpreter_interface.device_wake          = &kit_device_wake;
-    g_kit_interpreter_interface.device_receive       = NULL;
-    g_kit_interpreter_interface.device_send          = NULL;
+    g_kit_interpreter_interface.device_receive       = &kit_device_receive;
+    g_kit_interpreter_interface.device_send          = &kit_device_send;
     g_kit_interpreter_interface.device_talk          = &kit_device_talk;
+    g_kit_interpreter_interface.device_talk_batch    = &kit_device_talk_batch;
     
     // Initialize the Kit Protocol interpreter 
     kit_interpreter_init(&g_kit_interpreter_interface);
@@ -511,10 +520,12 @@ static enum kit_protocol_status process_board_application_gen_csr(JSON_Object *p
                            AWS_STATUS_SUCCESS,
                            "The AWS IoT Demo successfully generated the device CSR.");
         
-        // Generate the AWS IoT device CSR
+        // Generate the AWS IoT device CSR, its commands run in one wake session
         csr_buffer_length = sizeof(csr_buffer);
+        ecc_session_begin();
         atca_status = atcacert_create_csr(&g_csr_def_3_device, csr_buffer, 
                                           &csr_buffer_length);
+        ecc_session_end();
         
         if (atca_status == ATCA_SUCCESS)
         {
@@ -542,23 +553,156 @@ static enum kit_protocol_status process_board_application_gen_csr(JSON_Object *p
     return KIT_STATUS_SUCCESS;
 }
 
+/**
+ * \brief Decodes a hex certificate and gets what verifying its signature takes
+ *
+ * \param[in]  cert_def             The certificate definition
+ * \param[in]  hex                  The DER certificate in hex
+ * \param[out] cert                 The DER certificate
+ * \param[in]  cert_max_size        The size of the cert buffer
+ * \param[out] cert_size            The size of the DER certificate
+ * \param[out] tbs_digest           The SHA-256 digest of the to-be-signed part
+ * \param[out] signature            The certificate signature, R and S
+ *
+ * \return  ATCA_SUCCESS, ATCA_BAD_PARAM if the certificate is missing or too large
+ */
+static ATCA_STATUS provisioning_decode_certificate(const atcacert_def_t *cert_def, const char *hex,
+                                                   uint8_t *cert, size_t cert_max_size,
+                                                   size_t *cert_size, uint8_t *tbs_digest,
+                                                   uint8_t *signature)
+{
+    ATCA_STATUS atca_status = ATCA_SUCCESS;
+    size_t hex_length = (hex != NULL) ? strlen(hex) : 0;
+
+    if ((hex_length == 0) || ((hex_length % 2) != 0) || ((hex_length / 2) > cert_max_size))
+    {
+        return ATCA_BAD_PARAM;
+    }
+
+    *cert_size = hex_codec_decode(hex, hex_length, cert);
+
+    atca_status = atcacert_get_tbs_digest(cert_def, cert, *cert_size, tbs_digest);
+    if (atca_status != ATCACERT_E_SUCCESS)
+    {
+        return atca_status;
+    }
+
+    return atcacert_get_signature(cert_def, cert, *cert_size, signature);
+}
+
+/**
+ * \brief Checks that a certificate comes back unchanged from what is written
+ *
+ * Nothing is written to the ATECCx08A. The compressed certificate and the
+ * other device data are taken from the certificate the way
+ * atcacert_write_cert() stores them, then the certificate is rebuilt from
+ * them in RAM the way it is read back for TLS.
+ *
+ * \param[in] cert_def              The certificate definition
+ * \param[in] cert                  The DER certificate
+ * \param[in] cert_size             The size of the DER certificate
+ * \param[in] ca_public_key         The public key of the issuer, for the authority key ID
+ *
+ * \return  ATCA_SUCCESS, ATCACERT_E_WRONG_CERT_DEF if the rebuilt certificate differs
+ */
+static ATCA_STATUS provisioning_check_certificate(const atcacert_def_t *cert_def, const uint8_t *cert,
+                                                  size_t cert_size, const uint8_t *ca_public_key)
+{
+    ATCA_STATUS atca_status = ATCA_SUCCESS;
+    atcacert_device_loc_t device_locs[PROVISIONING_DEVICE_LOCS_MAX];
+    size_t device_locs_count = 0;
+    uint8_t device_data[SLOT8_SIZE];
+    uint8_t comp_cert[ATCACERT_COMP_CERT_MAX_SIZE];
+    atcacert_build_state_t build_state;
+    uint8_t rebuilt_cert[PROVISIONING_CERTIFICATE_SIZE_MAX];
+    size_t rebuilt_cert_size = sizeof(rebuilt_cert);
+
+    atca_status = atcacert_get_device_locs(cert_def, device_locs, &device_locs_count,
+                                           PROVISIONING_DEVICE_LOCS_MAX, ATCA_BLOCK_SIZE);
+    if (atca_status != ATCACERT_E_SUCCESS)
+    {
+        return atca_status;
+    }
+
+    atca_status = atcacert_get_comp_cert(cert_def, cert, cert_size, comp_cert);
+    if (atca_status != ATCACERT_E_SUCCESS)
+    {
+        return atca_status;
+    }
+
+    atca_status = atcacert_cert_build_start(&build_state, cert_def, rebuilt_cert,
+                                            &rebuilt_cert_size, ca_public_key);
+    if (atca_status == ATCACERT_E_SUCCESS)
+    {
+        atca_status = atcacert_cert_build_process(&build_state, &cert_def->comp_cert_dev_loc, comp_cert);
+    }
+
+    // The slot images hold the compressed certificate again, next to the other elements
+    for (size_t index = 0; (index < device_locs_count) && (atca_status == ATCACERT_E_SUCCESS); index++)
+    {
+        if (device_locs[index].is_genkey)
+        {
+            // The public key is generated in the slot, not written to it
+            atca_status = atcacert_get_subj_public_key(cert_def, cert, cert_size, device_data);
+        }
+        else
+        {
+            atca_status = atcacert_get_device_data(cert_def, cert, cert_size,
+                                                   &device_locs[index], device_data);
+        }
+
+        if (atca_status == ATCACERT_E_SUCCESS)
+        {
+            atca_status = atcacert_cert_build_process(&build_state, &device_locs[index], device_data);
+        }
+    }
+
+    if (atca_status == ATCACERT_E_SUCCESS)
+    {
+        atca_status = atcacert_cert_build_finish(&build_state);
+    }
+    if (atca_status != ATCACERT_E_SUCCESS)
+    {
+        return atca_status;
+    }
+
+    if ((rebuilt_cert_size != cert_size) || (memcmp(rebuilt_cert, cert, cert_size) != 0))
+    {
+        return ATCACERT_E_WRONG_CERT_DEF;
+    }
+
+    return ATCA_SUCCESS;
+}
+
 static enum kit_protocol_status process_board_application_save_credentials(JSON_Object *params_object,
                                                                            JSON_Object *result_object)
 {
     ATCA_STATUS atca_status = ATCA_STATUS_UNKNOWN;
-    char *certificate = NULL;
-    char *signer_ca_public_key = NULL;
+    ATCA_STATUS decode_status = ATCA_STATUS_UNKNOWN;
+    ATCA_STATUS check_status = ATCA_SUCCESS;
+    const char *signer_ca_public_key_hex = NULL;
     char *hostname = NULL;
-    uint8_t credentials_buffer[3000];
-    uint16_t credentials_buffer_length = 0;
-    
-    uint8_t read_certificate[1000];
-    uint32_t read_certificate_length;
-    uint8_t public_key[ATCA_PUB_KEY_SIZE];
-    
+
+    // The Signer certificate, followed by the Device certificate
+    uint8_t certificates[PROVISIONING_CERTIFICATES_SIZE];
+    size_t signer_cert_size = 0;
+    size_t device_cert_size = 0;
+
+    uint8_t signer_ca_public_key[ATCA_PUB_KEY_SIZE];
+    uint8_t signer_public_key[ATCA_PUB_KEY_SIZE];
+    uint8_t signer_tbs_digest[ATCA_SHA256_DIGEST_SIZE];
+    uint8_t signer_signature[ATCA_SIG_SIZE];
+    uint8_t device_tbs_digest[ATCA_SHA256_DIGEST_SIZE];
+    uint8_t device_signature[ATCA_SIG_SIZE];
+    struct ecc_verify verify;
+    struct ecc_job verify_job;
+
     struct Eccx08A_Slot8_Metadata metadata;
     uint8_t metadata_buffer[SLOT8_SIZE];
     
+    // Keep the ATECCx08A awake from the first verify to the last write
+    ecc_session_begin();
+
     do
     {
         // Set the successful AWS IoT Zero Touch Demo status
@@ -567,25 +711,14 @@ static enum kit_protocol_status process_board_application_save_credentials(JSON_
                            "The AWS IoT Demo successfully saved the device credentials.");
 
 
-        // Save the Signer CA public key in the ATECCx08A
-        signer_ca_public_key = (char*)json_object_get_string(params_object, "signerCaPublicKey");
-        credentials_buffer_length = strlen(signer_ca_public_key);
-        memset(&credentials_buffer[0], 0, sizeof(credentials_buffer));
-        memcpy(&credentials_buffer[0], &signer_ca_public_key[0], credentials_buffer_length);
-                
-        credentials_buffer_length = kit_protocol_convert_hex_to_binary(credentials_buffer_length,
-                                                                       credentials_buffer);
-
-        memset(&public_key[0], 0, sizeof(public_key));
-        memcpy(&public_key[0], &credentials_buffer[0], sizeof(public_key));
-
-        atca_status = atcab_write_pubkey(SIGNER_CA_PUBLIC_KEY_SLOT, credentials_buffer);
-        if (atca_status != ATCA_SUCCESS)
+        // Decode the Signer CA public key
+        signer_ca_public_key_hex = json_object_get_string(params_object, "signerCaPublicKey");
+        if ((signer_ca_public_key_hex == NULL) ||
+            (strlen(signer_ca_public_key_hex) != (sizeof(signer_ca_public_key) * 2)))
         {
-            // The ECCx08A failed to save the Signer CA public key in the ATECCx08A
             aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
-                               AWS_STATUS_ATECCx08A_COMM_FAILURE,
-                               "The AWS IoT Demo failed to save the Signer CA public key.");
+                               AWS_STATUS_BAD_PARAMETER,
+                               "The Signer CA public key is missing or of the wrong size.");
             
             // Print the status to the console
             console_print_aws_status("AWS IoT Zero Touch Demo saveCredentials Message:",
@@ -594,25 +727,28 @@ static enum kit_protocol_status process_board_application_save_credentials(JSON_
             // Break the do/while loop
             break;
         }
-        
-        
-        // Save the Signer certificate in the ATECCx08A
-        certificate = (char*)json_object_get_string(params_object, "signerCert");
-        credentials_buffer_length = strlen(certificate);
-        memset(&credentials_buffer[0], 0, sizeof(credentials_buffer));
-        memcpy(&credentials_buffer[0], &certificate[0], credentials_buffer_length);
-        
-        credentials_buffer_length = kit_protocol_convert_hex_to_binary(credentials_buffer_length,
-                                                                       credentials_buffer);
-        
-        atca_status = atcacert_write_cert(&g_cert_def_1_signer, credentials_buffer,
-                                          credentials_buffer_length);
+
+        hex_codec_decode(signer_ca_public_key_hex, sizeof(signer_ca_public_key) * 2,
+                         signer_ca_public_key);
+
+
+        // Decode the Signer certificate, it is verified before anything is written
+        atca_status = provisioning_decode_certificate(&g_cert_def_1_signer,
+                                                      json_object_get_string(params_object, "signerCert"),
+                                                      &certificates[0], sizeof(certificates),
+                                                      &signer_cert_size, signer_tbs_digest,
+                                                      signer_signature);
+        if (atca_status == ATCA_SUCCESS)
+        {
+            atca_status = atcacert_get_subj_public_key(&g_cert_def_1_signer, &certificates[0],
+                                                       signer_cert_size, signer_public_key);
+        }
+
         if (atca_status != ATCA_SUCCESS)
         {
-            // The ECCx08A failed to save the Signer certificate in the ATECCx08A
             aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
-                               AWS_STATUS_ATECCx08A_COMM_FAILURE,
-                               "The AWS IoT Demo failed to save the Signer certificate.");
+                               AWS_STATUS_BAD_PARAMETER,
+                               "The Signer certificate is missing or malformed.");
             
             // Print the status to the console
             console_print_aws_status("AWS IoT Zero Touch Demo saveCredentials Message:",
@@ -623,15 +759,42 @@ static enum kit_protocol_status process_board_application_save_credentials(JSON_
         }
 
 
-        // Verify the Signer certificate in the ATECCx08A
-        read_certificate_length = sizeof(read_certificate);
-        atca_status = atcacert_read_cert(&g_cert_def_1_signer,
-                                         public_key,
-                                         read_certificate,
-                                         (size_t*)&read_certificate_length);
-        if (atca_status != ATCA_SUCCESS)
+        // Start verifying the Signer certificate against the Signer CA public key
+        verify.message_digest = signer_tbs_digest;
+        verify.signature      = signer_signature;
+        verify.public_key     = signer_ca_public_key;
+        ecc_devices_init_verify_job(&verify_job, &verify);
+
+        atca_status = ecc_devices_start(&verify_job, 1);
+        if (atca_status == ATCA_SUCCESS)
         {
-            // The ECCx08A failed to save the Signer certificate in the ATECCx08A
+            // Decode the Device certificate after it while the ATECCx08A executes
+            decode_status = provisioning_decode_certificate(&g_cert_def_2_device,
+                                                            json_object_get_string(params_object, "deviceCert"),
+                                                            &certificates[signer_cert_size],
+                                                            sizeof(certificates) - signer_cert_size,
+                                                            &device_cert_size, device_tbs_digest,
+                                                            device_signature);
+
+            // Then check that both certificates rebuild from what is written
+            if (decode_status == ATCA_SUCCESS)
+            {
+                check_status = provisioning_check_certificate(&g_cert_def_1_signer, &certificates[0],
+                                                              signer_cert_size, signer_ca_public_key);
+            }
+            if ((decode_status == ATCA_SUCCESS) && (check_status == ATCA_SUCCESS))
+            {
+                check_status = provisioning_check_certificate(&g_cert_def_2_device,
+                                                              &certificates[signer_cert_size],
+                                                              device_cert_size, signer_public_key);
+            }
+
+            atca_status = ecc_devices_wait();
+        }
+
+        if ((atca_status != ATCA_SUCCESS) || !verify.is_verified)
+        {
+            // The ECCx08A failed to verify the Signer certificate
             aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
                                AWS_STATUS_ATECCx08A_COMM_FAILURE,
                                "The AWS IoT Demo failed to verify the Signer certificate.");
@@ -643,15 +806,12 @@ static enum kit_protocol_status process_board_application_save_credentials(JSON_
             // Break the do/while loop
             break;
         }
-        
-        atca_status = atcacert_verify_cert_hw(&g_cert_def_1_signer, read_certificate, 
-                                              read_certificate_length, public_key);
-        if (atca_status != ATCA_SUCCESS)
+
+        if (decode_status != ATCA_SUCCESS)
         {
-            // The ECCx08A failed to save the Signer certificate in the ATECCx08A
             aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
-                               AWS_STATUS_ATECCx08A_COMM_FAILURE,
-                               "The AWS IoT Demo failed to verify the Signer certificate.");
+                               AWS_STATUS_BAD_PARAMETER,
+                               "The Device certificate is missing or malformed.");
             
             // Print the status to the console
             console_print_aws_status("AWS IoT Zero Touch Demo saveCredentials Message:",
@@ -661,43 +821,35 @@ static enum kit_protocol_status process_board_application_save_credentials(JSON_
             break;
         }
 
-        
-        // Get the Signer public key from the certificate
-        atca_status = atcacert_get_subj_public_key(&g_cert_def_1_signer, read_certificate, 
-                                                   read_certificate_length, public_key);
-        if (atca_status != ATCA_SUCCESS)
+        if (check_status != ATCA_SUCCESS)
         {
-            // The ECCx08A failed to save the Signer certificate in the ATECCx08A
+            // The certificates would not read back as they were sent
             aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
-                               AWS_STATUS_ATECCx08A_COMM_FAILURE,
-                               "The AWS IoT Demo failed to retrieve the Signer public key.");
+                               AWS_STATUS_BAD_PARAMETER,
+                               "The certificates do not match their certificate definitions.");
             
             // Print the status to the console
             console_print_aws_status("AWS IoT Zero Touch Demo saveCredentials Message:",
                                      aws_iot_get_status());
-
+            
             // Break the do/while loop
             break;
         }
-        
 
-        // Save the Device certificate in the ATECCx08A
-        certificate = (char*)json_object_get_string(params_object, "deviceCert");
-        credentials_buffer_length = strlen(certificate);
-        memset(&credentials_buffer[0], 0, sizeof(credentials_buffer));
-        memcpy(&credentials_buffer[0], &certificate[0], credentials_buffer_length);
-        
-        credentials_buffer_length = kit_protocol_convert_hex_to_binary(credentials_buffer_length,
-                                                                       credentials_buffer);
-        
-        atca_status = atcacert_write_cert(&g_cert_def_2_device, credentials_buffer,
-                                          credentials_buffer_length);
-        if (atca_status != ATCA_SUCCESS)
+
+        // Verify the Device certificate against the Signer public key
+        verify.message_digest = device_tbs_digest;
+        verify.signature      = device_signature;
+        verify.public_key     = signer_public_key;
+        ecc_devices_init_verify_job(&verify_job, &verify);
+
+        atca_status = ecc_devices_run(&verify_job, 1);
+        if ((atca_status != ATCA_SUCCESS) || !verify.is_verified)
         {
-            // The ECCx08A failed to save the Device certificate in the ATECCx08A
+            // The ECCx08A failed to verify the Device certificate
             aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
                                AWS_STATUS_ATECCx08A_COMM_FAILURE,
-                               "The AWS IoT Demo failed to save the Device certificate.");
+                               "The AWS IoT Demo failed to verify the Device certificate.");
             
             // Print the status to the console
             console_print_aws_status("AWS IoT Zero Touch Demo saveCredentials Message:",
@@ -708,18 +860,14 @@ static enum kit_protocol_status process_board_application_save_credentials(JSON_
         }
 
 
-        // Verify the Device certificate in the ATECCx08A
-        read_certificate_length = sizeof(read_certificate);
-        atca_status = atcacert_read_cert(&g_cert_def_2_device,
-                                         public_key,
-                                         read_certificate,
-                                         (size_t*)&read_certificate_length);
+        // Save the Signer CA public key in the ATECCx08A
+        atca_status = atcab_write_pubkey(SIGNER_CA_PUBLIC_KEY_SLOT, signer_ca_public_key);
         if (atca_status != ATCA_SUCCESS)
         {
-            // The ECCx08A failed to save the Signer certificate in the ATECCx08A
+            // The ECCx08A failed to save the Signer CA public key in the ATECCx08A
             aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
                                AWS_STATUS_ATECCx08A_COMM_FAILURE,
-                               "The AWS IoT Demo failed to verify the Device certificate.");
+                               "The AWS IoT Demo failed to save the Signer CA public key.");
             
             // Print the status to the console
             console_print_aws_status("AWS IoT Zero Touch Demo saveCredentials Message:",
@@ -729,14 +877,35 @@ static enum kit_protocol_status process_board_application_save_credentials(JSON_
             break;
         }
         
-        atca_status = atcacert_verify_cert_hw(&g_cert_def_2_device, read_certificate,
-                                              read_certificate_length, public_key);
+        
+        // Save the Signer certificate in the ATECCx08A
+        atca_status = atcacert_write_cert(&g_cert_def_1_signer, &certificates[0],
+                                          signer_cert_size);
         if (atca_status != ATCA_SUCCESS)
         {
             // The ECCx08A failed to save the Signer certificate in the ATECCx08A
             aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
                                AWS_STATUS_ATECCx08A_COMM_FAILURE,
-                               "The AWS IoT Demo failed to verify the Device certificate.");
+                               "The AWS IoT Demo failed to save the Signer certificate.");
+            
+            // Print the status to the console
+            console_print_aws_status("AWS IoT Zero Touch Demo saveCredentials Message:",
+                                     aws_iot_get_status());
+            
+            // Break the do/while loop
+            break;
+        }
+        
+
+        // Save the Device certificate in the ATECCx08A
+        atca_status = atcacert_write_cert(&g_cert_def_2_device, &certificates[signer_cert_size],
+                                          device_cert_size);
+        if (atca_status != ATCA_SUCCESS)
+        {
+            // The ECCx08A failed to save the Device certificate in the ATECCx08A
+            aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
+                               AWS_STATUS_ATECCx08A_COMM_FAILURE,
+                               "The AWS IoT Demo failed to save the Device certificate.");
             
             // Print the status to the console
             console_print_aws_status("AWS IoT Zero Touch Demo saveCredentials Message:",
@@ -795,6 +964,8 @@ static enum kit_protocol_status process_board_application_save_credentials(JSON_
         g_provisioning_state = AWS_STATE_ATECCx08A_CONFIGURE;
     } while (false);
 
+    ecc_session_end();
+
     // The AWS IoT Zero Touch Demo saveCredentials message will always return KIT_STATUS_SUCCESS
     return KIT_STATUS_SUCCESS;
 }
@@ -836,83 +1007,297 @@ static enum kit_protocol_status process_board_application_reset_kit(JSON_Object
     return KIT_STATUS_SUCCESS;
 }
 
-/**
- * \brief Gets the current processing state of the provisioning task
- */
-enum aws_iot_state provisioning_get_state(void)
+static enum kit_protocol_status process_board_application_benchmark_i2c(JSON_Object *params_object,
+                                                                        JSON_Object *result_object)
 {
-    return g_provisioning_state;    
-}
+    static const uint32_t bauds[] = { 100000, ECC_DEVICES_BAUD_DEFAULT, ECC_DEVICES_BAUD_ATECC608A };
 
-/**
- * \brief Gets the AWS Provisioning Serial Number
- *
- * \param[in,out] serial_number_length The length, in bytes, of the
- *                                     AWS Provisioning serial number
- *                                       IN  - The maximum size of the AWS 
- *                                             Provisioning serial number
- *                                       OUT - The size of the AWS
- *                                             Provisioning serial number
- * \param[out] serial_number           The AWS Provisioning serial number
- *
- * \return  ATCA_SUCCESS when the AWS Provisioning Signer CA Public Key has 
- *          been retrieved successfully
- */
-ATCA_STATUS provisioning_get_serial_number(uint32_t *serial_number_length,
-                                           uint8_t *serial_number)
-{
     ATCA_STATUS atca_status = ATCA_STATUS_UNKNOWN;
+    uint32_t negotiated_baud = g_crypto_device.atcai2c.baud;
+    uint32_t iterations = PROVISIONING_BENCHMARK_ITERATIONS;
+    uint16_t slot = METADATA_SLOT;
+    size_t slot_size = 0;
+    uint8_t read_buffer[SLOT8_SIZE];
+    TickType_t start = 0;
+    uint32_t elapsed_ms = 0;
+    uint32_t scl_hz = 0;
+
+    JSON_Value *speeds_value = json_value_init_array();
+    JSON_Array *speeds_array = json_value_get_array(speeds_value);
+    JSON_Value *speed_value = NULL;
+    JSON_Object *speed_object = NULL;
 
-    if ((serial_number_length == NULL) || (serial_number == NULL))
+    // Set the successful AWS IoT Zero Touch Demo status
+    aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
+                       AWS_STATUS_SUCCESS,
+                       "The AWS IoT Demo successfully measured the ATECCx08A I2C throughput.");
+
+    if (json_value_get_type(json_object_get_value(params_object, "slot")) == JSONNumber)
     {
-        return ATCA_BAD_PARAM;
+        slot = (uint16_t)json_object_get_number(params_object, "slot");
     }
-    
-    do
+
+    if (json_value_get_type(json_object_get_value(params_object, "iterations")) == JSONNumber)
     {
-        // Get the AWS Provisioning serial number from the ATECCx08A
-        if (*serial_number_length >= ATCA_SERIAL_NUM_SIZE)
+        iterations = (uint32_t)json_object_get_number(params_object, "iterations");
+        iterations = min(max(iterations, 1), PROVISIONING_BENCHMARK_ITERATIONS_MAX);
+    }
+
+    atca_status = atcab_get_zone_size(ATCA_ZONE_DATA, slot, &slot_size);
+    slot_size = min(slot_size, sizeof(read_buffer));
+
+    // Time the slot reads at each speed the devices support, in one wake session each
+    for (size_t index = 0; (index < (sizeof(bauds) / sizeof(bauds[0]))) && (atca_status == ATCA_SUCCESS); index++)
+    {
+        if (bauds[index] > ecc_devices_get_max_baud())
         {
-            *serial_number_length = 0;
+            continue;
+        }
 
-            atca_status = atcab_read_serial_number(serial_number);
-            if (atca_status == ATCA_SUCCESS)
-            {
-                *serial_number_length = ATCA_SERIAL_NUM_SIZE;
-            }
+        atca_status = ecc_devices_set_baud(&g_crypto_device, bauds[index]);
+        if (atca_status != ATCA_SUCCESS)
+        {
+            break;
         }
-        else
+
+        ecc_session_begin();
+        start = xTaskGetTickCount();
+        for (uint32_t iteration = 0; (iteration < iterations) && (atca_status == ATCA_SUCCESS); iteration++)
         {
-            atca_status = ATCA_INVALID_SIZE;
+            atca_status = atcab_read_bytes_zone(ATCA_ZONE_DATA, slot, 0, read_buffer, slot_size);
         }
-    } while (false);
+        elapsed_ms = ((xTaskGetTickCount() - start) * portTICK_PERIOD_MS);
+
+        // The clock the TWI generated for the reads, the HAL sets it again after every wake
+        scl_hz = ecc_devices_get_scl_hz();
+        ecc_session_end();
+
+        speed_value  = json_value_init_object();
+        speed_object = json_value_get_object(speed_value);
+        json_object_set_number(speed_object, "baud", bauds[index]);
+        json_object_set_number(speed_object, "sclHz", scl_hz);
+        json_object_set_number(speed_object, "ms", elapsed_ms);
+        json_object_set_number(speed_object, "bytesPerSecond",
+                               (elapsed_ms > 0) ? ((slot_size * iterations * 1000) / elapsed_ms) : 0);
+        json_object_set_number(speed_object, "status", atca_status);
+        json_array_append_value(speeds_array, speed_value);
+
+        // A failed speed is reported, the slower speeds were measured already
+        atca_status = ATCA_SUCCESS;
+    }
 
-    return atca_status;
+    // Return to the negotiated speed
+    if (ecc_devices_set_baud(&g_crypto_device, negotiated_baud) != ATCA_SUCCESS)
+    {
+        atca_status = ATCA_COMM_FAIL;
+    }
+
+    if (atca_status != ATCA_SUCCESS)
+    {
+        // The ECCx08A failed to read the slot
+        aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
+                           AWS_STATUS_ATECCx08A_COMM_FAILURE,
+                           "The AWS IoT Demo failed to measure the ATECCx08A I2C throughput.");
+
+        // Print the status to the console
+        console_print_aws_status("AWS IoT Zero Touch Demo benchmarkI2c Message:",
+                                 aws_iot_get_status());
+    }
+
+    json_object_set_number(result_object, "slot", slot);
+    json_object_set_number(result_object, "bytes", slot_size);
+    json_object_set_number(result_object, "iterations", iterations);
+    json_object_set_number(result_object, "baud", negotiated_baud);
+    json_object_set_value(result_object, "speeds", speeds_value);
+
+    // The AWS IoT Zero Touch Demo benchmarkI2c message will always return KIT_STATUS_SUCCESS
+    return KIT_STATUS_SUCCESS;
 }
 
-/**
- * \brief Gets the AWS Provisioning Signer CA Public Key
- *
- * \param[in,out] public_key_length The length, in bytes, of the
- *                                  AWS Provisioning Signer CA Public Key
- *                                    IN  - The maximum size of the AWS 
- *                                          Provisioning Signer CA Public Key
- *                                    OUT - The size of the AWS
- *                                          Provisioning Signer CA Public Key
- * \param[out] public_key           The AWS Provisioning Signer CA Public Key
- *
- * \return  ATCA_SUCCESS when the AWS Provisioning Signer CA Public Key has 
- *          been retrieved successfully
- */
-ATCA_STATUS provisioning_get_signer_ca_public_key(uint32_t *public_key_length, 
-                                                  uint8_t *public_key)
+static enum kit_protocol_status process_board_application_sign_batch(JSON_Object *params_object,
+                                                                     JSON_Object *result_object)
 {
-    ATCA_STATUS atca_status = ATCA_STATUS_UNKNOWN;
+    ATCA_STATUS atca_status = ATCA_SUCCESS;
+    const char *digests = NULL;
+    size_t digests_length = 0;
+    size_t digest_count = 0;
+    size_t signed_count = 0;
+    uint8_t digest[ATCA_SHA256_DIGEST_SIZE];
+    uint8_t signature[ATCA_SIG_SIZE];
+    char signatures[(PROVISIONING_SIGN_BATCH_MAX * ATCA_SIG_SIZE * 2) + 1];
+    TickType_t start = 0;
 
-    if ((public_key_length == NULL) || (public_key == NULL))
+    do
     {
-        return ATCA_BAD_PARAM;
-    }
+        // Set the successful AWS IoT Zero Touch Demo status
+        aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
+                           AWS_STATUS_SUCCESS,
+                           "The AWS IoT Demo successfully signed the digests.");
+
+        // The digests are one hex string, 32 bytes each
+        digests = json_object_get_string(params_object, "digests");
+        digests_length = (digests != NULL) ? strlen(digests) : 0;
+        digest_count = (digests_length / (ATCA_SHA256_DIGEST_SIZE * 2));
+        if ((digest_count == 0) || (digest_count > PROVISIONING_SIGN_BATCH_MAX) ||
+            (digests_length != (digest_count * ATCA_SHA256_DIGEST_SIZE * 2)))
+        {
+            aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
+                               AWS_STATUS_BAD_PARAMETER,
+                               "The signBatch digests are missing or of the wrong size.");
+
+            // Print the status to the console
+            console_print_aws_status("AWS IoT Zero Touch Demo signBatch Message:",
+                                     aws_iot_get_status());
+
+            // Break the do/while loop
+            break;
+        }
+
+        // Sign back to back, with the ATECCx08A awake for the whole batch
+        start = xTaskGetTickCount();
+        ecc_session_begin();
+        for (signed_count = 0; signed_count < digest_count; signed_count++)
+        {
+            hex_codec_decode(&digests[signed_count * ATCA_SHA256_DIGEST_SIZE * 2],
+                             ATCA_SHA256_DIGEST_SIZE * 2, digest);
+
+            atca_status = atcab_sign(DEVICE_KEY_SLOT, digest, signature);
+            if (atca_status != ATCA_SUCCESS)
+            {
+                break;
+            }
+
+            hex_codec_encode(signature, sizeof(signature),
+                             &signatures[signed_count * ATCA_SIG_SIZE * 2], false);
+        }
+        ecc_session_end();
+
+        signatures[signed_count * ATCA_SIG_SIZE * 2] = 0;
+        json_object_set_string(result_object, "signatures", signatures);
+        json_object_set_number(result_object, "count", signed_count);
+        json_object_set_number(result_object, "ms", ((xTaskGetTickCount() - start) * portTICK_PERIOD_MS));
+
+        if (atca_status != ATCA_SUCCESS)
+        {
+            // The ECCx08A failed to sign a digest
+            aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
+                               AWS_STATUS_ATECCx08A_COMM_FAILURE,
+                               "The AWS IoT Demo failed to sign a digest.");
+
+            // Print the status to the console
+            console_print_aws_status("AWS IoT Zero Touch Demo signBatch Message:",
+                                     aws_iot_get_status());
+
+            // Break the do/while loop
+            break;
+        }
+    } while (false);
+
+    // The AWS IoT Zero Touch Demo signBatch message will always return KIT_STATUS_SUCCESS
+    return KIT_STATUS_SUCCESS;
+}
+
+static enum kit_protocol_status process_board_application_set_verify_mode(JSON_Object *params_object,
+                                                                           JSON_Object *result_object)
+{
+    enum ecc_verify_mode mode = ECC_VERIFY_MODE_DEFAULT;
+
+    // Set the successful AWS IoT Zero Touch Demo status
+    aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
+                       AWS_STATUS_SUCCESS,
+                       "The AWS IoT Demo successfully set the verify mode.");
+
+    if (!ecc_verify_get_mode_by_name(json_object_get_string(params_object, "mode"), &mode))
+    {
+        aws_iot_set_status(AWS_STATE_ATECCx08A_CONFIGURE,
+                           AWS_STATUS_BAD_PARAMETER,
+                           "The verify mode is not auto, atecc or software.");
+
+        // Print the status to the console
+        console_print_aws_status("AWS IoT Zero Touch Demo setVerifyMode Message:",
+                                 aws_iot_get_status());
+    }
+    else
+    {
+        ecc_verify_set_mode(mode);
+    }
+
+    // Return the mode in effect and the benchmark results
+    ecc_verify_get_json(result_object);
+
+    // The AWS IoT Zero Touch Demo setVerifyMode message will always return KIT_STATUS_SUCCESS
+    return KIT_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Gets the AWS Provisioning Serial Number
+ *
+ * \param[in,out] serial_number_length The length, in bytes, of the
+ *                                     AWS Provisioning serial number
+ *                                       IN  - The maximum size of the AWS 
+ *                                             Provisioning serial number
+ *                                       OUT - The size of the AWS
+ *                                             Provisioning serial number
+ * \param[out] serial_number           The AWS Provisioning serial number
+ *
+ * \return  ATCA_SUCCESS when the AWS Provisioning Signer CA Public Key has 
+ *          been retrieved successfully
+ */
+ATCA_STATUS provisioning_get_serial_number(uint32_t *serial_number_length,
+                                           uint8_t *serial_number)
+{
+    ATCA_STATUS atca_status = ATCA_STATUS_UNKNOWN;
+
+    if ((serial_number_length == NULL) || (serial_number == NULL))
+    {
+        return ATCA_BAD_PARAM;
+    }
+    
+    do
+    {
+        // Get the AWS Provisioning serial number from the ATECCx08A
+        if (*serial_number_length >= ATCA_SERIAL_NUM_SIZE)
+        {
+            *serial_number_length = 0;
+
+            atca_status = atcab_read_serial_number(serial_number);
+            if (atca_status == ATCA_SUCCESS)
+            {
+                *serial_number_length = ATCA_SERIAL_NUM_SIZE;
+            }
+        }
+        else
+        {
+            atca_status = ATCA_INVALID_SIZE;
+        }
+    } while (false);
+
+    return atca_status;
+}
+
+/**
+ * \brief Gets the AWS Provisioning Signer CA Public Key
+ *
+ * \param[in,out] public_key_length The length, in bytes, of the
+ *                                  AWS Provisioning Signer CA Public Key
+ *                                    IN  - The maximum size of the AWS 
+ *                                          Provisioning Signer CA Public Key
+ *                                    OUT - The size of the AWS
+ *                                          Provisioning Signer CA Public Key
+ * \param[out] public_key           The AWS Provisioning Signer CA Public Key
+ *
+ * \return  ATCA_SUCCESS when the AWS Provisioning Signer CA Public Key has 
+ *          been retrieved successfully
+ */
+ATCA_STATUS provisioning_get_signer_ca_public_key(uint32_t *public_key_length, 
+                                                  uint8_t *public_key)
+{
+    ATCA_STATUS atca_status = ATCA_STATUS_UNKNOWN;
+
+    if ((public_key_length == NULL) || (public_key == NULL))
+    {
+        return ATCA_BAD_PARAM;
+    }
     
     do 
     {
@@ -1126,7 +1511,7 @@ enum kit_protocol_status kit_board_get_version(uint8_t *message,
     
     // Create the Kit Protocol Get Version response message
     sprintf((char*)&message[0], "AWS IoT Zero Touch Demo ECCx08A TWI(%02X)%c",
-            g_kit_devices[0].address, KIT_MESSAGE_DELIMITER);
+            AWS_ECCx08A_I2C_ADDRESS, KIT_MESSAGE_DELIMITER);
     
     *message_length = strlen((char*)&message[0]);
 
@@ -1160,6 +1545,7 @@ enum kit_protocol_status kit_board_get_device(uint32_t device_handle,
                                               uint16_t *message_length)
 {
     uint16_t max_message_length = kit_interpreter_get_max_message_length();
+    struct kit_device kit_device;
 
     if ((message == NULL) || (message_length == NULL))
     {
@@ -1171,15 +1557,15 @@ enum kit_protocol_status kit_board_get_device(uint32_t device_handle,
     *message_length = 0;
 
     // Create the Kit Protocol Get Device response message
-    if (g_kit_devices[device_handle].device_id != KIT_DEVICE_ID_UNKNOWN)
+    if (ecc_devices_get_kit_device(device_handle, &kit_device))
     {
         sprintf((char*)&message[0], "ECCx08A TWI(%02X)%c", 
-                g_kit_devices[device_handle].address, 
+                kit_device.address, 
                 KIT_MESSAGE_DELIMITER); 
     }
     else
     {
-        sprintf((char*)&message[0], "no device");
+        sprintf((char*)&message[0], "no device%c", KIT_MESSAGE_DELIMITER);
     }
     
     *message_length = strlen((char*)&message[0]);   
@@ -1187,10 +1573,111 @@ enum kit_protocol_status kit_board_get_device(uint32_t device_handle,
     return KIT_STATUS_SUCCESS;
 }
 
+enum kit_protocol_status kit_board_get_devices(uint8_t *message,
+                                               uint16_t *message_length)
+{
+    uint16_t max_message_length = kit_interpreter_get_max_message_length();
+    struct kit_device kit_device;
+
+    if ((message == NULL) || (message_length == NULL))
+    {
+        return KIT_STATUS_INVALID_PARAM;
+    }
+
+    // Reset the returned message information
+    memset(&message[0], 0, max_message_length);
+    *message_length = 0;
+
+    // Return the device ID, protocol and address of each device, indexed by device handle
+    for (size_t index = 0; ecc_devices_get_kit_device(index, &kit_device); index++)
+    {
+        message[(*message_length)++] = (uint8_t)kit_device.device_id;
+        message[(*message_length)++] = (uint8_t)kit_device.protocol;
+        message[(*message_length)++] = kit_device.address;
+    }
+
+    return KIT_STATUS_SUCCESS;
+}
+
+/**
+ * \brief An AWS IoT Zero Touch board application method registration.
+ */
+struct board_application_method
+{
+    const char *name;                                               //! The JSON-RPC method name
+    enum kit_protocol_status (*process)(JSON_Object *params_object,
+                                        JSON_Object *result_object);  //! Handles the method
+};
+
+//! The AWS IoT Zero Touch board application methods
+static const struct board_application_method g_board_application_methods[] =
+{
+    { "init",            &process_board_application_init },
+    { "setWifi",         &process_board_application_set_wifi },
+    { "getStatus",       &process_board_application_get_status },
+    { "genKey",          &process_board_application_gen_key },
+    { "genCsr",          &process_board_application_gen_csr },
+    { "saveCredentials", &process_board_application_save_credentials },
+    { "resetKit",        &process_board_application_reset_kit },
+    { "benchmarkI2c",    &process_board_application_benchmark_i2c },
+    { "signBatch",       &process_board_application_sign_batch },
+    { "setVerifyMode",   &process_board_application_set_verify_mode }
+};
+
+#define BOARD_APPLICATION_METHODS  (sizeof(g_board_application_methods) / sizeof(g_board_application_methods[0]))
+
+//! The perfect hash table of the board application method names
+static struct kit_protocol_hash_table g_board_application_method_hash;
+
+/**
+ * \brief Generates the board application method lookup table
+ *
+ * \return  Whether the lookup table was generated
+ */
+static bool board_application_init(void)
+{
+    uint32_t keys[BOARD_APPLICATION_METHODS];
+
+    for (size_t index = 0; index < BOARD_APPLICATION_METHODS; index++)
+    {
+        keys[index] = kit_protocol_hash_string(g_board_application_methods[index].name);
+    }
+
+    return kit_protocol_hash_build(&g_board_application_method_hash, keys, BOARD_APPLICATION_METHODS);
+}
+
+/**
+ * \brief Finds the registered board application method
+ *
+ * \param[in] name                  The method name
+ *
+ * \return  The method registration, or NULL if the method is unknown
+ */
+static const struct board_application_method *board_application_find_method(const char *name)
+{
+    int index = -1;
+
+    if (name == NULL)
+    {
+        return NULL;
+    }
+
+    // Confirm the name, another name may hash to the same key
+    index = kit_protocol_hash_find(&g_board_application_method_hash, kit_protocol_hash_string(name));
+    if ((index < 0) || (strcmp(g_board_application_methods[index].name, name) != 0))
+    {
+        return NULL;
+    }
+
+    return &g_board_application_methods[index];
+}
+
 enum kit_protocol_status kit_board_application(uint32_t device_handle,
                                                uint8_t *message,
                                                uint16_t *message_length)
 {
+    const struct board_application_method *method = NULL;
+
     JSON_Value *command_value = NULL;
     JSON_Object *command_object = NULL;
     JSON_Object *params_object = NULL;
@@ -1234,40 +1721,10 @@ enum kit_protocol_status kit_board_application(uint32_t device_handle,
     
 
     // Handle the incoming AWS IoT Zero Touch command message
-    if (strcmp(message_method, "init") == 0)
-    {
-        // Handle the incoming AWS IoT Zero Touch Init command message
-        process_board_application_init(params_object, result_object);
-    }
-    else if (strcmp(message_method, "setWifi") == 0)
-    {
-        // Handle the incoming AWS IoT Zero Touch setWifi command message
-        process_board_application_set_wifi(params_object, result_object);
-    }
-    else if (strcmp(message_method, "getStatus") == 0)
-    {
-        // Handle the incoming AWS IoT Zero Touch getStatus command message
-        process_board_application_get_status(params_object, result_object);
-    }
-    else if (strcmp(message_method, "genKey") == 0)
-    {
-        // Handle the incoming AWS IoT Zero Touch genKey command message
-        process_board_application_gen_key(params_object, result_object);
-    }
-    else if (strcmp(message_method, "genCsr") == 0)
-    {
-        // Handle the incoming AWS IoT Zero Touch genCsr command message
-        process_board_application_gen_csr(params_object, result_object);
-    }
-    else if (strcmp(message_method, "saveCredentials") == 0)
-    {
-        // Handle the incoming AWS IoT Zero Touch saveCredentials command message
-        process_board_application_save_credentials(params_object, result_object);
-    }
-    else if (strcmp(message_method, "resetKit") == 0)
+    method = board_application_find_method(message_method);
+    if (method != NULL)
     {
-        // Handle the incoming AWS IoT Zero Touch resetKit command message
-        process_board_application_reset_kit(params_object, result_object);
+        method->process(params_object, result_object);
     }
     else
     {
@@ -1328,12 +1785,127 @@ enum kit_protocol_status kit_board_application(uint32_t device_handle,
     return KIT_STATUS_SUCCESS;
 }
 
+enum kit_protocol_status kit_board_get_stats(uint8_t *message,
+                                             uint16_t *message_length)
+{
+    JSON_Value *stats_value = NULL;
+    JSON_Object *stats_object = NULL;
+    uint16_t max_message_length = kit_interpreter_get_max_message_length();
+    size_t stats_length = 0;
+
+    if ((message == NULL) || (message_length == NULL))
+    {
+        return KIT_STATUS_INVALID_PARAM;
+    }
+
+    // Reset the returned message information
+    memset(&message[0], 0, max_message_length);
+    *message_length = 0;
+
+    stats_value  = json_value_init_object();
+    stats_object = json_value_get_object(stats_value);
+
+    // Collect the task, heap, parson and ECCx08A device statistics
+    system_stats_get_json(stats_object);
+    ecc_devices_get_json(stats_object);
+    ecc_session_get_json(stats_object);
+    ecc_verify_get_json(stats_object);
+    json_object_set_number(stats_object, "ecc_ready_ms", g_crypto_ready_ms);
+    json_object_set_number(stats_object, "ecc_probe_ms", get_crypto_device_probe()->probe_ms);
+
+    // The response is converted to ASCII hex in place, so only half the buffer is usable
+    stats_length = (json_serialization_size(stats_value) - 1);
+    if (stats_length < (max_message_length / 2))
+    {
+        json_serialize_to_buffer(stats_value, (char*)message, max_message_length);
+        *message_length = (uint16_t)stats_length;
+    }
+
+    // Free allocated memory
+    json_value_free(stats_value);
+
+    return ((*message_length > 0) ? KIT_STATUS_SUCCESS : KIT_STATUS_INVALID_SIZE);
+}
+
+enum kit_protocol_status kit_board_fwupdate(uint8_t *message,
+                                            uint16_t *message_length)
+{
+    enum kit_protocol_status status = KIT_STATUS_SUCCESS;
+    struct firmware_update_stats stats;
+    uint16_t max_message_length = kit_interpreter_get_max_message_length();
+    uint32_t argument = 0;
+    bool result = false;
+
+    if ((message == NULL) || (message_length == NULL))
+    {
+        return KIT_STATUS_INVALID_PARAM;
+    }
+
+    // The command byte is followed by a little endian size or offset
+    if (*message_length >= 5)
+    {
+        argument = ((uint32_t)message[1] << 0) | ((uint32_t)message[2] << 8) |
+                   ((uint32_t)message[3] << 16) | ((uint32_t)message[4] << 24);
+    }
+
+    switch ((*message_length > 0) ? message[0] : 0xFF)
+    {
+    case FIRMWARE_UPDATE_COMMAND_BEGIN:
+        result = (*message_length == (5 + FIRMWARE_UPDATE_DIGEST_SIZE)) &&
+                 firmware_update_begin(argument, &message[5]);
+        break;
+
+    case FIRMWARE_UPDATE_COMMAND_WRITE:
+        result = (*message_length > 5) &&
+                 firmware_update_write(argument, &message[5], (uint32_t)(*message_length - 5));
+        break;
+
+    case FIRMWARE_UPDATE_COMMAND_VERIFY:
+        result = firmware_update_verify();
+        break;
+
+    case FIRMWARE_UPDATE_COMMAND_SWITCH:
+        // The switch happens once this response was sent
+        result = firmware_update_request_switch();
+        break;
+
+    case FIRMWARE_UPDATE_COMMAND_STATUS:
+        result = true;
+        break;
+
+    default:
+        status = KIT_STATUS_INVALID_PARAM;
+        break;
+    }
+
+    if ((status == KIT_STATUS_SUCCESS) && !result)
+    {
+        status = KIT_STATUS_FAILURE;
+    }
+
+    // Reset the returned message information
+    memset(&message[0], 0, max_message_length);
+
+    // Every response reports the update progress, the host times the transfer with it
+    firmware_update_get_stats(&stats);
+    memcpy(&message[0], &stats, sizeof(stats));
+    *message_length = sizeof(stats);
+
+    return status;
+}
+
 enum kit_protocol_status kit_device_idle(uint32_t device_handle)
 {
+    ATCADevice device = ecc_devices_get_device(device_handle);
     ATCA_STATUS status = ATCA_GEN_FAIL;
 
+    if (device == NULL)
+    {
+        return KIT_STATUS_INVALID_ID;
+    }
+
     // Send the idle command to the device
-    status = atcab_idle();
+    status = atidle(atGetIFace(device));
     if (status != ATCA_SUCCESS)
     {
         return KIT_STATUS_COMM_FAIL;
@@ -1344,10 +1916,16 @@ enum kit_protocol_status kit_device_idle(uint32_t device_handle)
 
 enum kit_protocol_status kit_device_sleep(uint32_t device_handle)
 {
+    ATCADevice device = ecc_devices_get_device(device_handle);
     ATCA_STATUS status = ATCA_GEN_FAIL;
 
+    if (device == NULL)
+    {
+        return KIT_STATUS_INVALID_ID;
+    }
+
     // Send the sleep command to the device
-    status = atcab_sleep();
+    status = atsleep(atGetIFace(device));
     if (status != ATCA_SUCCESS)
     {
         return KIT_STATUS_COMM_FAIL;
@@ -1358,10 +1936,16 @@ enum kit_protocol_status kit_device_sleep(uint32_t device_handle)
 
 enum kit_protocol_status kit_device_wake(uint32_t device_handle)
 {
+    ATCADevice device = ecc_devices_get_device(device_handle);
     ATCA_STATUS status = ATCA_GEN_FAIL;
 
+    if (device == NULL)
+    {
+        return KIT_STATUS_INVALID_ID;
+    }
+
     // Send the wakeup command to the device
-    status = atcab_wakeup();
+    status = atwake(atGetIFace(device));
     if (status != ATCA_SUCCESS)
     {
         return KIT_STATUS_COMM_FAIL;
@@ -1370,10 +1954,88 @@ enum kit_protocol_status kit_device_wake(uint32_t device_handle)
     return KIT_STATUS_SUCCESS;
 }
 
-enum kit_protocol_status kit_device_talk(uint32_t device_handle,
+/**
+ * \brief Copies a raw ATECCx08A command packet into a CryptoAuthLib packet
+ *
+ * \param[out] packet               The CryptoAuthLib packet
+ * \param[in]  command              The command packet: count, opcode, param1,
+ *                                  param2, data and CRC, as sent on the wire
+ * \param[in]  command_length       The length, in bytes, of the command packet
+ *
+ * \return  KIT_STATUS_INVALID_SIZE if the count byte does not match the length
+ */
+static enum kit_protocol_status kit_device_load_packet(ATCAPacket *packet,
+                                                      const uint8_t *command,
+                                                      uint16_t command_length)
+{
+    if ((command_length < ATCA_CMD_SIZE_MIN) || (command_length > ATCA_CMD_SIZE_MAX) ||
+        (command[ATCA_COUNT_IDX] != command_length))
+    {
+        return KIT_STATUS_INVALID_SIZE;
+    }
+
+    // The packet starts at the count byte, the I2C word address slot before it is reserved
+    memset(packet, 0, sizeof(*packet));
+    memcpy(&packet->txsize, command, command_length);
+
+    return KIT_STATUS_SUCCESS;
+}
+
+/**
+ * \brief Executes a raw ATECCx08A command packet: wake, send, wait, receive and idle
+ *
+ * \param[in]     device            The device of the pool to execute the command on
+ * \param[in]     command           The command packet, see kit_device_load_packet()
+ * \param[in]     command_length    The length, in bytes, of the command packet
+ * \param[out]    response          The response packet: count, data and CRC
+ * \param[in,out] response_length   IN  - The size of the response buffer
+ *                                  OUT - The length, in bytes, of the response packet
+ *
+ * \return  KIT_STATUS_SUCCESS also when the device returned an error packet,
+ *          the host decodes the device status from the response
+ */
+static enum kit_protocol_status kit_device_execute(ATCADevice device,
+                                                   const uint8_t *command,
+                                                   uint16_t command_length,
+                                                   uint8_t *response,
+                                                   uint16_t *response_length)
+{
+    enum kit_protocol_status kit_status = KIT_STATUS_SUCCESS;
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+    ATCAPacket packet;
+
+    kit_status = kit_device_load_packet(&packet, command, command_length);
+    if (kit_status != KIT_STATUS_SUCCESS)
+    {
+        return kit_status;
+    }
+
+    status = atca_execute_command(&packet, device);
+    if ((status != ATCA_SUCCESS) && (packet.data[ATCA_COUNT_IDX] != 4))
+    {
+        // Only a device error packet is returned, not a communication failure
+        return KIT_STATUS_COMM_FAIL;
+    }
+
+    if ((packet.data[ATCA_COUNT_IDX] > sizeof(packet.data)) ||
+        (packet.data[ATCA_COUNT_IDX] > *response_length))
+    {
+        return KIT_STATUS_INVALID_SIZE;
+    }
+
+    // Return the response
+    *response_length = packet.data[ATCA_COUNT_IDX];
+    memcpy(response, packet.data, *response_length);
+
+    return KIT_STATUS_SUCCESS;
+}
+
+enum kit_protocol_status kit_device_send(uint32_t device_handle,
                                          uint8_t *message,
                                          uint16_t *message_length)
 {
+    enum kit_protocol_status kit_status = KIT_STATUS_SUCCESS;
+    ATCADevice device = ecc_devices_get_device(device_handle);
     ATCA_STATUS status = ATCA_GEN_FAIL;
     ATCAPacket packet;
 
@@ -1382,46 +2044,245 @@ enum kit_protocol_status kit_device_talk(uint32_t device_handle,
         return KIT_STATUS_INVALID_PARAM;
     }
 
-    if (*message_length > sizeof(packet) - 1)
+    if (device == NULL)
     {
-        // Message length is longer than the max expected packet length
-        return KIT_STATUS_INVALID_SIZE;
+        return KIT_STATUS_INVALID_ID;
     }
 
-    memset(&packet, 0, sizeof(packet));
-    memcpy(&packet.opcode, message, *message_length);
+    kit_status = kit_device_load_packet(&packet, message, *message_length);
+    if (kit_status != KIT_STATUS_SUCCESS)
+    {
+        return kit_status;
+    }
 
-    status = atca_execute_command(&packet, atcab_get_device());
+    // Send the command to the awake device, the host wakes it and waits out the execution time
+    status = atsend(atGetIFace(device), (uint8_t*)&packet, packet.txsize);
     if (status != ATCA_SUCCESS)
     {
-        if (packet.data[ATCA_COUNT_IDX] == 4)
+        return KIT_STATUS_COMM_FAIL;
+    }
+
+    *message_length = 0;
+
+    return KIT_STATUS_SUCCESS;
+}
+
+enum kit_protocol_status kit_device_receive(uint32_t device_handle,
+                                            uint8_t *message,
+                                            uint16_t *message_length)
+{
+    ATCADevice device = ecc_devices_get_device(device_handle);
+    ATCA_STATUS status = ATCA_GEN_FAIL;
+    uint16_t receive_length = ATCA_RSP_SIZE_MAX;
+
+    if ((message == NULL) || (message_length == NULL))
+    {
+        return KIT_STATUS_INVALID_PARAM;
+    }
+
+    if (device == NULL)
+    {
+        return KIT_STATUS_INVALID_ID;
+    }
+
+    // Receive the response to the command sent before
+    status = atreceive(atGetIFace(device), message, &receive_length);
+    if ((status != ATCA_SUCCESS) || (message[ATCA_COUNT_IDX] > ATCA_RSP_SIZE_MAX))
+    {
+        *message_length = 0;
+        return KIT_STATUS_COMM_FAIL;
+    }
+
+    *message_length = message[ATCA_COUNT_IDX];
+
+    return KIT_STATUS_SUCCESS;
+}
+
+enum kit_protocol_status kit_device_talk(uint32_t device_handle,
+                                         uint8_t *message,
+                                         uint16_t *message_length)
+{
+    ATCADevice device = ecc_devices_get_device(device_handle);
+    uint8_t response[ATCA_RSP_SIZE_MAX];
+    uint16_t response_length = sizeof(response);
+    enum kit_protocol_status status = KIT_STATUS_SUCCESS;
+
+    if ((message == NULL) || (message_length == NULL))
+    {
+        return KIT_STATUS_INVALID_PARAM;
+    }
+
+    if (device == NULL)
+    {
+        return KIT_STATUS_INVALID_ID;
+    }
+
+    status = kit_device_execute(device, message, *message_length, response, &response_length);
+    if (status != KIT_STATUS_SUCCESS)
+    {
+        return status;
+    }
+
+    // Return the response
+    *message_length = response_length;
+    memcpy(message, response, response_length);
+    
+    return KIT_STATUS_SUCCESS;
+}
+
+enum kit_protocol_status kit_device_talk_batch(uint32_t device_handle,
+                                               uint8_t *message,
+                                               uint16_t *message_length)
+{
+    enum kit_protocol_status status = KIT_STATUS_SUCCESS;
+    ATCADevice device = ecc_devices_get_device(device_handle);
+    uint16_t max_message_length = kit_interpreter_get_max_message_length();
+    uint16_t max_response_length = kit_interpreter_get_max_response_length();
+    uint16_t command_offset = 0;
+    uint16_t command_length = 0;
+    uint16_t response_offset = 0;
+    uint16_t response_length = 0;
+
+    if ((message == NULL) || (message_length == NULL) || (*message_length > max_message_length))
+    {
+        return KIT_STATUS_INVALID_PARAM;
+    }
+
+    if (device == NULL)
+    {
+        return KIT_STATUS_INVALID_ID;
+    }
+
+    /**
+     * Move the command packets to the end of the buffer, so the responses are
+     * written from the front without a second buffer. A response may only use
+     * the space up to the next command packet.
+     */
+    command_offset = (max_message_length - *message_length);
+    memmove(&message[command_offset], &message[0], *message_length);
+
+    // Execute the command packets back to back, stop at the first failure
+    while (command_offset < max_message_length)
+    {
+        command_length = message[command_offset + ATCA_COUNT_IDX];
+        if ((command_length == 0) || (command_length > (max_message_length - command_offset)))
         {
-            // Want to return the device error and not raise a kit error
-            status = KIT_STATUS_SUCCESS;
+            status = KIT_STATUS_INVALID_SIZE;
+            break;
         }
-        else
+
+        // Do not execute a command whose longest response could not be returned
+        response_length = (min((command_offset + command_length), max_response_length) - response_offset);
+        if (response_length < ATCA_RSP_SIZE_MAX)
         {
-            return KIT_STATUS_COMM_FAIL;
+            status = KIT_STATUS_INVALID_SIZE;
+            break;
         }
+
+        status = kit_device_execute(device, &message[command_offset], command_length,
+                                    &message[response_offset], &response_length);
+        if (status != KIT_STATUS_SUCCESS)
+        {
+            break;
+        }
+
+        command_offset += command_length;
+        response_offset += response_length;
     }
 
-    // Return the response
-    *message_length = packet.data[ATCA_COUNT_IDX];
-    memcpy(message, packet.data, *message_length);
+    // Return the responses of the executed commands, one count prefixed packet each
+    *message_length = response_offset;
+
+    return status;
+}
+
+/**
+ * \brief Called from the PIOA interrupt when SW0 is pressed
+ */
+static void provisioning_sw0_handler(uint32_t id, uint32_t mask)
+{
+    if ((id == PIN_SW0_ID) && (mask == PIN_SW0_MASK))
+    {
+        aws_event_post_from_isr(g_provisioning_event_queue, AWS_EVENT_SW0_PRESSED, 0);
+    }
+}
+
+/**
+ * \brief Enables the SW0 interrupt used to confirm the automatic configuration
+ */
+static void provisioning_sw0_enable(void)
+{
+    pmc_enable_periph_clk(PIN_SW0_ID);
+    pio_handler_set(PIN_SW0_PIO, PIN_SW0_ID, PIN_SW0_MASK, PROVISIONING_SW0_ATTR,
+                    &provisioning_sw0_handler);
+    NVIC_EnableIRQ((IRQn_Type)PIN_SW0_ID);
+    pio_handler_set_priority(PIN_SW0_PIO, (IRQn_Type)PIN_SW0_ID, PROVISIONING_SW0_PRIORITY);
+    pio_enable_interrupt(PIN_SW0_PIO, PIN_SW0_MASK);
+}
+
+/**
+ * \brief Handles the Kit Protocol command message received over USB
+ */
+static void provisioning_handle_usb_message(void)
+{
+    bool response_sent = false;
+
+    // Obtain the provisioning mutex
+    xSemaphoreTake(g_provisioning_mutex, portMAX_DELAY);
+
+    // Turn the processing LED on
+    led_set_processing_state(PROCESSING_LED_ON);
     
-    return KIT_STATUS_SUCCESS;
+    // Print the incoming command message
+    console_print_kit_protocol_message("Incoming Kit Protocol command message:",
+                                       g_usb_message_buffer, g_usb_message_buffer_length);
+    
+    kit_interpreter_handle_message((char*)g_usb_message_buffer, &g_usb_message_buffer_length);
+
+    // Print the outgoing response message
+    console_print_kit_protocol_message("Outgoing Kit Protocol response message:",
+                                       g_usb_message_buffer, g_usb_message_buffer_length);
+    
+    // Send the AWS IoT Zero Touch response message
+    response_sent = usb_send_response_message(g_usb_message_buffer, g_usb_message_buffer_length);
+    if (response_sent == false)
+    {
+        // Print error message
+        console_print_error_message("Unable to send the outgoing Kit Protocol response message.");
+    }
+    // Reset message buffer, a message the host sent meanwhile is handled next
+    usb_hid_release_message();
+
+    // Turn the processing LED off
+    led_set_processing_state(PROCESSING_LED_OFF);
+
+    // Release the provisioning mutex
+    xSemaphoreGive(g_provisioning_mutex);
+
+    if (firmware_update_is_switch_pending())
+    {
+        console_print_message("Switching to the updated firmware.");
+
+        // Only returns when the switch failed, the board resets into the
+        // boot sector that copies the new firmware otherwise
+        firmware_update_switch();
+        console_print_error_message("Failed to switch to the updated firmware.");
+    }
 }
 
 void provisioning_task(void *params)
 {
     ATCA_STATUS status = ATCA_SUCCESS;
     bool device_provisioned = false;
-    enum aws_iot_state wifi_state;
-    bool response_sent = false;
-    static int loops = 20;
+    enum aws_iot_state previous_state = AWS_STATE_UNKNOWN;
+    struct aws_event event = {AWS_EVENT_TIMEOUT, 0};
+    bool usb_message_pending = false;
+    char message[96];
 
     do
     {
+        previous_state = g_provisioning_state;
+
         // The state machine for the provisioning task
         switch (g_provisioning_state)
         {
@@ -1438,6 +2299,9 @@ void provisioning_task(void *params)
             {
                 // Un-configured device found
                 g_provisioning_state = AWS_STATE_ATECCx08A_PRECONFIGURE;
+
+                // Wait for SW0 to be pressed
+                provisioning_sw0_enable();
             }
             else if(status == ATCA_NO_DEVICES)
             {
@@ -1487,8 +2351,8 @@ void provisioning_task(void *params)
             
         case AWS_STATE_ATECCx08A_PRECONFIGURE:
         
-        //print once every 25 times through so as not to flood the console with messages
-        if( !(loops%25) )
+        //print on entry and then on every reminder timeout so as not to flood the console with messages
+        if (event.type == AWS_EVENT_TIMEOUT)
         {
             console_print_warning_message("Unconfigured CryptoAuth board found.");
             console_print_warning_message("Auto-configuring the attached CryptoAuth Board will lock the Config and Data zones.");
@@ -1497,7 +2361,7 @@ void provisioning_task(void *params)
         }
         
         //do the preconfiguration once SW0 is pressed
-        if( ioport_get_pin_level(SW0_PIN) == SW0_ACTIVE )
+        if (event.type == AWS_EVENT_SW0_PRESSED)
         {
             status = preconfigure_crypto_device();
             if(status == ATCA_SUCCESS)
@@ -1530,6 +2394,10 @@ void provisioning_task(void *params)
 
             // Initialize the Kit Protocol interpreter
             kit_protocol_init();
+            if (board_application_init() == false)
+            {
+                console_print_error_message("Unable to register the AWS IoT Zero Touch command messages.");
+            }
 
             // Initialize the CryptoAuthLib library
             status = cryptoauthlib_init();
@@ -1542,6 +2410,16 @@ void provisioning_task(void *params)
 
                 console_print_warning_message("The ATECCx08A device has not been provisioned. Waiting ...");
 
+                // Report the time to ready, the board is often power-cycled
+                g_crypto_ready_ms = (xTaskGetTickCount() * portTICK_PERIOD_MS);
+                sprintf(message, "The ATECCx08A was ready %lu ms after boot, its detection took %lu ms.",
+                        (unsigned long)g_crypto_ready_ms,
+                        (unsigned long)get_crypto_device_probe()->probe_ms);
+                console_print_message(message);
+
+                // Let the AWS WIFI task initialize the WINC1500
+                aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_CRYPTO_READY, 0);
+
                 // Set the next provisioning state
                 g_provisioning_state = AWS_STATE_ATECCx08A_CONFIGURE;
             }
@@ -1572,26 +2450,19 @@ void provisioning_task(void *params)
                 AWS_STATUS_SUCCESS,
                 "The AWS IoT Zero Touch Demo ATECCx08A device has been successfully provisioned.");
                
-                wifi_state = aws_wifi_get_state();
-                if (wifi_state > AWS_STATE_WIFI_DISCONNECT && wifi_state != AWS_STATE_AWS_DISCONNECT)
-                {
-                    // Re-provisioned, reconnect wifi
-                    aws_wifi_set_state(AWS_STATE_AWS_DISCONNECT);
-                    g_provisioning_state = AWS_STATE_ATECCx08A_CONFIGURE;
-                }
-                else
-                {
-                    // Set the next provisioning state
-                    g_provisioning_state = AWS_STATE_ATECCx08A_PROVISIONED;
-                }
+                // Let the AWS WIFI task connect, or reconnect if it was re-provisioned
+                aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_PROVISIONED, 0);
+
+                // Set the next provisioning state
+                g_provisioning_state = AWS_STATE_ATECCx08A_PROVISIONED;
             }
             break;
             
         case AWS_STATE_ATECCx08A_PROVISIONED:
             /**
-             * Do nothing.  This state is here to provide a state for the 
-             * WIFI task to check, before starting the WINC1500 initialization 
-             * and startup process
+             * Do nothing.  The AWS WIFI task was notified with the
+             * AWS_EVENT_PROVISIONED event, a new saveCredentials message
+             * moves back to the configure state
              */
             break;
         
@@ -1599,7 +2470,7 @@ void provisioning_task(void *params)
             // The ATECCx08A provisioned device configuration has been reset
             
             // Force the AWS WIFI task to disconnect and reset
-            aws_wifi_set_state(AWS_STATE_AWS_DISCONNECT);
+            aws_event_post(g_aws_wifi_event_queue, AWS_EVENT_PROVISION_RESET, 0);
             
             // Set the state to start the ATECCx08A device provisioning process
             g_provisioning_state = AWS_STATE_ATECCx08A_CONFIGURE;
@@ -1609,48 +2480,38 @@ void provisioning_task(void *params)
             // Do nothing
             break;
         }
-    
-        // Check if a USB Kit Protocol command message was received
-        if ((g_provisioning_state > AWS_STATE_ATECCx08A_INIT) && 
-            (g_usb_message_received == true))
-        {
-            // Obtain the provisioning mutex
-            xSemaphoreTake(g_provisioning_mutex, portMAX_DELAY);
-    
-            // Turn the processing LED on
-            led_set_processing_state(PROCESSING_LED_ON);
-            
-            // Print the incoming command message
-            console_print_kit_protocol_message("Incoming Kit Protocol command message:",
-                                               g_usb_message_buffer, g_usb_message_buffer_length);
-            
-            kit_interpreter_handle_message((char*)g_usb_message_buffer, &g_usb_message_buffer_length);
 
-            // Print the outgoing response message
-            console_print_kit_protocol_message("Outgoing Kit Protocol response message:",
-                                               g_usb_message_buffer, g_usb_message_buffer_length);
-            
-            // Send the AWS IoT Zero Touch response message
-            response_sent = usb_send_response_message(g_usb_message_buffer, g_usb_message_buffer_length);
-            if (response_sent == false)
-            {
-                // Print error message
-                console_print_error_message("Unable to send the outgoing Kit Protocol response message.");
-            }
-            // Reset message buffer
-            g_usb_message_buffer_length = 0;
-            g_usb_message_received = false;
+        // Answer a USB Kit Protocol command message, it stays pending until the ATECCx08A is initialized
+        if ((g_provisioning_state > AWS_STATE_ATECCx08A_INIT) && usb_message_pending)
+        {
+            usb_message_pending = false;
+            provisioning_handle_usb_message();
+        }
 
-            // Turn the processing LED off
-            led_set_processing_state(PROCESSING_LED_OFF);
+        // Run the next state right away, otherwise wait for the next event
+        if (g_provisioning_state != previous_state)
+        {
+            event.type = AWS_EVENT_TIMEOUT;
+            continue;
+        }
 
-            // Release the provisioning mutex
-            xSemaphoreGive(g_provisioning_mutex);
+        if (g_provisioning_state == AWS_STATE_ATECCx08A_PRECONFIGURE)
+        {
+            aws_event_wait(g_provisioning_event_queue, &event, PROVISIONING_PRECONFIGURE_REMINDER_MS);
+        }
+        else if (g_provisioning_state == AWS_STATE_ATECCx08A_CONFIGURE)
+        {
+            // Keep checking whether the ATECCx08A was provisioned
+            aws_event_wait(g_provisioning_event_queue, &event, PROVISIONING_CONFIGURE_POLL_MS);
+        }
+        else
+        {
+            aws_event_wait(g_provisioning_event_queue, &event, portMAX_DELAY);
         }
 
-        // Delay the Provisioning task
-        vTaskDelay(PROVISIONING_TASK_DELAY);
-       
-        loops++;
+        if (event.type == AWS_EVENT_USB_MESSAGE)
+        {
+            usb_message_pending = true;
+        }
     } while (true);
 }
@@ -59,7 +59,6 @@
 #define ECCx08A_DEFAULT_ADDRESS  (uint8_t)(0xC0)  //! Default I2C address for unconfigured ECCx08A crypto devices
 #define AWS_WINC_ECC508A_I2C_ADDRESS (uint8_t)(0xC2) //! AWS WINC1500 ECC508A device address
 #define AWS_ECCx08A_I2C_ADDRESS  (uint8_t)(0xB0)  //! AWS ECCx08A device I2C address
-#define AWS_KIT_DEVICES_MAX      (1)              //! Maximum number of AWS Kit CryptoAuth devices
 
 
 // Externs
@@ -78,9 +77,6 @@ struct Eccx08A_Slot8_Metadata
     uint8_t  hostname[SLOT8_HOSTNAME_SIZE];
 };
 
-enum aws_iot_state provisioning_get_state(void);
-
-
 ATCA_STATUS provisioning_get_serial_number(uint32_t *serial_number_length, 
                                            uint8_t *serial_number);
 ATCA_STATUS provisioning_get_signer_ca_public_key(uint32_t *public_key_length,
@@ -97,16 +93,31 @@ enum kit_protocol_status kit_board_get_firmware(uint8_t *message,
 enum kit_protocol_status kit_board_get_device(uint32_t device_handle,
                                               uint8_t *message,
                                               uint16_t *message_length);
+enum kit_protocol_status kit_board_get_devices(uint8_t *message,
+                                               uint16_t *message_length);
 enum kit_protocol_status kit_board_application(uint32_t device_handle,
                                                uint8_t *message,
                                                uint16_t *message_length);
+enum kit_protocol_status kit_board_get_stats(uint8_t *message,
+                                             uint16_t *message_length);
+enum kit_protocol_status kit_board_fwupdate(uint8_t *message,
+                                            uint16_t *message_length);
 
 enum kit_protocol_status kit_device_idle(uint32_t device_handle);
 enum kit_protocol_status kit_device_sleep(uint32_t device_handle);
 enum kit_protocol_status kit_device_wake(uint32_t device_handle);
+enum kit_protocol_status kit_device_receive(uint32_t device_handle,
+                                            uint8_t *message,
+                                            uint16_t *message_length);
+enum kit_protocol_status kit_device_send(uint32_t device_handle,
+                                         uint8_t *message,
+                                         uint16_t *message_length);
 enum kit_protocol_status kit_device_talk(uint32_t device_handle,
                                          uint8_t *message,
                                          uint16_t *message_length);
+enum kit_protocol_status kit_device_talk_batch(uint32_t device_handle,
+                                               uint8_t *message,
+                                               uint16_t *message_length);
 
 void provisioning_task(void *params);
 
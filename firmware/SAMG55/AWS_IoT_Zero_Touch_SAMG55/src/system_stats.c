@@ -0,0 +1,258 @@
+/**
+ * \file
+ * \brief System Runtime Statistics Functions
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asf.h"
+#include "aws_event.h"
+#include "aws_keepalive.h"
+#include "aws_publish_queue.h"
+#include "system_stats.h"
+
+// Defines
+#define PARSON_ALLOC_HEADER_SIZE  (8)  // Keeps the parson allocations 8-byte aligned
+
+
+// Global variables
+static struct parson_alloc_stats g_parson_alloc_stats;
+static TaskStatus_t g_task_status[SYSTEM_STATS_TASKS_MAX];
+
+/**
+ * \brief Allocates memory for parson and counts the allocation
+ *
+ * The size of the block is kept in front of the returned pointer so the
+ * free can account for the bytes released.
+ */
+static void * system_stats_parson_malloc(size_t size)
+{
+    uint8_t *block = malloc(size + PARSON_ALLOC_HEADER_SIZE);
+
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    *(uint32_t*)block = (uint32_t)size;
+
+    taskENTER_CRITICAL();
+    g_parson_alloc_stats.alloc_count++;
+    g_parson_alloc_stats.bytes_in_use += (uint32_t)size;
+    if (g_parson_alloc_stats.bytes_in_use > g_parson_alloc_stats.bytes_peak)
+    {
+        g_parson_alloc_stats.bytes_peak = g_parson_alloc_stats.bytes_in_use;
+    }
+    taskEXIT_CRITICAL();
+
+    return (block + PARSON_ALLOC_HEADER_SIZE);
+}
+
+/**
+ * \brief Frees memory allocated by system_stats_parson_malloc()
+ */
+static void system_stats_parson_free(void *memory)
+{
+    uint8_t *block = NULL;
+
+    if (memory == NULL)
+    {
+        return;
+    }
+    block = ((uint8_t*)memory - PARSON_ALLOC_HEADER_SIZE);
+
+    taskENTER_CRITICAL();
+    g_parson_alloc_stats.free_count++;
+    g_parson_alloc_stats.bytes_in_use -= *(uint32_t*)block;
+    taskEXIT_CRITICAL();
+
+    free(block);
+}
+
+/**
+ * \brief Gets the name of a FreeRTOS task state
+ */
+static const char * system_stats_get_task_state_name(eTaskState state)
+{
+    switch (state)
+    {
+    case eRunning:
+        return "running";
+
+    case eReady:
+        return "ready";
+
+    case eBlocked:
+        return "blocked";
+
+    case eSuspended:
+        return "suspended";
+
+    case eDeleted:
+        return "deleted";
+
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * \brief Initializes the system statistics
+ *
+ * \note Must be called before the first parson allocation.
+ */
+void system_stats_init(void)
+{
+    memset(&g_parson_alloc_stats, 0, sizeof(g_parson_alloc_stats));
+
+    // Count the parson allocations
+    json_set_allocation_functions(&system_stats_parson_malloc, &system_stats_parson_free);
+}
+
+/**
+ * \brief Gets the FreeRTOS run time statistics counter
+ *
+ * The RTT is free running from the slow clock, so the counter keeps counting
+ * during the tickless idle and the idle task is credited for the time slept.
+ * The 1ms resolution is coarse compared to a task switch, but as the switches
+ * are not synchronized to the RTT the error averages out.
+ */
+uint32_t system_stats_get_run_time_counter(void)
+{
+    return rtt_read_timer_value(RTT);
+}
+
+/**
+ * \brief Gets the parson allocation statistics
+ *
+ * \param[out] stats                The parson allocation statistics
+ */
+void system_stats_get_parson_stats(struct parson_alloc_stats *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    memcpy(stats, &g_parson_alloc_stats, sizeof(*stats));
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * \brief Adds the task, heap and parson statistics to a JSON object
+ *
+ * CPU usage is in percent of the total run time since boot, stack space is
+ * the minimum ever free stack in bytes.
+ *
+ * \param[out] stats_object         The JSON object receiving the statistics
+ */
+void system_stats_get_json(JSON_Object *stats_object)
+{
+    JSON_Value *tasks_value = NULL;
+    JSON_Array *tasks_array = NULL;
+    JSON_Value *task_value = NULL;
+    JSON_Object *task_object = NULL;
+    UBaseType_t task_count = 0;
+    uint32_t total_run_time = 0;
+    struct parson_alloc_stats parson_stats;
+    struct aws_publish_queue_stats publish_queue_stats;
+    struct aws_keepalive_stats keepalive_stats;
+    struct mallinfo malloc_info;
+
+    if (stats_object == NULL)
+    {
+        return;
+    }
+
+    // FreeRTOS task statistics
+    task_count = uxTaskGetSystemState(g_task_status, SYSTEM_STATS_TASKS_MAX, &total_run_time);
+
+    tasks_value = json_value_init_array();
+    tasks_array = json_value_get_array(tasks_value);
+    for (UBaseType_t task = 0; task < task_count; task++)
+    {
+        task_value = json_value_init_object();
+        task_object = json_value_get_object(task_value);
+
+        json_object_set_string(task_object, "name", g_task_status[task].pcTaskName);
+        json_object_set_string(task_object, "state",
+                               system_stats_get_task_state_name(g_task_status[task].eCurrentState));
+        json_object_set_number(task_object, "priority", g_task_status[task].uxCurrentPriority);
+        json_object_set_number(task_object, "cpu",
+                               ((total_run_time > 0) ?
+                                (((double)g_task_status[task].ulRunTimeCounter * 100.0) / total_run_time) : 0));
+        json_object_set_number(task_object, "stack_free",
+                               g_task_status[task].usStackHighWaterMark * sizeof(StackType_t));
+
+        json_array_append_value(tasks_array, task_value);
+    }
+    json_object_set_value(stats_object, "tasks", tasks_value);
+    json_object_set_number(stats_object, "run_time", total_run_time);
+
+    // FreeRTOS heap statistics, heap_1 never frees so the current free size is also the minimum
+    json_object_dotset_number(stats_object, "rtos_heap.free", xPortGetFreeHeapSize());
+    json_object_dotset_number(stats_object, "rtos_heap.min_free", xPortGetFreeHeapSize());
+
+    // C library heap statistics
+    malloc_info = mallinfo();
+    json_object_dotset_number(stats_object, "malloc_heap.arena", malloc_info.arena);
+    json_object_dotset_number(stats_object, "malloc_heap.in_use", malloc_info.uordblks);
+    json_object_dotset_number(stats_object, "malloc_heap.free", malloc_info.fordblks);
+
+    // Parson allocation statistics
+    system_stats_get_parson_stats(&parson_stats);
+    json_object_dotset_number(stats_object, "parson.allocs", parson_stats.alloc_count);
+    json_object_dotset_number(stats_object, "parson.frees", parson_stats.free_count);
+    json_object_dotset_number(stats_object, "parson.bytes_in_use", parson_stats.bytes_in_use);
+    json_object_dotset_number(stats_object, "parson.bytes_peak", parson_stats.bytes_peak);
+
+    // Task events lost because a queue was full
+    json_object_dotset_number(stats_object, "events.dropped", aws_event_get_dropped_count());
+
+    // Offline publish queue statistics
+    aws_publish_queue_get_stats(&publish_queue_stats);
+    json_object_dotset_number(stats_object, "publish_queue.ram_depth", publish_queue_stats.ram_depth);
+    json_object_dotset_number(stats_object, "publish_queue.flash_depth", publish_queue_stats.flash_depth);
+    json_object_dotset_number(stats_object, "publish_queue.max_depth", publish_queue_stats.max_depth);
+    json_object_dotset_number(stats_object, "publish_queue.queued", publish_queue_stats.queued_count);
+    json_object_dotset_number(stats_object, "publish_queue.spills", publish_queue_stats.spill_count);
+    json_object_dotset_number(stats_object, "publish_queue.drops", publish_queue_stats.drop_count);
+    json_object_dotset_number(stats_object, "publish_queue.erases", publish_queue_stats.erase_count);
+    json_object_dotset_number(stats_object, "publish_queue.mark_failures", publish_queue_stats.mark_fail_count);
+    json_object_dotset_number(stats_object, "publish_queue.drained", publish_queue_stats.drain_count);
+    json_object_dotset_number(stats_object, "publish_queue.drain_ms", publish_queue_stats.drain_ms);
+
+    // Adaptive MQTT keep alive statistics
+    aws_keepalive_get_stats(&keepalive_stats);
+    json_object_dotset_number(stats_object, "keepalive.interval_s", keepalive_stats.interval_s);
+    json_object_dotset_number(stats_object, "keepalive.max_s", keepalive_stats.max_s);
+    json_object_dotset_number(stats_object, "keepalive.good_s", keepalive_stats.good_s);
+    json_object_dotset_number(stats_object, "keepalive.bad_s", keepalive_stats.bad_s);
+    json_object_dotset_number(stats_object, "keepalive.pingresps", keepalive_stats.pingresp_count);
+    json_object_dotset_number(stats_object, "keepalive.timeouts", keepalive_stats.timeout_count);
+    json_object_dotset_number(stats_object, "keepalive.misses", keepalive_stats.miss_count);
+}
@@ -0,0 +1,54 @@
+/**
+ * \file
+ * \brief System Runtime Statistics Functions
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef SYSTEM_STATS_H
+#define SYSTEM_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parson.h"
+
+// Defines
+#define SYSTEM_STATS_TASKS_MAX  (8)  //! Maximum number of FreeRTOS tasks reported
+
+struct parson_alloc_stats
+{
+    uint32_t alloc_count;  //! Number of parson allocations
+    uint32_t free_count;   //! Number of parson frees
+    uint32_t bytes_in_use; //! Bytes currently allocated by parson
+    uint32_t bytes_peak;   //! Most bytes ever allocated by parson at once
+};
+
+void system_stats_init(void);
+
+uint32_t system_stats_get_run_time_counter(void);
+void system_stats_get_parson_stats(struct parson_alloc_stats *stats);
+
+void system_stats_get_json(JSON_Object *stats_object);
+
+#endif // SYSTEM_STATS_H
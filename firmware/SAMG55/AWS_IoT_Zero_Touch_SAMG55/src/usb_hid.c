@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include "asf.h"
+#include "aws_event.h"
 #include "usb_hid.h"
 #include "kit_protocol_utilities.h"
 
@@ -37,17 +38,38 @@
 #define USB_DELAY              (5 / portTICK_PERIOD_MS)
 
 // Global variables
+//! The two USB message buffers, the next message is received while the previous one is processed
+static uint8_t g_usb_buffers[2][KIT_MESSAGE_SIZE_MAX];
+
 // These variables are used for a message currently being received
-uint8_t  g_usb_rx_buffer[KIT_MESSAGE_SIZE_MAX]; //! USB received message buffer
+uint8_t  *g_usb_rx_buffer = g_usb_buffers[0];   //! USB received message buffer
 uint16_t g_usb_rx_buffer_length = 0;            //! Size of message in buffer
+bool     g_usb_rx_held = false;                 //! Whether a complete message waits for the message buffer
 
 // These are used for the message currently being processed
 bool     g_usb_message_received = false;        //! Whether a complete message was received
-uint8_t  g_usb_message_buffer[KIT_MESSAGE_SIZE_MAX];
+uint8_t  *g_usb_message_buffer = g_usb_buffers[1];
 uint16_t g_usb_message_buffer_length = 0;
 
 bool g_usb_error = false;
 
+/**
+ * \brief Hands the received message over for processing
+ *
+ * The buffers are swapped instead of copying the message.
+ */
+static void usb_hid_swap_buffers(void)
+{
+    uint8_t *buffer = g_usb_message_buffer;
+
+    g_usb_message_buffer = g_usb_rx_buffer;
+    g_usb_message_buffer_length = g_usb_rx_buffer_length;
+    g_usb_message_received = true;
+
+    g_usb_rx_buffer = buffer;
+    g_usb_rx_buffer_length = 0;
+}
+
 /**
  * \brief Initializes the USB HID interface.
  */
@@ -55,9 +77,6 @@ void usb_hid_init(void)
 {
     // Start the USB device stack
     udc_start();
-
-    // Enter sleep mode
-    sleepmgr_enter_sleep();
 }
 
 bool usb_send_response_message(uint8_t *response, uint16_t response_length)
@@ -116,6 +135,34 @@ bool usb_send_response_message(uint8_t *response, uint16_t response_length)
     return usb_report_sent;
 }
 
+/**
+ * \brief Releases the message buffer once its response was sent
+ *
+ * A message the host sent ahead while the previous one was processed is
+ * handed over right away, so the host can pipeline one message.
+ */
+void usb_hid_release_message(void)
+{
+    bool message_received = false;
+
+    taskENTER_CRITICAL();
+    g_usb_message_buffer_length = 0;
+    g_usb_message_received = false;
+    if (g_usb_rx_held)
+    {
+        usb_hid_swap_buffers();
+        g_usb_rx_held = false;
+        message_received = true;
+    }
+    taskEXIT_CRITICAL();
+
+    if (message_received)
+    {
+        // Wake up the provisioning task to handle the held message
+        aws_event_post(g_provisioning_event_queue, AWS_EVENT_USB_MESSAGE, 0);
+    }
+}
+
 /**
  * \brief Callback called when the USB host enables the USB interface.
  *
@@ -150,10 +197,17 @@ void usb_hid_wakeup_callback(void)
 void usb_hid_report_out_callback(uint8_t *report)
 {
     // Handle incoming USB report
+
+    if (g_usb_rx_held)
+    {
+        // The host is more than one message ahead, drop the reports up to the end of its message
+        g_usb_error = (memchr(report, USB_MESSAGE_DELIMITER, UDI_HID_REPORT_OUT_SIZE) == NULL);
+        return;
+    }
     
     for (uint32_t index = 0; index < UDI_HID_REPORT_OUT_SIZE; index++)
     {
-        if (g_usb_rx_buffer_length >= sizeof(g_usb_rx_buffer)-1)
+        if (g_usb_rx_buffer_length >= KIT_MESSAGE_SIZE_MAX-1)
         {
             // Incoming message is too long (corrupted?)
             g_usb_rx_buffer_length = 0;
@@ -169,14 +223,21 @@ void usb_hid_report_out_callback(uint8_t *report)
             // Check if the USB message was received
             if (report[index] == USB_MESSAGE_DELIMITER)
             {
-                // Copy completed message to message buffer
-                g_usb_message_buffer_length = g_usb_rx_buffer_length;
-                memcpy(g_usb_message_buffer, g_usb_rx_buffer, g_usb_rx_buffer_length);
-                g_usb_message_buffer[g_usb_rx_buffer_length] = 0; // Null terminate, just in case
-                g_usb_message_received = true;
+                g_usb_rx_buffer[g_usb_rx_buffer_length] = 0; // Null terminate, just in case
 
-                // Reset receive buffer
-                g_usb_rx_buffer_length = 0;
+                if (g_usb_message_received)
+                {
+                    // Hold the message until the previous one was handled
+                    g_usb_rx_held = true;
+                }
+                else
+                {
+                    // Hand the completed message over, receive the next one in the other buffer
+                    usb_hid_swap_buffers();
+
+                    // Wake up the provisioning task to handle the message
+                    aws_event_post_from_isr(g_provisioning_event_queue, AWS_EVENT_USB_MESSAGE, 0);
+                }
                 break;
             }
         }
@@ -33,7 +33,7 @@
 
 #include "kit_protocol_api.h"
 
-extern uint8_t  g_usb_message_buffer[KIT_MESSAGE_SIZE_MAX];  //! The USB message buffer
+extern uint8_t  *g_usb_message_buffer;                       //! The USB message buffer, KIT_MESSAGE_SIZE_MAX bytes
 extern uint16_t g_usb_message_buffer_length;                 //! The USB message buffer length
 extern bool     g_usb_message_received;                      //! Whether the USB message was received
 
@@ -41,6 +41,7 @@ extern bool     g_usb_message_received;                      //! Whether the USB
 void usb_hid_init(void);
 
 bool usb_send_response_message(uint8_t *response, uint16_t response_length);
+void usb_hid_release_message(void);
 
 bool usb_hid_enable_callback(void);
 void usb_hid_disable_callback(void);
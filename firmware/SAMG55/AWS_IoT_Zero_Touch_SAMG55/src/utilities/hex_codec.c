@@ -0,0 +1,176 @@
+/**
+ * \file
+ * \brief Hex encoding and decoding utility functions
+ *
+ * \copyright (c) 2017-2019 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "hex_codec.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "The hex codec tables hold the digit pairs in little endian memory order"
+#endif
+
+// Expand an entry macro for the 256 byte values at compile time
+#define HEX_CODEC_ROW(entry, high, arg) \
+    entry(((high) << 4) | 0x0, arg), entry(((high) << 4) | 0x1, arg), \
+    entry(((high) << 4) | 0x2, arg), entry(((high) << 4) | 0x3, arg), \
+    entry(((high) << 4) | 0x4, arg), entry(((high) << 4) | 0x5, arg), \
+    entry(((high) << 4) | 0x6, arg), entry(((high) << 4) | 0x7, arg), \
+    entry(((high) << 4) | 0x8, arg), entry(((high) << 4) | 0x9, arg), \
+    entry(((high) << 4) | 0xA, arg), entry(((high) << 4) | 0xB, arg), \
+    entry(((high) << 4) | 0xC, arg), entry(((high) << 4) | 0xD, arg), \
+    entry(((high) << 4) | 0xE, arg), entry(((high) << 4) | 0xF, arg)
+
+#define HEX_CODEC_TABLE(entry, arg) \
+    HEX_CODEC_ROW(entry, 0x0, arg), HEX_CODEC_ROW(entry, 0x1, arg), \
+    HEX_CODEC_ROW(entry, 0x2, arg), HEX_CODEC_ROW(entry, 0x3, arg), \
+    HEX_CODEC_ROW(entry, 0x4, arg), HEX_CODEC_ROW(entry, 0x5, arg), \
+    HEX_CODEC_ROW(entry, 0x6, arg), HEX_CODEC_ROW(entry, 0x7, arg), \
+    HEX_CODEC_ROW(entry, 0x8, arg), HEX_CODEC_ROW(entry, 0x9, arg), \
+    HEX_CODEC_ROW(entry, 0xA, arg), HEX_CODEC_ROW(entry, 0xB, arg), \
+    HEX_CODEC_ROW(entry, 0xC, arg), HEX_CODEC_ROW(entry, 0xD, arg), \
+    HEX_CODEC_ROW(entry, 0xE, arg), HEX_CODEC_ROW(entry, 0xF, arg)
+
+#define HEX_CODEC_DIGIT(nibble, alpha) \
+    (((nibble) < 10) ? ('0' + (nibble)) : ((alpha) + (nibble) - 10))
+
+#define HEX_CODEC_PAIR(value, alpha) \
+    (uint16_t)(HEX_CODEC_DIGIT((value) >> 4, alpha) | (HEX_CODEC_DIGIT((value) & 0x0F, alpha) << 8))
+
+#define HEX_CODEC_NIBBLE(character, unused) \
+    (uint8_t)((((character) >= '0') && ((character) <= '9')) ? ((character) - '0') :      \
+              (((character) >= 'A') && ((character) <= 'F')) ? ((character) - 'A' + 10) : \
+              (((character) >= 'a') && ((character) <= 'f')) ? ((character) - 'a' + 10) : 0)
+
+const uint16_t g_hex_codec_upper[256] = { HEX_CODEC_TABLE(HEX_CODEC_PAIR, 'A') };
+const uint16_t g_hex_codec_lower[256] = { HEX_CODEC_TABLE(HEX_CODEC_PAIR, 'a') };
+
+//! Nibble value of every ASCII hex digit, other characters decode as 0
+static const uint8_t g_hex_codec_nibble[256] = { HEX_CODEC_TABLE(HEX_CODEC_NIBBLE, 0) };
+
+/**
+ * \brief Converts binary data to ASCII hex digits.
+ *
+ * The conversion runs from the end of the data to the start, four bytes at
+ * a time, so the hex buffer may be the binary buffer itself. No terminating
+ * null is written.
+ *
+ * \param[in]  binary      The binary data
+ * \param[in]  length      The length, in bytes, of the binary data
+ * \param[out] hex         The buffer receiving the (length * 2) hex digits,
+ *                         may be the same as the binary buffer
+ * \param[in]  uppercase   Whether to use uppercase hex digits
+ *
+ * \return    The number of hex digits
+ */
+size_t hex_codec_encode(const void *binary, size_t length, char *hex, bool uppercase)
+{
+    const uint16_t *table = uppercase ? g_hex_codec_upper : g_hex_codec_lower;
+    const uint8_t *data = (const uint8_t*)binary;
+    size_t index = length;
+    uint32_t word = 0;
+    uint32_t digits[2];
+    uint16_t pair = 0;
+
+    if ((binary == NULL) || (hex == NULL))
+    {
+        return 0;
+    }
+
+    // Convert the bytes after the last whole word
+    while ((index % 4) != 0)
+    {
+        index--;
+        pair = table[data[index]];
+        memcpy(&hex[index * 2], &pair, sizeof(pair));
+    }
+
+    // Each word is read before its digits are written over it
+    while (index > 0)
+    {
+        index -= 4;
+        memcpy(&word, &data[index], sizeof(word));
+
+        digits[0] = table[word & 0xFF] | ((uint32_t)table[(word >> 8) & 0xFF] << 16);
+        digits[1] = table[(word >> 16) & 0xFF] | ((uint32_t)table[word >> 24] << 16);
+        memcpy(&hex[index * 2], &digits[0], sizeof(digits));
+    }
+
+    return (length * 2);
+}
+
+/**
+ * \brief Converts ASCII hex digits to binary data.
+ *
+ * The conversion runs from the start of the digits, four at a time, so the
+ * binary buffer may be the hex buffer itself. Characters that are not hex
+ * digits decode as 0, an odd last digit is the high nibble of the last byte.
+ *
+ * \param[in]  hex         The ASCII hex digits
+ * \param[in]  length      The number of hex digits
+ * \param[out] binary      The buffer receiving the ((length + 1) / 2) bytes,
+ *                         may be the same as the hex buffer
+ *
+ * \return    The length, in bytes, of the binary data
+ */
+size_t hex_codec_decode(const char *hex, size_t length, void *binary)
+{
+    const uint8_t *digits = (const uint8_t*)hex;
+    uint8_t *data = (uint8_t*)binary;
+    size_t index = 0;
+    uint32_t word = 0;
+    uint16_t pair = 0;
+
+    if ((hex == NULL) || (binary == NULL))
+    {
+        return 0;
+    }
+
+    // Each word is read before its bytes are written over it
+    for (index = 0; (index + 4) <= length; index += 4)
+    {
+        memcpy(&word, &digits[index], sizeof(word));
+
+        pair = (uint16_t)((g_hex_codec_nibble[word & 0xFF] << 4) |
+                          g_hex_codec_nibble[(word >> 8) & 0xFF] |
+                          (g_hex_codec_nibble[(word >> 16) & 0xFF] << 12) |
+                          (g_hex_codec_nibble[word >> 24] << 8));
+        memcpy(&data[index / 2], &pair, sizeof(pair));
+    }
+
+    for (; (index + 2) <= length; index += 2)
+    {
+        data[index / 2] = (uint8_t)((g_hex_codec_nibble[digits[index]] << 4) |
+                                    g_hex_codec_nibble[digits[index + 1]]);
+    }
+
+    if (index < length)
+    {
+        data[index / 2] = (uint8_t)(g_hex_codec_nibble[digits[index]] << 4);
+    }
+
+    return ((length + 1) / 2);
+}
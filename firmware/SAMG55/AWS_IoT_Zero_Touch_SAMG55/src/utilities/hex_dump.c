@@ -27,14 +27,16 @@
 
 #include <ctype.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
+#include "hex_codec.h"
 #include "hex_dump.h"
 
 /**
  * \brief Prints a hex dump of the information in the buffer.
  *
+ * Each line is formatted in a buffer on the stack and printed at once.
+ *
  * \param[in] buffer             The data buffer containing the information
  *                               to be printed
  * \param[in] length             The length, in bytes, of the data buffer
@@ -44,90 +46,80 @@
  * \param[in] display_ascii      Whether to display the data ASCII information
  *                                 TRUE  - The data ASCII information will be displayed
  *                                 FALSE - The data ASCII information will not be displayed
- * \param[in] bytes_line         The number of bytes to display on each line
+ * \param[in] bytes_line         The number of bytes to display on each line,
+ *                               at most HEX_DUMP_BYTES_LINE_MAX
  */
 void print_hex_dump(const void *buffer, size_t length, bool display_address, 
                     bool display_ascii, size_t bytes_line)
 {
-    uint8_t *data = (uint8_t*)buffer;
+    const uint8_t *data = (const uint8_t*)buffer;
     size_t current_position = 0;
-    char *ascii_buffer = NULL;
-    int printable_character = 0;
+    size_t line_length = 0;
+    uint8_t value = 0;
+    // Address, three characters per byte, group spaces, ASCII and line end
+    char line[10 + (HEX_DUMP_BYTES_LINE_MAX * 5) + 4];
 
-    if ((buffer == NULL) || (length == 0))
+    if ((buffer == NULL) || (length == 0) || (bytes_line == 0))
     {
         return;
     }
 
-    // Allocate the memory
-    if (display_ascii == true)
+    if (bytes_line > HEX_DUMP_BYTES_LINE_MAX)
     {
-        ascii_buffer = (char*)malloc((bytes_line + 1));
-        memset(ascii_buffer, ' ', (bytes_line + 1));
+        bytes_line = HEX_DUMP_BYTES_LINE_MAX;
     }
 
     do
     {
+        line_length = 0;
+
         // Display the data address
         if (display_address == true)
         {
-            printf("%08lX  ", (uint32_t)current_position);
+            line_length += sprintf(&line[line_length], "%08lX  ", (unsigned long)current_position);
         }
 
-        for (uint8_t index = 0; index < bytes_line; index++)
+        for (size_t index = 0; index < bytes_line; index++)
         {
             // Add a space after every 8th byte of data
             if ((index > 0) && ((index % 8) == 0))
             {
-                printf(" ");
+                line[line_length++] = ' ';
             }
 
             if ((current_position + index) < length)
             {
-                // Print the hex representation of the data
-                printf("%02X ", data[(current_position + index)]);
-
-                // Check for a printable character
-                if (display_ascii == true)
-                {
-                    printable_character = isprint(data[(current_position + index)]);
-
-                    if (printable_character != 0)
-                    {
-                        ascii_buffer[index] = data[(current_position + index)];
-                    }
-                    else
-                    {
-                        ascii_buffer[index] = '.';
-                    }
-                }
+                // Add the hex representation of the data
+                memcpy(&line[line_length], &g_hex_codec_upper[data[(current_position + index)]], 2);
+                line_length += 2;
             }
             else
             {
                 // Add spaces for the data
-                printf("   ");
+                line[line_length++] = ' ';
+                line[line_length++] = ' ';
             }
+            line[line_length++] = ' ';
         }
 
-        // Print the ASCII representation of the data
+        // Add the ASCII representation of the data
         if (display_ascii == true)
         {
-            ascii_buffer[bytes_line] = '\0';
-            printf(" %s\r\n", ascii_buffer);
-            memset(ascii_buffer, 0, bytes_line);
-        }
-        else
-        {
-            printf("\r\n");
+            line[line_length++] = ' ';
+
+            for (size_t index = 0; (index < bytes_line) && ((current_position + index) < length); index++)
+            {
+                value = data[(current_position + index)];
+                line[line_length++] = (isprint(value) != 0) ? (char)value : '.';
+            }
         }
 
+        line[line_length++] = '\r';
+        line[line_length++] = '\n';
+        line[line_length] = '\0';
+        printf("%s", line);
+
         // Increment the current position
         current_position += bytes_line;
     } while (current_position < length);
-
-    // Free allocated memory
-    if (display_ascii == true)
-    {
-        free(ascii_buffer);
-    }
 }
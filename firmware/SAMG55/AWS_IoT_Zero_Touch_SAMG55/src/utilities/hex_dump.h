@@ -31,6 +31,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#define HEX_DUMP_BYTES_LINE_MAX     (32)    // Longest line, in bytes of data, print_hex_dump() formats
+
 void print_hex_dump(const void *buffer, size_t length, bool display_address, 
                     bool display_ascii, size_t bytes_line);
 
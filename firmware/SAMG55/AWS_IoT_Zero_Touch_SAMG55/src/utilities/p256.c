@@ -0,0 +1,576 @@
+/**
+ * \file
+ * \brief Software P-256 ECDSA signature verification
+ *
+ * \copyright (c) 2015-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "p256.h"
+
+#define P256_LIMBS  (8)     // 32-bit words of a 256-bit number, least significant first
+
+/**
+ * \brief A modulus and the constants of its Montgomery arithmetic.
+ */
+struct p256_modulus
+{
+    uint32_t m[P256_LIMBS];     //! The modulus
+    uint32_t r2[P256_LIMBS];    //! R^2 mod m, with R = 2^256
+    uint32_t inverse;           //! -m^-1 mod 2^32
+};
+
+/**
+ * \brief A point in Jacobian coordinates, the point at infinity has Z = 0.
+ */
+struct p256_point
+{
+    uint32_t x[P256_LIMBS];
+    uint32_t y[P256_LIMBS];
+    uint32_t z[P256_LIMBS];
+};
+
+/**
+ * \brief A point in affine coordinates.
+ */
+struct p256_affine
+{
+    uint32_t x[P256_LIMBS];
+    uint32_t y[P256_LIMBS];
+};
+
+//! The field prime p = 2^256 - 2^224 + 2^192 + 2^96 - 1
+static const struct p256_modulus g_p256_p =
+{
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000, 0x00000001, 0xFFFFFFFF },
+    { 0x00000003, 0x00000000, 0xFFFFFFFF, 0xFFFFFFFB, 0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFD, 0x00000004 },
+    0x00000001
+};
+
+//! The order n of the base point
+static const struct p256_modulus g_p256_n =
+{
+    { 0xFC632551, 0xF3B9CAC2, 0xA7179E84, 0xBCE6FAAD, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF },
+    { 0xBE79EEA2, 0x83244C95, 0x49BD6FA6, 0x4699799C, 0x2B6BEC59, 0x2845B239, 0xF3D95620, 0x66E12D94 },
+    0xEE00BC4F
+};
+
+//! The curve coefficient b, the coefficient a is -3
+static const uint32_t g_p256_b[P256_LIMBS] =
+{
+    0x27D2604B, 0x3BCE3C3E, 0xCC53B0F6, 0x651D06B0, 0x769886BC, 0xB3EBBD55, 0xAA3A93E7, 0x5AC635D8
+};
+
+//! The base point G
+static const struct p256_affine g_p256_g =
+{
+    { 0xD898C296, 0xF4A13945, 0x2DEB33A0, 0x77037D81, 0x63A440F2, 0xF8BCE6E5, 0xE12C4247, 0x6B17D1F2 },
+    { 0x37BF51F5, 0xCBB64068, 0x6B315ECE, 0x2BCE3357, 0x7C0F9E16, 0x8EE7EB4A, 0xFE1A7F9B, 0x4FE342E2 }
+};
+
+
+/**
+ * \brief Reads a 32-byte big endian number
+ */
+static void p256_from_bytes(uint32_t *a, const uint8_t *bytes)
+{
+    for (int limb = 0; limb < P256_LIMBS; limb++)
+    {
+        const uint8_t *word = &bytes[(P256_LIMBS - 1 - limb) * 4];
+
+        a[limb] = ((uint32_t)word[0] << 24) | ((uint32_t)word[1] << 16) |
+                  ((uint32_t)word[2] << 8) | (uint32_t)word[3];
+    }
+}
+
+static bool p256_is_zero(const uint32_t *a)
+{
+    uint32_t bits = 0;
+
+    for (int limb = 0; limb < P256_LIMBS; limb++)
+    {
+        bits |= a[limb];
+    }
+
+    return (bits == 0);
+}
+
+static bool p256_is_equal(const uint32_t *a, const uint32_t *b)
+{
+    return (memcmp(a, b, P256_LIMBS * sizeof(uint32_t)) == 0);
+}
+
+/**
+ * \return  Whether a < b
+ */
+static bool p256_is_less(const uint32_t *a, const uint32_t *b)
+{
+    for (int limb = P256_LIMBS - 1; limb >= 0; limb--)
+    {
+        if (a[limb] != b[limb])
+        {
+            return (a[limb] < b[limb]);
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \return  The carry out of r = a + b
+ */
+static uint32_t p256_add_carry(uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+    uint64_t sum = 0;
+
+    for (int limb = 0; limb < P256_LIMBS; limb++)
+    {
+        sum += (uint64_t)a[limb] + b[limb];
+        r[limb] = (uint32_t)sum;
+        sum >>= 32;
+    }
+
+    return (uint32_t)sum;
+}
+
+/**
+ * \return  The borrow out of r = a - b
+ */
+static uint32_t p256_sub_borrow(uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+    uint64_t difference = 0;
+    uint32_t borrow = 0;
+
+    for (int limb = 0; limb < P256_LIMBS; limb++)
+    {
+        difference = (uint64_t)a[limb] - b[limb] - borrow;
+        r[limb] = (uint32_t)difference;
+        borrow = (uint32_t)(difference >> 32) & 1;
+    }
+
+    return borrow;
+}
+
+/**
+ * \brief r = (a + b) mod m, for a and b below m
+ */
+static void p256_mod_add(uint32_t *r, const uint32_t *a, const uint32_t *b, const struct p256_modulus *m)
+{
+    if (p256_add_carry(r, a, b) || !p256_is_less(r, m->m))
+    {
+        p256_sub_borrow(r, r, m->m);
+    }
+}
+
+/**
+ * \brief r = (a - b) mod m, for a and b below m
+ */
+static void p256_mod_sub(uint32_t *r, const uint32_t *a, const uint32_t *b, const struct p256_modulus *m)
+{
+    if (p256_sub_borrow(r, a, b))
+    {
+        p256_add_carry(r, r, m->m);
+    }
+}
+
+/**
+ * \brief Multiply-accumulate {carry, low word} = a * b + c + carry
+ *
+ * The result always fits in 64 bits. On the Cortex-M4 this is the single
+ * UMAAL instruction of the DSP extension.
+ *
+ * \return  The low word
+ */
+static inline uint32_t p256_mul_add(uint32_t a, uint32_t b, uint32_t c, uint32_t *carry)
+{
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t high = *carry;
+
+    __asm__ ("umaal %0, %1, %2, %3" : "+r" (c), "+r" (high) : "r" (a), "r" (b));
+    *carry = high;
+
+    return c;
+#else
+    uint64_t product = ((uint64_t)a * b) + c + *carry;
+
+    *carry = (uint32_t)(product >> 32);
+
+    return (uint32_t)product;
+#endif // __ARM_FEATURE_DSP
+}
+
+/**
+ * \brief Montgomery multiplication r = a * b / R mod m, for a and b below m
+ *
+ * Word by word (CIOS) so every inner step is one p256_mul_add().
+ * r may be a or b.
+ */
+static void p256_mont_mul(uint32_t *r, const uint32_t *a, const uint32_t *b, const struct p256_modulus *m)
+{
+    uint32_t t[P256_LIMBS + 2];
+    uint64_t accumulator = 0;
+    uint32_t carry = 0;
+    uint32_t q = 0;
+
+    memset(t, 0, sizeof(t));
+
+    for (int i = 0; i < P256_LIMBS; i++)
+    {
+        // t += a * b[i]
+        carry = 0;
+        for (int j = 0; j < P256_LIMBS; j++)
+        {
+            t[j] = p256_mul_add(a[j], b[i], t[j], &carry);
+        }
+        accumulator = (uint64_t)t[P256_LIMBS] + carry;
+        t[P256_LIMBS] = (uint32_t)accumulator;
+        t[P256_LIMBS + 1] = (uint32_t)(accumulator >> 32);
+
+        // t = (t + q * m) / 2^32, with q making the low word zero
+        q = t[0] * m->inverse;
+        carry = 0;
+        p256_mul_add(q, m->m[0], t[0], &carry);
+        for (int j = 1; j < P256_LIMBS; j++)
+        {
+            t[j - 1] = p256_mul_add(q, m->m[j], t[j], &carry);
+        }
+        accumulator = (uint64_t)t[P256_LIMBS] + carry;
+        t[P256_LIMBS - 1] = (uint32_t)accumulator;
+        t[P256_LIMBS] = t[P256_LIMBS + 1] + (uint32_t)(accumulator >> 32);
+    }
+
+    // t is below 2m
+    if ((t[P256_LIMBS] != 0) || !p256_is_less(t, m->m))
+    {
+        p256_sub_borrow(t, t, m->m);
+    }
+
+    memcpy(r, t, P256_LIMBS * sizeof(uint32_t));
+}
+
+static void p256_to_mont(uint32_t *r, const uint32_t *a, const struct p256_modulus *m)
+{
+    p256_mont_mul(r, a, m->r2, m);
+}
+
+/**
+ * \brief r = a^-1 in Montgomery form, by Fermat's little theorem a^(m - 2)
+ *
+ * \note  m is prime and a is not zero, the exponent is public
+ */
+static void p256_mont_inverse(uint32_t *r, const uint32_t *a, const struct p256_modulus *m)
+{
+    static const uint32_t one[P256_LIMBS] = { 1 };
+    static const uint32_t two[P256_LIMBS] = { 2 };
+    uint32_t exponent[P256_LIMBS];
+    uint32_t result[P256_LIMBS];
+
+    p256_sub_borrow(exponent, m->m, two);
+    p256_to_mont(result, one, m);
+
+    for (int bit = (P256_LIMBS * 32) - 1; bit >= 0; bit--)
+    {
+        p256_mont_mul(result, result, result, m);
+        if ((exponent[bit / 32] >> (bit % 32)) & 1)
+        {
+            p256_mont_mul(result, result, a, m);
+        }
+    }
+
+    memcpy(r, result, sizeof(result));
+}
+
+/**
+ * \brief Doubles a point, with a = -3 (dbl-2001-b)
+ */
+static void p256_point_double(struct p256_point *r, const struct p256_point *a)
+{
+    const struct p256_modulus *p = &g_p256_p;
+    uint32_t delta[P256_LIMBS];
+    uint32_t gamma[P256_LIMBS];
+    uint32_t beta[P256_LIMBS];
+    uint32_t alpha[P256_LIMBS];
+    uint32_t t[P256_LIMBS];
+
+    p256_mont_mul(delta, a->z, a->z, p);
+    p256_mont_mul(gamma, a->y, a->y, p);
+    p256_mont_mul(beta, a->x, gamma, p);
+
+    // alpha = 3 * (X - delta) * (X + delta)
+    p256_mod_sub(t, a->x, delta, p);
+    p256_mod_add(alpha, a->x, delta, p);
+    p256_mont_mul(alpha, alpha, t, p);
+    p256_mod_add(t, alpha, alpha, p);
+    p256_mod_add(alpha, alpha, t, p);
+
+    // Z3 = (Y + Z)^2 - gamma - delta
+    p256_mod_add(t, a->y, a->z, p);
+    p256_mont_mul(t, t, t, p);
+    p256_mod_sub(t, t, gamma, p);
+    p256_mod_sub(r->z, t, delta, p);
+
+    // X3 = alpha^2 - 8 * beta
+    p256_mod_add(beta, beta, beta, p);
+    p256_mod_add(beta, beta, beta, p);
+    p256_mont_mul(t, alpha, alpha, p);
+    p256_mod_sub(t, t, beta, p);
+    p256_mod_sub(r->x, t, beta, p);
+
+    // Y3 = alpha * (4 * beta - X3) - 8 * gamma^2
+    p256_mod_sub(t, beta, r->x, p);
+    p256_mont_mul(t, alpha, t, p);
+    p256_mont_mul(gamma, gamma, gamma, p);
+    p256_mod_add(gamma, gamma, gamma, p);
+    p256_mod_add(gamma, gamma, gamma, p);
+    p256_mod_add(gamma, gamma, gamma, p);
+    p256_mod_sub(r->y, t, gamma, p);
+}
+
+/**
+ * \brief Adds an affine point to a point (madd-2007-bl)
+ */
+static void p256_point_add_affine(struct p256_point *r, const struct p256_point *a,
+                                  const struct p256_affine *b, const uint32_t *one)
+{
+    const struct p256_modulus *p = &g_p256_p;
+    uint32_t z1z1[P256_LIMBS];
+    uint32_t h[P256_LIMBS];
+    uint32_t hh[P256_LIMBS];
+    uint32_t i[P256_LIMBS];
+    uint32_t j[P256_LIMBS];
+    uint32_t s[P256_LIMBS];
+    uint32_t v[P256_LIMBS];
+    uint32_t t[P256_LIMBS];
+
+    if (p256_is_zero(a->z))
+    {
+        memcpy(r->x, b->x, sizeof(r->x));
+        memcpy(r->y, b->y, sizeof(r->y));
+        memcpy(r->z, one, sizeof(r->z));
+        return;
+    }
+
+    // H = X2 * Z1^2 - X1, s = 2 * (Y2 * Z1^3 - Y1)
+    p256_mont_mul(z1z1, a->z, a->z, p);
+    p256_mont_mul(h, b->x, z1z1, p);
+    p256_mod_sub(h, h, a->x, p);
+    p256_mont_mul(s, b->y, a->z, p);
+    p256_mont_mul(s, s, z1z1, p);
+    p256_mod_sub(s, s, a->y, p);
+
+    if (p256_is_zero(h))
+    {
+        if (p256_is_zero(s))
+        {
+            // The points are the same
+            p256_point_double(r, a);
+        }
+        else
+        {
+            // The points are opposite
+            memset(r, 0, sizeof(*r));
+        }
+        return;
+    }
+
+    p256_mod_add(s, s, s, p);
+
+    // I = 4 * H^2, J = H * I, V = X1 * I
+    p256_mont_mul(hh, h, h, p);
+    p256_mod_add(i, hh, hh, p);
+    p256_mod_add(i, i, i, p);
+    p256_mont_mul(j, h, i, p);
+    p256_mont_mul(v, a->x, i, p);
+
+    // Z3 = (Z1 + H)^2 - Z1Z1 - HH
+    p256_mod_add(t, a->z, h, p);
+    p256_mont_mul(t, t, t, p);
+    p256_mod_sub(t, t, z1z1, p);
+    p256_mod_sub(r->z, t, hh, p);
+
+    // Y3 = s * (V - X3) - 2 * Y1 * J, with X3 = s^2 - J - 2 * V
+    p256_mont_mul(i, a->y, j, p);
+    p256_mod_add(i, i, i, p);
+    p256_mont_mul(t, s, s, p);
+    p256_mod_sub(t, t, j, p);
+    p256_mod_sub(t, t, v, p);
+    p256_mod_sub(r->x, t, v, p);
+    p256_mod_sub(t, v, r->x, p);
+    p256_mont_mul(t, s, t, p);
+    p256_mod_sub(r->y, t, i, p);
+}
+
+/**
+ * \brief Checks that an affine point in Montgomery form is on the curve
+ */
+static bool p256_is_on_curve(const struct p256_affine *a)
+{
+    const struct p256_modulus *p = &g_p256_p;
+    uint32_t left[P256_LIMBS];
+    uint32_t right[P256_LIMBS];
+    uint32_t t[P256_LIMBS];
+
+    // y^2 = x^3 - 3x + b
+    p256_mont_mul(left, a->y, a->y, p);
+    p256_mont_mul(right, a->x, a->x, p);
+    p256_mont_mul(right, right, a->x, p);
+    p256_mod_add(t, a->x, a->x, p);
+    p256_mod_add(t, t, a->x, p);
+    p256_mod_sub(right, right, t, p);
+    p256_to_mont(t, g_p256_b, p);
+    p256_mod_add(right, right, t, p);
+
+    return p256_is_equal(left, right);
+}
+
+/**
+ * \brief Verifies a P-256 ECDSA signature in software.
+ *
+ * The two scalar multiplications u1*G + u2*Q share their doublings
+ * (Shamir's trick), with G, Q and G+Q added as affine points. The field and
+ * the scalars use Montgomery arithmetic on 32-bit words. The inputs are
+ * public, so the code is not constant time.
+ *
+ * \param[in]  digest      The 32-byte SHA-256 digest that was signed
+ * \param[in]  signature   The 64-byte signature, R and S big endian
+ * \param[in]  public_key  The 64-byte public key, X and Y big endian
+ *
+ * \return  Whether the signature is valid, false for a public key that is
+ *          not on the curve
+ */
+bool p256_verify(const uint8_t *digest, const uint8_t *signature, const uint8_t *public_key)
+{
+    const struct p256_modulus *p = &g_p256_p;
+    const struct p256_modulus *n = &g_p256_n;
+    static const uint32_t one[P256_LIMBS] = { 1 };
+    uint32_t mont_one[P256_LIMBS];
+    uint32_t r[P256_LIMBS];
+    uint32_t s[P256_LIMBS];
+    uint32_t e[P256_LIMBS];
+    uint32_t u1[P256_LIMBS];
+    uint32_t u2[P256_LIMBS];
+    uint32_t t[P256_LIMBS];
+    struct p256_affine points[4];   // Indexed by the u1 bit and the u2 bit, 0 is unused
+    bool has_sum = true;
+    struct p256_point sum;
+    int bits = 0;
+
+    if ((digest == NULL) || (signature == NULL) || (public_key == NULL))
+    {
+        return false;
+    }
+
+    p256_from_bytes(r, &signature[0]);
+    p256_from_bytes(s, &signature[32]);
+    p256_from_bytes(e, digest);
+    p256_from_bytes(points[2].x, &public_key[0]);
+    p256_from_bytes(points[2].y, &public_key[32]);
+
+    // 0 < r, s < n and the public key coordinates are below p
+    if (p256_is_zero(r) || !p256_is_less(r, n->m) || p256_is_zero(s) || !p256_is_less(s, n->m) ||
+        !p256_is_less(points[2].x, p->m) || !p256_is_less(points[2].y, p->m))
+    {
+        return false;
+    }
+
+    // The digest is below 2^256 < 2n
+    if (!p256_is_less(e, n->m))
+    {
+        p256_sub_borrow(e, e, n->m);
+    }
+
+    // u1 = e / s and u2 = r / s mod n, the Montgomery product of a plain number and s^-1*R is plain
+    p256_to_mont(t, s, n);
+    p256_mont_inverse(t, t, n);
+    p256_mont_mul(u1, e, t, n);
+    p256_mont_mul(u2, r, t, n);
+
+    // The points G, Q and G + Q in Montgomery form
+    p256_to_mont(mont_one, one, p);
+    p256_to_mont(points[1].x, g_p256_g.x, p);
+    p256_to_mont(points[1].y, g_p256_g.y, p);
+    p256_to_mont(points[2].x, points[2].x, p);
+    p256_to_mont(points[2].y, points[2].y, p);
+    if (!p256_is_on_curve(&points[2]))
+    {
+        return false;
+    }
+
+    memcpy(sum.x, points[1].x, sizeof(sum.x));
+    memcpy(sum.y, points[1].y, sizeof(sum.y));
+    memcpy(sum.z, mont_one, sizeof(sum.z));
+    p256_point_add_affine(&sum, &sum, &points[2], mont_one);
+    if (p256_is_zero(sum.z))
+    {
+        // Q = -G, adding both leaves the sum unchanged
+        has_sum = false;
+    }
+    else
+    {
+        // x = X / Z^2, y = Y / Z^3
+        p256_mont_inverse(t, sum.z, p);
+        p256_mont_mul(sum.z, t, t, p);
+        p256_mont_mul(points[3].x, sum.x, sum.z, p);
+        p256_mont_mul(sum.z, sum.z, t, p);
+        p256_mont_mul(points[3].y, sum.y, sum.z, p);
+    }
+
+    // u1 * G + u2 * Q, from the most significant bit
+    memset(&sum, 0, sizeof(sum));
+    for (int bit = (P256_LIMBS * 32) - 1; bit >= 0; bit--)
+    {
+        p256_point_double(&sum, &sum);
+
+        bits = (int)((u1[bit / 32] >> (bit % 32)) & 1) | (int)(((u2[bit / 32] >> (bit % 32)) & 1) << 1);
+        if ((bits != 0) && ((bits != 3) || has_sum))
+        {
+            p256_point_add_affine(&sum, &sum, &points[bits], mont_one);
+        }
+    }
+
+    if (p256_is_zero(sum.z))
+    {
+        return false;
+    }
+
+    // x mod n == r, checked as X == r * Z^2 without an inversion, r < n < p
+    p256_mont_mul(sum.z, sum.z, sum.z, p);
+    p256_to_mont(t, r, p);
+    p256_mont_mul(t, t, sum.z, p);
+    if (p256_is_equal(t, sum.x))
+    {
+        return true;
+    }
+
+    // x may also be r + n when that is below p
+    if (p256_add_carry(r, r, n->m) || !p256_is_less(r, p->m))
+    {
+        return false;
+    }
+
+    p256_to_mont(t, r, p);
+    p256_mont_mul(t, t, sum.z, p);
+
+    return p256_is_equal(t, sum.x);
+}
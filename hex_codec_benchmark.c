@@ -0,0 +1,299 @@
+/**
+ * \file
+ * \brief Host Benchmark of the Firmware Hex Codec
+ *
+ * Times the kit protocol hex conversions of firmware v2.2.5 against the
+ * table-driven codec in utilities/hex_codec.c on a 3 KB credential sized
+ * buffer, after checking that both produce the same output.
+ *
+ * Build and run from the repository root:
+ *   gcc -O2 -I firmware/SAMG55/AWS_IoT_Zero_Touch_SAMG55/src/utilities \
+ *       hex_codec_benchmark.c \
+ *       firmware/SAMG55/AWS_IoT_Zero_Touch_SAMG55/src/utilities/hex_codec.c \
+ *       -o hex_codec_benchmark
+ *   ./hex_codec_benchmark
+ *
+ * \copyright (c) 2017-2019 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hex_codec.h"
+
+// Defines
+#define BENCHMARK_BINARY_SIZE      (3072)    // About the size of the credentials sent in one kit message
+#define BENCHMARK_ITERATIONS       (2000)
+#define BENCHMARK_RUNS             (50)      // Only the fastest run is reported, to filter out host noise
+#define BENCHMARK_CHECK_SIZE_MAX   (40)      // Every shorter length is checked for identical output
+
+
+/**
+ * \brief The v2.2.5 kit_protocol_convert_hex_to_nibble()
+ */
+static uint8_t old_convert_hex_to_nibble(uint8_t hex)
+{
+    if ((hex <= '9') && (hex >= '0'))
+    {
+        hex -= '0';
+    }
+    else if ((hex <= 'F' ) && (hex >= 'A'))
+    {
+        hex -= ('A' - 10);
+    }
+    else if ((hex <= 'f') && (hex >= 'a'))
+    {
+        hex -= ('a' - 10);
+    }
+    else
+    {
+        hex = 0;
+    }
+
+    return hex;
+}
+
+/**
+ * \brief The v2.2.5 kit_protocol_convert_nibble_to_hex()
+ */
+static uint8_t old_convert_nibble_to_hex(uint8_t nibble)
+{
+    nibble &= 0x0F;
+
+    if (nibble <= 0x09)
+    {
+        nibble += '0';
+    }
+    else
+    {
+        nibble += ('A' - 10);
+    }
+
+    return nibble;
+}
+
+/**
+ * \brief The v2.2.5 kit_protocol_convert_hex_to_binary()
+ */
+static uint16_t old_convert_hex_to_binary(uint16_t length, uint8_t *buffer)
+{
+    uint16_t index = 0;
+    uint16_t binary_index = 0;
+    uint8_t  hex = 0;
+
+    if ((buffer == NULL) || (length < 2))
+    {
+        return 0;
+    }
+
+    for (index = 0, binary_index = 0; index < length; index += 2, binary_index++)
+    {
+        hex = buffer[index];
+        buffer[binary_index]  = (old_convert_hex_to_nibble(hex) << 4);
+
+        hex = buffer[(index + 1)];
+        buffer[binary_index] |= old_convert_hex_to_nibble(hex);
+    }
+
+    return binary_index;
+}
+
+/**
+ * \brief The v2.2.5 kit_protocol_convert_binary_to_hex()
+ */
+static uint16_t old_convert_binary_to_hex(uint16_t length, uint8_t *buffer)
+{
+    const size_t hex_buffer_size = ((length * 2) + 1);
+
+    char     *hex_buffer = NULL;
+    uint16_t hex_length = 0;
+
+    if ((buffer == NULL) || (length == 0))
+    {
+        return 0;
+    }
+
+    // Allocate the memory needed for the ASCII hex buffer
+    hex_buffer = (char*)malloc(hex_buffer_size);
+    memset(hex_buffer, 0, hex_buffer_size);
+
+    for (uint16_t index = 0; index < length; index++)
+    {
+        hex_buffer[hex_length++] = (char)old_convert_nibble_to_hex((buffer[index] >> 4));
+        hex_buffer[hex_length++] = (char)old_convert_nibble_to_hex((buffer[index] & 0x0F));
+    }
+
+    // Save the ASCII hex buffer
+    memcpy(buffer, hex_buffer, hex_length);
+
+    // Free the allocated memory
+    free(hex_buffer);
+
+    return hex_length;
+}
+
+static double get_time_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e6) + (now.tv_nsec / 1e3);
+}
+
+/**
+ * \brief Checks that the old and the new conversions agree on every length
+ * up to BENCHMARK_CHECK_SIZE_MAX and on the benchmark buffer
+ */
+static int check_conversions(const uint8_t *binary)
+{
+    static uint8_t old_buffer[(2 * BENCHMARK_BINARY_SIZE) + 1];
+    static uint8_t new_buffer[(2 * BENCHMARK_BINARY_SIZE) + 1];
+    size_t lengths[BENCHMARK_CHECK_SIZE_MAX + 1];
+    size_t hex_length = 0;
+
+    for (size_t index = 0; index < BENCHMARK_CHECK_SIZE_MAX; index++)
+    {
+        lengths[index] = index;
+    }
+    lengths[BENCHMARK_CHECK_SIZE_MAX] = BENCHMARK_BINARY_SIZE;
+
+    for (size_t index = 0; index <= BENCHMARK_CHECK_SIZE_MAX; index++)
+    {
+        memcpy(old_buffer, binary, lengths[index]);
+        memcpy(new_buffer, binary, lengths[index]);
+        old_convert_binary_to_hex((uint16_t)lengths[index], old_buffer);
+        hex_codec_encode(new_buffer, lengths[index], (char*)new_buffer, true);
+        if (memcmp(old_buffer, new_buffer, 2 * lengths[index]) != 0)
+        {
+            printf("Encoding %zu bytes does not match\n", lengths[index]);
+            return 1;
+        }
+
+        // Odd digit counts too, the old decoder reads the null after the last digit
+        hex_length = (2 * lengths[index]) - (lengths[index] & 1);
+        if (hex_length < 2)
+        {
+            continue;
+        }
+        old_buffer[hex_length] = 0;
+        new_buffer[hex_length] = 0;
+        old_convert_hex_to_binary((uint16_t)hex_length, old_buffer);
+        hex_codec_decode((char*)new_buffer, hex_length, new_buffer);
+        if (memcmp(old_buffer, new_buffer, (hex_length + 1) / 2) != 0)
+        {
+            printf("Decoding %zu digits does not match\n", hex_length);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void old_encode(uint8_t *buffer)
+{
+    old_convert_binary_to_hex(BENCHMARK_BINARY_SIZE, buffer);
+}
+
+static void new_encode(uint8_t *buffer)
+{
+    hex_codec_encode(buffer, BENCHMARK_BINARY_SIZE, (char*)buffer, true);
+}
+
+static void old_decode(uint8_t *buffer)
+{
+    old_convert_hex_to_binary(2 * BENCHMARK_BINARY_SIZE, buffer);
+}
+
+static void new_decode(uint8_t *buffer)
+{
+    hex_codec_decode((char*)buffer, 2 * BENCHMARK_BINARY_SIZE, buffer);
+}
+
+/**
+ * \brief Times an in place conversion, every iteration starts from a fresh
+ * copy of the input
+ *
+ * \return The time of one conversion in the fastest run, in microseconds
+ */
+static double time_conversion(void (*convert)(uint8_t *buffer), const uint8_t *input, size_t input_size)
+{
+    static uint8_t buffer[(2 * BENCHMARK_BINARY_SIZE) + 1];
+    volatile uint32_t sink = 0;
+    double start = 0;
+    double best_us = 0;
+    double run_us = 0;
+
+    for (int run = 0; run < BENCHMARK_RUNS; run++)
+    {
+        start = get_time_us();
+        for (int iteration = 0; iteration < BENCHMARK_ITERATIONS; iteration++)
+        {
+            memcpy(buffer, input, input_size);
+            convert(buffer);
+            sink += buffer[iteration % BENCHMARK_BINARY_SIZE];
+        }
+        run_us = (get_time_us() - start) / BENCHMARK_ITERATIONS;
+
+        if ((run == 0) || (run_us < best_us))
+        {
+            best_us = run_us;
+        }
+    }
+
+    return best_us;
+}
+
+int main(void)
+{
+    static uint8_t binary[BENCHMARK_BINARY_SIZE];
+    static uint8_t hex[2 * BENCHMARK_BINARY_SIZE];
+    double old_us = 0;
+    double new_us = 0;
+
+    for (size_t index = 0; index < sizeof(binary); index++)
+    {
+        binary[index] = (uint8_t)((index * 131) + 7);
+    }
+    hex_codec_encode(binary, sizeof(binary), (char*)hex, true);
+
+    if (check_conversions(binary) != 0)
+    {
+        return 1;
+    }
+
+    old_us = time_conversion(&old_encode, binary, sizeof(binary));
+    new_us = time_conversion(&new_encode, binary, sizeof(binary));
+    printf("encode %u KB:      %.2f us -> %.2f us (%.1fx)\n",
+           BENCHMARK_BINARY_SIZE / 1024, old_us, new_us, old_us / new_us);
+
+    old_us = time_conversion(&old_decode, hex, sizeof(hex));
+    new_us = time_conversion(&new_decode, hex, sizeof(hex));
+    printf("decode %u KB hex:  %.2f us -> %.2f us (%.1fx)\n",
+           (2 * BENCHMARK_BINARY_SIZE) / 1024, old_us, new_us, old_us / new_us);
+
+    return 0;
+}
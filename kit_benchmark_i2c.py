@@ -0,0 +1,45 @@
+from argparse import ArgumentParser
+import hid
+from mchp_aws_zt_kit import MchpAwsZTKitDevice
+from aws_kit_common import *
+
+
+def kit_benchmark_i2c(slot=None, iterations=None):
+    print('\nOpening AWS Zero-touch Kit Device')
+    device = MchpAwsZTKitDevice(hid.device())
+    device.open()
+
+    print('\nTiming ATECCx08A Slot Reads')
+    result = device.benchmark_i2c(slot=slot, iterations=iterations)
+    print('    Slot %d, %d bytes, %d reads per speed' % (result['slot'], result['bytes'], result['iterations']))
+    for speed in result['speeds']:
+        if speed['status'] != 0:
+            print('    %4d kHz: failed with status 0x%02X' % (speed['baud'] / 1000, speed['status']))
+            continue
+        print('    %4d kHz: %5d ms, %6d bytes/s, SCL measured at %d kHz'
+              % (speed['baud'] / 1000, speed['ms'], speed['bytesPerSecond'], speed['sclHz'] / 1000))
+    print('    The kit runs at %d kHz' % (result['baud'] / 1000))
+
+    print('\nDone')
+
+
+if __name__ == '__main__':
+    # Create argument parser to document script use
+    parser = ArgumentParser(description='Measure the ATECCx08A I2C throughput at each bus speed')
+    parser.add_argument(
+        '--slot',
+        help='Data slot to read. Defaults to slot 8.',
+        type=int
+    )
+    parser.add_argument(
+        '--iterations',
+        help='Reads timed at each speed. Defaults to 10.',
+        type=int
+    )
+    args = parser.parse_args()
+
+    try:
+        kit_benchmark_i2c(slot=args.slot, iterations=args.iterations)
+    except AWSZTKitError as e:
+        # Print kit errors without a stack trace
+        print(e)
@@ -0,0 +1,100 @@
+from argparse import ArgumentParser
+import hashlib
+import struct
+import time
+import hid
+from mchp_aws_zt_kit import *
+from aws_kit_common import *
+
+# Largest image block in one kit message, FIRMWARE_UPDATE_BLOCK_SIZE_MAX in the firmware
+FWUPDATE_BLOCK_SIZE = 2048
+# Resident boot sector at the start of the .bin, FIRMWARE_UPDATE_BOOT_SIZE in the firmware.
+# It is never updated, the image sent to the kit is the application that follows it.
+FWUPDATE_BOOT_SIZE = 8192
+
+
+def check_progress(progress, step):
+    if progress['status'] != 0:
+        raise AWSZTKitError('Firmware update %s failed with kit status 0x%02X. Progress: %s'
+                            % (step, progress['status'], progress))
+    return progress
+
+
+def kit_fwupdate(image_file, switch=True, pipeline=True):
+    with open(image_file, 'rb') as f:
+        image = f.read()[FWUPDATE_BOOT_SIZE:]
+    if len(image) == 0:
+        raise AWSZTKitError('%s has no application after the boot sector' % image_file)
+    digest = hashlib.sha256(image).digest()
+
+    print('\nOpening AWS Zero-touch Kit Device')
+    device = MchpAwsZTKitDevice(hid.device())
+    device.open()
+
+    print('\nStarting Firmware Update')
+    print('    Image:   %s (%d bytes)' % (image_file, len(image)))
+    print('    SHA-256: %s' % binascii.b2a_hex(digest).decode('ascii'))
+    device.fwupdate_write(FWUPDATE_BEGIN, struct.pack('<I', len(image)) + digest)
+    check_progress(device.fwupdate_read(), 'begin')
+
+    print('\nWriting Image')
+    start = time.time()
+    outstanding = 0
+    for offset in range(0, len(image), FWUPDATE_BLOCK_SIZE):
+        device.fwupdate_write(FWUPDATE_WRITE, struct.pack('<I', offset) + image[offset:offset + FWUPDATE_BLOCK_SIZE])
+        outstanding += 1
+        # Keep the next block in flight while the kit writes the previous one
+        if outstanding > (1 if pipeline else 0):
+            progress = check_progress(device.fwupdate_read(), 'write')
+            outstanding -= 1
+    while outstanding > 0:
+        progress = check_progress(device.fwupdate_read(), 'write')
+        outstanding -= 1
+    elapsed = time.time() - start
+
+    print('    %d bytes in %.2f s, %.1f KB/s over HID' % (len(image), elapsed, len(image) / 1024.0 / elapsed))
+    print('    Kit: %d ms total, %d ms flash, %d ms SHA-256, %d sectors erased'
+          % (progress['elapsed_ms'], progress['flash_ms'], progress['hash_ms'], progress['erase_count']))
+
+    print('\nVerifying Image')
+    device.fwupdate_write(FWUPDATE_VERIFY)
+    check_progress(device.fwupdate_read(), 'verify')
+
+    if switch:
+        print('\nSwitching to the New Firmware')
+        device.fwupdate_write(FWUPDATE_SWITCH)
+        check_progress(device.fwupdate_read(), 'switch')
+        print('    The kit resets into the new firmware')
+
+    print('\nDone')
+
+
+if __name__ == '__main__':
+    # Create argument parser to document script use
+    parser = ArgumentParser(description='Update the demo board firmware over USB')
+    parser.add_argument(
+        '--image',
+        dest='image',
+        required=True,
+        metavar='file',
+        help='Firmware image (.bin)'
+    )
+    parser.add_argument(
+        '--no-switch',
+        dest='switch',
+        help='Write and verify the image, but keep running the current firmware.',
+        action='store_false'
+    )
+    parser.add_argument(
+        '--no-pipeline',
+        dest='pipeline',
+        help='Wait for every block to be written before sending the next one.',
+        action='store_false'
+    )
+    args = parser.parse_args()
+
+    try:
+        kit_fwupdate(image_file=args.image, switch=args.switch, pipeline=args.pipeline)
+    except AWSZTKitError as e:
+        # Print kit errors without a stack trace
+        print(e)
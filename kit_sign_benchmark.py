@@ -0,0 +1,60 @@
+from argparse import ArgumentParser
+import os
+import time
+import hid
+from mchp_aws_zt_kit import MchpAwsZTKitDevice
+from aws_kit_common import *
+
+# Most digests in one signBatch message, PROVISIONING_SIGN_BATCH_MAX in the firmware
+SIGN_BATCH_MAX = 20
+
+
+def sign_all(device, digests, batch_size):
+    signatures = []
+    kit_ms = 0
+    start = time.time()
+    for i in range(0, len(digests), batch_size):
+        batch_signatures, batch_ms = device.sign_batch(digests[i:i + batch_size])
+        signatures += batch_signatures
+        kit_ms += batch_ms
+    return signatures, time.time() - start, kit_ms
+
+
+def kit_sign_benchmark(count):
+    print('\nOpening AWS Zero-touch Kit Device')
+    device = MchpAwsZTKitDevice(hid.device())
+    device.open()
+
+    print('\nInitializing Kit')
+    resp = device.init()
+    print('    ATECCx08A SN: %s' % resp['deviceSn'])
+
+    digests = [os.urandom(32) for i in range(count)]
+
+    print('\nSigning %d Digests' % count)
+    for batch_size in (1, SIGN_BATCH_MAX):
+        signatures, elapsed, kit_ms = sign_all(device, digests, batch_size)
+        if len(signatures) != count:
+            raise AWSZTKitError('Expected %d signatures, received %d' % (count, len(signatures)))
+        print('    %2d per message: %6.1f signatures/s over USB, %6.1f ms per signature on the kit'
+              % (batch_size, count / elapsed, kit_ms / count))
+
+    print('\nDone')
+
+
+if __name__ == '__main__':
+    # Create argument parser to document script use
+    parser = ArgumentParser(description='Measure the signatures per second of the signBatch method over USB')
+    parser.add_argument(
+        '--count',
+        help='Digests to sign. Defaults to 100.',
+        type=int,
+        default=100
+    )
+    args = parser.parse_args()
+
+    try:
+        kit_sign_benchmark(count=args.count)
+    except AWSZTKitError as e:
+        # Print kit errors without a stack trace
+        print(e)
@@ -1,11 +1,39 @@
 import re
 import binascii
 import json
+import struct
 
 DEVICE_HID_VID = 0x04d8
 DEVICE_HID_PID = 0x0f32
 KIT_VERSION = "2.0.0"
 
+# board:fwupdate commands, see enum firmware_update_command in the firmware
+FWUPDATE_BEGIN  = 0x00
+FWUPDATE_WRITE  = 0x01
+FWUPDATE_VERIFY = 0x02
+FWUPDATE_SWITCH = 0x03
+FWUPDATE_STATUS = 0x04
+# Reply fields, see struct firmware_update_stats in the firmware
+FWUPDATE_PROGRESS_FIELDS = ('state', 'image_size', 'bytes_written', 'erase_count',
+                            'elapsed_ms', 'flash_ms', 'hash_ms')
+
+def atca_crc16(data):
+    """CRC-16 of an ATECCx08A packet (polynomial 0x8005, data bits LSB first), little endian."""
+    crc = 0
+    for byte in data:
+        for bit in range(8):
+            data_bit = (byte >> bit) & 1
+            crc_bit = crc >> 15
+            crc = (crc << 1) & 0xFFFF
+            if data_bit != crc_bit:
+                crc ^= 0x8005
+    return struct.pack('<H', crc)
+
+def atca_packet(opcode, param1, param2, data=b''):
+    """Build a raw ATECCx08A command packet: count, opcode, param1, param2, data and CRC."""
+    packet = struct.pack('<BBBH', 7 + len(data), opcode, param1, param2) + data
+    return packet + atca_crc16(packet)
+
 #class MchpAwsZTKitDevice(hid.device):
 class MchpAwsZTKitDevice():
     def __init__(self, device):
@@ -132,6 +160,71 @@ class MchpAwsZTKitDevice():
         resp = self.kit_read_app_no_error(id)
         return resp['result']
 
+    def benchmark_i2c(self, slot=None, iterations=None):
+        """Time ATECCx08A slot reads at each I2C speed the kit supports."""
+        params = {}
+        if slot is not None:
+            params['slot'] = slot
+        if iterations is not None:
+            params['iterations'] = iterations
+        id = self.kit_write_app('benchmarkI2c', params)
+        resp = self.kit_read_app_no_error(id)
+        return resp['result']
+
+    def set_verify_mode(self, mode):
+        """Choose where the kit verifies the AWS server certificate chain:
+           'atecc', 'software' or 'auto' to benchmark both on the next TLS
+           connection. Returns the verify statistics."""
+        id = self.kit_write_app('setVerifyMode', {'mode': mode})
+        resp = self.kit_read_app_no_error(id)
+        return resp['result']['ecc_verify']
+
+    def sign_batch(self, digests):
+        """Sign 32-byte digests with the device key, back to back in one kit
+           message. Returns the 64-byte signatures (R and S) and the time the
+           kit took in ms."""
+        params = {'digests': binascii.b2a_hex(b''.join(digests)).decode('ascii')}
+        id = self.kit_write_app('signBatch', params)
+        resp = self.kit_read_app_no_error(id)
+        data = binascii.a2b_hex(resp['result']['signatures'])
+        return [data[i:i + 64] for i in range(0, len(data), 64)], resp['result']['ms']
+
+    def get_stats(self):
+        """Get the RTOS task, stack and heap statistics of the kit."""
+        self.kit_write('board:stats', b'')
+        data = self.kit_read()
+        kit_resp = self.parse_kit_reply(data)
+        if kit_resp['status'] != 0:
+            raise RuntimeError('Kit protocol error. Received reply %s' % data)
+        return json.loads(binascii.a2b_hex(kit_resp['data']).decode('ascii'))
+
+    def fwupdate_write(self, command, data=b''):
+        """Send a firmware update command without waiting for its reply, so the
+           next one can be sent while the kit handles this one."""
+        self.kit_write('board:fwupdate', bytes([command]) + data)
+
+    def fwupdate_read(self):
+        """Read the reply to a firmware update command, it carries the update progress."""
+        data = self.kit_read()
+        kit_resp = self.parse_kit_reply(data)
+        fields = struct.unpack('<%dI' % len(FWUPDATE_PROGRESS_FIELDS), binascii.a2b_hex(kit_resp['data']))
+        progress = dict(zip(FWUPDATE_PROGRESS_FIELDS, fields))
+        progress['status'] = kit_resp['status']
+        return progress
+
+    def device_talk_batch(self, packets):
+        """Execute raw ATECCx08A command packets back to back on the kit, in one
+           USB round trip. Returns the kit status and the response packet of each
+           executed command, the kit stops at the first failure."""
+        self.kit_write('device:talk_batch', b''.join(packets))
+        kit_resp = self.parse_kit_reply(self.kit_read())
+        data = binascii.a2b_hex(kit_resp['data'])
+        responses = []
+        while len(data) > 0 and data[0] > 0:
+            responses.append(data[:data[0]])
+            data = data[data[0]:]
+        return kit_resp['status'], responses
+
 class MchpAwsZTKitError(Exception):
     def __init__(self, error_info):
         self.error_code = error_info['error_code']